@@ -60,6 +60,7 @@
 #include "../source/ff.application/graphics/dxgi/format_util.h"
 #include "../source/ff.application/graphics/dxgi/palette_base.h"
 #include "../source/ff.application/graphics/dxgi/palette_data_base.h"
+#include "../source/ff.application/graphics/dxgi/recording_draw_device.h"
 #include "../source/ff.application/graphics/dxgi/sprite_data.h"
 #include "../source/ff.application/graphics/dxgi/target_access_base.h"
 #include "../source/ff.application/graphics/dxgi/target_base.h"
@@ -74,6 +75,7 @@
 #include "../source/ff.application/graphics/resource/animation_keys.h"
 #include "../source/ff.application/graphics/resource/animation_player.h"
 #include "../source/ff.application/graphics/resource/animation_player_base.h"
+#include "../source/ff.application/graphics/resource/animation_system.h"
 #include "../source/ff.application/graphics/resource/palette_cycle.h"
 #include "../source/ff.application/graphics/resource/palette_data.h"
 #include "../source/ff.application/graphics/resource/png_image.h"
@@ -99,6 +101,7 @@
 #include "../source/ff.application/graphics/types/viewport.h"
 
 #include "../source/ff.application/graphics/write/font_file.h"
+#include "../source/ff.application/graphics/write/truetype_font.h"
 #include "../source/ff.application/graphics/write/write.h"
 
 #include "../source/ff.application/input/gamepad_device.h"
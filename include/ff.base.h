@@ -50,13 +50,16 @@
 #include "../source/ff.base/resource/auto_resource.h"
 #include "../source/ff.base/resource/global_resources.h"
 #include "../source/ff.base/resource/resource.h"
+#include "../source/ff.base/resource/resource_build_cache.h"
 #include "../source/ff.base/resource/resource_file.h"
 #include "../source/ff.base/resource/resource_load.h"
 #include "../source/ff.base/resource/resource_load_context.h"
+#include "../source/ff.base/resource/resource_load_trace.h"
 #include "../source/ff.base/resource/resource_object_base.h"
 #include "../source/ff.base/resource/resource_object_factory_base.h"
 #include "../source/ff.base/resource/resource_object_provider.h"
 #include "../source/ff.base/resource/resource_objects.h"
+#include "../source/ff.base/resource/resource_prefetch.h"
 #include "../source/ff.base/resource/resource_value_provider.h"
 #include "../source/ff.base/resource/resource_values.h"
 
@@ -64,6 +67,7 @@
 #include "../source/ff.base/thread/co_exceptions.h"
 #include "../source/ff.base/thread/co_task.h"
 #include "../source/ff.base/thread/thread_dispatch.h"
+#include "../source/ff.base/thread/task_graph.h"
 #include "../source/ff.base/thread/thread_pool.h"
 
 #include "../source/ff.base/types/fixed.h"
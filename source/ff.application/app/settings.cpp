@@ -60,8 +60,9 @@ bool ff::internal::app::save_settings()
         std::filesystem::path settings_path = ::settings_path();
         ff::log::write(ff::log::type::application, "Save settings: ", ff::filesystem::to_string(settings_path), "\r\n", ::named_settings);
 
-        ff::file_writer writer(settings_path);
-        if (!::named_settings.save(writer))
+        ff::file_writer file_writer(settings_path);
+        ff::buffered_writer writer(file_writer);
+        if (!::named_settings.save(writer) || !writer.flush())
         {
             assert(false);
             return false;
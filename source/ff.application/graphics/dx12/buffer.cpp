@@ -209,11 +209,7 @@ void* ff::dx12::buffer_gpu::map(ff::dxgi::command_context_base& context, size_t
     assert_ret_val(size, nullptr);
     assert_msg(!this->mapped_memory, "Forgot to unmap buffer");
 
-    if (size > this->size())
-    {
-        CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(std::max(this->size() * 2, size));
-        this->resource_ = std::make_unique<ff::dx12::resource>("Buffer", std::shared_ptr<ff::dx12::mem_range>(), desc);
-    }
+    this->ensure_size(size);
 
     ff::dx12::commands& commands = ff::dx12::commands::get(context);
     this->mapped_memory = ff::dx12::upload_allocator().alloc_buffer(size, commands.next_fence_value());
@@ -231,6 +227,54 @@ void ff::dx12::buffer_gpu::unmap(ff::dxgi::command_context_base& context)
     this->mapped_memory = {};
 }
 
+void* ff::dx12::buffer_gpu::map_chunk(ff::dxgi::command_context_base& context, size_t size, size_t& chunk_id)
+{
+    assert_ret_val(size, nullptr);
+
+    // The upload ring won't reuse this memory until the GPU is done with the commands for this fence value
+    ff::dx12::commands& commands = ff::dx12::commands::get(context);
+    ff::dx12::mem_range range = ff::dx12::upload_allocator().alloc_buffer(size, commands.next_fence_value());
+    assert_ret_val(range, nullptr);
+
+    chunk_id = this->mapped_chunks.size();
+    this->mapped_chunks.push_back(std::move(range));
+    return this->mapped_chunks.back().cpu_data();
+}
+
+bool ff::dx12::buffer_gpu::unmap_chunks(ff::dxgi::command_context_base& context, size_t buffer_size, const ff::dxgi::buffer_chunk_t* chunks, size_t chunk_count)
+{
+    if (buffer_size)
+    {
+        this->ensure_size(buffer_size);
+
+        ff::dx12::commands& commands = ff::dx12::commands::get(context);
+        for (const ff::dxgi::buffer_chunk_t& chunk : std::span(chunks, chunk_count))
+        {
+            assert(chunk.chunk_id < this->mapped_chunks.size() && chunk.offset + chunk.size <= buffer_size);
+
+            if (chunk.size)
+            {
+                commands.update_buffer(*this->resource_, chunk.offset, this->mapped_chunks[chunk.chunk_id], chunk.size);
+            }
+        }
+
+        this->data_hash = 0;
+        this->version_++;
+    }
+
+    this->mapped_chunks.clear();
+    return buffer_size && this->valid();
+}
+
+void ff::dx12::buffer_gpu::ensure_size(size_t size)
+{
+    if (size > this->size())
+    {
+        CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(std::max(this->size() * 2, size));
+        this->resource_ = std::make_unique<ff::dx12::resource>("Buffer", std::shared_ptr<ff::dx12::mem_range>(), desc);
+    }
+}
+
 ff::dx12::buffer_cpu::buffer_cpu(ff::dxgi::buffer_type type)
     : ff::dx12::buffer_base(type)
 {
@@ -107,10 +107,15 @@ namespace ff::dx12
         virtual bool update(ff::dxgi::command_context_base& context, const void* data, size_t size) override;
         virtual void* map(ff::dxgi::command_context_base& context, size_t size) override;
         virtual void unmap(ff::dxgi::command_context_base& context) override;
+        virtual void* map_chunk(ff::dxgi::command_context_base& context, size_t size, size_t& chunk_id) override;
+        virtual bool unmap_chunks(ff::dxgi::command_context_base& context, size_t buffer_size, const ff::dxgi::buffer_chunk_t* chunks, size_t chunk_count) override;
 
     private:
+        void ensure_size(size_t size);
+
         std::unique_ptr<ff::dx12::resource> resource_;
         ff::dx12::mem_range mapped_memory;
+        std::vector<ff::dx12::mem_range> mapped_chunks;
         size_t data_hash{};
         size_t version_{ 1 };
     };
@@ -445,11 +445,16 @@ void ff::dx12::commands::discard_target(ff::dx12::resource& resource)
 
 void ff::dx12::commands::update_buffer(ff::dx12::resource& dest, uint64_t dest_offset, ff::dx12::mem_range& source)
 {
-    assert(source.heap() && source.heap()->cpu_usage());
+    this->update_buffer(dest, dest_offset, source, source.size());
+}
+
+void ff::dx12::commands::update_buffer(ff::dx12::resource& dest, uint64_t dest_offset, ff::dx12::mem_range& source, uint64_t source_size)
+{
+    assert(source.heap() && source.heap()->cpu_usage() && source_size <= source.size());
 
     this->keep_resident(source);
     this->resource_state(dest, D3D12_RESOURCE_STATE_COPY_DEST);
-    this->list()->CopyBufferRegion(ff::dx12::get_resource(dest), dest_offset, ff::dx12::get_resource(*source.heap()), source.start(), source.size());
+    this->list()->CopyBufferRegion(ff::dx12::get_resource(dest), dest_offset, ff::dx12::get_resource(*source.heap()), source.start(), source_size);
 }
 
 void ff::dx12::commands::readback_buffer(ff::dx12::mem_range& dest, ff::dx12::resource& source, uint64_t source_offset)
@@ -110,6 +110,7 @@ namespace ff::dx12
         void discard_target(ff::dx12::resource& resource);
 
         void update_buffer(ff::dx12::resource& dest, uint64_t dest_offset, ff::dx12::mem_range& source);
+        void update_buffer(ff::dx12::resource& dest, uint64_t dest_offset, ff::dx12::mem_range& source, uint64_t source_size);
         void readback_buffer(ff::dx12::mem_range& dest, ff::dx12::resource& source, uint64_t source_offset);
 
         void update_texture(ff::dx12::resource& dest, size_t dest_sub_index, ff::point_size dest_pos, ff::dx12::mem_range& source, const D3D12_SUBRESOURCE_FOOTPRINT& source_layout);
@@ -523,6 +523,11 @@ namespace
             return this->internal_valid();
         }
 
+        virtual size_t culled_count() const override
+        {
+            return this->internal_culled_count();
+        }
+
         virtual ff::dxgi::draw_ptr begin_draw(
             ff::dxgi::command_context_base& context,
             ff::dxgi::target_base& target,
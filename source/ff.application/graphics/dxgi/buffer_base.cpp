@@ -12,3 +12,14 @@ std::string_view ff::dxgi::buffer_type_name(ff::dxgi::buffer_type type)
         case ff::dxgi::buffer_type::constant: return "constant";
     }
 }
+
+void* ff::dxgi::buffer_base::map_chunk(ff::dxgi::command_context_base& context, size_t size, size_t& chunk_id)
+{
+    return nullptr;
+}
+
+bool ff::dxgi::buffer_base::unmap_chunks(ff::dxgi::command_context_base& context, size_t buffer_size, const ff::dxgi::buffer_chunk_t* chunks, size_t chunk_count)
+{
+    assert(!chunk_count);
+    return false;
+}
@@ -14,6 +14,13 @@ namespace ff::dxgi
 
     std::string_view buffer_type_name(ff::dxgi::buffer_type type);
 
+    struct buffer_chunk_t
+    {
+        size_t chunk_id; // from map_chunk
+        size_t offset; // where it goes in the buffer
+        size_t size; // bytes used in the chunk
+    };
+
     class buffer_base
     {
     public:
@@ -25,5 +32,11 @@ namespace ff::dxgi
         virtual bool update(ff::dxgi::command_context_base& context, const void* data, size_t size) = 0;
         virtual void* map(ff::dxgi::command_context_base& context, size_t size) = 0;
         virtual void unmap(ff::dxgi::command_context_base& context) = 0;
+
+        // Optional: chunks of upload memory can be written before knowing where they go in the buffer,
+        // then unmap_chunks copies them into place without the CPU touching the data again.
+        // map_chunk returns nullptr when not supported.
+        virtual void* map_chunk(ff::dxgi::command_context_base& context, size_t size, size_t& chunk_id);
+        virtual bool unmap_chunks(ff::dxgi::command_context_base& context, size_t buffer_size, const ff::dxgi::buffer_chunk_t* chunks, size_t chunk_count);
     };
 }
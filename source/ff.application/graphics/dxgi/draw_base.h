@@ -9,6 +9,11 @@ namespace ff
     struct transform;
 }
 
+namespace ff::dxgi::draw_util
+{
+    class draw_recorder;
+}
+
 namespace ff::dxgi
 {
     class command_context_base;
@@ -30,6 +35,16 @@ namespace ff::dxgi
         ff::fixed_int size{};
     };
 
+    // Arrays for drawing lots of sprites at once, the positions decide how many sprites get drawn
+    struct sprite_batch_t
+    {
+        std::span<const ff::dxgi::sprite_data* const> sprites; // one for all, or one per position
+        std::span<const ff::point_float> positions;
+        std::span<const ff::point_float> scales; // empty for (1, 1), one for all, or one per position
+        std::span<const float> rotations; // degrees CCW, empty for zero, one for all, or one per position
+        std::span<const ff::color> colors; // empty for white, one for all, or one per position
+    };
+
     class draw_base
     {
     public:
@@ -41,10 +56,13 @@ namespace ff::dxgi
 
         // Core drawing
         virtual void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform) = 0;
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms) = 0;
+        virtual void draw_sprites(const ff::dxgi::sprite_batch_t& batch) = 0;
         virtual void draw_lines(std::span<const ff::dxgi::endpoint_t> points) = 0;
         virtual void draw_triangles(std::span<const ff::dxgi::endpoint_t> points) = 0;
         virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness = std::nullopt) = 0;
         virtual void draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness = std::nullopt, const ff::color* outside_color = nullptr) = 0;
+        virtual void draw_recorded(const ff::dxgi::draw_util::draw_recorder& recorder) = 0; // relative to the current world matrix
 
         // Pixel drawing, converts to core drawing
         void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::pixel_transform& transform);
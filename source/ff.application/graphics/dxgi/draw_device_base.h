@@ -13,6 +13,7 @@ namespace ff::dxgi
         none = 0x00,
         pre_multiplied_alpha = 0x01,
         ignore_rotation = 0x02,
+        no_culling = 0x04,
     };
 
     class draw_device_base
@@ -21,6 +22,7 @@ namespace ff::dxgi
         virtual ~draw_device_base() = default;
 
         virtual bool valid() const = 0;
+        virtual size_t culled_count() const = 0; // instances skipped by the last begin_draw for being outside of world_rect
 
         virtual ff::dxgi::draw_ptr begin_draw(
             ff::dxgi::command_context_base& context,
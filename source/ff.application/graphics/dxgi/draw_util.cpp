@@ -66,6 +66,71 @@ static ::alpha_type get_alpha_type(const ff::dxgi::sprite_data& data, float alph
     }
 }
 
+namespace
+{
+    struct transform_sprite_source
+    {
+        const ff::dxgi::sprite_data* sprite(size_t i) const
+        {
+            return this->sprites[(this->sprites.size() == 1) ? 0 : i];
+        }
+
+        const ff::point_float& position(size_t i) const
+        {
+            return this->transforms[i].position;
+        }
+
+        const ff::point_float& scale(size_t i) const
+        {
+            return this->transforms[i].scale;
+        }
+
+        float rotation_radians(size_t i) const
+        {
+            return this->transforms[i].rotation_radians();
+        }
+
+        const ff::color& color(size_t i) const
+        {
+            return this->transforms[i].color;
+        }
+
+        std::span<const ff::dxgi::sprite_data* const> sprites;
+        std::span<const ff::transform> transforms;
+    };
+
+    struct batch_sprite_source
+    {
+        const ff::dxgi::sprite_data* sprite(size_t i) const
+        {
+            return this->batch.sprites[(this->batch.sprites.size() == 1) ? 0 : i];
+        }
+
+        const ff::point_float& position(size_t i) const
+        {
+            return this->batch.positions[i];
+        }
+
+        const ff::point_float& scale(size_t i) const
+        {
+            static const ff::point_float default_scale(1, 1);
+            return this->batch.scales.empty() ? default_scale : this->batch.scales[(this->batch.scales.size() == 1) ? 0 : i];
+        }
+
+        float rotation_radians(size_t i) const
+        {
+            return this->batch.rotations.empty() ? 0.0f : ff::math::degrees_to_radians(this->batch.rotations[(this->batch.rotations.size() == 1) ? 0 : i]);
+        }
+
+        const ff::color& color(size_t i) const
+        {
+            return this->batch.colors.empty() ? ff::color_white() : this->batch.colors[(this->batch.colors.size() == 1) ? 0 : i];
+        }
+
+        const ff::dxgi::sprite_batch_t& batch;
+    };
+}
+
 static ff::dxgi::remap_t default_palette_remap()
 {
     static std::array<uint8_t, ff::dxgi::palette_size> value
@@ -98,6 +163,7 @@ ffdu::instance_bucket::instance_bucket(ffdu::instance_bucket_type bucket_type, c
     , item_type_(item_type)
     , item_size_(item_size)
     , item_align(item_align)
+    , next_chunk_size(item_size * ffdu::MIN_INSTANCE_BUCKET_COUNT)
 {
 }
 
@@ -106,10 +172,19 @@ ffdu::instance_bucket::instance_bucket(ffdu::instance_bucket&& rhs) noexcept
     , item_type_(rhs.item_type_)
     , item_size_(rhs.item_size_)
     , item_align(rhs.item_align)
+    , chunks(std::move(rhs.chunks))
+    , spare_chunk(rhs.spare_chunk)
+    , direct_buffer_(rhs.direct_buffer_)
+    , direct_context(rhs.direct_context)
+    , full_chunks_byte_size(rhs.full_chunks_byte_size)
+    , next_chunk_size(rhs.next_chunk_size)
     , data_start(rhs.data_start)
     , data_cur(rhs.data_cur)
     , data_end(rhs.data_end)
 {
+    rhs.chunks.clear();
+    rhs.spare_chunk = {};
+    rhs.full_chunks_byte_size = 0;
     rhs.data_start = nullptr;
     rhs.data_cur = nullptr;
     rhs.data_end = nullptr;
@@ -117,26 +192,33 @@ ffdu::instance_bucket::instance_bucket(ffdu::instance_bucket&& rhs) noexcept
 
 ffdu::instance_bucket::~instance_bucket()
 {
-    ::_aligned_free(this->data_start);
+    this->reset();
 }
 
 void ffdu::instance_bucket::reset()
 {
-    ::_aligned_free(this->data_start);
-    this->data_start = nullptr;
-    this->data_cur = nullptr;
-    this->data_end = nullptr;
+    this->clear_items();
+
+    ::_aligned_free(this->spare_chunk.data);
+    this->spare_chunk = {};
+    this->next_chunk_size = this->item_size_ * ffdu::MIN_INSTANCE_BUCKET_COUNT;
+    this->direct_buffer_ = nullptr;
+    this->direct_context = nullptr;
+}
+
+void ffdu::instance_bucket::direct_buffer(ff::dxgi::buffer_base* buffer, ff::dxgi::command_context_base* context)
+{
+    // Chunks from a buffer belong to the context that was used to map them, so a new context can't reuse them
+    assert(!this->chunks.size() || !buffer || context == this->direct_context);
+    this->direct_buffer_ = context ? buffer : nullptr;
+    this->direct_context = buffer ? context : nullptr;
 }
 
 void* ffdu::instance_bucket::add()
 {
     if (this->data_cur == this->data_end)
     {
-        size_t cur_size = this->data_end - this->data_start;
-        size_t new_size = std::max<size_t>(cur_size * 2, this->item_size_ * ffdu::MIN_INSTANCE_BUCKET_COUNT);
-        this->data_start = reinterpret_cast<uint8_t*>(_aligned_realloc(this->data_start, new_size, this->item_align));
-        this->data_cur = this->data_start + cur_size;
-        this->data_end = this->data_start + new_size;
+        this->add_chunk();
     }
 
     void* result = this->data_cur;
@@ -166,22 +248,126 @@ bool ffdu::instance_bucket::is_transparent() const
 
 size_t ffdu::instance_bucket::count() const
 {
-    return (this->data_cur - this->data_start) / this->item_size_;
+    return this->byte_size() / this->item_size_;
 }
 
 void ffdu::instance_bucket::clear_items()
 {
-    this->data_cur = this->data_start;
+    const size_t used_size = this->byte_size();
+
+    for (ffdu::instance_bucket::chunk_t& chunk : this->chunks)
+    {
+        if (chunk.buffer_chunk_id != ff::constants::invalid_unsigned<size_t>())
+        {
+            // Buffer memory is owned by the buffer
+        }
+        else if (!this->spare_chunk.data && this->chunks.size() == 1)
+        {
+            this->spare_chunk = chunk;
+            this->spare_chunk.used_size = 0;
+        }
+        else
+        {
+            ::_aligned_free(chunk.data);
+        }
+    }
+
+    // Next time, start with one chunk that's big enough for everything
+    if (this->chunks.size() > 1)
+    {
+        this->next_chunk_size = std::min(std::max(this->next_chunk_size, ff::math::round_up(used_size, this->item_size_)), ffdu::MAX_INSTANCE_CHUNK_SIZE);
+    }
+
+    this->chunks.clear();
+    this->full_chunks_byte_size = 0;
+    this->data_start = nullptr;
+    this->data_cur = nullptr;
+    this->data_end = nullptr;
 }
 
 size_t ffdu::instance_bucket::byte_size() const
 {
-    return this->data_cur - this->data_start;
+    return this->full_chunks_byte_size + (this->data_cur - this->data_start);
+}
+
+void ffdu::instance_bucket::copy_to(uint8_t* data) const
+{
+    const_cast<ffdu::instance_bucket*>(this)->update_current_chunk();
+
+    for (const ffdu::instance_bucket::chunk_t& chunk : this->chunks)
+    {
+        std::memcpy(data, chunk.data, chunk.used_size);
+        data += chunk.used_size;
+    }
 }
 
-const uint8_t* ffdu::instance_bucket::data() const
+bool ffdu::instance_bucket::buffer_chunks(std::vector<ff::dxgi::buffer_chunk_t>& chunks)
 {
-    return this->data_start;
+    this->update_current_chunk();
+
+    for (size_t offset = this->render_start_ * this->item_size_; ffdu::instance_bucket::chunk_t& chunk : this->chunks)
+    {
+        size_t buffer_chunk_id = chunk.buffer_chunk_id;
+
+        if (buffer_chunk_id == ff::constants::invalid_unsigned<size_t>() && chunk.used_size)
+        {
+            void* data = this->direct_buffer_ ? this->direct_buffer_->map_chunk(*this->direct_context, chunk.used_size, buffer_chunk_id) : nullptr;
+            check_ret_val(data, false);
+            std::memcpy(data, chunk.data, chunk.used_size);
+        }
+
+        chunks.push_back(ff::dxgi::buffer_chunk_t{ buffer_chunk_id, offset, chunk.used_size });
+        offset += chunk.used_size;
+    }
+
+    return true;
+}
+
+void ffdu::instance_bucket::add_chunk()
+{
+    this->update_current_chunk();
+    this->full_chunks_byte_size = this->byte_size();
+
+    ffdu::instance_bucket::chunk_t chunk{ nullptr, this->next_chunk_size, 0, ff::constants::invalid_unsigned<size_t>() };
+    if (!this->chunks.empty())
+    {
+        chunk.size = std::min(this->chunks.back().size * 2, std::max(ffdu::MAX_INSTANCE_CHUNK_SIZE, this->item_size_));
+    }
+
+    if (this->direct_buffer_)
+    {
+        chunk.data = reinterpret_cast<uint8_t*>(this->direct_buffer_->map_chunk(*this->direct_context, chunk.size, chunk.buffer_chunk_id));
+    }
+
+    if (!chunk.data)
+    {
+        chunk.buffer_chunk_id = ff::constants::invalid_unsigned<size_t>();
+
+        if (this->spare_chunk.data && this->spare_chunk.size >= chunk.size)
+        {
+            chunk = this->spare_chunk;
+            this->spare_chunk = {};
+        }
+        else
+        {
+            ::_aligned_free(this->spare_chunk.data);
+            this->spare_chunk = {};
+            chunk.data = reinterpret_cast<uint8_t*>(::_aligned_malloc(chunk.size, this->item_align));
+        }
+    }
+
+    this->chunks.push_back(chunk);
+    this->data_start = chunk.data;
+    this->data_cur = chunk.data;
+    this->data_end = chunk.data + chunk.size / this->item_size_ * this->item_size_;
+}
+
+void ffdu::instance_bucket::update_current_chunk()
+{
+    if (!this->chunks.empty())
+    {
+        this->chunks.back().used_size = this->data_cur - this->data_start;
+    }
 }
 
 void ffdu::instance_bucket::render_start(size_t start)
@@ -200,6 +386,124 @@ size_t ffdu::instance_bucket::render_count() const
     return this->render_count_;
 }
 
+// Conservative bounds of a sprite after it's scaled, rotated, and moved to its position
+static ff::rect_float get_sprite_bounds(const ff::rect_float& sprite_rect, const ff::point_float& position, const ff::point_float& scale, float rotation)
+{
+    ff::rect_float rect(sprite_rect.left * scale.x, sprite_rect.top * scale.y, sprite_rect.right * scale.x, sprite_rect.bottom * scale.y);
+
+    if (rotation)
+    {
+        const float x = std::max(std::abs(rect.left), std::abs(rect.right));
+        const float y = std::max(std::abs(rect.top), std::abs(rect.bottom));
+        const float radius = std::sqrt(x * x + y * y);
+        rect = ff::rect_float(-radius, -radius, radius, radius);
+    }
+
+    return rect.normalize().offset(position);
+}
+
+static ff::rect_float get_point_bounds(std::span<const ff::dxgi::endpoint_t> points, float& max_thickness)
+{
+    ff::rect_float rect(points.front().pos, points.front().pos);
+    max_thickness = 0;
+
+    for (const ff::dxgi::endpoint_t& point : points)
+    {
+        rect.left = std::min(rect.left, point.pos.x);
+        rect.top = std::min(rect.top, point.pos.y);
+        rect.right = std::max(rect.right, point.pos.x);
+        rect.bottom = std::max(rect.bottom, point.pos.y);
+        max_thickness = std::max(max_thickness, std::abs(point.size));
+    }
+
+    return rect;
+}
+
+// Returns false if there is nothing to draw
+static bool get_rectangle_outline(const ff::rect_float& rect, std::optional<float> thickness, ff::rect_float& rect_out, float& thickness_out)
+{
+    rect_out = rect.normalize();
+    thickness_out = 0;
+    check_ret_val(rect_out.area(), false);
+
+    if (thickness.has_value())
+    {
+        thickness_out = thickness.value();
+        check_ret_val(thickness_out, false);
+
+        if (thickness_out < 0)
+        {
+            rect_out = rect_out.deflate(thickness_out, thickness_out);
+            thickness_out = -thickness_out;
+        }
+
+        if (thickness_out * 2 >= rect_out.width() || thickness_out * 2 >= rect_out.height())
+        {
+            thickness_out = 0;
+        }
+    }
+
+    return true;
+}
+
+// Returns false if there is nothing to draw
+static bool get_circle_outline(float radius, std::optional<float> thickness, float& radius_out, float& thickness_out)
+{
+    radius_out = std::abs(radius);
+    thickness_out = 0;
+
+    if (thickness.has_value())
+    {
+        thickness_out = thickness.value();
+        check_ret_val(thickness_out, false);
+
+        if (thickness_out < 0)
+        {
+            radius_out += thickness_out;
+            thickness_out = -thickness_out;
+        }
+
+        if (thickness_out >= radius_out)
+        {
+            thickness_out = 0;
+        }
+    }
+
+    return true;
+}
+
+static void fill_line_instance(ffdu::line_instance& instance, std::span<const ff::dxgi::endpoint_t> points, size_t i, bool closed, const ff::color& color0, const ff::color& color1, const uint8_t* palette_remap)
+{
+    const size_t count = points.size();
+    const ff::dxgi::endpoint_t& p0 = points[i];
+    const ff::dxgi::endpoint_t& p1 = points[i + 1];
+
+    instance.start = ff::dxgi::cast_point(p0.pos);
+    instance.end = ff::dxgi::cast_point(p1.pos);
+    instance.before_start = ff::dxgi::cast_point((i == 0) ? (closed ? points[count - 2].pos : p0.pos) : points[i - 1].pos);
+    instance.after_end = ff::dxgi::cast_point((i == count - 2) ? (closed ? points[1].pos : p1.pos) : points[i + 2].pos);
+    instance.start_color = color0.to_shader_color(palette_remap);
+    instance.end_color = color1.to_shader_color(palette_remap);
+    instance.start_thickness = std::abs(p0.size);
+    instance.end_thickness = std::abs(p1.size);
+}
+
+static void fill_triangle_instance(ffdu::triangle_instance& instance, const ff::dxgi::endpoint_t* points, const ff::color* const* colors, const uint8_t* palette_remap)
+{
+    for (size_t i = 0; i < 3; i++)
+    {
+        instance.position[i] = ff::dxgi::cast_point(points[i].pos);
+        instance.color[i] = colors[i]->to_shader_color(palette_remap);
+    }
+}
+
+static ffdu::instance_bucket_type opaque_bucket_type(ffdu::instance_bucket_type type)
+{
+    return (type >= ffdu::instance_bucket_type::first_transparent)
+        ? static_cast<ffdu::instance_bucket_type>(static_cast<size_t>(type) - static_cast<size_t>(ffdu::instance_bucket_type::first_transparent))
+        : type;
+}
+
 static const DirectX::XMMATRIX& get_rotate_matrix(int dmod, bool ignore_rotate)
 {
     static const DirectX::XMFLOAT4X4A rotate_0(
@@ -226,51 +530,521 @@ static const DirectX::XMMATRIX& get_rotate_matrix(int dmod, bool ignore_rotate)
         0, 0, 1, 0,
         1, -1, 0, 1);
 
-    static const DirectX::XMFLOAT4X4A ignore_rotate_180(
-        2, 0, 0, 0,
-        0, -2, 0, 0,
-        0, 0, 1, 0,
-        -1, 1, 0, 1);
+    static const DirectX::XMFLOAT4X4A ignore_rotate_180(
+        2, 0, 0, 0,
+        0, -2, 0, 0,
+        0, 0, 1, 0,
+        -1, 1, 0, 1);
+
+    static const DirectX::XMFLOAT4X4A rotate_270(
+        0, -2, 0, 0,
+        -2, 0, 0, 0,
+        0, 0, 1, 0,
+        1, 1, 0, 1);
+
+    static const DirectX::XMFLOAT4X4A ignore_rotate_270(
+        2, 0, 0, 0,
+        0, -2, 0, 0,
+        0, 0, 1, 0,
+        -1, 1, 0, 1);
+
+    static const DirectX::XMMATRIX matrices[4][2] =
+    {
+        { DirectX::XMLoadFloat4x4(&rotate_0), DirectX::XMLoadFloat4x4(&rotate_0) },
+        { DirectX::XMLoadFloat4x4(&rotate_90), DirectX::XMLoadFloat4x4(&ignore_rotate_90) },
+        { DirectX::XMLoadFloat4x4(&rotate_180), DirectX::XMLoadFloat4x4(&ignore_rotate_180) },
+        { DirectX::XMLoadFloat4x4(&rotate_270), DirectX::XMLoadFloat4x4(&ignore_rotate_270) },
+    };
+
+    return matrices[dmod][ignore_rotate ? 1 : 0];
+}
+
+static DirectX::XMMATRIX get_view_matrix(const ff::window_size& target_size, const ff::rect_float& world_rect, bool ignore_rotation)
+{
+    DirectX::XMMATRIX rotate_matrix = ::get_rotate_matrix(target_size.rotation, ignore_rotation);
+    DirectX::XMMATRIX scale_matrix = DirectX::XMMatrixScaling(1 / world_rect.width(), 1 / world_rect.height(), 1);
+    DirectX::XMMATRIX translate_matrix = DirectX::XMMatrixTranslation(-world_rect.left, -world_rect.top, 0);
+
+    return translate_matrix * scale_matrix * rotate_matrix;
+}
+
+static bool setup_view_matrix(ff::dxgi::target_base& target, const ff::rect_float& view_rect, const ff::rect_float& world_rect, DirectX::XMFLOAT4X4& view_matrix, bool ignore_rotation)
+{
+    check_ret_val(world_rect.area() != 0 && view_rect.area() > 0, false);
+
+    DirectX::XMMATRIX view_matrix2 = ::get_view_matrix(target.size(), world_rect, ignore_rotation);
+    DirectX::XMStoreFloat4x4(&view_matrix, DirectX::XMMatrixTranspose(view_matrix2));
+    return true;
+}
+
+size_t ffdu::matrix_hash::operator()(const DirectX::XMFLOAT4X4& value) const
+{
+    // Fold the rows together with lanes rotated, so that a value in any cell affects the result differently
+    const DirectX::XMMATRIX matrix = DirectX::XMLoadFloat4x4(&value);
+    DirectX::XMVECTOR fold = DirectX::XMVectorXorInt(
+        DirectX::XMVectorXorInt(matrix.r[0], DirectX::XMVectorSwizzle<1, 2, 3, 0>(matrix.r[1])),
+        DirectX::XMVectorXorInt(DirectX::XMVectorSwizzle<2, 3, 0, 1>(matrix.r[2]), DirectX::XMVectorSwizzle<3, 0, 1, 2>(matrix.r[3])));
+
+    DirectX::XMUINT4 bits;
+    DirectX::XMStoreUInt4(&bits, fold);
+
+    uint64_t hash = ((static_cast<uint64_t>(bits.x) << 32) | bits.y) * 0x9E3779B97F4A7C15ull;
+    hash ^= ((static_cast<uint64_t>(bits.z) << 32) | bits.w) * 0xC2B2AE3D27D4EB4Full;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+bool ffdu::matrix_equal::operator()(const DirectX::XMFLOAT4X4& value1, const DirectX::XMFLOAT4X4& value2) const
+{
+    const DirectX::XMMATRIX matrix1 = DirectX::XMLoadFloat4x4(&value1);
+    const DirectX::XMMATRIX matrix2 = DirectX::XMLoadFloat4x4(&value2);
+    const DirectX::XMVECTOR diff = DirectX::XMVectorOrInt(
+        DirectX::XMVectorOrInt(DirectX::XMVectorXorInt(matrix1.r[0], matrix2.r[0]), DirectX::XMVectorXorInt(matrix1.r[1], matrix2.r[1])),
+        DirectX::XMVectorOrInt(DirectX::XMVectorXorInt(matrix1.r[2], matrix2.r[2]), DirectX::XMVectorXorInt(matrix1.r[3], matrix2.r[3])));
+
+    return DirectX::XMVector4EqualInt(diff, DirectX::XMVectorZero());
+}
+
+ffdu::draw_recorder::draw_recorder()
+    : world_matrix_stack_changing_connection(this->world_matrix_stack_.matrix_changing().connect(std::bind(&draw_recorder::matrix_changing, this, std::placeholders::_1)))
+{
+    this->reset();
+}
+
+void ffdu::draw_recorder::record(std::span<ffdu::draw_recorder* const> recorders, const std::function<void(size_t index, ffdu::draw_recorder& recorder)>& func)
+{
+    ff::task_graph graph;
+
+    for (size_t i = 0; i < recorders.size(); i++)
+    {
+        graph.add_task([&func, &recorders, i]()
+            {
+                func(i, *recorders[i]);
+                return true;
+            });
+    }
+
+    graph.run();
+}
+
+void ffdu::draw_recorder::reset()
+{
+    this->commands.clear();
+    this->sprites.clear();
+    this->lines.clear();
+    this->triangles.clear();
+    this->rectangles.clear();
+    this->circles.clear();
+    this->matrixes.clear();
+    this->palettes.clear();
+    this->remaps.clear();
+    this->custom_contexts.clear();
+
+    this->world_matrix_stack_.reset();
+    this->palette_remap_stack.clear();
+    this->palette_remap_stack.push_back(::default_palette_remap());
+    this->last_depth_type = ffdu::last_depth_type::none;
+    this->force_no_overlap = 0;
+    this->force_opaque = 0;
+    this->matrix_current = true; // identity means the device's world matrix
+}
+
+bool ffdu::draw_recorder::empty() const
+{
+    return this->commands.empty();
+}
+
+void ffdu::draw_recorder::end_draw()
+{
+}
+
+void ffdu::draw_recorder::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
+{
+    const ff::dxgi::sprite_data* sprites[] = { &sprite };
+    this->draw_sprites(sprites, std::span(&transform, 1));
+}
+
+void ffdu::draw_recorder::draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms)
+{
+    assert_ret(sprites.size() == transforms.size() || (sprites.size() == 1 && transforms.size()));
+    this->draw_sprites(::transform_sprite_source{ sprites, transforms }, transforms.size());
+}
+
+void ffdu::draw_recorder::draw_sprites(const ff::dxgi::sprite_batch_t& batch)
+{
+    const size_t count = batch.positions.size();
+    assert_ret(batch.sprites.size() == count || (batch.sprites.size() == 1 && count));
+    assert_ret(batch.scales.size() <= 1 || batch.scales.size() == count);
+    assert_ret(batch.rotations.size() <= 1 || batch.rotations.size() == count);
+    assert_ret(batch.colors.size() <= 1 || batch.colors.size() == count);
+
+    this->draw_sprites(::batch_sprite_source{ batch }, count);
+}
+
+template<class Source>
+void ffdu::draw_recorder::draw_sprites(const Source& source, size_t count)
+{
+    const bool allow_transparent = !this->force_opaque;
+    const uint8_t* palette_remap = this->palette_remap();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const ff::dxgi::sprite_data* sprite = source.sprite(i);
+        const ff::color& color = source.color(i);
+        ::alpha_type alpha_type = ::get_alpha_type(*sprite, color.alpha(), allow_transparent);
+
+        if (alpha_type == ::alpha_type::invisible || !sprite->view())
+        {
+            continue;
+        }
+
+        const bool is_palette_sprite = ff::flags::has(sprite->type(), ff::dxgi::sprite_type::palette);
+        ffdu::instance_bucket_type bucket_type = (alpha_type == ::alpha_type::transparent)
+            ? (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent)
+            : (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites);
+
+        ffdu::sprite_instance& instance = this->add_instance<ffdu::sprite_instance>(bucket_type, this->nudge_depth(), sprite->view());
+        const ff::point_float& position = source.position(i);
+        const ff::point_float& scale = source.scale(i);
+
+        DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite->world())),
+            DirectX::XMVectorSwizzle<0, 1, 0, 1>(DirectX::XMLoadFloat2(&ff::dxgi::cast_point(scale)))));
+        instance.uv_rect = ff::dxgi::cast_rect(sprite->texture_uv());
+        instance.color = color.to_shader_color(palette_remap);
+        DirectX::XMStoreFloat4(&instance.pos_rot, DirectX::XMVectorSet(position.x, position.y, 0, source.rotation_radians(i)));
+        instance.indexes = 0;
+    }
+}
+
+void ffdu::draw_recorder::draw_lines(std::span<const ff::dxgi::endpoint_t> points)
+{
+    size_t count = points.size();
+    check_ret(count > 1);
+
+    const bool allow_transparent = !this->force_opaque;
+    const bool closed = count > 2 && points.front().pos == points.back().pos;
+    const ff::color* default_color = points.front().color ? points.front().color : &ff::color_none();
+    bool new_depth = this->nudge_depth();
+
+    for (size_t i = 0; i < count - 1; i++)
+    {
+        const ff::dxgi::endpoint_t& p0 = points[i];
+        const ff::dxgi::endpoint_t& p1 = points[i + 1];
+        const ff::color* color0 = p0.color ? p0.color : default_color;
+        const ff::color* color1 = p1.color ? p1.color : default_color;
+
+        if (p0.pos == p1.pos || (!p0.size && !p1.size))
+        {
+            continue;
+        }
+
+        ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), allow_transparent);
+        alpha_type = ::get_alpha_type(color1->alpha(), allow_transparent, alpha_type);
+        if (alpha_type == ::alpha_type::invisible)
+        {
+            continue;
+        }
+
+        ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+            ? ffdu::instance_bucket_type::lines_out_transparent
+            : ffdu::instance_bucket_type::lines;
+
+        ffdu::line_instance& instance = this->add_instance<ffdu::line_instance>(type, new_depth);
+        ::fill_line_instance(instance, points, i, closed, *color0, *color1, this->palette_remap());
+        instance.depth = 0;
+        instance.matrix_index = 0;
+        new_depth = false;
+    }
+}
+
+void ffdu::draw_recorder::draw_triangles(std::span<const ff::dxgi::endpoint_t> points)
+{
+    assert(points.size() % 3 == 0);
+
+    const bool allow_transparent = !this->force_opaque;
+    bool new_depth = this->nudge_depth();
+
+    for (size_t i = 0; i + 2 < points.size(); i += 3)
+    {
+        const ff::color* colors[3];
+        colors[0] = points[i].color ? points[i].color : &ff::color_none();
+        colors[1] = points[i + 1].color ? points[i + 1].color : colors[0];
+        colors[2] = points[i + 2].color ? points[i + 2].color : colors[1];
+
+        ::alpha_type alpha_type = ::get_alpha_type(colors[0]->alpha(), allow_transparent);
+        alpha_type = ::get_alpha_type(colors[1]->alpha(), allow_transparent, alpha_type);
+        alpha_type = ::get_alpha_type(colors[2]->alpha(), allow_transparent, alpha_type);
+        check_ret(alpha_type != ::alpha_type::invisible);
+
+        ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+            ? ffdu::instance_bucket_type::triangles_out_transparent
+            : ffdu::instance_bucket_type::triangles;
+
+        ffdu::triangle_instance& instance = this->add_instance<ffdu::triangle_instance>(type, new_depth);
+        ::fill_triangle_instance(instance, &points[i], colors, this->palette_remap());
+        instance.depth = 0;
+        instance.matrix_index = 0;
+        new_depth = false;
+    }
+}
+
+void ffdu::draw_recorder::draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness)
+{
+    ::alpha_type alpha_type = ::get_alpha_type(color.alpha(), !this->force_opaque);
+    check_ret(alpha_type != ::alpha_type::invisible);
+
+    ff::rect_float rect2;
+    float thickness2;
+    check_ret(::get_rectangle_outline(rect, thickness, rect2, thickness2));
+
+    ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+        ? (thickness2 ? ffdu::instance_bucket_type::rectangles_outline_out_transparent : ffdu::instance_bucket_type::rectangles_filled_out_transparent)
+        : (thickness2 ? ffdu::instance_bucket_type::rectangles_outline : ffdu::instance_bucket_type::rectangles_filled);
+
+    ffdu::rectangle_instance& instance = this->add_instance<ffdu::rectangle_instance>(type, this->nudge_depth());
+    instance.rect = ff::dxgi::cast_rect(rect2);
+    instance.color = color.to_shader_color(this->palette_remap());
+    instance.depth = 0;
+    instance.thickness = thickness2;
+    instance.matrix_index = 0;
+}
+
+void ffdu::draw_recorder::draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
+{
+    check_ret(pos.size && (pos.color || outside_color));
+
+    const ff::color& inside_color2 = pos.color ? *pos.color : *outside_color;
+    const ff::color& outside_color2 = outside_color ? *outside_color : inside_color2;
+    ::alpha_type alpha_type = ::get_alpha_type(inside_color2.alpha(), !this->force_opaque);
+    alpha_type = ::get_alpha_type(outside_color2.alpha(), !this->force_opaque, alpha_type);
+    check_ret(alpha_type != ::alpha_type::invisible);
+
+    float radius, thickness2;
+    check_ret(::get_circle_outline(pos.size, thickness, radius, thickness2));
+
+    ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+        ? (thickness2 ? ffdu::instance_bucket_type::circles_outline_out_transparent : ffdu::instance_bucket_type::circles_filled_out_transparent)
+        : (thickness2 ? ffdu::instance_bucket_type::circles_outline : ffdu::instance_bucket_type::circles_filled);
+
+    ffdu::circle_instance& instance = this->add_instance<ffdu::circle_instance>(type, this->nudge_depth());
+    instance.position_radius = DirectX::XMFLOAT4(pos.pos.x, pos.pos.y, 0, radius);
+    instance.inside_color = inside_color2.to_shader_color(this->palette_remap());
+    instance.outside_color = outside_color2.to_shader_color(this->palette_remap());
+    instance.thickness = thickness2;
+    instance.matrix_index = 0;
+}
+
+void ffdu::draw_recorder::draw_recorded(const ffdu::draw_recorder& recorder)
+{
+    check_ret(&recorder != this && !recorder.empty());
+
+    // The other recorder's identity matrix means this recorder's current matrix
+    const DirectX::XMMATRIX base_matrix = DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix());
+    this->add_command(ffdu::draw_recorder::command_type::world_matrix, this->matrixes.size());
+    this->matrixes.push_back(this->world_matrix_stack_.matrix());
+
+    const size_t sprite_start = this->sprites.size();
+    const size_t line_start = this->lines.size();
+    const size_t triangle_start = this->triangles.size();
+    const size_t rectangle_start = this->rectangles.size();
+    const size_t circle_start = this->circles.size();
+    const size_t matrix_start = this->matrixes.size();
+    const size_t palette_start = this->palettes.size();
+    const size_t remap_start = this->remaps.size();
+    const size_t custom_context_start = this->custom_contexts.size();
+
+    this->sprites.insert(this->sprites.end(), recorder.sprites.cbegin(), recorder.sprites.cend());
+    this->lines.insert(this->lines.end(), recorder.lines.cbegin(), recorder.lines.cend());
+    this->triangles.insert(this->triangles.end(), recorder.triangles.cbegin(), recorder.triangles.cend());
+    this->rectangles.insert(this->rectangles.end(), recorder.rectangles.cbegin(), recorder.rectangles.cend());
+    this->circles.insert(this->circles.end(), recorder.circles.cbegin(), recorder.circles.cend());
+    this->palettes.insert(this->palettes.end(), recorder.palettes.cbegin(), recorder.palettes.cend());
+    this->remaps.insert(this->remaps.end(), recorder.remaps.cbegin(), recorder.remaps.cend());
+    this->custom_contexts.insert(this->custom_contexts.end(), recorder.custom_contexts.cbegin(), recorder.custom_contexts.cend());
+
+    for (const DirectX::XMFLOAT4X4& matrix : recorder.matrixes)
+    {
+        DirectX::XMStoreFloat4x4(&this->matrixes.emplace_back(), DirectX::XMLoadFloat4x4(&matrix) * base_matrix);
+    }
+
+    for (ffdu::draw_recorder::command_t command : recorder.commands)
+    {
+        switch (command.type)
+        {
+            case ffdu::draw_recorder::command_type::instance:
+                switch (::opaque_bucket_type(command.bucket_type))
+                {
+                    case ffdu::instance_bucket_type::sprites:
+                    case ffdu::instance_bucket_type::palette_sprites:
+                        command.index += static_cast<uint32_t>(sprite_start);
+                        break;
+
+                    case ffdu::instance_bucket_type::lines:
+                        command.index += static_cast<uint32_t>(line_start);
+                        break;
+
+                    case ffdu::instance_bucket_type::triangles:
+                        command.index += static_cast<uint32_t>(triangle_start);
+                        break;
+
+                    case ffdu::instance_bucket_type::rectangles_filled:
+                    case ffdu::instance_bucket_type::rectangles_outline:
+                        command.index += static_cast<uint32_t>(rectangle_start);
+                        break;
+
+                    default:
+                        command.index += static_cast<uint32_t>(circle_start);
+                        break;
+                }
+                break;
+
+            case ffdu::draw_recorder::command_type::world_matrix:
+                command.index += static_cast<uint32_t>(matrix_start);
+                break;
+
+            case ffdu::draw_recorder::command_type::push_palette:
+                command.index += static_cast<uint32_t>(palette_start);
+                break;
+
+            case ffdu::draw_recorder::command_type::push_palette_remap:
+                command.index += static_cast<uint32_t>(remap_start);
+                break;
+
+            case ffdu::draw_recorder::command_type::push_custom_context:
+                command.index += static_cast<uint32_t>(custom_context_start);
+                break;
+
+            default:
+                break;
+        }
+
+        this->commands.push_back(command);
+    }
+
+    this->last_depth_type = ffdu::last_depth_type::instance;
+    this->matrix_current = false;
+}
+
+ff::matrix_stack& ffdu::draw_recorder::world_matrix_stack()
+{
+    return this->world_matrix_stack_;
+}
+
+void ffdu::draw_recorder::push_palette(ff::dxgi::palette_base* palette)
+{
+    assert(palette);
+    this->add_command(ffdu::draw_recorder::command_type::push_palette, this->palettes.size());
+    this->palettes.push_back(palette);
+
+    ff::dxgi::remap_t remap = palette->remap();
+    this->palette_remap_stack.push_back(remap.hash ? remap : ::default_palette_remap());
+}
+
+void ffdu::draw_recorder::pop_palette()
+{
+    assert(this->palette_remap_stack.size() > 1);
+    this->add_command(ffdu::draw_recorder::command_type::pop_palette);
+    this->palette_remap_stack.pop_back();
+}
+
+void ffdu::draw_recorder::push_palette_remap(ff::dxgi::remap_t remap)
+{
+    this->add_command(ffdu::draw_recorder::command_type::push_palette_remap, this->remaps.size());
+    this->remaps.push_back(remap);
+    this->palette_remap_stack.push_back(remap.hash ? remap : ::default_palette_remap());
+}
+
+void ffdu::draw_recorder::pop_palette_remap()
+{
+    assert(this->palette_remap_stack.size() > 1);
+    this->add_command(ffdu::draw_recorder::command_type::pop_palette_remap);
+    this->palette_remap_stack.pop_back();
+}
+
+void ffdu::draw_recorder::push_no_overlap()
+{
+    this->force_no_overlap++;
+}
+
+void ffdu::draw_recorder::pop_no_overlap()
+{
+    assert(this->force_no_overlap > 0);
+
+    if (!--this->force_no_overlap && this->last_depth_type == ffdu::last_depth_type::instance_no_overlap)
+    {
+        this->last_depth_type = ffdu::last_depth_type::instance;
+    }
+}
+
+void ffdu::draw_recorder::push_opaque()
+{
+    this->force_opaque++;
+}
+
+void ffdu::draw_recorder::pop_opaque()
+{
+    assert(this->force_opaque > 0);
+    this->force_opaque--;
+}
+
+void ffdu::draw_recorder::push_pre_multiplied_alpha()
+{
+    this->add_command(ffdu::draw_recorder::command_type::push_pre_multiplied_alpha);
+}
+
+void ffdu::draw_recorder::pop_pre_multiplied_alpha()
+{
+    this->add_command(ffdu::draw_recorder::command_type::pop_pre_multiplied_alpha);
+}
 
-    static const DirectX::XMFLOAT4X4A rotate_270(
-        0, -2, 0, 0,
-        -2, 0, 0, 0,
-        0, 0, 1, 0,
-        1, 1, 0, 1);
+void ffdu::draw_recorder::push_custom_context(ff::dxgi::draw_base::custom_context_func&& func)
+{
+    this->add_command(ffdu::draw_recorder::command_type::push_custom_context, this->custom_contexts.size());
+    this->custom_contexts.push_back(std::move(func));
+}
 
-    static const DirectX::XMFLOAT4X4A ignore_rotate_270(
-        2, 0, 0, 0,
-        0, -2, 0, 0,
-        0, 0, 1, 0,
-        -1, 1, 0, 1);
+void ffdu::draw_recorder::pop_custom_context()
+{
+    this->add_command(ffdu::draw_recorder::command_type::pop_custom_context);
+}
 
-    static const DirectX::XMMATRIX matrices[4][2] =
-    {
-        { DirectX::XMLoadFloat4x4(&rotate_0), DirectX::XMLoadFloat4x4(&rotate_0) },
-        { DirectX::XMLoadFloat4x4(&rotate_90), DirectX::XMLoadFloat4x4(&ignore_rotate_90) },
-        { DirectX::XMLoadFloat4x4(&rotate_180), DirectX::XMLoadFloat4x4(&ignore_rotate_180) },
-        { DirectX::XMLoadFloat4x4(&rotate_270), DirectX::XMLoadFloat4x4(&ignore_rotate_270) },
-    };
+void ffdu::draw_recorder::push_sampler_linear_filter(bool linear_filter)
+{
+    this->add_command(ffdu::draw_recorder::command_type::push_sampler_linear_filter, linear_filter ? 1 : 0);
+}
 
-    return matrices[dmod][ignore_rotate ? 1 : 0];
+void ffdu::draw_recorder::pop_sampler_linear_filter()
+{
+    this->add_command(ffdu::draw_recorder::command_type::pop_sampler_linear_filter);
 }
 
-static DirectX::XMMATRIX get_view_matrix(const ff::window_size& target_size, const ff::rect_float& world_rect, bool ignore_rotation)
+void ffdu::draw_recorder::add_command(ffdu::draw_recorder::command_type type, size_t index, ffdu::instance_bucket_type bucket_type, bool new_depth, ff::dxgi::texture_view_base* view)
 {
-    DirectX::XMMATRIX rotate_matrix = ::get_rotate_matrix(target_size.rotation, ignore_rotation);
-    DirectX::XMMATRIX scale_matrix = DirectX::XMMatrixScaling(1 / world_rect.width(), 1 / world_rect.height(), 1);
-    DirectX::XMMATRIX translate_matrix = DirectX::XMMatrixTranslation(-world_rect.left, -world_rect.top, 0);
+    if (type == ffdu::draw_recorder::command_type::instance && !this->matrix_current)
+    {
+        this->matrix_current = true;
+        this->commands.emplace_back(ffdu::draw_recorder::command_type::world_matrix, ffdu::instance_bucket_type{}, false, static_cast<uint32_t>(this->matrixes.size()), nullptr);
+        this->matrixes.push_back(this->world_matrix_stack_.matrix());
+    }
 
-    return translate_matrix * scale_matrix * rotate_matrix;
+    this->commands.emplace_back(type, bucket_type, new_depth, static_cast<uint32_t>(index), view);
 }
 
-static bool setup_view_matrix(ff::dxgi::target_base& target, const ff::rect_float& view_rect, const ff::rect_float& world_rect, DirectX::XMFLOAT4X4& view_matrix, bool ignore_rotation)
+void ffdu::draw_recorder::matrix_changing(const ff::matrix_stack& matrix_stack)
 {
-    check_ret_val(world_rect.area() != 0 && view_rect.area() > 0, false);
+    this->matrix_current = false;
+}
 
-    DirectX::XMMATRIX view_matrix2 = ::get_view_matrix(target.size(), world_rect, ignore_rotation);
-    DirectX::XMStoreFloat4x4(&view_matrix, DirectX::XMMatrixTranspose(view_matrix2));
-    return true;
+bool ffdu::draw_recorder::nudge_depth()
+{
+    ffdu::last_depth_type depth_type = this->force_no_overlap ? ffdu::last_depth_type::instance_no_overlap : ffdu::last_depth_type::instance;
+    bool new_depth = (depth_type != ffdu::last_depth_type::instance_no_overlap || this->last_depth_type != depth_type);
+    this->last_depth_type = depth_type;
+    return new_depth;
+}
+
+const uint8_t* ffdu::draw_recorder::palette_remap() const
+{
+    return this->palette_remap_stack.back().remap.data();
 }
 
 ffdu::draw_device_base::draw_device_base()
@@ -311,6 +1085,7 @@ void ffdu::draw_device_base::end_draw()
 
     this->state = draw_device_base::state_t::valid;
     this->command_context_ = nullptr;
+    this->update_instance_buckets_context();
     this->palette_stack.resize(1);
     this->palette_remap_stack.resize(1);
     this->sampler_stack.resize(1);
@@ -324,29 +1099,105 @@ void ffdu::draw_device_base::end_draw()
 
 void ffdu::draw_device_base::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
 {
-    ::alpha_type alpha_type = ::get_alpha_type(sprite, transform.color.alpha(), this->allow_transparent());
-    check_ret(alpha_type != ::alpha_type::invisible && sprite.view());
+    const ff::dxgi::sprite_data* sprites[] = { &sprite };
+    this->draw_sprites(sprites, std::span(&transform, 1));
+}
+
+void ffdu::draw_device_base::draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms)
+{
+    assert_ret(sprites.size() == transforms.size() || (sprites.size() == 1 && transforms.size()));
+    this->draw_sprites(::transform_sprite_source{ sprites, transforms }, transforms.size());
+}
+
+void ffdu::draw_device_base::draw_sprites(const ff::dxgi::sprite_batch_t& batch)
+{
+    const size_t count = batch.positions.size();
+    assert_ret(batch.sprites.size() == count || (batch.sprites.size() == 1 && count));
+    assert_ret(batch.scales.size() <= 1 || batch.scales.size() == count);
+    assert_ret(batch.rotations.size() <= 1 || batch.rotations.size() == count);
+    assert_ret(batch.colors.size() <= 1 || batch.colors.size() == count);
+
+    this->draw_sprites(::batch_sprite_source{ batch }, count);
+}
 
-    bool is_palette_sprite = ff::flags::has(sprite.type(), ff::dxgi::sprite_type::palette);
-    uint32_t indexes = this->get_world_matrix_and_texture_index(*sprite.view(), is_palette_sprite);
+template<class Source>
+void ffdu::draw_device_base::draw_sprites(const Source& source, size_t count)
+{
+    // Anything shared by neighboring sprites is only looked up once
+    const bool allow_transparent = this->allow_transparent();
+    const uint8_t* palette_remap = this->palette_remap();
+    const ff::dxgi::sprite_data* prev_sprite{};
+    const ff::dxgi::texture_view_base* prev_view{};
+    DirectX::XMVECTOR world_rect{};
+    DirectX::XMFLOAT4 uv_rect{};
+    uint32_t indexes{};
+    size_t prev_flush_count{};
+    bool is_palette_sprite{};
 
-    ffdu::instance_bucket_type bucket_type = (alpha_type == ::alpha_type::transparent)
-        ? (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent)
-        : (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites);
+    for (size_t i = 0; i < count; i++)
+    {
+        const ff::dxgi::sprite_data* sprite = source.sprite(i);
+        const ff::color& color = source.color(i);
+        ::alpha_type alpha_type = ::get_alpha_type(*sprite, color.alpha(), allow_transparent);
 
-    float depth = this->nudge_depth();
-    ffdu::sprite_instance& instance = this->add_instance<ffdu::sprite_instance>(bucket_type, depth);
+        if (alpha_type == ::alpha_type::invisible || !sprite->view())
+        {
+            continue;
+        }
+
+        const ff::point_float& position = source.position(i);
+        const ff::point_float& scale = source.scale(i);
+        const float rotation = source.rotation_radians(i);
+
+        // Offscreen sprites are skipped before they can use up a texture slot
+        if (this->cull(::get_sprite_bounds(sprite->world(), position, scale, rotation)))
+        {
+            continue;
+        }
+
+        const bool transparent = (alpha_type == ::alpha_type::transparent);
+        if (transparent && !this->deferred_sprites.empty())
+        {
+            // Deferred sprites must be drawn before anything transparent that's in front of them
+            this->flush();
+        }
+
+        if (sprite != prev_sprite)
+        {
+            prev_sprite = sprite;
+            world_rect = DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite->world()));
+            uv_rect = ff::dxgi::cast_rect(sprite->texture_uv());
+        }
+
+        // Opaque sprites are depth tested, so they can be drawn later when they don't fit into the current slots
+        const bool new_is_palette_sprite = ff::flags::has(sprite->type(), ff::dxgi::sprite_type::palette);
+        const bool can_defer = this->can_defer_sprite(transparent, new_is_palette_sprite);
+
+        if (sprite->view() != prev_view || new_is_palette_sprite != is_palette_sprite || prev_flush_count != this->flush_count || (indexes == ::INVALID_INDEX && !can_defer))
+        {
+            // This can flush, but only before any instances are added with the new indexes
+            indexes = this->get_world_matrix_and_texture_index(*sprite->view(), new_is_palette_sprite, can_defer);
+            prev_view = sprite->view();
+            prev_flush_count = this->flush_count;
+            is_palette_sprite = new_is_palette_sprite;
+        }
 
-    DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(
-        DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite.world())),
-        DirectX::XMVectorSet(transform.scale.x, transform.scale.y, transform.scale.x, transform.scale.y)));
-    instance.uv_rect = ff::dxgi::cast_rect(sprite.texture_uv());
-    instance.color = transform.color.to_shader_color(this->palette_remap());;
-    instance.pos_rot.x = transform.position.x;
-    instance.pos_rot.y = transform.position.y;
-    instance.pos_rot.z = depth;
-    instance.pos_rot.w = transform.rotation_radians();
-    instance.indexes = indexes;
+        ffdu::instance_bucket_type bucket_type = transparent
+            ? (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent)
+            : (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites);
+
+        float depth = this->nudge_depth();
+        ffdu::sprite_instance& instance = (indexes != ::INVALID_INDEX)
+            ? this->add_instance<ffdu::sprite_instance>(bucket_type, depth)
+            : this->add_deferred_sprite(*sprite->view());
+
+        DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(world_rect,
+            DirectX::XMVectorSwizzle<0, 1, 0, 1>(DirectX::XMLoadFloat2(&ff::dxgi::cast_point(scale)))));
+        instance.uv_rect = uv_rect;
+        instance.color = color.to_shader_color(palette_remap);
+        DirectX::XMStoreFloat4(&instance.pos_rot, DirectX::XMVectorSet(position.x, position.y, depth, rotation));
+        instance.indexes = (indexes != ::INVALID_INDEX) ? indexes : (static_cast<uint32_t>(this->linear_sampler()) << 8);
+    }
 }
 
 void ffdu::draw_device_base::draw_lines(std::span<const ff::dxgi::endpoint_t> points)
@@ -354,8 +1205,13 @@ void ffdu::draw_device_base::draw_lines(std::span<const ff::dxgi::endpoint_t> po
     size_t count = points.size();
     check_ret(count > 1);
 
+    // Mitered joints can stick out past the thickness, so the bounds are inflated generously
+    float max_thickness;
+    ff::rect_float bounds = ::get_point_bounds(points, max_thickness);
+    check_ret(!this->cull(bounds.inflate(max_thickness * 5, max_thickness * 5), count - 1));
+
     bool closed = count > 2 && points.front().pos == points.back().pos;
-    const uint32_t matrix_index = this->get_world_matrix_index();
+    uint32_t matrix_index = this->get_world_matrix_index();
     const float depth = this->nudge_depth();
     const ff::color* default_color = points.front().color ? points.front().color : &ff::color_none();
 
@@ -382,15 +1238,14 @@ void ffdu::draw_device_base::draw_lines(std::span<const ff::dxgi::endpoint_t> po
             ? ffdu::instance_bucket_type::lines_out_transparent
             : ffdu::instance_bucket_type::lines;
 
+        if (type == ffdu::instance_bucket_type::lines_out_transparent && !this->deferred_sprites.empty())
+        {
+            this->flush();
+            matrix_index = this->get_world_matrix_index();
+        }
+
         ffdu::line_instance& instance = this->add_instance<ffdu::line_instance>(type, depth);
-        instance.start = ff::dxgi::cast_point(p0.pos);
-        instance.end = ff::dxgi::cast_point(p1.pos);
-        instance.before_start = ff::dxgi::cast_point((i == 0) ? (closed ? points[count - 2].pos : p0.pos) : points[i - 1].pos);
-        instance.after_end = ff::dxgi::cast_point((i == count - 2) ? (closed ? points[1].pos : p1.pos) : points[i + 2].pos);
-        instance.start_color = color0->to_shader_color(this->palette_remap());
-        instance.end_color = color1->to_shader_color(this->palette_remap());
-        instance.start_thickness = std::abs(p0.size);
-        instance.end_thickness = std::abs(p1.size);
+        ::fill_line_instance(instance, points, i, closed, *color0, *color1, this->palette_remap());
         instance.depth = depth;
         instance.matrix_index = matrix_index;
     }
@@ -400,31 +1255,45 @@ void ffdu::draw_device_base::draw_triangles(std::span<const ff::dxgi::endpoint_t
 {
     assert(points.size() % 3 == 0);
 
-    const uint32_t matrix_index = this->get_world_matrix_index();
-    const float depth = this->nudge_depth();
+    uint32_t matrix_index = ::INVALID_INDEX;
+    float depth = 0;
 
     for (size_t i = 0; i + 2 < points.size(); i += 3)
     {
-        const ff::color* color0 = points[i].color ? points[i].color : &ff::color_none();
-        const ff::color* color1 = points[i + 1].color ? points[i + 1].color : color0;
-        const ff::color* color2 = points[i + 2].color ? points[i + 2].color : color1;
-
-        ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), this->allow_transparent());
-        alpha_type = ::get_alpha_type(color1->alpha(), this->allow_transparent(), alpha_type);
-        alpha_type = ::get_alpha_type(color2->alpha(), this->allow_transparent(), alpha_type);
+        const ff::color* colors[3];
+        colors[0] = points[i].color ? points[i].color : &ff::color_none();
+        colors[1] = points[i + 1].color ? points[i + 1].color : colors[0];
+        colors[2] = points[i + 2].color ? points[i + 2].color : colors[1];
+
+        ::alpha_type alpha_type = ::get_alpha_type(colors[0]->alpha(), this->allow_transparent());
+        alpha_type = ::get_alpha_type(colors[1]->alpha(), this->allow_transparent(), alpha_type);
+        alpha_type = ::get_alpha_type(colors[2]->alpha(), this->allow_transparent(), alpha_type);
         check_ret(alpha_type != ::alpha_type::invisible);
 
+        float max_thickness;
+        if (this->cull(::get_point_bounds(points.subspan(i, 3), max_thickness)))
+        {
+            continue;
+        }
+
         ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
             ? ffdu::instance_bucket_type::triangles_out_transparent
             : ffdu::instance_bucket_type::triangles;
 
+        if (type == ffdu::instance_bucket_type::triangles_out_transparent && !this->deferred_sprites.empty())
+        {
+            this->flush();
+            matrix_index = ::INVALID_INDEX;
+        }
+
+        if (matrix_index == ::INVALID_INDEX)
+        {
+            matrix_index = this->get_world_matrix_index();
+            depth = depth ? depth : this->nudge_depth();
+        }
+
         ffdu::triangle_instance& instance = this->add_instance<ffdu::triangle_instance>(type, depth);
-        instance.position[0] = ff::dxgi::cast_point(points[i].pos);
-        instance.position[1] = ff::dxgi::cast_point(points[i + 1].pos);
-        instance.position[2] = ff::dxgi::cast_point(points[i + 2].pos);
-        instance.color[0] = color0->to_shader_color(this->palette_remap());
-        instance.color[1] = color1->to_shader_color(this->palette_remap());
-        instance.color[2] = color2->to_shader_color(this->palette_remap());
+        ::fill_triangle_instance(instance, &points[i], colors, this->palette_remap());
         instance.depth = depth;
         instance.matrix_index = matrix_index;
     }
@@ -435,25 +1304,13 @@ void ffdu::draw_device_base::draw_rectangle(const ff::rect_float& rect, const ff
     ::alpha_type alpha_type = ::get_alpha_type(color.alpha(), this->allow_transparent());
     check_ret(alpha_type != ::alpha_type::invisible);
 
-    ff::rect_float rect2 = rect.normalize();
-    check_ret(rect2.area());
+    ff::rect_float rect2;
+    float thickness2;
+    check_ret(::get_rectangle_outline(rect, thickness, rect2, thickness2) && !this->cull(rect2));
 
-    float thickness2 = 0;
-    if (thickness.has_value())
+    if (alpha_type == ::alpha_type::transparent && !this->deferred_sprites.empty())
     {
-        thickness2 = thickness.value();
-        check_ret(thickness2);
-
-        if (thickness2 < 0)
-        {
-            rect2 = rect2.deflate(thickness2, thickness2);
-            thickness2 = -thickness2;
-        }
-
-        if (thickness2 * 2 >= rect2.width() || thickness2 * 2 >= rect2.height())
-        {
-            thickness2 = 0;
-        }
+        this->flush();
     }
 
     ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
@@ -472,8 +1329,7 @@ void ffdu::draw_device_base::draw_rectangle(const ff::rect_float& rect, const ff
 
 void ffdu::draw_device_base::draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
 {
-    float radius = std::abs(pos.size);
-    check_ret(radius && (pos.color || outside_color));
+    check_ret(pos.size && (pos.color || outside_color));
 
     const ff::color& inside_color2 = pos.color ? *pos.color : *outside_color;
     const ff::color& outside_color2 = outside_color ? *outside_color : inside_color2;
@@ -481,22 +1337,13 @@ void ffdu::draw_device_base::draw_circle(const ff::dxgi::endpoint_t& pos, std::o
     alpha_type = ::get_alpha_type(outside_color2.alpha(), this->allow_transparent(), alpha_type);
     check_ret(alpha_type != ::alpha_type::invisible);
 
-    float thickness2 = 0;
-    if (thickness.has_value())
-    {
-        thickness2 = thickness.value();
-        check_ret(thickness2);
-
-        if (thickness2 < 0)
-        {
-            radius += thickness2;
-            thickness2 = -thickness2;
-        }
+    float radius, thickness2;
+    check_ret(::get_circle_outline(pos.size, thickness, radius, thickness2));
+    check_ret(!this->cull(ff::rect_float(pos.pos.x - radius, pos.pos.y - radius, pos.pos.x + radius, pos.pos.y + radius)));
 
-        if (thickness2 >= radius)
-        {
-            thickness2 = 0;
-        }
+    if (alpha_type == ::alpha_type::transparent && !this->deferred_sprites.empty())
+    {
+        this->flush();
     }
 
     ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
@@ -516,6 +1363,170 @@ void ffdu::draw_device_base::draw_circle(const ff::dxgi::endpoint_t& pos, std::o
     instance.matrix_index = matrix_index;
 }
 
+void ffdu::draw_device_base::draw_recorded(const ffdu::draw_recorder& recorder)
+{
+    check_ret(!recorder.empty());
+
+    // Recorded matrixes are relative to the current world matrix
+    const DirectX::XMMATRIX base_matrix = DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix());
+    this->world_matrix_stack_.push();
+
+    const ff::dxgi::texture_view_base* prev_view{};
+    uint32_t indexes = ::INVALID_INDEX;
+    size_t prev_flush_count{};
+    bool prev_use_palette{};
+
+    for (const ffdu::draw_recorder::command_t& command : recorder.commands)
+    {
+        switch (command.type)
+        {
+            case ffdu::draw_recorder::command_type::instance:
+                break;
+
+            case ffdu::draw_recorder::command_type::world_matrix:
+                {
+                    DirectX::XMFLOAT4X4 matrix;
+                    DirectX::XMStoreFloat4x4(&matrix, DirectX::XMLoadFloat4x4(&recorder.matrixes[command.index]) * base_matrix);
+                    this->world_matrix_stack_.set(matrix);
+                }
+                continue;
+
+            case ffdu::draw_recorder::command_type::push_palette:
+                this->push_palette(recorder.palettes[command.index]);
+                prev_view = nullptr;
+                continue;
+
+            case ffdu::draw_recorder::command_type::pop_palette:
+                this->pop_palette();
+                prev_view = nullptr;
+                continue;
+
+            case ffdu::draw_recorder::command_type::push_palette_remap:
+                this->push_palette_remap(recorder.remaps[command.index]);
+                prev_view = nullptr;
+                continue;
+
+            case ffdu::draw_recorder::command_type::pop_palette_remap:
+                this->pop_palette_remap();
+                prev_view = nullptr;
+                continue;
+
+            case ffdu::draw_recorder::command_type::push_pre_multiplied_alpha:
+                this->push_pre_multiplied_alpha();
+                continue;
+
+            case ffdu::draw_recorder::command_type::pop_pre_multiplied_alpha:
+                this->pop_pre_multiplied_alpha();
+                continue;
+
+            case ffdu::draw_recorder::command_type::push_custom_context:
+                this->push_custom_context(ff::dxgi::draw_base::custom_context_func(recorder.custom_contexts[command.index]));
+                continue;
+
+            case ffdu::draw_recorder::command_type::pop_custom_context:
+                this->pop_custom_context();
+                continue;
+
+            case ffdu::draw_recorder::command_type::push_sampler_linear_filter:
+                this->push_sampler_linear_filter(command.index != 0);
+                prev_view = nullptr;
+                continue;
+
+            case ffdu::draw_recorder::command_type::pop_sampler_linear_filter:
+                this->pop_sampler_linear_filter();
+                prev_view = nullptr;
+                continue;
+        }
+
+        // Palette targets can't blend, so anything transparent gets drawn as opaque
+        ffdu::instance_bucket_type bucket_type = this->target_requires_palette_ ? ::opaque_bucket_type(command.bucket_type) : command.bucket_type;
+        const bool transparent = (bucket_type >= ffdu::instance_bucket_type::first_transparent);
+        if (transparent && !this->deferred_sprites.empty())
+        {
+            // Deferred sprites must be drawn before anything transparent that's in front of them
+            this->flush();
+        }
+
+        if (command.view)
+        {
+            const bool use_palette = (::opaque_bucket_type(bucket_type) == ffdu::instance_bucket_type::palette_sprites);
+            const bool can_defer = this->can_defer_sprite(transparent, use_palette);
+
+            if (command.view != prev_view || use_palette != prev_use_palette || prev_flush_count != this->flush_count || this->world_matrix_index == ::INVALID_INDEX || (indexes == ::INVALID_INDEX && !can_defer))
+            {
+                indexes = this->get_world_matrix_and_texture_index(*command.view, use_palette, can_defer);
+                prev_view = command.view;
+                prev_use_palette = use_palette;
+                prev_flush_count = this->flush_count;
+            }
+        }
+
+        const uint32_t matrix_index = command.view ? 0 : this->get_world_matrix_index();
+
+        if (command.new_depth || this->last_depth_type == ffdu::last_depth_type::none)
+        {
+            this->draw_depth += ffdu::RENDER_DEPTH_DELTA;
+            this->last_depth_type = ffdu::last_depth_type::instance;
+        }
+
+        const float depth = this->draw_depth;
+
+        switch (::opaque_bucket_type(bucket_type))
+        {
+            case ffdu::instance_bucket_type::sprites:
+            case ffdu::instance_bucket_type::palette_sprites:
+                {
+                    ffdu::sprite_instance& instance = (indexes != ::INVALID_INDEX)
+                        ? this->add_instance<ffdu::sprite_instance>(bucket_type, depth)
+                        : this->add_deferred_sprite(*command.view);
+                    instance = recorder.sprites[command.index];
+                    instance.pos_rot.z = depth;
+                    instance.indexes = (indexes != ::INVALID_INDEX) ? indexes : (static_cast<uint32_t>(this->linear_sampler()) << 8);
+                }
+                break;
+
+            case ffdu::instance_bucket_type::lines:
+                {
+                    ffdu::line_instance& instance = this->add_instance<ffdu::line_instance>(bucket_type, depth);
+                    instance = recorder.lines[command.index];
+                    instance.depth = depth;
+                    instance.matrix_index = matrix_index;
+                }
+                break;
+
+            case ffdu::instance_bucket_type::triangles:
+                {
+                    ffdu::triangle_instance& instance = this->add_instance<ffdu::triangle_instance>(bucket_type, depth);
+                    instance = recorder.triangles[command.index];
+                    instance.depth = depth;
+                    instance.matrix_index = matrix_index;
+                }
+                break;
+
+            case ffdu::instance_bucket_type::rectangles_filled:
+            case ffdu::instance_bucket_type::rectangles_outline:
+                {
+                    ffdu::rectangle_instance& instance = this->add_instance<ffdu::rectangle_instance>(bucket_type, depth);
+                    instance = recorder.rectangles[command.index];
+                    instance.depth = depth;
+                    instance.matrix_index = matrix_index;
+                }
+                break;
+
+            default:
+                {
+                    ffdu::circle_instance& instance = this->add_instance<ffdu::circle_instance>(bucket_type, depth);
+                    instance = recorder.circles[command.index];
+                    instance.position_radius.z = depth;
+                    instance.matrix_index = matrix_index;
+                }
+                break;
+        }
+    }
+
+    this->world_matrix_stack_.pop();
+}
+
 ff::matrix_stack& ffdu::draw_device_base::world_matrix_stack()
 {
     return this->world_matrix_stack_;
@@ -631,6 +1642,11 @@ void ffdu::draw_device_base::pop_sampler_linear_filter()
     this->sampler_stack.pop_back();
 }
 
+std::shared_ptr<ff::dxgi::texture_base> ffdu::draw_device_base::create_palette_texture(ff::point_size size, DXGI_FORMAT format)
+{
+    return ff::dxgi::create_render_texture(size, format);
+}
+
 ff::dxgi::device_child_base* ffdu::draw_device_base::as_device_child()
 {
     return this;
@@ -641,6 +1657,11 @@ bool ffdu::draw_device_base::internal_valid() const
     return this->state != draw_device_base::state_t::invalid;
 }
 
+size_t ffdu::draw_device_base::internal_culled_count() const
+{
+    return this->culled_count_;
+}
+
 bool ffdu::draw_device_base::linear_sampler() const
 {
     return this->sampler_stack.back();
@@ -678,8 +1699,14 @@ ff::dxgi::draw_ptr ffdu::draw_device_base::internal_begin_draw(
     {
         this->init_vs_constants_buffer_0(target, view_rect, world_rect);
         this->target_requires_palette_ = ff::dxgi::palette_format(target.format());
+        this->has_depth = depth != nullptr;
         this->force_pre_multiplied_alpha = ff::flags::has(options, ff::dxgi::draw_options::pre_multiplied_alpha) && ff::dxgi::supports_pre_multiplied_alpha(target.format()) ? 1 : 0;
+        this->cull_world_rect = world_rect.normalize();
+        this->cull_enabled = !ff::flags::has(options, ff::dxgi::draw_options::no_culling);
+        this->cull_rect_valid = false;
+        this->culled_count_ = 0;
         this->state = draw_device_base::state_t::drawing;
+        this->update_instance_buckets_context();
 
         return { this, ::draw_ptr_deleter };
     }
@@ -692,10 +1719,10 @@ bool ffdu::draw_device_base::reset()
     this->destroy();
 
     this->palette_stack.push_back(nullptr);
-    this->palette_texture = ff::dxgi::create_render_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTES));
+    this->palette_texture = this->create_palette_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTES), DXGI_FORMAT_R8G8B8A8_UNORM);
 
     this->palette_remap_stack.push_back(::default_palette_remap());
-    this->palette_remap_texture = ff::dxgi::create_render_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTE_REMAPS), DXGI_FORMAT_R8_UINT);
+    this->palette_remap_texture = this->create_palette_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTE_REMAPS), DXGI_FORMAT_R8_UINT);
 
     this->sampler_stack.push_back(false);
     this->custom_context_stack.push_back([](ff::dxgi::command_context_base&, const std::type_info&, bool) { return true; });
@@ -722,6 +1749,7 @@ void ffdu::draw_device_base::destroy()
     this->view_matrix = ff::matrix_identity_4x4();
     this->world_matrix_stack_.reset();
     this->world_matrix_to_index.clear();
+    this->world_matrix_id_cache.fill(std::make_pair(ff::constants::invalid_unsigned<size_t>(), ::INVALID_INDEX));
     this->world_matrix_index = ::INVALID_INDEX;
 
     std::memset(this->textures.data(), 0, ff::array_byte_size(this->textures));
@@ -742,6 +1770,10 @@ void ffdu::draw_device_base::destroy()
     this->palette_remap_index = ::INVALID_INDEX;
 
     this->transparent_instances.clear();
+    this->deferred_sprites.clear();
+    this->deferred_matrixes.clear();
+    this->deferred_matrix_current = false;
+    this->has_depth = false;
     this->last_depth_type = ffdu::last_depth_type::none;
     this->draw_depth = 0;
     this->force_no_overlap = 0;
@@ -755,6 +1787,29 @@ void ffdu::draw_device_base::destroy()
 }
 
 void ffdu::draw_device_base::flush(bool end_draw)
+{
+    // Each batch is filled with as many deferred sprites as its slots can hold, so they need the fewest extra batches
+    while (!this->deferred_sprites.empty())
+    {
+        size_t prev_flush_count = this->flush_count;
+        this->add_deferred_sprites();
+        this->flush_batch(false);
+
+        if (prev_flush_count == this->flush_count)
+        {
+            // Nothing could be drawn even into an empty batch, so give up rather than trying forever
+            ff::log::write(ff::log::type::dxgi, "Dropped ", this->deferred_sprites.size(), " deferred sprite(s) that don't fit into any batch");
+            assert(false);
+            this->deferred_sprites.clear();
+        }
+    }
+
+    this->deferred_matrixes.clear();
+    this->deferred_matrix_current = false;
+    this->flush_batch(end_draw);
+}
+
+void ffdu::draw_device_base::flush_batch(bool end_draw)
 {
     if (this->last_depth_type != ffdu::last_depth_type::none && this->create_instance_buffer())
     {
@@ -783,6 +1838,7 @@ void ffdu::draw_device_base::flush(bool end_draw)
         // Reset draw data
 
         this->world_matrix_to_index.clear();
+        this->world_matrix_id_cache.fill(std::make_pair(ff::constants::invalid_unsigned<size_t>(), ::INVALID_INDEX));
         this->world_matrix_index = ::INVALID_INDEX;
 
         this->palette_to_index.clear();
@@ -795,18 +1851,31 @@ void ffdu::draw_device_base::flush(bool end_draw)
 
         this->transparent_instances.clear();
         this->last_depth_type = ffdu::last_depth_type::none;
+        this->flush_count++;
 
         this->command_context_ = this->internal_flush(this->command_context_, end_draw);
+        this->update_instance_buckets_context();
     }
     else if (end_draw)
     {
         this->command_context_ = this->internal_flush(this->command_context_, end_draw);
+        this->update_instance_buckets_context();
+    }
+}
+
+void ffdu::draw_device_base::update_instance_buckets_context()
+{
+    for (ffdu::instance_bucket& bucket : this->instance_buckets)
+    {
+        bucket.direct_buffer(this->command_context_ ? &this->instance_buffer() : nullptr, this->command_context_);
     }
 }
 
 void ffdu::draw_device_base::matrix_changing(const ff::matrix_stack& matrix_stack)
 {
     this->world_matrix_index = ::INVALID_INDEX;
+    this->deferred_matrix_current = false;
+    this->cull_rect_valid = false;
 }
 
 void ffdu::draw_device_base::init_vs_constants_buffer_0(ff::dxgi::target_base& target, const ff::rect_float& view_rect, const ff::rect_float& world_rect)
@@ -851,12 +1920,26 @@ void ffdu::draw_device_base::update_ps_constants_buffer_0()
 bool ffdu::draw_device_base::create_instance_buffer()
 {
     size_t byte_size = 0;
+    bool use_chunks = true;
+    this->instance_chunks.clear();
 
     for (ffdu::instance_bucket& bucket : this->instance_buckets)
     {
         byte_size = ff::math::round_up(byte_size, bucket.item_size());
         bucket.render_start(byte_size / bucket.item_size());
         byte_size += bucket.byte_size();
+        use_chunks = use_chunks && (!bucket.render_count() || bucket.buffer_chunks(this->instance_chunks));
+    }
+
+    // Instances were written straight into upload memory, so the GPU just copies each chunk into place
+    if (use_chunks && this->instance_buffer().unmap_chunks(*this->command_context_, byte_size, this->instance_chunks.data(), this->instance_chunks.size()))
+    {
+        for (ffdu::instance_bucket& bucket : this->instance_buckets)
+        {
+            bucket.clear_items();
+        }
+
+        return true;
     }
 
     if (void* buffer_data = this->instance_buffer().map(*this->command_context_, byte_size))
@@ -865,12 +1948,15 @@ bool ffdu::draw_device_base::create_instance_buffer()
         {
             if (bucket.render_count())
             {
-                ::memcpy(reinterpret_cast<uint8_t*>(buffer_data) + bucket.render_start() * bucket.item_size(), bucket.data(), bucket.byte_size());
+                bucket.copy_to(reinterpret_cast<uint8_t*>(buffer_data) + bucket.render_start() * bucket.item_size());
                 bucket.clear_items();
             }
         }
 
         this->instance_buffer().unmap(*this->command_context_);
+
+        // Release any chunks that were mapped before falling back to a full copy
+        this->instance_buffer().unmap_chunks(*this->command_context_, 0, nullptr, 0);
         return true;
     }
 
@@ -946,24 +2032,42 @@ uint32_t ffdu::draw_device_base::get_world_matrix_index_no_flush()
 {
     if (this->world_matrix_index == ::INVALID_INDEX)
     {
-        DirectX::XMFLOAT4X4 wm;
-        DirectX::XMStoreFloat4x4(&wm, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix())));
-        auto iter = this->world_matrix_to_index.find(wm);
+        // The stack's ID only changes with the matrix, so recently used matrixes skip the transpose and hash
+        const size_t matrix_id = this->world_matrix_stack_.matrix_id();
+        auto& cache_entry = this->world_matrix_id_cache[matrix_id % this->world_matrix_id_cache.size()];
 
-        if (iter == this->world_matrix_to_index.cend() && this->world_matrix_to_index.size() != ffdu::MAX_TRANSFORM_MATRIXES)
+        if (cache_entry.first == matrix_id)
         {
-            iter = this->world_matrix_to_index.try_emplace(wm, static_cast<uint32_t>(this->world_matrix_to_index.size())).first;
+            this->world_matrix_index = cache_entry.second;
         }
-
-        if (iter != this->world_matrix_to_index.cend())
+        else
         {
-            this->world_matrix_index = iter->second;
+            DirectX::XMFLOAT4X4 wm;
+            DirectX::XMStoreFloat4x4(&wm, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix())));
+            this->world_matrix_index = this->get_world_matrix_index_no_flush(wm);
+
+            if (this->world_matrix_index != ::INVALID_INDEX)
+            {
+                cache_entry = std::make_pair(matrix_id, this->world_matrix_index);
+            }
         }
     }
 
     return this->world_matrix_index;
 }
 
+uint32_t ffdu::draw_device_base::get_world_matrix_index_no_flush(const DirectX::XMFLOAT4X4& transposed_matrix)
+{
+    auto iter = this->world_matrix_to_index.find(transposed_matrix);
+
+    if (iter == this->world_matrix_to_index.cend() && this->world_matrix_to_index.size() != ffdu::MAX_TRANSFORM_MATRIXES)
+    {
+        iter = this->world_matrix_to_index.try_emplace(transposed_matrix, static_cast<uint32_t>(this->world_matrix_to_index.size())).first;
+    }
+
+    return (iter != this->world_matrix_to_index.cend()) ? iter->second : ::INVALID_INDEX;
+}
+
 uint32_t ffdu::draw_device_base::get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette)
 {
     if (use_palette)
@@ -1081,13 +2185,25 @@ uint32_t ffdu::draw_device_base::get_palette_remap_index_no_flush()
     return this->palette_remap_index;
 }
 
-uint32_t ffdu::draw_device_base::get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette)
+bool ffdu::draw_device_base::can_defer_sprite(bool transparent, bool use_palette) const
+{
+    // Deferred sprites are drawn in a later batch, which only looks right when the depth test puts them back in order.
+    // No overlap sprites share a depth value, so the first one drawn has to win and they can't be reordered.
+    return this->has_depth && !this->force_no_overlap && !transparent && !use_palette && !this->target_requires_palette_;
+}
+
+uint32_t ffdu::draw_device_base::get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette, bool can_defer)
 {
     uint32_t model_index = (this->world_matrix_index == ::INVALID_INDEX) ? this->get_world_matrix_index_no_flush() : this->world_matrix_index;
     uint32_t texture_index = this->get_texture_index_no_flush(texture_view, use_palette);
 
     if (model_index == ::INVALID_INDEX || texture_index == ::INVALID_INDEX)
     {
+        if (can_defer)
+        {
+            return ::INVALID_INDEX;
+        }
+
         this->flush();
         return this->get_world_matrix_and_texture_index(texture_view, use_palette);
     }
@@ -1095,6 +2211,111 @@ uint32_t ffdu::draw_device_base::get_world_matrix_and_texture_index(ff::dxgi::te
     return (model_index << 24) | texture_index;
 }
 
+ffdu::sprite_instance& ffdu::draw_device_base::add_deferred_sprite(ff::dxgi::texture_view_base& texture_view)
+{
+    if (!this->deferred_matrix_current)
+    {
+        DirectX::XMFLOAT4X4& wm = this->deferred_matrixes.emplace_back();
+        DirectX::XMStoreFloat4x4(&wm, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix())));
+        this->deferred_matrix_current = true;
+    }
+
+    ffdu::draw_device_base::deferred_sprite_t& entry = this->deferred_sprites.emplace_back();
+    entry.view = &texture_view;
+    entry.matrix_index = this->deferred_matrixes.size() - 1;
+    return entry.instance;
+}
+
+void ffdu::draw_device_base::add_deferred_sprites()
+{
+    size_t remaining_count = 0;
+
+    for (const ffdu::draw_device_base::deferred_sprite_t& entry : this->deferred_sprites)
+    {
+        uint32_t model_index = this->get_world_matrix_index_no_flush(this->deferred_matrixes[entry.matrix_index]);
+        uint32_t texture_index = (model_index != ::INVALID_INDEX) ? this->get_texture_index_no_flush(*entry.view, false) : ::INVALID_INDEX;
+
+        if (texture_index == ::INVALID_INDEX)
+        {
+            // Try again in the next batch
+            this->deferred_sprites[remaining_count++] = entry;
+            continue;
+        }
+
+        ffdu::sprite_instance& instance = this->add_instance<ffdu::sprite_instance>(ffdu::instance_bucket_type::sprites, entry.instance.pos_rot.z);
+        instance = entry.instance;
+        instance.indexes |= (model_index << 24) | (texture_index & 0xFF);
+
+        if (this->last_depth_type == ffdu::last_depth_type::none)
+        {
+            this->last_depth_type = ffdu::last_depth_type::instance;
+        }
+    }
+
+    this->deferred_sprites.resize(remaining_count);
+}
+
+bool ffdu::draw_device_base::cull(const ff::rect_float& local_bounds, size_t instance_count)
+{
+    if (!this->cull_enabled)
+    {
+        return false;
+    }
+
+    if (!this->cull_rect_valid)
+    {
+        this->update_cull_rect();
+    }
+
+    if (local_bounds.touches(this->cull_rect))
+    {
+        return false;
+    }
+
+    this->culled_count_ += instance_count;
+    return true;
+}
+
+void ffdu::draw_device_base::update_cull_rect()
+{
+    // Bring the world rect into the local space of the world matrix, rather than transforming every primitive out of it
+    DirectX::XMMATRIX world_matrix = DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix());
+    DirectX::XMVECTOR determinant;
+    DirectX::XMMATRIX inverse_matrix = DirectX::XMMatrixInverse(&determinant, world_matrix);
+    this->cull_rect_valid = true;
+
+    if (std::abs(DirectX::XMVectorGetX(determinant)) < 1.0e-12f)
+    {
+        const float max_value = std::numeric_limits<float>::max();
+        this->cull_rect = ff::rect_float(-max_value, -max_value, max_value, max_value);
+        return;
+    }
+
+    const ff::rect_float& rect = this->cull_world_rect;
+    DirectX::XMFLOAT2 corners[4] =
+    {
+        { rect.left, rect.top },
+        { rect.right, rect.top },
+        { rect.left, rect.bottom },
+        { rect.right, rect.bottom },
+    };
+
+    DirectX::XMVECTOR min_corner = DirectX::g_XMFltMax;
+    DirectX::XMVECTOR max_corner = DirectX::XMVectorNegate(DirectX::g_XMFltMax);
+
+    for (const DirectX::XMFLOAT2& corner : corners)
+    {
+        DirectX::XMVECTOR local_corner = DirectX::XMVector2TransformCoord(DirectX::XMLoadFloat2(&corner), inverse_matrix);
+        min_corner = DirectX::XMVectorMin(min_corner, local_corner);
+        max_corner = DirectX::XMVectorMax(max_corner, local_corner);
+    }
+
+    DirectX::XMFLOAT2 min_value, max_value;
+    DirectX::XMStoreFloat2(&min_value, min_corner);
+    DirectX::XMStoreFloat2(&max_value, max_corner);
+    this->cull_rect = ff::rect_float(min_value.x, min_value.y, max_value.x, max_value.y);
+}
+
 const uint8_t* ffdu::draw_device_base::palette_remap() const
 {
     return this->palette_remap_stack.back().remap.data();
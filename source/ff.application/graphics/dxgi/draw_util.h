@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../dxgi/buffer_base.h"
 #include "../dxgi/device_child_base.h"
 #include "../dxgi/draw_base.h"
 #include "../dxgi/palette_base.h"
@@ -8,7 +9,6 @@
 
 namespace ff::dxgi
 {
-    class buffer_base;
     class command_context_base;
     class depth_base;
     class sprite_data;
@@ -32,6 +32,7 @@ namespace ff::dxgi::draw_util
     constexpr float MAX_RENDER_DEPTH = 1.0f;
     constexpr float RENDER_DEPTH_DELTA = MAX_RENDER_DEPTH / MAX_RENDER_COUNT;
     constexpr size_t MIN_INSTANCE_BUCKET_COUNT = 64;
+    constexpr size_t MAX_INSTANCE_CHUNK_SIZE = 1024 * 1024 * 4;
 
     struct sprite_instance
     {
@@ -113,6 +114,14 @@ namespace ff::dxgi::draw_util
         first_transparent = sprites_out_transparent,
     };
 
+    /// <summary>
+    /// Collects instances of one type in chunks of memory that never move once they are written
+    /// </summary>
+    /// <remarks>
+    /// When a direct buffer supports chunks, instances are written straight into its upload memory
+    /// and the GPU copies each chunk into place at flush. Otherwise chunks are CPU memory that is copied
+    /// into the mapped buffer at flush. Either way, growing never copies the existing instances.
+    /// </remarks>
     class instance_bucket
     {
     private:
@@ -129,6 +138,7 @@ namespace ff::dxgi::draw_util
         }
 
         void reset();
+        void direct_buffer(ff::dxgi::buffer_base* buffer, ff::dxgi::command_context_base* context);
         void* add();
         size_t item_size() const;
         const std::type_info& item_type() const;
@@ -137,19 +147,37 @@ namespace ff::dxgi::draw_util
         size_t count() const;
         void clear_items();
         size_t byte_size() const;
-        const uint8_t* data() const;
+        void copy_to(uint8_t* data) const;
+        bool buffer_chunks(std::vector<ff::dxgi::buffer_chunk_t>& chunks); // CPU chunks get copied into new buffer chunks
 
         void render_start(size_t start);
         size_t render_start() const;
         size_t render_count() const;
 
     private:
+        struct chunk_t
+        {
+            uint8_t* data;
+            size_t size;
+            size_t used_size;
+            size_t buffer_chunk_id; // invalid for CPU memory
+        };
+
+        void add_chunk();
+        void update_current_chunk();
+
         ffdu::instance_bucket_type bucket_type_;
         const std::type_info& item_type_;
         size_t item_size_{};
         size_t item_align{};
         size_t render_start_{};
         size_t render_count_{};
+        std::vector<ffdu::instance_bucket::chunk_t> chunks;
+        ffdu::instance_bucket::chunk_t spare_chunk{}; // CPU memory kept between flushes
+        ff::dxgi::buffer_base* direct_buffer_{};
+        ff::dxgi::command_context_base* direct_context{};
+        size_t full_chunks_byte_size{};
+        size_t next_chunk_size{};
         uint8_t* data_start{};
         uint8_t* data_cur{};
         uint8_t* data_end{};
@@ -181,6 +209,147 @@ namespace ff::dxgi::draw_util
         std::array<ff::rect_float, ffdu::MAX_PALETTE_TEXTURES> texture_palette_sizes;
     };
 
+    // SIMD hash and exact bitwise compare for looking up transform matrixes
+    struct matrix_hash
+    {
+        size_t operator()(const DirectX::XMFLOAT4X4& value) const;
+    };
+
+    struct matrix_equal
+    {
+        bool operator()(const DirectX::XMFLOAT4X4& value1, const DirectX::XMFLOAT4X4& value2) const;
+    };
+
+    class draw_device_base;
+
+    /// <summary>
+    /// Records drawing on any thread, so that it can be drawn later by a draw_device_base
+    /// </summary>
+    /// <remarks>
+    /// Each recorder has its own world matrix and state stacks, and builds finished instances that only refer to
+    /// texture views and recorded matrixes. draw_base::draw_recorded maps those to the device's texture and matrix
+    /// slots and copies the instances in order, so drawing several recorders one after another gives the same result
+    /// as drawing everything directly. Recorders start with default state, and everything they refer to must
+    /// stay alive until they are drawn. There is no viewport culling, since the world rect isn't known yet.
+    /// Anything recorded on several threads at once must be safe to draw from multiple threads, like ff::animation and ff::sprite_font.
+    /// </remarks>
+    class draw_recorder : public ff::dxgi::draw_base
+    {
+    public:
+        draw_recorder();
+        virtual ~draw_recorder() override = default;
+
+        draw_recorder(draw_recorder&& other) noexcept = delete;
+        draw_recorder(const draw_recorder& other) = delete;
+        draw_recorder& operator=(draw_recorder&& other) noexcept = delete;
+        draw_recorder& operator=(const draw_recorder& other) = delete;
+
+        // Calls func for each recorder on the thread pool, and waits for them all to finish
+        static void record(std::span<ffdu::draw_recorder* const> recorders, const std::function<void(size_t index, ffdu::draw_recorder& recorder)>& func);
+
+        void reset(); // keeps memory for the next recording
+        bool empty() const;
+
+        virtual void end_draw() override;
+        virtual void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform) override;
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms) override;
+        virtual void draw_sprites(const ff::dxgi::sprite_batch_t& batch) override;
+        virtual void draw_lines(std::span<const ff::dxgi::endpoint_t> points) override;
+        virtual void draw_triangles(std::span<const ff::dxgi::endpoint_t> points) override;
+        virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness) override;
+        virtual void draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color) override;
+        virtual void draw_recorded(const ffdu::draw_recorder& recorder) override;
+
+        virtual ff::matrix_stack& world_matrix_stack() override;
+        virtual void push_palette(ff::dxgi::palette_base* palette) override;
+        virtual void pop_palette() override;
+        virtual void push_palette_remap(ff::dxgi::remap_t remap) override;
+        virtual void pop_palette_remap() override;
+        virtual void push_no_overlap() override;
+        virtual void pop_no_overlap() override;
+        virtual void push_opaque() override;
+        virtual void pop_opaque() override;
+        virtual void push_pre_multiplied_alpha() override;
+        virtual void pop_pre_multiplied_alpha() override;
+        virtual void push_custom_context(ff::dxgi::draw_base::custom_context_func&& func) override;
+        virtual void pop_custom_context() override;
+        virtual void push_sampler_linear_filter(bool linear_filter) override;
+        virtual void pop_sampler_linear_filter() override;
+
+    private:
+        friend class ffdu::draw_device_base;
+
+        enum class command_type : uint8_t
+        {
+            instance,
+            world_matrix,
+            push_palette,
+            pop_palette,
+            push_palette_remap,
+            pop_palette_remap,
+            push_pre_multiplied_alpha,
+            pop_pre_multiplied_alpha,
+            push_custom_context,
+            pop_custom_context,
+            push_sampler_linear_filter,
+            pop_sampler_linear_filter,
+        };
+
+        struct command_t
+        {
+            ffdu::draw_recorder::command_type type;
+            ffdu::instance_bucket_type bucket_type;
+            bool new_depth;
+            uint32_t index; // into the instances for bucket_type, matrixes, palettes, remaps, or custom_contexts
+            ff::dxgi::texture_view_base* view; // sprites only
+        };
+
+        template<class Source>
+        void draw_sprites(const Source& source, size_t count);
+
+        template<class T>
+        std::vector<T>& instances()
+        {
+            if constexpr (std::is_same_v<T, ffdu::sprite_instance>) return this->sprites;
+            else if constexpr (std::is_same_v<T, ffdu::line_instance>) return this->lines;
+            else if constexpr (std::is_same_v<T, ffdu::triangle_instance>) return this->triangles;
+            else if constexpr (std::is_same_v<T, ffdu::rectangle_instance>) return this->rectangles;
+            else return this->circles;
+        }
+
+        template<class T>
+        T& add_instance(ffdu::instance_bucket_type bucket_type, bool new_depth, ff::dxgi::texture_view_base* view = nullptr)
+        {
+            std::vector<T>& instances = this->instances<T>();
+            this->add_command(ffdu::draw_recorder::command_type::instance, instances.size(), bucket_type, new_depth, view);
+            return instances.emplace_back();
+        }
+
+        void add_command(ffdu::draw_recorder::command_type type, size_t index = 0, ffdu::instance_bucket_type bucket_type = {}, bool new_depth = false, ff::dxgi::texture_view_base* view = nullptr);
+        void matrix_changing(const ff::matrix_stack& matrix_stack);
+        bool nudge_depth(); // true when the depth needs to change
+        const uint8_t* palette_remap() const;
+
+        std::vector<ffdu::draw_recorder::command_t> commands;
+        std::vector<ffdu::sprite_instance> sprites;
+        std::vector<ffdu::line_instance> lines;
+        std::vector<ffdu::triangle_instance> triangles;
+        std::vector<ffdu::rectangle_instance> rectangles;
+        std::vector<ffdu::circle_instance> circles;
+        std::vector<DirectX::XMFLOAT4X4> matrixes;
+        std::vector<ff::dxgi::palette_base*> palettes;
+        std::vector<ff::dxgi::remap_t> remaps;
+        std::vector<ff::dxgi::draw_base::custom_context_func> custom_contexts;
+
+        ff::matrix_stack world_matrix_stack_;
+        ff::signal_connection world_matrix_stack_changing_connection;
+        std::vector<ff::dxgi::remap_t> palette_remap_stack;
+        ffdu::last_depth_type last_depth_type{};
+        int force_no_overlap{};
+        int force_opaque{};
+        bool matrix_current{};
+    };
+
     class draw_device_base : public ff::dxgi::draw_base, private ff::dxgi::device_child_base
     {
     public:
@@ -194,10 +363,13 @@ namespace ff::dxgi::draw_util
 
         virtual void end_draw() override;
         virtual void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform) override;
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms) override;
+        virtual void draw_sprites(const ff::dxgi::sprite_batch_t& batch) override;
         virtual void draw_lines(std::span<const ff::dxgi::endpoint_t> points) override;
         virtual void draw_triangles(std::span<const ff::dxgi::endpoint_t> points) override;
         virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness) override;
         virtual void draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color) override;
+        virtual void draw_recorded(const ffdu::draw_recorder& recorder) override;
 
         virtual ff::matrix_stack& world_matrix_stack() override;
         virtual void push_palette(ff::dxgi::palette_base* palette) override;
@@ -241,9 +413,11 @@ namespace ff::dxgi::draw_util
             ff::dxgi::texture_base& palette_texture, ff::dxgi::texture_base& palette_remap_texture) = 0;
         virtual bool apply_instance_state(ff::dxgi::command_context_base& context, const ffdu::instance_bucket& bucket) = 0;
         virtual void draw(ff::dxgi::command_context_base& context, ffdu::instance_bucket_type instance_type, size_t instance_start, size_t instance_count) = 0;
+        virtual std::shared_ptr<ff::dxgi::texture_base> create_palette_texture(ff::point_size size, DXGI_FORMAT format); // defaults to a render texture on the GPU
 
         ff::dxgi::device_child_base* as_device_child();
         bool internal_valid() const;
+        size_t internal_culled_count() const;
         bool linear_sampler() const;
         bool target_requires_palette() const;
         bool pre_multiplied_alpha() const;
@@ -260,8 +434,17 @@ namespace ff::dxgi::draw_util
         // device_child_base
         virtual bool reset() override;
 
+        struct deferred_sprite_t
+        {
+            ffdu::sprite_instance instance; // indexes only has the sampler set
+            ff::dxgi::texture_view_base* view;
+            size_t matrix_index; // into deferred_matrixes
+        };
+
         void destroy();
         void flush(bool end_draw = false);
+        void flush_batch(bool end_draw);
+        void update_instance_buckets_context();
 
         void matrix_changing(const ff::matrix_stack& matrix_stack);
         void init_vs_constants_buffer_0(ff::dxgi::target_base& target, const ff::rect_float& view_rect, const ff::rect_float& world_rect);
@@ -275,15 +458,24 @@ namespace ff::dxgi::draw_util
 
         uint32_t get_world_matrix_index();
         uint32_t get_world_matrix_index_no_flush();
+        uint32_t get_world_matrix_index_no_flush(const DirectX::XMFLOAT4X4& transposed_matrix);
         uint32_t get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette);
         uint32_t get_palette_index_no_flush();
         uint32_t get_palette_remap_index_no_flush();
-        uint32_t get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette);
+        bool can_defer_sprite(bool transparent, bool use_palette) const;
+        uint32_t get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette, bool can_defer = false);
+        ffdu::sprite_instance& add_deferred_sprite(ff::dxgi::texture_view_base& texture_view);
+        void add_deferred_sprites();
+        bool cull(const ff::rect_float& local_bounds, size_t instance_count = 1);
+        void update_cull_rect();
 
         const uint8_t* palette_remap() const;
         bool allow_transparent() const;
         void* add_instance_void(ffdu::instance_bucket_type bucket_type, float depth);
 
+        template<class Source>
+        void draw_sprites(const Source& source, size_t count);
+
         template<class T>
         T& add_instance(ffdu::instance_bucket_type bucket_type, float depth)
         {
@@ -313,9 +505,17 @@ namespace ff::dxgi::draw_util
         DirectX::XMFLOAT4X4 view_matrix{};
         ff::matrix_stack world_matrix_stack_;
         ff::signal_connection world_matrix_stack_changing_connection;
-        std::unordered_map<DirectX::XMFLOAT4X4, uint32_t, ff::stable_hash<DirectX::XMFLOAT4X4>> world_matrix_to_index;
+        std::unordered_map<DirectX::XMFLOAT4X4, uint32_t, ffdu::matrix_hash, ffdu::matrix_equal> world_matrix_to_index;
+        std::array<std::pair<size_t, uint32_t>, 16> world_matrix_id_cache; // direct mapped, matrix_stack::matrix_id() to index
         uint32_t world_matrix_index{};
 
+        // Culling
+        ff::rect_float cull_world_rect{};
+        ff::rect_float cull_rect{}; // cull_world_rect in the space of the current world matrix
+        size_t culled_count_{};
+        bool cull_enabled{};
+        bool cull_rect_valid{};
+
         // Textures
         std::array<ff::dxgi::texture_view_base*, ffdu::MAX_TEXTURES> textures{};
         std::array<ff::dxgi::texture_view_base*, ffdu::MAX_PALETTE_TEXTURES> textures_using_palette{};
@@ -339,6 +539,12 @@ namespace ff::dxgi::draw_util
 
         // Render data
         std::vector<ffdu::transparent_instance_entry> transparent_instances;
+        std::vector<ff::dxgi::buffer_chunk_t> instance_chunks;
+        std::vector<ffdu::draw_device_base::deferred_sprite_t> deferred_sprites; // opaque sprites that didn't fit into the texture or matrix slots
+        std::vector<DirectX::XMFLOAT4X4> deferred_matrixes;
+        bool deferred_matrix_current{};
+        bool has_depth{};
+        size_t flush_count{};
         std::array<ffdu::instance_bucket, static_cast<size_t>(ffdu::instance_bucket_type::count)> instance_buckets;
         ffdu::last_depth_type last_depth_type{};
         float draw_depth{};
@@ -0,0 +1,557 @@
+#include "pch.h"
+#include "graphics/dxgi/buffer_base.h"
+#include "graphics/dxgi/command_context_base.h"
+#include "graphics/dxgi/depth_base.h"
+#include "graphics/dxgi/recording_draw_device.h"
+#include "graphics/dxgi/target_access_base.h"
+#include "graphics/dxgi/target_base.h"
+#include "graphics/dxgi/texture_base.h"
+#include "graphics/dxgi/texture_view_access_base.h"
+
+namespace ffdu = ff::dxgi::draw_util;
+
+namespace
+{
+    class recording_command_context : public ff::dxgi::command_context_base
+    {
+    };
+
+    class recording_buffer : public ff::dxgi::buffer_base
+    {
+    public:
+        recording_buffer(ff::dxgi::buffer_type type)
+            : type_(type)
+        {}
+
+        const uint8_t* data() const
+        {
+            return this->data_.data();
+        }
+
+        virtual ff::dxgi::buffer_type type() const override
+        {
+            return this->type_;
+        }
+
+        virtual size_t size() const override
+        {
+            return this->data_.size();
+        }
+
+        virtual bool writable() const override
+        {
+            return true;
+        }
+
+        virtual bool update(ff::dxgi::command_context_base& context, const void* data, size_t size) override
+        {
+            this->data_.resize(size);
+            std::memcpy(this->data_.data(), data, size);
+            return true;
+        }
+
+        virtual void* map(ff::dxgi::command_context_base& context, size_t size) override
+        {
+            this->data_.resize(size);
+            return size ? this->data_.data() : nullptr;
+        }
+
+        virtual void unmap(ff::dxgi::command_context_base& context) override
+        {}
+
+        virtual void* map_chunk(ff::dxgi::command_context_base& context, size_t size, size_t& chunk_id) override
+        {
+            check_ret_val(size && size <= this->max_chunk_size_, nullptr);
+
+            chunk_id = this->mapped_chunks.size();
+            return this->mapped_chunks.emplace_back(size).data();
+        }
+
+        virtual bool unmap_chunks(ff::dxgi::command_context_base& context, size_t buffer_size, const ff::dxgi::buffer_chunk_t* chunks, size_t chunk_count) override
+        {
+            if (buffer_size)
+            {
+                this->data_.resize(buffer_size);
+
+                for (const ff::dxgi::buffer_chunk_t& chunk : std::span(chunks, chunk_count))
+                {
+                    assert(chunk.chunk_id < this->mapped_chunks.size() && chunk.offset + chunk.size <= buffer_size);
+                    std::memcpy(this->data_.data() + chunk.offset, this->mapped_chunks[chunk.chunk_id].data(), chunk.size);
+                }
+
+                this->unmapped_chunk_count_ += chunk_count;
+            }
+
+            this->mapped_chunks.clear();
+            return buffer_size != 0;
+        }
+
+        size_t unmapped_chunk_count() const
+        {
+            return this->unmapped_chunk_count_;
+        }
+
+        void max_chunk_size(size_t value)
+        {
+            this->max_chunk_size_ = value;
+        }
+
+        void clear_counts()
+        {
+            this->unmapped_chunk_count_ = 0;
+        }
+
+    private:
+        std::vector<uint8_t> data_;
+        std::vector<std::vector<uint8_t>> mapped_chunks; // from map_chunk, until unmap_chunks
+        ff::dxgi::buffer_type type_;
+        size_t max_chunk_size_{};
+        size_t unmapped_chunk_count_{};
+    };
+
+    class recording_texture : public ff::dxgi::texture_base, public ff::dxgi::texture_view_access_base
+    {
+    public:
+        recording_texture(ff::point_size size, DXGI_FORMAT format, ff::dxgi::sprite_type sprite_type)
+            : size_(size)
+            , format_(format)
+            , sprite_type_(sprite_type)
+        {}
+
+        // texture_metadata_base
+        virtual ff::point_size size() const override
+        {
+            return this->size_;
+        }
+
+        virtual size_t mip_count() const override
+        {
+            return 1;
+        }
+
+        virtual size_t array_size() const override
+        {
+            return 1;
+        }
+
+        virtual size_t sample_count() const override
+        {
+            return 1;
+        }
+
+        virtual DXGI_FORMAT format() const override
+        {
+            return this->format_;
+        }
+
+        // texture_view_base
+        virtual ff::dxgi::texture_view_access_base& view_access() override
+        {
+            return *this;
+        }
+
+        virtual ff::dxgi::texture_base* view_texture() override
+        {
+            return this;
+        }
+
+        virtual size_t view_array_start() const override
+        {
+            return 0;
+        }
+
+        virtual size_t view_array_size() const override
+        {
+            return 1;
+        }
+
+        virtual size_t view_mip_start() const override
+        {
+            return 0;
+        }
+
+        virtual size_t view_mip_size() const override
+        {
+            return 1;
+        }
+
+        // texture_base
+        virtual ff::dxgi::sprite_type sprite_type() const override
+        {
+            return this->sprite_type_;
+        }
+
+        virtual std::shared_ptr<DirectX::ScratchImage> data() const override
+        {
+            return nullptr;
+        }
+
+        virtual bool update(ff::dxgi::command_context_base& context, size_t array_index, size_t mip_index, const ff::point_size& pos, const DirectX::Image& data) override
+        {
+            return true;
+        }
+
+    private:
+        ff::point_size size_;
+        DXGI_FORMAT format_;
+        ff::dxgi::sprite_type sprite_type_;
+    };
+
+    class recording_target : public ff::dxgi::target_base, public ff::dxgi::target_access_base
+    {
+    public:
+        recording_target(const ff::window_size& size, DXGI_FORMAT format)
+            : size_(size)
+            , format_(format)
+        {}
+
+        virtual void clear(ff::dxgi::command_context_base& context, const ff::color& clear_color) override
+        {}
+
+        virtual void discard(ff::dxgi::command_context_base& context) override
+        {}
+
+        virtual bool begin_render(ff::dxgi::command_context_base& context, const ff::color* clear_color) override
+        {
+            return true;
+        }
+
+        virtual bool end_render(ff::dxgi::command_context_base& context) override
+        {
+            return true;
+        }
+
+        virtual ff::dxgi::target_access_base& target_access() override
+        {
+            return *this;
+        }
+
+        virtual size_t target_array_start() const override
+        {
+            return 0;
+        }
+
+        virtual size_t target_array_size() const override
+        {
+            return 1;
+        }
+
+        virtual size_t target_mip_start() const override
+        {
+            return 0;
+        }
+
+        virtual size_t target_mip_size() const override
+        {
+            return 1;
+        }
+
+        virtual size_t target_sample_count() const override
+        {
+            return 1;
+        }
+
+        virtual DXGI_FORMAT format() const override
+        {
+            return this->format_;
+        }
+
+        virtual ff::window_size size() const override
+        {
+            return this->size_;
+        }
+
+    private:
+        ff::window_size size_;
+        DXGI_FORMAT format_;
+    };
+
+    class recording_depth : public ff::dxgi::depth_base
+    {
+    public:
+        recording_depth(ff::point_size size)
+            : size(size)
+        {}
+
+        virtual ff::point_size physical_size() const override
+        {
+            return this->size;
+        }
+
+        virtual bool physical_size(ff::dxgi::command_context_base& context, const ff::point_size& size) override
+        {
+            this->size = size;
+            return true;
+        }
+
+        virtual size_t sample_count() const override
+        {
+            return 1;
+        }
+
+        virtual void clear(ff::dxgi::command_context_base& context, float depth, uint8_t stencil) const override
+        {}
+
+        virtual void clear_depth(ff::dxgi::command_context_base& context, float depth) const override
+        {}
+
+        virtual void clear_stencil(ff::dxgi::command_context_base& context, uint8_t stencil) const override
+        {}
+
+    private:
+        ff::point_size size;
+    };
+
+    class cpu_recording_draw_device : public ffdu::draw_device_base, public ff::dxgi::recording_draw_device
+    {
+    public:
+        cpu_recording_draw_device()
+        {
+            this->as_device_child()->reset();
+        }
+
+        cpu_recording_draw_device(cpu_recording_draw_device&& other) noexcept = delete;
+        cpu_recording_draw_device(const cpu_recording_draw_device& other) = delete;
+        cpu_recording_draw_device& operator=(cpu_recording_draw_device&& other) noexcept = delete;
+        cpu_recording_draw_device& operator=(const cpu_recording_draw_device& other) = delete;
+
+        // ff::dxgi::draw_device_base
+
+        virtual bool valid() const override
+        {
+            return this->internal_valid();
+        }
+
+        virtual size_t culled_count() const override
+        {
+            return this->internal_culled_count();
+        }
+
+        virtual ff::dxgi::draw_ptr begin_draw(
+            ff::dxgi::command_context_base& context,
+            ff::dxgi::target_base& target,
+            ff::dxgi::depth_base* depth,
+            const ff::rect_float& view_rect,
+            const ff::rect_float& world_rect,
+            ff::dxgi::draw_options options) override
+        {
+            return this->internal_begin_draw(context, target, depth, view_rect, world_rect, options);
+        }
+
+        // ff::dxgi::recording_draw_device
+
+        virtual ff::dxgi::command_context_base& command_context() override
+        {
+            return this->context;
+        }
+
+        virtual const std::vector<ff::dxgi::recording_draw_device::draw_call_t>& draw_calls() const override
+        {
+            return this->draw_calls_;
+        }
+
+        virtual const std::vector<uint8_t>& instance_data() const override
+        {
+            return this->instance_data_;
+        }
+
+        virtual const std::vector<ff::dxgi::texture_view_base*>& texture_views() const override
+        {
+            return this->texture_views_;
+        }
+
+        virtual size_t batch_count() const override
+        {
+            return this->batch_count_;
+        }
+
+        virtual size_t palette_update_count() const override
+        {
+            return this->palette_update_count_;
+        }
+
+        virtual size_t instance_chunk_count() const override
+        {
+            return this->instance_buffer_.unmapped_chunk_count();
+        }
+
+        virtual void record_instances(bool value) override
+        {
+            this->record_instances_ = value;
+        }
+
+        virtual void max_instance_chunk_size(size_t value) override
+        {
+            this->instance_buffer_.max_chunk_size(value);
+        }
+
+        virtual void clear() override
+        {
+            this->draw_calls_.clear();
+            this->instance_data_.clear();
+            this->texture_views_.clear();
+            this->batch_count_ = 0;
+            this->palette_update_count_ = 0;
+            this->instance_buffer_.clear_counts();
+        }
+
+    protected:
+        virtual void internal_destroy() override
+        {
+            assert(!this->setup_target);
+        }
+
+        virtual void internal_reset() override
+        {}
+
+        virtual ff::dxgi::command_context_base* internal_setup(
+            ff::dxgi::command_context_base& context,
+            ff::dxgi::target_base& target,
+            ff::dxgi::depth_base* depth,
+            const ff::rect_float& view_rect,
+            bool ignore_rotation) override
+        {
+            assert_msg_ret_val(&context == &this->context, "Use recording_draw_device::command_context()", nullptr);
+
+            this->setup_target = &target;
+            this->setup_depth = depth;
+            return &this->context;
+        }
+
+        virtual ff::dxgi::command_context_base* internal_flush(ff::dxgi::command_context_base* context, bool end_draw) override
+        {
+            if (end_draw)
+            {
+                this->setup_target = nullptr;
+                this->setup_depth = nullptr;
+                return nullptr;
+            }
+
+            return context;
+        }
+
+        virtual void internal_flush_begin(ff::dxgi::command_context_base* context) override
+        {}
+
+        virtual void internal_flush_end(ff::dxgi::command_context_base* context) override
+        {
+            this->batch_count_++;
+        }
+
+        virtual void update_palette_texture(ff::dxgi::command_context_base& context,
+            size_t textures_using_palette_count,
+            ff::dxgi::texture_base& palette_texture, size_t* palette_texture_hashes, palette_to_index_t& palette_to_index,
+            ff::dxgi::texture_base& palette_remap_texture, size_t* palette_remap_texture_hashes, palette_remap_to_index_t& palette_remap_to_index) override
+        {
+            this->palette_update_count_++;
+        }
+
+        virtual void apply_shader_input(ff::dxgi::command_context_base& context,
+            size_t texture_count, ff::dxgi::texture_view_base** textures,
+            size_t textures_using_palette_count, ff::dxgi::texture_view_base** textures_using_palette,
+            ff::dxgi::texture_base& palette_texture, ff::dxgi::texture_base& palette_remap_texture) override
+        {
+            this->applied_texture_start = this->texture_views_.size();
+            this->applied_texture_count = texture_count;
+            this->applied_textures_using_palette_count = textures_using_palette_count;
+            this->texture_views_.insert(this->texture_views_.end(), textures, textures + texture_count);
+        }
+
+        virtual bool apply_instance_state(ff::dxgi::command_context_base& context, const ffdu::instance_bucket& bucket) override
+        {
+            this->applied_instance_size = bucket.item_size();
+            return true;
+        }
+
+        virtual void draw(ff::dxgi::command_context_base& context, ffdu::instance_bucket_type instance_type, size_t instance_start, size_t instance_count) override
+        {
+            ff::dxgi::recording_draw_device::draw_call_t& draw_call = this->draw_calls_.emplace_back();
+            draw_call.instance_type = instance_type;
+            draw_call.batch = this->batch_count_;
+            draw_call.instance_start = instance_start;
+            draw_call.instance_count = instance_count;
+            draw_call.instance_size = this->applied_instance_size;
+            draw_call.texture_start = this->applied_texture_start;
+            draw_call.texture_count = this->applied_texture_count;
+            draw_call.textures_using_palette_count = this->applied_textures_using_palette_count;
+            draw_call.depth = this->setup_depth != nullptr;
+            draw_call.pre_multiplied_alpha = this->pre_multiplied_alpha();
+
+            if (this->record_instances_)
+            {
+                const size_t byte_start = instance_start * this->applied_instance_size;
+                const size_t byte_size = instance_count * this->applied_instance_size;
+                assert_ret(byte_start + byte_size <= this->instance_buffer_.size());
+
+                draw_call.data_offset = this->instance_data_.size();
+                this->instance_data_.insert(this->instance_data_.end(), this->instance_buffer_.data() + byte_start, this->instance_buffer_.data() + byte_start + byte_size);
+            }
+        }
+
+        virtual ff::dxgi::buffer_base& instance_buffer() override
+        {
+            return this->instance_buffer_;
+        }
+
+        virtual ff::dxgi::buffer_base& vs_constants_buffer_0() override
+        {
+            return this->vs_constants_buffer_0_;
+        }
+
+        virtual ff::dxgi::buffer_base& vs_constants_buffer_1() override
+        {
+            return this->vs_constants_buffer_1_;
+        }
+
+        virtual ff::dxgi::buffer_base& ps_constants_buffer_0() override
+        {
+            return this->ps_constants_buffer_0_;
+        }
+
+        virtual std::shared_ptr<ff::dxgi::texture_base> create_palette_texture(ff::point_size size, DXGI_FORMAT format) override
+        {
+            return ff::dxgi::create_recording_texture(size, format);
+        }
+
+    private:
+        ::recording_command_context context;
+        ::recording_buffer instance_buffer_{ ff::dxgi::buffer_type::vertex };
+        ::recording_buffer vs_constants_buffer_0_{ ff::dxgi::buffer_type::constant };
+        ::recording_buffer vs_constants_buffer_1_{ ff::dxgi::buffer_type::constant };
+        ::recording_buffer ps_constants_buffer_0_{ ff::dxgi::buffer_type::constant };
+        ff::dxgi::target_base* setup_target{};
+        ff::dxgi::depth_base* setup_depth{};
+
+        // Recorded data
+        std::vector<ff::dxgi::recording_draw_device::draw_call_t> draw_calls_;
+        std::vector<uint8_t> instance_data_;
+        std::vector<ff::dxgi::texture_view_base*> texture_views_;
+        size_t batch_count_{};
+        size_t palette_update_count_{};
+        size_t applied_instance_size{};
+        size_t applied_texture_start{};
+        size_t applied_texture_count{};
+        size_t applied_textures_using_palette_count{};
+        bool record_instances_{ true };
+    };
+}
+
+std::unique_ptr<ff::dxgi::recording_draw_device> ff::dxgi::create_recording_draw_device()
+{
+    return std::make_unique<::cpu_recording_draw_device>();
+}
+
+std::shared_ptr<ff::dxgi::texture_base> ff::dxgi::create_recording_texture(ff::point_size size, DXGI_FORMAT format, ff::dxgi::sprite_type sprite_type)
+{
+    return std::make_shared<::recording_texture>(size, format, sprite_type);
+}
+
+std::shared_ptr<ff::dxgi::target_base> ff::dxgi::create_recording_target(const ff::window_size& size, DXGI_FORMAT format)
+{
+    return std::make_shared<::recording_target>(size, format);
+}
+
+std::shared_ptr<ff::dxgi::depth_base> ff::dxgi::create_recording_depth(ff::point_size size)
+{
+    return std::make_shared<::recording_depth>(size);
+}
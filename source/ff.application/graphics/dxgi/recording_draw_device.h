@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../dxgi/draw_device_base.h"
+#include "../dxgi/draw_util.h"
+
+namespace ff
+{
+    struct window_size;
+}
+
+namespace ff::dxgi
+{
+    class command_context_base;
+    class depth_base;
+    class target_base;
+    class texture_base;
+    class texture_view_base;
+    enum class sprite_type;
+
+    /// <summary>
+    /// Draw device that runs all of the batching logic without a GPU, and records what would have been drawn
+    /// </summary>
+    /// <remarks>
+    /// Used for benchmarking draw throughput and for golden tests of batching decisions. Since nothing is
+    /// rendered, textures, targets, and depth buffers must come from the create_recording functions,
+    /// and begin_draw must use this device's command_context().
+    /// </remarks>
+    class recording_draw_device : public ff::dxgi::draw_device_base
+    {
+    public:
+        struct draw_call_t
+        {
+            ff::dxgi::draw_util::instance_bucket_type instance_type;
+            size_t batch; // counts up for every flush
+            size_t instance_start; // within the batch's instance buffer
+            size_t instance_count;
+            size_t instance_size;
+            size_t data_offset; // into instance_data(), or zero if instances aren't being recorded
+            size_t texture_start; // into texture_views()
+            size_t texture_count;
+            size_t textures_using_palette_count;
+            bool depth;
+            bool pre_multiplied_alpha;
+        };
+
+        virtual ff::dxgi::command_context_base& command_context() = 0;
+        virtual const std::vector<ff::dxgi::recording_draw_device::draw_call_t>& draw_calls() const = 0;
+        virtual const std::vector<uint8_t>& instance_data() const = 0; // instances for every draw call, in order
+        virtual const std::vector<ff::dxgi::texture_view_base*>& texture_views() const = 0; // textures applied for every batch, in order
+        virtual size_t batch_count() const = 0;
+        virtual size_t palette_update_count() const = 0;
+        virtual size_t instance_chunk_count() const = 0; // instance buffer chunks that were copied into place, batches that used map() add nothing
+        virtual void record_instances(bool value) = 0; // turn off to only measure batching, defaults to on
+        virtual void max_instance_chunk_size(size_t value) = 0; // bigger instance buffer chunks can't be mapped, defaults to zero so every batch uses map()
+        virtual void clear() = 0;
+
+        template<class T>
+        std::span<const T> instances(const ff::dxgi::recording_draw_device::draw_call_t& draw_call) const
+        {
+            assert_ret_val(sizeof(T) == draw_call.instance_size && draw_call.data_offset + sizeof(T) * draw_call.instance_count <= this->instance_data().size(), {});
+            return { reinterpret_cast<const T*>(this->instance_data().data() + draw_call.data_offset), draw_call.instance_count };
+        }
+
+        // The low byte of a non-palette sprite's texture index is an index into this span
+        std::span<ff::dxgi::texture_view_base* const> textures(const ff::dxgi::recording_draw_device::draw_call_t& draw_call) const
+        {
+            assert_ret_val(draw_call.texture_start + draw_call.texture_count <= this->texture_views().size(), {});
+            return { this->texture_views().data() + draw_call.texture_start, draw_call.texture_count };
+        }
+    };
+
+    std::unique_ptr<ff::dxgi::recording_draw_device> create_recording_draw_device();
+    std::shared_ptr<ff::dxgi::texture_base> create_recording_texture(ff::point_size size, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM, ff::dxgi::sprite_type sprite_type = {});
+    std::shared_ptr<ff::dxgi::target_base> create_recording_target(const ff::window_size& size, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM);
+    std::shared_ptr<ff::dxgi::depth_base> create_recording_depth(ff::point_size size);
+}
@@ -4,11 +4,40 @@
 #include "graphics/types/matrix.h"
 #include "graphics/types/transform.h"
 
+// Each visual has cursors for its visual, color, position, scale, and rotate keys
+constexpr size_t CURSORS_PER_VISUAL = 5;
+
+// Baked floats for each visual: position, scale, rotation, color
+constexpr size_t BAKED_FLOATS = 9;
+constexpr size_t BAKED_INDEXES = 2;
+
+// Uses the compiled curve for numeric keys, which doesn't allocate, and falls back to converting the key value
+template<class T>
+static bool get_key_value(const ff::animation_keys& keys, float frame, const ff::dict* params, ff::animation_keys::cursor_t* cursor, T& value)
+{
+    constexpr size_t float_count = sizeof(T) / sizeof(float);
+    if (keys.float_count() == float_count)
+    {
+        return keys.get_floats(frame, reinterpret_cast<float*>(&value), float_count, cursor);
+    }
+
+    ff::value_ptr converted_value = keys.get_value(frame, params, cursor)->try_convert<T>();
+    if (converted_value)
+    {
+        value = converted_value->get<T>();
+        return true;
+    }
+
+    return false;
+}
+
 ff::animation::animation()
     : play_length_(0)
     , frame_length_(0)
     , frames_per_second_(0)
     , method(ff::animation_keys::method_t::none)
+    , baked_frames_per_sample(0)
+    , baked_sample_count(0)
 {}
 
 float ff::animation::frame_length() const
@@ -58,96 +87,112 @@ void ff::animation::frame_events(float start, float end, bool include_start, ff:
 
 void ff::animation::draw_frame(ff::dxgi::draw_base& draw, const ff::transform& transform, float frame, const ff::dict* params)
 {
-    if (!ff::animation_keys::adjust_frame(frame, 0.0f, this->frame_length_, this->method))
+    this->draw_frames(draw, std::span<const ff::transform>(&transform, 1), frame, params);
+}
+
+void ff::animation::draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params)
+{
+    this->draw_frames(draw, transforms, frame, params, nullptr);
+}
+
+void ff::animation::draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params, ff::animation::cursors_t* cursors)
+{
+    if (cursors && cursors->size() != this->visuals.size() * ::CURSORS_PER_VISUAL)
+    {
+        cursors->resize(this->visuals.size() * ::CURSORS_PER_VISUAL);
+    }
+
+    if (transforms.empty() || !ff::animation_keys::adjust_frame(frame, 0.0f, this->frame_length_, this->method))
     {
         return;
     }
 
-    bool push_transform = (transform.rotation != 0);
-    const ff::transform& draw_transform = push_transform ? ff::transform::identity() : transform;
+    // Keys only depend on the frame, so they are evaluated once no matter how many times the frame is drawn
+    ff::stack_vector<ff::animation::visual_frame_t, 16> visual_frames;
+    const bool use_baked = this->baked_sample_count && !params;
 
-    if (push_transform)
+    for (size_t i = 0; i < this->visuals.size(); i++)
     {
-        draw.world_matrix_stack().push();
+        ff::animation::visual_frame_t state;
 
-        DirectX::XMFLOAT4X4 matrix;
-        DirectX::XMStoreFloat4x4(&matrix, transform.matrix());
-        draw.world_matrix_stack().transform(matrix);
-    }
+        if (use_baked)
+        {
+            if (this->baked_visual_frame(i, frame, state))
+            {
+                visual_frames.push_back(state);
+            }
 
-    for (const ff::animation::visual_info& info : this->visuals)
-    {
+            continue;
+        }
+
+        const ff::animation::visual_info& info = this->visuals[i];
         float visual_frame = frame - info.start;
         if (!ff::animation_keys::adjust_frame(visual_frame, 0.0f, info.length, info.method))
         {
             continue;
         }
 
-        const ff::animation::cached_visuals_t* visuals = this->get_cached_visuals(info.visual_keys ? info.visual_keys->get_value(visual_frame, params) : nullptr);
-        if (!visuals || visuals->empty())
+        ff::animation_keys::cursor_t* visual_cursors = cursors ? cursors->data() + i * ::CURSORS_PER_VISUAL : nullptr;
+        state.visuals = this->get_cached_visuals(this->key_visual_frame(info, visual_frame, params, visual_cursors, state));
+        if (state.visuals && !state.visuals->empty())
         {
-            continue;
+            visual_frames.push_back(state);
         }
+    }
 
-        ff::transform visual_transform = draw_transform;
+    if (visual_frames.empty())
+    {
+        return;
+    }
 
-        if (info.position_keys)
-        {
-            ff::value_ptr value = info.position_keys->get_value(visual_frame, params)->try_convert<ff::point_float>();
-            if (value)
-            {
-                visual_transform.position += value->get<ff::point_float>() * draw_transform.scale;
-            }
-        }
+    for (const ff::transform& transform : transforms)
+    {
+        bool push_transform = (transform.rotation != 0);
+        const ff::transform& draw_transform = push_transform ? ff::transform::identity() : transform;
 
-        if (info.scale_keys)
+        if (push_transform)
         {
-            ff::value_ptr value = info.scale_keys->get_value(visual_frame, params)->try_convert<ff::point_float>();
-            if (value)
-            {
-                visual_transform.scale *= value->get<ff::point_float>();
-            }
-        }
+            draw.world_matrix_stack().push();
 
-        if (info.rotate_keys)
-        {
-            ff::value_ptr value = info.rotate_keys->get_value(visual_frame, params)->try_convert<float>();
-            if (value)
-            {
-                visual_transform.rotation += value->get<float>();
-            }
+            DirectX::XMFLOAT4X4 matrix;
+            DirectX::XMStoreFloat4x4(&matrix, transform.matrix());
+            draw.world_matrix_stack().transform(matrix);
         }
 
-        if (info.color_keys)
+        for (const ff::animation::visual_frame_t& state : visual_frames)
         {
-            ff::value_ptr value = info.color_keys->get_value(visual_frame, params);
-            ff::value_ptr rect_value = value->try_convert<ff::rect_float>();
-            ff::value_ptr int_value = value->try_convert<int>();
+            ff::transform visual_transform = draw_transform;
+            visual_transform.position += state.position * draw_transform.scale;
+            visual_transform.scale *= state.scale;
+            visual_transform.rotation += state.rotation;
 
-            if (rect_value)
+            if (state.palette_color)
+            {
+                visual_transform.color = ff::color(*state.palette_color);
+            }
+            else
             {
                 DirectX::XMStoreFloat4(&visual_transform.color.rgba(),
-                    DirectX::XMVectorMultiply(
-                        DirectX::XMLoadFloat4(&visual_transform.color.rgba()),
-                        DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&rect_value->get<ff::rect_float>()))));
+                    DirectX::XMVectorMultiply(DirectX::XMLoadFloat4(&visual_transform.color.rgba()), DirectX::XMLoadFloat4(&state.color)));
             }
-            else if (int_value)
+
+            for (auto& anim_visual : *state.visuals)
             {
-                visual_transform.color = ff::color(int_value->get<int>());
+                float visual_anim_frame = (this->frames_per_second_ != 0.0f) ? state.frame * anim_visual->frames_per_second() / this->frames_per_second_ : 0.0f;
+                anim_visual->draw_frame(draw, visual_transform, visual_anim_frame, params);
             }
         }
 
-        for (auto& anim_visual : *visuals)
+        if (push_transform)
         {
-            float visual_anim_frame = (this->frames_per_second_ != 0.0f) ? visual_frame * anim_visual->frames_per_second() / this->frames_per_second_ : 0.0f;
-            anim_visual->draw_frame(draw, visual_transform, visual_anim_frame, params);
+            draw.world_matrix_stack().pop();
         }
     }
+}
 
-    if (push_transform)
-    {
-        draw.world_matrix_stack().pop();
-    }
+bool ff::animation::baked() const
+{
+    return this->baked_sample_count > 0;
 }
 
 ff::value_ptr ff::animation::frame_value(size_t value_id, float frame, const ff::dict* params)
@@ -240,9 +285,23 @@ bool ff::animation::load(const ff::dict& dict, bool from_source, ff::resource_lo
     this->frames_per_second_ = dict.get<float>("fps");
     this->method = ff::animation_keys::load_method(dict, from_source);
 
-    return this->load_keys(dict.get<ff::dict>("keys"), from_source, context) &&
-        this->load_visuals(dict.get<std::vector<ff::value_ptr>>("visuals"), from_source, context) &&
-        this->load_events(dict.get<std::vector<ff::value_ptr>>("events"), from_source, context);
+    if (!this->load_keys(dict.get<ff::dict>("keys"), from_source, context) ||
+        !this->load_visuals(dict.get<std::vector<ff::value_ptr>>("visuals"), from_source, context) ||
+        !this->load_events(dict.get<std::vector<ff::value_ptr>>("events"), from_source, context))
+    {
+        return false;
+    }
+
+    if (from_source && dict.get<bool>("bake"))
+    {
+        this->bake();
+    }
+    else if (!from_source && !this->load_baked(dict))
+    {
+        return false;
+    }
+
+    return true;
 }
 
 bool ff::animation::load_events(const std::vector<ff::value_ptr>& values, bool from_source, ff::resource_load_context& context)
@@ -337,7 +396,248 @@ bool ff::animation::load_keys(const ff::dict& values, bool from_source, ff::reso
     return true;
 }
 
+bool ff::animation::load_baked(const ff::dict& dict)
+{
+    const size_t sample_count = dict.get<size_t>("baked_samples");
+    check_ret_val(sample_count, true);
+
+    const size_t visual_count = this->visuals.size();
+    this->baked_ranges = dict.get<std::vector<float>>("baked_ranges");
+    this->baked_indexes = dict.get<std::vector<int>>("baked_indexes");
+    this->baked_visuals = dict.get<std::vector<ff::value_ptr>>("baked_visuals");
+    this->baked_floats.resize(sample_count * visual_count * ::BAKED_FLOATS);
+
+    assert_ret_val(this->baked_ranges.size() == visual_count * ::BAKED_FLOATS * 2 &&
+        this->baked_indexes.size() == sample_count * visual_count * ::BAKED_INDEXES &&
+        dict.get_bytes("baked_floats", this->baked_floats.data(), ff::vector_byte_size(this->baked_floats)), false);
+
+    this->baked_frames_per_sample = dict.get<float>("baked_frames_per_sample");
+    this->baked_sample_count = sample_count;
+    this->baked_cached_visuals.assign(this->baked_visuals.size(), nullptr);
+
+    return true;
+}
+
+void ff::animation::save_baked_to_cache(ff::dict& dict) const
+{
+    check_ret(this->baked_sample_count);
+
+    dict.set<size_t>("baked_samples", this->baked_sample_count);
+    dict.set<float>("baked_frames_per_sample", this->baked_frames_per_sample);
+    dict.set<std::vector<float>>("baked_ranges", std::vector<float>(this->baked_ranges));
+    dict.set<std::vector<int>>("baked_indexes", std::vector<int>(this->baked_indexes));
+    dict.set<std::vector<ff::value_ptr>>("baked_visuals", std::vector<ff::value_ptr>(this->baked_visuals));
+    dict.set_bytes("baked_floats", this->baked_floats.data(), ff::vector_byte_size(this->baked_floats));
+}
+
+// Samples keys at every update tick, so drawing only needs to look up and blend two samples
+void ff::animation::bake()
+{
+    const float frames_per_sample = this->frames_per_second_ / ff::constants::updates_per_second<float>();
+    check_ret(frames_per_sample > 0.0f && this->frame_length_ > 0.0f && !this->visuals.empty());
+
+    const size_t visual_count = this->visuals.size();
+    const size_t sample_count = static_cast<size_t>(std::ceil(this->frame_length_ / frames_per_sample)) + 1;
+    const size_t stride = visual_count * ::BAKED_FLOATS;
+    const ff::dict params;
+    std::vector<float> values(sample_count * stride);
+    std::unordered_map<ff::value_ptr, int> visual_to_index;
+    ff::animation::cursors_t cursors(visual_count * ::CURSORS_PER_VISUAL);
+
+    this->baked_indexes.assign(sample_count * visual_count * ::BAKED_INDEXES, -1);
+    this->baked_visuals.clear();
+
+    for (size_t sample = 0; sample < sample_count; sample++)
+    {
+        const float frame = std::min(sample * frames_per_sample, this->frame_length_);
+
+        for (size_t i = 0; i < visual_count; i++)
+        {
+            const ff::animation::visual_info& info = this->visuals[i];
+            const size_t offset = sample * visual_count + i;
+            ff::animation::visual_frame_t state;
+            ff::value_ptr visual_value;
+
+            float visual_frame = frame - info.start;
+            if (ff::animation_keys::adjust_frame(visual_frame, 0.0f, info.length, info.method))
+            {
+                visual_value = this->key_visual_frame(info, visual_frame, &params, cursors.data() + i * ::CURSORS_PER_VISUAL, state);
+            }
+
+            if (visual_value)
+            {
+                auto [iter, inserted] = visual_to_index.try_emplace(visual_value, static_cast<int>(this->baked_visuals.size()));
+                if (inserted)
+                {
+                    this->baked_visuals.push_back(visual_value);
+                }
+
+                this->baked_indexes[offset * ::BAKED_INDEXES] = iter->second;
+                this->baked_indexes[offset * ::BAKED_INDEXES + 1] = state.palette_color.value_or(-1);
+            }
+
+            float* sample_values = &values[offset * ::BAKED_FLOATS];
+            sample_values[0] = state.position.x;
+            sample_values[1] = state.position.y;
+            sample_values[2] = state.scale.x;
+            sample_values[3] = state.scale.y;
+            sample_values[4] = state.rotation;
+            sample_values[5] = state.color.x;
+            sample_values[6] = state.color.y;
+            sample_values[7] = state.color.z;
+            sample_values[8] = state.color.w;
+        }
+    }
+
+    // Quantize each float of each visual within its own range
+    this->baked_ranges.resize(stride * 2);
+    this->baked_floats.resize(values.size());
+
+    for (size_t i = 0; i < stride; i++)
+    {
+        float min_value = std::numeric_limits<float>::max();
+        float max_value = std::numeric_limits<float>::lowest();
+
+        for (size_t h = i; h < values.size(); h += stride)
+        {
+            min_value = std::min(min_value, values[h]);
+            max_value = std::max(max_value, values[h]);
+        }
+
+        const float step = (max_value - min_value) / static_cast<float>(std::numeric_limits<uint16_t>::max());
+        this->baked_ranges[i * 2] = min_value;
+        this->baked_ranges[i * 2 + 1] = step;
+
+        for (size_t h = i; h < values.size(); h += stride)
+        {
+            this->baked_floats[h] = (step > 0.0f) ? static_cast<uint16_t>(std::lround((values[h] - min_value) / step)) : 0;
+        }
+    }
+
+    this->baked_frames_per_sample = frames_per_sample;
+    this->baked_sample_count = sample_count;
+    this->baked_cached_visuals.assign(this->baked_visuals.size(), nullptr);
+}
+
+ff::value_ptr ff::animation::key_visual_frame(const ff::animation::visual_info& info, float visual_frame, const ff::dict* params, ff::animation_keys::cursor_t* cursors, ff::animation::visual_frame_t& state) const
+{
+    ff::value_ptr visual_value = info.visual_keys ? info.visual_keys->get_value(visual_frame, params, cursors) : nullptr;
+    if (!visual_value)
+    {
+        return nullptr;
+    }
+
+    state.frame = visual_frame;
+
+    if (info.position_keys)
+    {
+        ::get_key_value(*info.position_keys, visual_frame, params, cursors ? cursors + 2 : nullptr, state.position);
+    }
+
+    if (info.scale_keys)
+    {
+        ::get_key_value(*info.scale_keys, visual_frame, params, cursors ? cursors + 3 : nullptr, state.scale);
+    }
+
+    if (info.rotate_keys)
+    {
+        ::get_key_value(*info.rotate_keys, visual_frame, params, cursors ? cursors + 4 : nullptr, state.rotation);
+    }
+
+    if (info.color_keys && info.color_keys->float_count() == 4)
+    {
+        info.color_keys->get_floats(visual_frame, &state.color.x, 4, cursors ? cursors + 1 : nullptr);
+    }
+    else if (info.color_keys)
+    {
+        ff::value_ptr value = info.color_keys->get_value(visual_frame, params, cursors ? cursors + 1 : nullptr);
+        ff::value_ptr rect_value = value->try_convert<ff::rect_float>();
+        ff::value_ptr int_value = value->try_convert<int>();
+
+        if (rect_value)
+        {
+            state.color = *reinterpret_cast<const DirectX::XMFLOAT4*>(&rect_value->get<ff::rect_float>());
+        }
+        else if (int_value)
+        {
+            state.palette_color = int_value->get<int>();
+        }
+    }
+
+    return visual_value;
+}
+
+bool ff::animation::baked_visual_frame(size_t visual_index, float frame, ff::animation::visual_frame_t& state)
+{
+    const ff::animation::visual_info& info = this->visuals[visual_index];
+    float visual_frame = frame - info.start;
+    check_ret_val(ff::animation_keys::adjust_frame(visual_frame, 0.0f, info.length, info.method), false);
+
+    const size_t visual_count = this->visuals.size();
+    const float sample = std::max(frame / this->baked_frames_per_sample, 0.0f);
+    const size_t sample0 = std::min(static_cast<size_t>(sample), this->baked_sample_count - 1);
+    const size_t sample1 = std::min(sample0 + 1, this->baked_sample_count - 1);
+    const int* indexes0 = &this->baked_indexes[(sample0 * visual_count + visual_index) * ::BAKED_INDEXES];
+    const int* indexes1 = &this->baked_indexes[(sample1 * visual_count + visual_index) * ::BAKED_INDEXES];
+    check_ret_val(indexes0[0] >= 0, false);
+
+    const ff::animation::cached_visuals_t* visuals;
+    {
+        std::scoped_lock lock(this->cached_visuals_mutex);
+        const ff::animation::cached_visuals_t*& cached = this->baked_cached_visuals[indexes0[0]];
+        if (!cached)
+        {
+            cached = this->get_cached_visuals_here(this->baked_visuals[indexes0[0]]);
+        }
+
+        visuals = cached;
+    }
+
+    check_ret_val(visuals && !visuals->empty(), false);
+
+    // Only blend with the next sample when it shows the same thing, and not across the loop point of a looping visual
+    float sample_frame0 = std::min(sample0 * this->baked_frames_per_sample, this->frame_length_) - info.start;
+    float sample_frame1 = std::min(sample1 * this->baked_frames_per_sample, this->frame_length_) - info.start;
+    const bool wrapped =
+        !ff::animation_keys::adjust_frame(sample_frame0, 0.0f, info.length, info.method) ||
+        !ff::animation_keys::adjust_frame(sample_frame1, 0.0f, info.length, info.method) ||
+        sample_frame1 < sample_frame0;
+    const bool blend = !wrapped && indexes0[0] == indexes1[0] && indexes0[1] == indexes1[1];
+    const float time = blend ? std::min(sample - sample0, 1.0f) : 0.0f;
+    const uint16_t* floats0 = &this->baked_floats[(sample0 * visual_count + visual_index) * ::BAKED_FLOATS];
+    const uint16_t* floats1 = &this->baked_floats[(sample1 * visual_count + visual_index) * ::BAKED_FLOATS];
+    const float* ranges = &this->baked_ranges[visual_index * ::BAKED_FLOATS * 2];
+    std::array<float, ::BAKED_FLOATS> values;
+
+    for (size_t i = 0; i < ::BAKED_FLOATS; i++)
+    {
+        const float quantized = floats0[i] + (static_cast<float>(floats1[i]) - floats0[i]) * time;
+        values[i] = ranges[i * 2] + quantized * ranges[i * 2 + 1];
+    }
+
+    state.visuals = visuals;
+    state.frame = visual_frame;
+    state.position = ff::point_float(values[0], values[1]);
+    state.scale = ff::point_float(values[2], values[3]);
+    state.rotation = values[4];
+    state.color = DirectX::XMFLOAT4(values[5], values[6], values[7], values[8]);
+
+    if (indexes0[1] >= 0)
+    {
+        state.palette_color = indexes0[1];
+    }
+
+    return true;
+}
+
 const ff::animation::cached_visuals_t* ff::animation::get_cached_visuals(const ff::value_ptr& value)
+{
+    std::scoped_lock lock(this->cached_visuals_mutex);
+    return this->get_cached_visuals_here(value);
+}
+
+// Caller must own the cached_visuals_mutex lock
+const ff::animation::cached_visuals_t* ff::animation::get_cached_visuals_here(const ff::value_ptr& value)
 {
     if (!value)
     {
@@ -367,7 +667,7 @@ const ff::animation::cached_visuals_t* ff::animation::get_cached_visuals(const f
 
             for (ff::value_ptr child_value : values)
             {
-                const ff::animation::cached_visuals_t* child_visuals = this->get_cached_visuals(child_value);
+                const ff::animation::cached_visuals_t* child_visuals = this->get_cached_visuals_here(child_value);
                 if (child_visuals)
                 {
                     visuals.insert(visuals.end(), child_visuals->begin(), child_visuals->end());
@@ -392,6 +692,7 @@ bool ff::animation::save_to_cache(ff::dict& dict) const
     dict.set<std::vector<ff::value_ptr>>("events", this->save_events_to_cache());
     dict.set<std::vector<ff::value_ptr>>("visuals", this->save_visuals_to_cache());
     dict.set<ff::dict>("keys", this->save_keys_to_cache());
+    this->save_baked_to_cache(dict);
 
     return true;
 }
@@ -462,6 +763,11 @@ void ff::create_animation::add_visual(float start, float length, float speed, ff
     this->visuals.push_back(ff::value::create<ff::dict>(std::move(dict)));
 }
 
+void ff::create_animation::bake(bool value)
+{
+    this->dict.set<bool>("bake", value);
+}
+
 std::shared_ptr<ff::animation> ff::create_animation::create() const
 {
     ff::dict dict = this->dict;
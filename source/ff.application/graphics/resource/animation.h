@@ -18,10 +18,10 @@ namespace ff
     {
     public:
         animation();
-        animation(animation&& other) noexcept = default;
+        animation(animation&& other) noexcept = delete;
         animation(const animation& other) = delete;
 
-        animation& operator=(animation&& other) noexcept = default;
+        animation& operator=(animation&& other) noexcept = delete;
         animation& operator=(const animation & other) = delete;
 
         // animation_base
@@ -29,8 +29,14 @@ namespace ff
         virtual float frames_per_second() const override;
         virtual void frame_events(float start, float end, bool include_start, ff::push_base<ff::animation_event>& events) override;
         virtual void draw_frame(ff::dxgi::draw_base& draw, const ff::transform& transform, float frame, const ff::dict* params = nullptr) override;
+        virtual void draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params = nullptr) override;
         virtual ff::value_ptr frame_value(size_t value_id, float frame, const ff::dict* params = nullptr) override;
 
+        // Keeps key cursors for every visual, so an animation player can draw each new frame without searching keys
+        using cursors_t = typename std::vector<ff::animation_keys::cursor_t>;
+        void draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params, ff::animation::cursors_t* cursors);
+        bool baked() const; // set "bake" in the source to sample keys at every update, params can't be used with baked keys
+
     protected:
         virtual bool save_to_cache(ff::dict& dict) const override;
 
@@ -62,6 +68,20 @@ namespace ff
             ff::animation_event public_event;
         };
 
+        using cached_visuals_t = typename std::vector<std::shared_ptr<ff::animation_base>>;
+
+        // Key values for one visual at one frame, which are the same wherever the frame is drawn
+        struct visual_frame_t
+        {
+            const ff::animation::cached_visuals_t* visuals{};
+            float frame{};
+            ff::point_float position{ 0.0f, 0.0f };
+            ff::point_float scale{ 1.0f, 1.0f };
+            float rotation{};
+            DirectX::XMFLOAT4 color{ 1.0f, 1.0f, 1.0f, 1.0f }; // multiplied with the draw color
+            std::optional<int> palette_color; // replaces the draw color
+        };
+
         std::vector<ff::value_ptr> save_events_to_cache() const;
         std::vector<ff::value_ptr> save_visuals_to_cache() const;
         ff::dict save_keys_to_cache() const;
@@ -69,9 +89,14 @@ namespace ff
         bool load_events(const std::vector<ff::value_ptr>& values, bool from_source, ff::resource_load_context& context);
         bool load_visuals(const std::vector<ff::value_ptr>& values, bool from_source, ff::resource_load_context& context);
         bool load_keys(const ff::dict& values, bool from_source, ff::resource_load_context& context);
+        bool load_baked(const ff::dict& dict);
+        void save_baked_to_cache(ff::dict& dict) const;
+        void bake();
 
-        using cached_visuals_t = typename std::vector<std::shared_ptr<ff::animation_base>>;
+        ff::value_ptr key_visual_frame(const ff::animation::visual_info& info, float visual_frame, const ff::dict* params, ff::animation_keys::cursor_t* cursors, ff::animation::visual_frame_t& state) const;
+        bool baked_visual_frame(size_t visual_index, float frame, ff::animation::visual_frame_t& state);
         const ff::animation::cached_visuals_t* get_cached_visuals(const ff::value_ptr& value);
+        const ff::animation::cached_visuals_t* get_cached_visuals_here(const ff::value_ptr& value);
 
         float play_length_;
         float frame_length_;
@@ -80,7 +105,19 @@ namespace ff
         std::vector<visual_info> visuals;
         std::vector<event_info> events;
         std::unordered_map<size_t, ff::animation_keys, ff::no_hash<size_t>> keys;
-        mutable std::unordered_map<ff::value_ptr, ff::animation::cached_visuals_t> cached_visuals;
+        // Drawing can happen on several threads at once (like with draw recorders), so the caches need a lock.
+        // Cached entries are never removed, so pointers to them stay valid after unlocking.
+        std::mutex cached_visuals_mutex;
+        std::unordered_map<ff::value_ptr, ff::animation::cached_visuals_t> cached_visuals;
+
+        // Keys sampled once per update, each float is quantized to 16 bits within its range
+        float baked_frames_per_sample;
+        size_t baked_sample_count;
+        std::vector<float> baked_ranges; // minimum and step for each float of each visual
+        std::vector<uint16_t> baked_floats; // for each sample, for each visual: position, scale, rotation, color
+        std::vector<int> baked_indexes; // for each sample, for each visual: index into baked_visuals and palette color, or -1
+        std::vector<ff::value_ptr> baked_visuals;
+        std::vector<const ff::animation::cached_visuals_t*> baked_cached_visuals; // resolved when first drawn
     };
 
     class create_animation
@@ -106,6 +143,7 @@ namespace ff
             std::string_view scale_keys,
             std::string_view rotate_keys);
 
+        void bake(bool value = true);
         std::shared_ptr<ff::animation> create() const;
 
     private:
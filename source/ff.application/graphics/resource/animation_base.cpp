@@ -20,6 +20,14 @@ void ff::animation_base::draw_frame(ff::dxgi::draw_base& draw, const ff::pixel_t
     this->draw_frame(draw, ff::transform(transform), frame, params);
 }
 
+void ff::animation_base::draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params)
+{
+    for (const ff::transform& transform : transforms)
+    {
+        this->draw_frame(draw, transform, frame, params);
+    }
+}
+
 ff::value_ptr ff::animation_base::frame_value(size_t value_id, float frame, const ff::dict* params)
 {
     return ff::value_ptr();
@@ -28,6 +28,7 @@ namespace ff
         virtual void frame_events(float start, float end, bool include_start, ff::push_base<ff::animation_event>& events);
         virtual void draw_frame(ff::dxgi::draw_base& draw, const ff::transform& transform, float frame, const ff::dict* params = nullptr) = 0;
         virtual void draw_frame(ff::dxgi::draw_base& draw, const ff::pixel_transform& transform, float frame, const ff::dict* params = nullptr);
+        virtual void draw_frames(ff::dxgi::draw_base& draw, std::span<const ff::transform> transforms, float frame, const ff::dict* params = nullptr); // same frame in many places
         virtual ff::value_ptr frame_value(size_t value_id, float frame, const ff::dict* params = nullptr);
     };
 }
@@ -15,13 +15,41 @@ ff::animation_keys::animation_keys()
     : start_(0)
     , length_(0)
     , method(method_t::none)
+    , curve_default{}
+    , float_count_(0)
+    , curve_has_default(false)
 {}
 
-ff::value_ptr ff::animation_keys::get_value(float frame, const ff::dict* params) const
+// Same result as std::lower_bound, but first checks if the frame is still in the cursor's segment or the next one
+template<class T>
+size_t ff::animation_keys::find_key(const T* keys, size_t key_count, float frame, ff::animation_keys::cursor_t* cursor)
+{
+    if (!cursor)
+    {
+        return std::lower_bound(keys, keys + key_count, frame) - keys;
+    }
+
+    const auto in_segment = [keys, key_count, frame](size_t i)
+        {
+            return i <= key_count && (!i || keys[i - 1] < frame) && (i == key_count || !(keys[i] < frame));
+        };
+
+    size_t index = cursor->key_index;
+    if (!in_segment(index) && !in_segment(++index))
+    {
+        // Seeked or looped
+        index = std::lower_bound(keys, keys + key_count, frame) - keys;
+    }
+
+    cursor->key_index = index;
+    return index;
+}
+
+ff::value_ptr ff::animation_keys::get_value(float frame, const ff::dict* params, ff::animation_keys::cursor_t* cursor) const
 {
     if (this->keys.size() && this->adjust_frame(frame, this->start_, this->length_, this->method))
     {
-        auto key_iter = std::lower_bound(this->keys.cbegin(), this->keys.cend(), frame);
+        auto key_iter = this->keys.cbegin() + ff::animation_keys::find_key(this->keys.data(), this->keys.size(), frame, cursor);
         if (key_iter == this->keys.cend())
         {
             return this->keys.back().value;
@@ -43,6 +71,63 @@ ff::value_ptr ff::animation_keys::get_value(float frame, const ff::dict* params)
     return this->default_value && !this->default_value->is_type<nullptr_t>() ? this->default_value : nullptr;
 }
 
+size_t ff::animation_keys::float_count() const
+{
+    return this->float_count_;
+}
+
+bool ff::animation_keys::get_floats(float frame, float* values, size_t value_count, ff::animation_keys::cursor_t* cursor) const
+{
+    const size_t count = this->float_count_;
+    check_ret_val(count && value_count == count, false);
+
+    if (this->curve_frames.size() && this->adjust_frame(frame, this->start_, this->length_, this->method))
+    {
+        const float* frames_begin = this->curve_frames.data();
+        const float* frames_end = frames_begin + this->curve_frames.size();
+        const float* key_iter = frames_begin + ff::animation_keys::find_key(frames_begin, this->curve_frames.size(), frame, cursor);
+
+        if (key_iter == frames_end || key_iter == frames_begin || *key_iter == frame)
+        {
+            const size_t key_index = (key_iter == frames_end) ? this->curve_frames.size() - 1 : key_iter - frames_begin;
+            std::memcpy(values, &this->curve_values[key_index * count], count * sizeof(float));
+        }
+        else
+        {
+            const size_t segment = key_iter - frames_begin - 1;
+            const float time = (frame - key_iter[-1]) / (key_iter[0] - key_iter[-1]);
+            const float* coefficients = &this->curve_coefficients[segment * count * 4];
+
+            if (count == 4)
+            {
+                const DirectX::XMVECTOR time_vector = DirectX::XMVectorReplicate(time);
+                DirectX::XMVECTOR output = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(coefficients));
+                output = DirectX::XMVectorMultiplyAdd(output, time_vector, DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(coefficients + 4)));
+                output = DirectX::XMVectorMultiplyAdd(output, time_vector, DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(coefficients + 8)));
+                output = DirectX::XMVectorMultiplyAdd(output, time_vector, DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(coefficients + 12)));
+                DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(values), output);
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    values[i] = ((coefficients[i] * time + coefficients[count + i]) * time + coefficients[count * 2 + i]) * time + coefficients[count * 3 + i];
+                }
+            }
+        }
+
+        return true;
+    }
+
+    if (this->curve_has_default)
+    {
+        std::memcpy(values, this->curve_default.data(), count * sizeof(float));
+        return true;
+    }
+
+    return false;
+}
+
 float ff::animation_keys::start() const
 {
     return this->start_;
@@ -130,9 +215,53 @@ bool ff::animation_keys::load_from_cache_internal(const ff::dict& dict)
         this->keys.push_back(std::move(key));
     }
 
+    this->compile();
     return true;
 }
 
+static size_t value_float_count(const ff::value_ptr& value)
+{
+    if (value)
+    {
+        if (value->is_type<float>())
+        {
+            return 1;
+        }
+        else if (value->is_type<ff::point_float>())
+        {
+            return 2;
+        }
+        else if (value->is_type<ff::rect_float>())
+        {
+            return 4;
+        }
+    }
+
+    return 0;
+}
+
+static void get_value_floats(const ff::value_ptr& value, float* output)
+{
+    if (value->is_type<float>())
+    {
+        output[0] = value->get<float>();
+    }
+    else if (value->is_type<ff::point_float>())
+    {
+        const ff::point_float& point = value->get<ff::point_float>();
+        output[0] = point.x;
+        output[1] = point.y;
+    }
+    else if (value->is_type<ff::rect_float>())
+    {
+        const ff::rect_float& rect = value->get<ff::rect_float>();
+        output[0] = rect.left;
+        output[1] = rect.top;
+        output[2] = rect.right;
+        output[3] = rect.bottom;
+    }
+}
+
 static ff::value_ptr convert_key_value(ff::value_ptr value)
 {
     // Check if it's an interpolatable value
@@ -257,6 +386,7 @@ bool ff::animation_keys::load_from_source_internal(std::string_view name, const
         }
     }
 
+    this->compile();
     return true;
 }
 
@@ -374,6 +504,80 @@ ff::value_ptr ff::animation_keys::interpolate(const key_frame& lhs, const key_fr
     return value;
 }
 
+void ff::animation_keys::compile()
+{
+    this->curve_frames.clear();
+    this->curve_values.clear();
+    this->curve_coefficients.clear();
+    this->curve_default = {};
+    this->float_count_ = 0;
+    this->curve_has_default = false;
+
+    // Only keys that all have the same numeric type can be compiled, get_value() handles everything else
+    const bool has_default = this->default_value && !this->default_value->is_type<nullptr_t>();
+    const size_t count = ::value_float_count(this->keys.size() ? this->keys.front().value : this->default_value);
+    check_ret(count && (!has_default || ::value_float_count(this->default_value) == count));
+
+    for (const key_frame& key : this->keys)
+    {
+        check_ret(::value_float_count(key.value) == count);
+    }
+
+    if (has_default)
+    {
+        ::get_value_floats(this->default_value, this->curve_default.data());
+        this->curve_has_default = true;
+    }
+
+    this->curve_frames.reserve(this->keys.size());
+    this->curve_values.resize(this->keys.size() * count);
+    this->curve_coefficients.resize((this->keys.size() ? this->keys.size() - 1 : 0) * count * 4);
+
+    for (size_t i = 0; i < this->keys.size(); i++)
+    {
+        this->curve_frames.push_back(this->keys[i].frame);
+        ::get_value_floats(this->keys[i].value, &this->curve_values[i * count]);
+    }
+
+    for (size_t i = 0; i + 1 < this->keys.size(); i++)
+    {
+        const key_frame& lhs = this->keys[i];
+        const key_frame& rhs = this->keys[i + 1];
+        const bool spline = ff::flags::has(this->method, method_t::interpolate_spline) &&
+            lhs.tangent_value->is_same_type(lhs.value) && rhs.tangent_value->is_same_type(lhs.value);
+
+        std::array<float, 4> t1{}, t2{};
+        if (spline)
+        {
+            ::get_value_floats(lhs.tangent_value, t1.data());
+            ::get_value_floats(rhs.tangent_value, t2.data());
+        }
+
+        const float* v1 = &this->curve_values[i * count];
+        const float* v2 = &this->curve_values[(i + 1) * count];
+        float* coefficients = &this->curve_coefficients[i * count * 4];
+
+        for (size_t h = 0; h < count; h++)
+        {
+            if (spline)
+            {
+                // Hermite: (2s^3 - 3s^2 + 1)v1 + (-2s^3 + 3s^2)v2 + (s^3 - 2s^2 + s)t1 + (s^3 - s^2)t2
+                coefficients[h] = 2 * v1[h] - 2 * v2[h] + t1[h] + t2[h];
+                coefficients[count + h] = -3 * v1[h] + 3 * v2[h] - 2 * t1[h] - t2[h];
+                coefficients[count * 2 + h] = t1[h];
+            }
+            else
+            {
+                coefficients[count * 2 + h] = v2[h] - v1[h];
+            }
+
+            coefficients[count * 3 + h] = v1[h];
+        }
+    }
+
+    this->float_count_ = count;
+}
+
 ff::animation_keys::method_t ff::animation_keys::load_method(const ff::dict& dict, bool from_source)
 {
     method_t method = method_t::none;
@@ -5,13 +5,22 @@ namespace ff
     class animation_keys
     {
     public:
+        // Remembers where the last frame was found, so that playing forward only has to check the next key.
+        // Keep one for each player and key channel. It's only a hint, so seeking or looping still works.
+        struct cursor_t
+        {
+            size_t key_index{};
+        };
+
         animation_keys(const animation_keys& other) = default;
         animation_keys(animation_keys&& other) noexcept = default;
 
         animation_keys& operator=(const animation_keys& other) = default;
         animation_keys& operator=(animation_keys && other) noexcept = default;
 
-        ff::value_ptr get_value(float frame, const ff::dict* params = nullptr) const;
+        ff::value_ptr get_value(float frame, const ff::dict* params = nullptr, ff::animation_keys::cursor_t* cursor = nullptr) const;
+        size_t float_count() const; // 1 for float keys, 2 for point_float, 4 for rect_float, 0 when not numeric
+        bool get_floats(float frame, float* values, size_t value_count, ff::animation_keys::cursor_t* cursor = nullptr) const; // no allocations, value_count must match float_count()
         float start() const;
         float length() const;
         const std::string& name() const;
@@ -53,7 +62,10 @@ namespace ff
         animation_keys();
         bool load_from_cache_internal(const ff::dict& dict);
         bool load_from_source_internal(std::string_view name, const ff::dict& dict, ff::resource_load_context& context);
+        template<class T>
+        static size_t find_key(const T* keys, size_t key_count, float frame, ff::animation_keys::cursor_t* cursor);
         static ff::value_ptr interpolate(const key_frame& lhs, const key_frame& other, float time, method_t method, const ff::dict* params);
+        void compile();
 
         std::string name_;
         std::vector<key_frame> keys;
@@ -61,6 +73,14 @@ namespace ff
         float start_;
         float length_;
         method_t method;
+
+        // Compiled numeric keys, each segment between two keys is ((a * s + b) * s + c) * s + d for s in [0, 1]
+        std::vector<float> curve_frames;
+        std::vector<float> curve_values; // float_count_ per key
+        std::vector<float> curve_coefficients; // float_count_ * 4 per segment, all of the a's, then b's, c's, d's
+        std::array<float, 4> curve_default;
+        size_t float_count_;
+        bool curve_has_default;
     };
 
     class create_animation_keys
@@ -1,10 +1,12 @@
 #include "pch.h"
+#include "graphics/resource/animation.h"
 #include "graphics/resource/animation_base.h"
 #include "graphics/resource/animation_player.h"
 
 ff::animation_player::animation_player(const std::shared_ptr<ff::animation_base>& animation, float start_frame, float speed, const ff::dict* params)
     : params(params ? *params : ff::dict())
     , animation_(animation)
+    , keyed_animation(dynamic_cast<ff::animation*>(animation.get()))
     , start_frame(start_frame)
     , frame(start_frame)
     , fps((speed != 0.0 ? std::abs(speed) : 1.0f) * animation->frames_per_second())
@@ -28,5 +30,14 @@ bool ff::animation_player::update_animation(ff::push_base<ff::animation_event>*
 
 void ff::animation_player::draw_animation(ff::dxgi::draw_base& draw, const ff::transform& transform) const
 {
-    this->animation_->draw_frame(draw, transform, this->frame, !this->params.empty() ? &this->params : nullptr);
+    const ff::dict* params = !this->params.empty() ? &this->params : nullptr;
+
+    if (this->keyed_animation)
+    {
+        this->keyed_animation->draw_frames(draw, std::span<const ff::transform>(&transform, 1), this->frame, params, &this->cursors);
+    }
+    else
+    {
+        this->animation_->draw_frame(draw, transform, this->frame, params);
+    }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../resource/animation.h"
 #include "../resource/animation_player_base.h"
 
 namespace ff
@@ -21,6 +22,8 @@ namespace ff
     private:
         ff::dict params;
         std::shared_ptr<ff::animation_base> animation_;
+        ff::animation* keyed_animation; // when animation_ is an ff::animation, it can use key cursors
+        mutable ff::animation::cursors_t cursors;
         float start_frame;
         float frame;
         float fps;
@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "graphics/resource/animation_system.h"
+#include "graphics/types/transform.h"
+
+// Big groups are split so that they can be updated on different threads
+constexpr size_t MAX_GROUP_SIZE = 1024;
+constexpr size_t MIN_PARALLEL_SIZE = 256;
+
+namespace
+{
+    class event_collector : public ff::push_base<ff::animation_event>
+    {
+    public:
+        event_collector(std::vector<ff::animation_system::event_t>& events, size_t player_id)
+            : events(events)
+            , player_id(player_id)
+        {}
+
+        virtual void push(const ff::animation_event& value) const override
+        {
+            this->events.push_back(ff::animation_system::event_t{ this->player_id, value });
+        }
+
+        virtual void push(ff::animation_event&& value) const override
+        {
+            this->events.push_back(ff::animation_system::event_t{ this->player_id, value });
+        }
+
+    private:
+        std::vector<ff::animation_system::event_t>& events;
+        size_t player_id;
+    };
+}
+
+size_t ff::animation_system::add(const std::shared_ptr<ff::animation_base>& animation, float start_frame, float speed, const ff::dict* params)
+{
+    assert_ret_val(animation, ff::constants::invalid_unsigned<size_t>());
+
+    size_t player_id = this->animations.size();
+    if (this->free_ids.empty())
+    {
+        this->animations.emplace_back();
+        this->params.emplace_back();
+        this->start_frames.push_back(0);
+        this->frames.push_back(0);
+        this->frames_per_second.push_back(0);
+        this->update_counts.push_back(0);
+        this->playing_.push_back(0);
+    }
+    else
+    {
+        player_id = this->free_ids.back();
+        this->free_ids.pop_back();
+    }
+
+    this->animations[player_id] = animation;
+    this->params[player_id] = params ? *params : ff::dict();
+    this->start_frames[player_id] = start_frame;
+    this->frames[player_id] = start_frame;
+    this->frames_per_second[player_id] = (speed != 0.0 ? std::abs(speed) : 1.0f) * animation->frames_per_second();
+    this->update_counts[player_id] = 0;
+    this->playing_[player_id] = 1;
+    this->size_++;
+    this->groups_dirty = true;
+
+    return player_id;
+}
+
+void ff::animation_system::remove(size_t player_id)
+{
+    assert_ret(player_id < this->animations.size() && this->animations[player_id]);
+
+    this->animations[player_id] = nullptr;
+    this->params[player_id] = ff::dict();
+    this->playing_[player_id] = 0;
+    this->free_ids.push_back(player_id);
+    this->size_--;
+    this->groups_dirty = true;
+}
+
+void ff::animation_system::clear()
+{
+    *this = ff::animation_system();
+}
+
+size_t ff::animation_system::size() const
+{
+    return this->size_;
+}
+
+const std::shared_ptr<ff::animation_base>& ff::animation_system::animation(size_t player_id) const
+{
+    return this->animations[player_id];
+}
+
+float ff::animation_system::frame(size_t player_id) const
+{
+    return this->frames[player_id];
+}
+
+bool ff::animation_system::playing(size_t player_id) const
+{
+    return this->playing_[player_id] != 0;
+}
+
+void ff::animation_system::update(bool collect_events, bool parallel)
+{
+    this->update_groups();
+    this->events_.clear();
+
+    if (parallel && this->groups.size() > 1 && this->size_ >= ::MIN_PARALLEL_SIZE)
+    {
+        ff::task_graph graph;
+
+        for (ff::animation_system::group_t& group : this->groups)
+        {
+            graph.add_task([this, &group, collect_events]()
+                {
+                    this->update_group(group, collect_events);
+                    return true;
+                });
+        }
+
+        graph.run();
+    }
+    else
+    {
+        for (ff::animation_system::group_t& group : this->groups)
+        {
+            this->update_group(group, collect_events);
+        }
+    }
+
+    if (collect_events)
+    {
+        for (ff::animation_system::group_t& group : this->groups)
+        {
+            this->events_.insert(this->events_.end(), group.events.cbegin(), group.events.cend());
+        }
+    }
+}
+
+const std::vector<ff::animation_system::event_t>& ff::animation_system::events() const
+{
+    return this->events_;
+}
+
+void ff::animation_system::draw(ff::dxgi::draw_base& draw, size_t player_id, const ff::transform& transform) const
+{
+    this->draw(draw, std::span<const size_t>(&player_id, 1), std::span<const ff::transform>(&transform, 1));
+}
+
+void ff::animation_system::draw(ff::dxgi::draw_base& draw, std::span<const size_t> player_ids, std::span<const ff::transform> transforms) const
+{
+    assert_ret(player_ids.size() == transforms.size());
+
+    // Draw order is kept, but runs of the same animation at the same frame are drawn with one call
+    for (size_t i = 0; i < player_ids.size(); )
+    {
+        const size_t player_id = player_ids[i];
+        ff::animation_base* animation = this->animations[player_id].get();
+        const ff::dict& params = this->params[player_id];
+        const float frame = this->frames[player_id];
+        size_t run_end = i + 1;
+
+        if (params.empty())
+        {
+            while (run_end < player_ids.size() &&
+                this->animations[player_ids[run_end]].get() == animation &&
+                this->frames[player_ids[run_end]] == frame &&
+                this->params[player_ids[run_end]].empty())
+            {
+                run_end++;
+            }
+        }
+
+        if (animation)
+        {
+            animation->draw_frames(draw, transforms.subspan(i, run_end - i), frame, !params.empty() ? &params : nullptr);
+        }
+
+        i = run_end;
+    }
+}
+
+void ff::animation_system::update_groups()
+{
+    check_ret(this->groups_dirty);
+    this->groups_dirty = false;
+
+    std::unordered_map<ff::animation_base*, size_t> animation_to_group;
+    std::vector<ff::animation_system::group_t> old_groups = std::move(this->groups);
+    this->groups.clear();
+
+    for (size_t player_id = 0; player_id < this->animations.size(); player_id++)
+    {
+        ff::animation_base* animation = this->animations[player_id].get();
+        if (animation)
+        {
+            auto [iter, inserted] = animation_to_group.try_emplace(animation, this->groups.size());
+            if (inserted || this->groups[iter->second].player_ids.size() == ::MAX_GROUP_SIZE)
+            {
+                iter->second = this->groups.size();
+
+                ff::animation_system::group_t& group = this->groups.emplace_back();
+                group.animation = animation;
+
+                // Reuse memory from the old groups
+                if (!old_groups.empty())
+                {
+                    group.player_ids = std::move(old_groups.back().player_ids);
+                    group.events = std::move(old_groups.back().events);
+                    group.player_ids.clear();
+                    old_groups.pop_back();
+                }
+            }
+
+            this->groups[iter->second].player_ids.push_back(player_id);
+        }
+    }
+}
+
+void ff::animation_system::update_group(ff::animation_system::group_t& group, bool collect_events)
+{
+    const float frame_length = group.animation->frame_length();
+    const float updates_per_second = ff::constants::updates_per_second<float>();
+    group.events.clear();
+
+    for (size_t player_id : group.player_ids)
+    {
+        const bool first_update = !this->update_counts[player_id];
+        const float begin_frame = this->frames[player_id];
+        const float updates = (this->update_counts[player_id] += 1.0f);
+        const float end_frame = this->start_frames[player_id] + (updates * this->frames_per_second[player_id] / updates_per_second);
+
+        this->frames[player_id] = end_frame;
+        this->playing_[player_id] = end_frame < frame_length;
+
+        if (collect_events)
+        {
+            ::event_collector collector(group.events, player_id);
+            group.animation->frame_events(begin_frame, end_frame, first_update, collector);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../resource/animation_base.h"
+
+namespace ff::dxgi
+{
+    class draw_base;
+}
+
+namespace ff
+{
+    struct transform;
+
+    /// <summary>
+    /// Updates and draws many animation players at once, like a collection of ff::animation_player
+    /// </summary>
+    /// <remarks>
+    /// Player state is kept in parallel arrays indexed by player ID, and players are grouped by animation
+    /// so each animation's length is only looked up once per update. Groups can be updated on the thread
+    /// pool, so frame_events() must be safe to call from multiple threads (it is for ff::animation).
+    /// Events from every player go into one list that is reused for every update. Drawing a run of
+    /// players with the same animation and frame only evaluates the animation's keys once.
+    /// </remarks>
+    class animation_system
+    {
+    public:
+        struct event_t
+        {
+            size_t player_id;
+            ff::animation_event event;
+        };
+
+        animation_system() = default;
+        animation_system(animation_system&& other) noexcept = default;
+        animation_system(const animation_system& other) = delete;
+
+        animation_system& operator=(animation_system&& other) noexcept = default;
+        animation_system& operator=(const animation_system& other) = delete;
+
+        size_t add(const std::shared_ptr<ff::animation_base>& animation, float start_frame = 0, float speed = 1, const ff::dict* params = nullptr); // returns a player ID
+        void remove(size_t player_id); // the ID can be reused by the next add()
+        void clear();
+        size_t size() const;
+
+        const std::shared_ptr<ff::animation_base>& animation(size_t player_id) const;
+        float frame(size_t player_id) const;
+        bool playing(size_t player_id) const; // same as the last result of animation_player::update_animation()
+
+        void update(bool collect_events = true, bool parallel = true);
+        const std::vector<ff::animation_system::event_t>& events() const; // from the last update, grouped by animation
+
+        void draw(ff::dxgi::draw_base& draw, size_t player_id, const ff::transform& transform) const;
+        void draw(ff::dxgi::draw_base& draw, std::span<const size_t> player_ids, std::span<const ff::transform> transforms) const;
+
+    private:
+        struct group_t
+        {
+            ff::animation_base* animation;
+            std::vector<size_t> player_ids;
+            std::vector<ff::animation_system::event_t> events;
+        };
+
+        void update_groups();
+        void update_group(ff::animation_system::group_t& group, bool collect_events);
+
+        // Players, indexed by ID
+        std::vector<std::shared_ptr<ff::animation_base>> animations;
+        std::vector<ff::dict> params;
+        std::vector<float> start_frames;
+        std::vector<float> frames;
+        std::vector<float> frames_per_second;
+        std::vector<float> update_counts;
+        std::vector<uint8_t> playing_; // not vector<bool>, since groups are updated in parallel
+        std::vector<size_t> free_ids;
+
+        std::vector<ff::animation_system::group_t> groups;
+        std::vector<ff::animation_system::event_t> events_;
+        size_t size_{};
+        bool groups_dirty{};
+    };
+}
@@ -110,6 +110,11 @@ std::unique_ptr<DirectX::ScratchImage> ff::png_image_reader::internal_read(DXGI_
     this->has_palette = ::png_get_PLTE(this->png, this->info, &this->palette_, &this->palette_size) != 0;
     this->has_trans_palette = ::png_get_tRNS(this->png, this->info, &this->trans_palette, &this->trans_palette_size, &this->trans_color) != 0;
 
+    if (this->bit_depth == 16)
+    {
+        ::png_set_strip_16(this->png);
+    }
+
     DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
     switch (this->color_type)
     {
@@ -148,7 +153,7 @@ std::unique_ptr<DirectX::ScratchImage> ff::png_image_reader::internal_read(DXGI_
 
                 format = DXGI_FORMAT_R8G8B8A8_UNORM;
             }
-            else if (this->palette_size < 256)
+            else if (this->bit_depth < 8)
             {
                 ::png_set_packing(this->png);
             }
@@ -169,6 +174,14 @@ std::unique_ptr<DirectX::ScratchImage> ff::png_image_reader::internal_read(DXGI_
             break;
     }
 
+    // Let libpng swizzle each row as it gets decoded, rather than converting the whole image later.
+    // sRGB formats are still converted later, since that changes the color values too.
+    if (format == DXGI_FORMAT_R8G8B8A8_UNORM && requested_format == DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        ::png_set_bgr(this->png);
+        format = requested_format;
+    }
+
     std::unique_ptr<DirectX::ScratchImage> scratch = std::make_unique<DirectX::ScratchImage>();
     if (FAILED(scratch->Initialize2D(format, this->width, this->height, 1, 1)))
     {
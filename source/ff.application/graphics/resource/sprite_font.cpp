@@ -1,4 +1,5 @@
 #include "pch.h"
+#include "app/app.h"
 #include "graphics/dxgi/draw_util.h"
 #include "graphics/dxgi/dxgi_globals.h"
 #include "graphics/dxgi/sprite_data.h"
@@ -9,17 +10,279 @@
 #include "graphics/resource/texture_resource.h"
 #include "graphics/types/transform.h"
 #include "graphics/write/font_file.h"
+#include "graphics/write/truetype_font.h"
 #include "graphics/write/write.h"
 
-static bool text_contains_outline_control(std::wstring_view text)
+static constexpr size_t GLYPHS_PER_TASK = 64;
+
+namespace
 {
-    static const std::wstring controls =
+    struct glyph_bitmap
     {
-        static_cast<wchar_t>(ff::sprite_font_control::outline_color),
-        static_cast<wchar_t>(ff::sprite_font_control::outline_palette_color),
+        ff::point_size size;
+        ff::point_float handle;
+        float glyph_width;
+        std::vector<uint8_t> alpha; // one byte per pixel, empty when the glyph has nothing to draw
     };
 
-    return text.find_first_of(controls) != std::wstring_view::npos;
+    struct font_metrics
+    {
+        float ascent; // all in pixels except for design_unit_size
+        float descent;
+        float line_gap;
+        float design_unit_size; // pixels per font unit
+        bool has_kerning;
+    };
+}
+
+static bool use_truetype(const ff::font_file& font_file, ff::sprite_font_rasterizer rasterizer)
+{
+    return rasterizer == ff::sprite_font_rasterizer::truetype && font_file.truetype();
+}
+
+static bool get_font_metrics(ff::font_file* font_file, ff::sprite_font_rasterizer rasterizer, float font_size, ::font_metrics& metrics)
+{
+    if (font_file && ::use_truetype(*font_file, rasterizer))
+    {
+        const ff::truetype_metrics& tm = font_file->truetype().metrics();
+        metrics.design_unit_size = font_size / tm.units_per_em;
+        metrics.ascent = tm.ascent * metrics.design_unit_size;
+        metrics.descent = tm.descent * metrics.design_unit_size;
+        metrics.line_gap = tm.line_gap * metrics.design_unit_size;
+        metrics.has_kerning = true;
+        return true;
+    }
+
+    IDWriteFontFace5* font_face = font_file ? font_file->font_face() : nullptr;
+    if (font_face)
+    {
+        DWRITE_FONT_METRICS1 fm{};
+        font_face->GetMetrics(&fm);
+        metrics.design_unit_size = font_size / fm.designUnitsPerEm;
+        metrics.ascent = fm.ascent * metrics.design_unit_size;
+        metrics.descent = fm.descent * metrics.design_unit_size;
+        metrics.line_gap = fm.lineGap * metrics.design_unit_size;
+        metrics.has_kerning = font_face->HasKerningPairs();
+        return true;
+    }
+
+    return false;
+}
+
+static uint16_t get_glyph_index(ff::font_file& font_file, ff::sprite_font_rasterizer rasterizer, uint32_t ch)
+{
+    if (::use_truetype(font_file, rasterizer))
+    {
+        return font_file.truetype().glyph_index(ch);
+    }
+
+    uint16_t glyph_id{};
+    IDWriteFontFace5* font_face = font_file.font_face();
+    return (font_face && SUCCEEDED(font_face->GetGlyphIndices(&ch, 1, &glyph_id))) ? glyph_id : 0;
+}
+
+static bool get_glyph_advance(ff::font_file& font_file, ff::sprite_font_rasterizer rasterizer, uint16_t glyph_id, float design_unit_size, float& advance)
+{
+    if (::use_truetype(font_file, rasterizer))
+    {
+        check_ret_val(glyph_id < font_file.truetype().glyph_count(), false);
+        advance = font_file.truetype().glyph_metrics(glyph_id).advance_width * design_unit_size;
+        return true;
+    }
+
+    DWRITE_GLYPH_METRICS gm{};
+    IDWriteFontFace5* font_face = font_file.font_face();
+    check_ret_val(font_face && SUCCEEDED(font_face->GetDesignGlyphMetrics(&glyph_id, 1, &gm)), false);
+    advance = gm.advanceWidth * design_unit_size;
+    return true;
+}
+
+// Returns the adjustment in font units
+static int get_kerning(ff::font_file& font_file, ff::sprite_font_rasterizer rasterizer, wchar_t ch0, wchar_t ch1)
+{
+    if (::use_truetype(font_file, rasterizer))
+    {
+        const ff::truetype_font& font = font_file.truetype();
+        return font.kerning(font.glyph_index(ch0), font.glyph_index(ch1));
+    }
+
+    uint16_t two_glyphs[2] = { ch0, ch1 };
+    int two_design_kerns[2];
+    IDWriteFontFace5* font_face = font_file.font_face();
+    return (font_face && SUCCEEDED(font_face->GetKerningPairAdjustments(2, two_glyphs, two_design_kerns))) ? two_design_kerns[0] : 0;
+}
+
+static bool rasterize_glyph_truetype(const ff::truetype_font& font, float font_size, float design_unit_size, bool anti_alias, uint16_t glyph_id, ::glyph_bitmap& bitmap)
+{
+    bitmap.size = {};
+    bitmap.handle = {};
+    bitmap.glyph_width = 0;
+    bitmap.alpha.clear();
+
+    check_ret_val(glyph_id < font.glyph_count(), false);
+    bitmap.glyph_width = font.glyph_metrics(glyph_id).advance_width * design_unit_size;
+
+    ff::truetype_glyph_bitmap truetype_bitmap;
+    if (font.rasterize(glyph_id, font_size, anti_alias, truetype_bitmap) && !truetype_bitmap.coverage.empty())
+    {
+        bitmap.size = truetype_bitmap.size;
+        bitmap.handle = -truetype_bitmap.offset.cast<float>();
+        bitmap.alpha = std::move(truetype_bitmap.coverage);
+    }
+
+    return true;
+}
+
+static bool rasterize_glyph_directwrite(IDWriteFontFace5* font_face, float font_size, float design_unit_size, bool anti_alias, uint16_t glyph_id, ::glyph_bitmap& bitmap)
+{
+    bitmap.size = {};
+    bitmap.handle = {};
+    bitmap.glyph_width = 0;
+    bitmap.alpha.clear();
+
+    DWRITE_GLYPH_METRICS gm{};
+    if (FAILED(font_face->GetDesignGlyphMetrics(&glyph_id, 1, &gm)))
+    {
+        return false;
+    }
+
+    bitmap.glyph_width = gm.advanceWidth * design_unit_size;
+
+    const DWRITE_GLYPH_OFFSET zero_offset{};
+    const DWRITE_MATRIX identity_transform{ 1.0, 0.0, 0.0, 1.0, 0.0, 0.0 };
+    const DWRITE_TEXTURE_TYPE glyph_texture_type = anti_alias ? DWRITE_TEXTURE_CLEARTYPE_3x1 : DWRITE_TEXTURE_ALIASED_1x1;
+    float glyph_advances = 0;
+
+    DWRITE_GLYPH_RUN gr{};
+    gr.fontEmSize = font_size;
+    gr.fontFace = font_face;
+    gr.glyphAdvances = &glyph_advances;
+    gr.glyphCount = 1;
+    gr.glyphIndices = &glyph_id;
+    gr.glyphOffsets = &zero_offset;
+
+    Microsoft::WRL::ComPtr<IDWriteGlyphRunAnalysis> gra;
+    if (FAILED(ff::write_factory()->CreateGlyphRunAnalysis(
+        &gr,
+        &identity_transform,
+        anti_alias ? DWRITE_RENDERING_MODE1_NATURAL : DWRITE_RENDERING_MODE1_ALIASED,
+        DWRITE_MEASURING_MODE_NATURAL,
+        DWRITE_GRID_FIT_MODE_DEFAULT,
+        DWRITE_TEXT_ANTIALIAS_MODE_CLEARTYPE,
+        0, 0,
+        &gra)))
+    {
+        return true;
+    }
+
+    RECT bounds;
+    if (FAILED(gra->GetAlphaTextureBounds(glyph_texture_type, &bounds)))
+    {
+        return true;
+    }
+
+    ff::rect_size black_box = ff::rect_int(bounds.left, bounds.top, bounds.right, bounds.bottom).cast<size_t>();
+    if (black_box.empty())
+    {
+        return true;
+    }
+
+    const size_t pixel_stride = anti_alias ? 3 : 1;
+    std::vector<uint8_t> glyph_bytes(black_box.area() * pixel_stride);
+    if (FAILED(gra->CreateAlphaTexture(glyph_texture_type, &bounds, glyph_bytes.data(), static_cast<uint32_t>(glyph_bytes.size()))))
+    {
+        return true;
+    }
+
+    if (anti_alias)
+    {
+        bitmap.alpha.resize(black_box.area());
+
+        for (size_t i = 0; i < bitmap.alpha.size(); i++)
+        {
+            float value =
+                static_cast<float>(glyph_bytes[i * pixel_stride + 0]) +
+                static_cast<float>(glyph_bytes[i * pixel_stride + 1]) +
+                static_cast<float>(glyph_bytes[i * pixel_stride + 2]);
+            bitmap.alpha[i] = static_cast<uint8_t>(static_cast<size_t>(value / 3) & 0xFF);
+        }
+    }
+    else
+    {
+        bitmap.alpha = std::move(glyph_bytes);
+    }
+
+    bitmap.size = black_box.size();
+    bitmap.handle = ff::point_float(-gm.leftSideBearing * design_unit_size, black_box.height() + gm.bottomSideBearing * design_unit_size);
+    return true;
+}
+
+// Returns false if the glyph doesn't exist, otherwise the bitmap may still be empty (like for a space)
+static bool rasterize_glyph(ff::font_file& font_file, ff::sprite_font_rasterizer rasterizer, float font_size, float design_unit_size, bool anti_alias, uint16_t glyph_id, ::glyph_bitmap& bitmap)
+{
+    if (::use_truetype(font_file, rasterizer))
+    {
+        return ::rasterize_glyph_truetype(font_file.truetype(), font_size, design_unit_size, anti_alias, glyph_id, bitmap);
+    }
+
+    IDWriteFontFace5* font_face = font_file.font_face();
+    return font_face && ::rasterize_glyph_directwrite(font_face, font_size, design_unit_size, anti_alias, glyph_id, bitmap);
+}
+
+// Writes white pixels with the glyph's alpha into an RGBA image
+static void copy_glyph(const ::glyph_bitmap& bitmap, const DirectX::Image& dest_image, ff::point_size pos)
+{
+    for (size_t y = 0; y < bitmap.size.y; y++)
+    {
+        const uint8_t* alpha_start = &bitmap.alpha[y * bitmap.size.x];
+        uint8_t* data_start = dest_image.pixels + (pos.y + y) * dest_image.rowPitch + pos.x * 4;
+
+        for (size_t x = 0; x < bitmap.size.x; x++)
+        {
+            data_start[x * 4 + 0] = 255;
+            data_start[x * 4 + 1] = 255;
+            data_start[x * 4 + 2] = 255;
+            data_start[x * 4 + 3] = alpha_start[x];
+        }
+    }
+}
+
+// Same as ff::internal::outline_sprites, the outline is one pixel bigger on each side
+static void copy_glyph_outline(const ::glyph_bitmap& bitmap, const DirectX::Image& dest_image, ff::point_size pos)
+{
+    for (size_t y = 0; y < bitmap.size.y; y++)
+    {
+        const uint8_t* alpha_start = &bitmap.alpha[y * bitmap.size.x];
+
+        for (size_t x = 0; x < bitmap.size.x; x++)
+        {
+            if (alpha_start[x])
+            {
+                uint8_t* dest = dest_image.pixels + (pos.y + y) * dest_image.rowPitch + (pos.x + x) * 4;
+
+                for (size_t i = 0; i < 3; i++, dest += dest_image.rowPitch)
+                {
+                    reinterpret_cast<uint32_t*>(dest)[0] = 0xFFFFFFFF;
+                    reinterpret_cast<uint32_t*>(dest)[1] = 0xFFFFFFFF;
+                    reinterpret_cast<uint32_t*>(dest)[2] = 0xFFFFFFFF;
+                }
+            }
+        }
+    }
+}
+
+static ff::sprite_font_rasterizer load_rasterizer(const ff::dict& dict)
+{
+    return (dict.get<std::string>("rasterizer") == "truetype") ? ff::sprite_font_rasterizer::truetype : ff::sprite_font_rasterizer::directwrite;
+}
+
+static ff::sprite_font_atlas_options load_atlas_options(const ff::dict& dict)
+{
+    ff::sprite_font_atlas_options atlas_options;
+    atlas_options.prewarm = dict.get<std::string>("prewarm");
+    atlas_options.page_size = dict.get<size_t>("page_size", atlas_options.page_size);
+    atlas_options.max_pages = dict.get<size_t>("max_pages", atlas_options.max_pages);
+    return atlas_options;
 }
 
 static std::wstring_view to_wstring(std::string_view text, std::array<wchar_t, 2048>& wtext_array, std::wstring& wtext_string)
@@ -45,12 +308,35 @@ static std::wstring_view to_wstring(std::string_view text, std::array<wchar_t, 2
     return L"";
 }
 
-ff::sprite_font::sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias)
-    : glyphs{}
+ff::sprite_font::sprite_font(
+    const std::shared_ptr<ff::resource>& font_file_resource,
+    float size,
+    int outline_thickness,
+    bool anti_alias,
+    ff::sprite_font_rasterizer rasterizer)
+    : glyphs(ff::sprite_font::MAX_GLYPH_COUNT)
+    , lazy_(false)
+    , font_file_resource(font_file_resource)
+    , size(size)
+    , outline_thickness(outline_thickness)
+    , anti_alias(anti_alias)
+    , rasterizer_(rasterizer)
+{}
+
+ff::sprite_font::sprite_font(
+    const std::shared_ptr<ff::resource>& font_file_resource,
+    float size,
+    int outline_thickness,
+    bool anti_alias,
+    const ff::sprite_font_atlas_options& atlas_options,
+    ff::sprite_font_rasterizer rasterizer)
+    : lazy_(true)
+    , atlas_options(atlas_options)
     , font_file_resource(font_file_resource)
     , size(size)
     , outline_thickness(outline_thickness)
     , anti_alias(anti_alias)
+    , rasterizer_(rasterizer)
 {}
 
 ff::sprite_font::sprite_font(
@@ -60,22 +346,25 @@ ff::sprite_font::sprite_font(
     bool anti_alias,
     const std::shared_ptr<ff::sprite_list>& sprites,
     const std::shared_ptr<ff::sprite_list>& outline_sprites,
-    const std::shared_ptr<ff::data_base>& glyphs_data)
+    const std::shared_ptr<ff::data_base>& glyphs_data,
+    ff::sprite_font_rasterizer rasterizer)
     : sprites(sprites)
     , outline_sprites(outline_sprites)
-    , glyphs{}
+    , glyphs(ff::sprite_font::MAX_GLYPH_COUNT)
+    , lazy_(false)
     , font_file_resource(font_file_resource)
     , size(size)
     , outline_thickness(outline_thickness)
     , anti_alias(anti_alias)
+    , rasterizer_(rasterizer)
 {
-    assert(glyphs_data && glyphs_data->size() == ff::array_byte_size(this->glyphs));
-    std::memcpy(this->glyphs.data(), glyphs_data->data(), std::min(this->glyphs.size(), glyphs_data->size()));
+    assert(glyphs_data && glyphs_data->size() == ff::vector_byte_size(this->glyphs));
+    std::memcpy(this->glyphs.data(), glyphs_data->data(), std::min(ff::vector_byte_size(this->glyphs), glyphs_data->size()));
 }
 
 ff::sprite_font::operator bool() const
 {
-    return this->font_file && this->sprites;
+    return this->font_file && (this->lazy_ || this->sprites);
 }
 
 ff::point_float ff::sprite_font::draw_text(
@@ -85,68 +374,82 @@ ff::point_float ff::sprite_font::draw_text(
     const ff::color& outline_color,
     ff::sprite_font_options options) const
 {
-    std::array<wchar_t, 2048> wtext_array;
-    std::wstring wtext_string;
-    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
-    ff::point_float size{};
+    // Held while drawing, since lazy glyphs can be evicted and rasterized again by another thread
+    std::scoped_lock lock(this->mutex);
+    const ff::sprite_font::text_run& run = this->get_text_run(text, options);
+    if (!draw || run.glyphs.empty() || transform.scale.x * transform.scale.y == 0.0f)
+    {
+        return run.size * transform.scale;
+    }
 
-    if ((outline_color.alpha() > 0 || ::text_contains_outline_control(wtext)) && !ff::flags::has(options, ff::sprite_font_options::no_outline) && this->outline_sprites)
+    if (this->lazy_)
+    {
+        this->update_lazy_atlas(run);
+    }
+
+    if ((outline_color.alpha() > 0 || run.has_outline_control) && !ff::flags::has(options, ff::sprite_font_options::no_outline) && this->has_outline())
     {
         ff::transform outline_transform = transform;
         outline_transform.color = outline_color;
-        size = this->internal_draw_text(draw, this->outline_sprites.get(), wtext, outline_transform, options);
+        this->draw_text_run(*draw, run, true, outline_transform);
     }
 
     if (!ff::flags::has(options, ff::sprite_font_options::no_text))
     {
-        size = this->internal_draw_text(draw, this->sprites.get(), wtext, transform, options);
+        this->draw_text_run(*draw, run, false, transform);
     }
 
-    return size;
+    return run.size * transform.scale;
 }
 
 ff::point_float ff::sprite_font::measure_text(std::string_view text, ff::point_float scale) const
 {
-    std::array<wchar_t, 2048> wtext_array;
-    std::wstring wtext_string;
-    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
-
-    return this->internal_draw_text(nullptr, nullptr, wtext, ff::transform({}, scale), ff::sprite_font_options::no_control);
+    std::scoped_lock lock(this->mutex);
+    return this->get_text_run(text, ff::sprite_font_options::no_control).size * scale;
 }
 
 float ff::sprite_font::line_spacing() const
 {
-    IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
-    assert(font_face);
+    ::font_metrics metrics;
+    assert_ret_val(::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics), 0.0f);
+    return metrics.ascent + metrics.descent + metrics.line_gap;
+}
 
-    if (font_face)
-    {
-        DWRITE_FONT_METRICS1 fm;
-        font_face->GetMetrics(&fm);
-        return (fm.ascent + fm.descent + fm.lineGap) * this->size / fm.designUnitsPerEm;
-    }
+bool ff::sprite_font::lazy() const
+{
+    return this->lazy_;
+}
 
-    return 0.0f;
+ff::sprite_font_rasterizer ff::sprite_font::rasterizer() const
+{
+    return this->rasterizer_;
 }
 
 bool ff::sprite_font::resource_load_complete(bool from_source)
 {
     this->font_file = this->font_file_resource.object();
+
+    if (this->rasterizer_ == ff::sprite_font_rasterizer::truetype && this->font_file && !this->font_file->truetype())
+    {
+        ff::log::write(ff::log::type::resource_load, "TrueType rasterizer can't read the font data (like CFF outlines), using DirectWrite instead");
+    }
+
+    if (this->lazy_)
+    {
+        return this->init_lazy_atlas();
+    }
+
     return !from_source || this->init_sprites();
 }
 
 bool ff::sprite_font::init_sprites()
 {
-    IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
-    if (this->size <= 0.0f || this->size > 200.0f || !font_face)
+    ::font_metrics metrics;
+    if (this->size <= 0.0f || this->size > 200.0f || !::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics))
     {
         return false;
     }
 
-    DWRITE_FONT_METRICS1 font_metrics;
-    font_face->GetMetrics(&font_metrics);
-    float design_unit_size = this->size / font_metrics.designUnitsPerEm;
-
     struct sprite_info
     {
         size_t texture_index;
@@ -155,11 +458,26 @@ bool ff::sprite_font::init_sprites()
     };
 
     std::vector<bool> has_glyph(ff::sprite_font::MAX_GLYPH_COUNT, false);
-    std::vector<sprite_info> sprite_infos;
-    sprite_infos.reserve(font_face->GetGlyphCount());
 
     // Map unicode characters to glyphs
+    if (::use_truetype(*this->font_file, this->rasterizer_))
     {
+        const ff::truetype_font& font = this->font_file->truetype();
+
+        for (uint32_t ch = 0; ch < ff::sprite_font::MAX_GLYPH_COUNT; ch++)
+        {
+            uint16_t glyph = font.glyph_index(ch);
+            if (glyph)
+            {
+                this->glyphs[ch].char_to_glyph = glyph;
+                has_glyph[glyph] = true;
+            }
+        }
+    }
+    else
+    {
+        IDWriteFontFace5* font_face = this->font_file->font_face();
+
         uint32_t unicode_range_count;
         if (font_face->GetUnicodeRanges(0, nullptr, &unicode_range_count) != E_NOT_SUFFICIENT_BUFFER)
         {
@@ -187,6 +505,41 @@ bool ff::sprite_font::init_sprites()
         }
     }
 
+    // Rasterizing is independent for each glyph, so spread it across the thread pool
+
+    std::vector<uint16_t> glyph_ids;
+    for (size_t i = 0; i < ff::sprite_font::MAX_GLYPH_COUNT; i++)
+    {
+        if (has_glyph[i])
+        {
+            glyph_ids.push_back(static_cast<uint16_t>(i));
+        }
+    }
+
+    std::vector<::glyph_bitmap> bitmaps(glyph_ids.size());
+    std::vector<uint8_t> glyph_exists(glyph_ids.size());
+    {
+        ff::task_graph graph;
+
+        for (size_t start = 0; start < glyph_ids.size(); start += ::GLYPHS_PER_TASK)
+        {
+            graph.add_task([this, start, &glyph_ids, &bitmaps, &glyph_exists, &metrics]()
+            {
+                for (size_t i = start, end = std::min(start + ::GLYPHS_PER_TASK, glyph_ids.size()); i < end; i++)
+                {
+                    glyph_exists[i] = ::rasterize_glyph(*this->font_file, this->rasterizer_, this->size, metrics.design_unit_size, this->anti_alias, glyph_ids[i], bitmaps[i]);
+                }
+
+                return true;
+            });
+        }
+
+        graph.run();
+    }
+
+    std::vector<sprite_info> sprite_infos;
+    sprite_infos.reserve(glyph_ids.size());
+
     std::vector<DirectX::ScratchImage> staging_scratches;
     const ff::point_size staging_texture_size(1024, 1024);
     ff::point_size staging_pos(0, 0);
@@ -200,76 +553,29 @@ bool ff::sprite_font::init_sprites()
 
     std::memset(staging_scratch.GetPixels(), 0, staging_scratch.GetPixelsSize());
 
-    float glyph_advances = 0;
-    std::vector<uint8_t> glyph_bytes;
     std::unordered_map<size_t, uint16_t, ff::no_hash<size_t>> hash_to_sprite;
-    DWRITE_TEXTURE_TYPE glyph_texture_type = this->anti_alias ? DWRITE_TEXTURE_CLEARTYPE_3x1 : DWRITE_TEXTURE_ALIASED_1x1;
-
-    const DWRITE_GLYPH_OFFSET zero_offset{};
-    const DWRITE_MATRIX identity_transform{ 1.0, 0.0, 0.0, 1.0, 0.0, 0.0 };
-    uint16_t glyph_id = 0;
-    DWRITE_GLYPH_RUN gr{};
-    gr.fontEmSize = this->size;
-    gr.fontFace = font_face;
-    gr.glyphAdvances = &glyph_advances;
-    gr.glyphCount = 1;
-    gr.glyphIndices = &glyph_id;
-    gr.glyphOffsets = &zero_offset;
 
-    for (size_t i = 0; i < ff::sprite_font::MAX_GLYPH_COUNT; i++)
+    for (size_t glyph_index = 0; glyph_index < glyph_ids.size(); glyph_index++)
     {
-        if (!has_glyph[i])
-        {
-            continue;
-        }
-
-        glyph_id = static_cast<uint16_t>(i);
-
-        DWRITE_GLYPH_METRICS gm{};
-        if (FAILED(font_face->GetDesignGlyphMetrics(&glyph_id, 1, &gm)))
+        if (!glyph_exists[glyph_index])
         {
             continue;
         }
 
-        this->glyphs[i].glyph_width = gm.advanceWidth * design_unit_size;
+        const size_t i = glyph_ids[glyph_index];
+        const ::glyph_bitmap& bitmap = bitmaps[glyph_index];
+        this->glyphs[i].glyph_width = bitmap.glyph_width;
 
-        Microsoft::WRL::ComPtr<IDWriteGlyphRunAnalysis> gra;
-        if (FAILED(ff::write_factory()->CreateGlyphRunAnalysis(
-            &gr,
-            &identity_transform,
-            this->anti_alias ? DWRITE_RENDERING_MODE1_NATURAL : DWRITE_RENDERING_MODE1_ALIASED,
-            DWRITE_MEASURING_MODE_NATURAL,
-            DWRITE_GRID_FIT_MODE_DEFAULT,
-            DWRITE_TEXT_ANTIALIAS_MODE_CLEARTYPE,
-            0, 0,
-            &gra)))
+        if (bitmap.alpha.empty())
         {
             continue;
         }
 
-        RECT bounds;
-        if (FAILED(gra->GetAlphaTextureBounds(glyph_texture_type, &bounds)))
-        {
-            continue;
-        }
-
-        ff::rect_size black_box = ff::rect_int(bounds.left, bounds.top, bounds.right, bounds.bottom).cast<size_t>();
-        if (black_box.empty())
-        {
-            continue;
-        }
-
-        glyph_bytes.resize(black_box.area() * (this->anti_alias ? 3 : 1));
-        if (FAILED(gra->CreateAlphaTexture(glyph_texture_type, &bounds, glyph_bytes.data(), static_cast<uint32_t>(glyph_bytes.size()))))
-        {
-            continue;
-        }
-
-        size_t glyph_bytes_hash = ff::stable_hash_bytes(glyph_bytes.data(), ff::vector_byte_size(glyph_bytes));
+        size_t glyph_bytes_hash = ff::stable_hash_bytes(bitmap.alpha.data(), ff::vector_byte_size(bitmap.alpha));
         auto iter = hash_to_sprite.find(glyph_bytes_hash);
         if (iter == hash_to_sprite.cend())
         {
-            if (staging_pos.x + black_box.width() > staging_texture_size.x)
+            if (staging_pos.x + bitmap.size.x > staging_texture_size.x)
             {
                 // Move down to the next row
 
@@ -278,7 +584,7 @@ bool ff::sprite_font::init_sprites()
                 staging_row_height = 0;
             }
 
-            if (staging_pos.y + black_box.height() > staging_texture_size.y)
+            if (staging_pos.y + bitmap.size.y > staging_texture_size.y)
             {
                 // Filled up this texture, make a new one
 
@@ -296,44 +602,19 @@ bool ff::sprite_font::init_sprites()
 
             // Copy bits to the texture
 
-            size_t pixel_stride = this->anti_alias ? 3 : 1;
-            for (size_t y = 0; y < black_box.height(); y++)
-            {
-                uint8_t* alpha_start = &glyph_bytes[y * black_box.width() * pixel_stride];
-                uint8_t* data_start = staging_scratch.GetImages()->pixels + (staging_pos.y + y) * staging_scratch.GetImages()->rowPitch + staging_pos.x * 4;
-
-                for (size_t x = 0; x < black_box.width(); x++)
-                {
-                    data_start[x * 4 + 0] = 255;
-                    data_start[x * 4 + 1] = 255;
-                    data_start[x * 4 + 2] = 255;
-
-                    if (this->anti_alias)
-                    {
-                        float value =
-                            static_cast<float>(alpha_start[x * pixel_stride + 0]) +
-                            static_cast<float>(alpha_start[x * pixel_stride + 1]) +
-                            static_cast<float>(alpha_start[x * pixel_stride + 2]);
-                        data_start[x * 4 + 3] = static_cast<uint8_t>(static_cast<size_t>(value / 3) & 0xFF);
-                    }
-                    else
-                    {
-                        data_start[x * 4 + 3] = alpha_start[x * pixel_stride];
-                    }
-                }
-            }
+            ::copy_glyph(bitmap, *staging_scratch.GetImages(), staging_pos);
 
             // Add sprite to staging texture
 
             sprite_infos.push_back(sprite_info
                 {
                     staging_scratches.size(),
-                    ff::rect_size(staging_pos, staging_pos + black_box.size()).cast<float>(),
-                    ff::point_float(-gm.leftSideBearing * design_unit_size, black_box.height() + gm.bottomSideBearing * design_unit_size),
+                    ff::rect_size(staging_pos, staging_pos + bitmap.size).cast<float>(),
+                    bitmap.handle,
                 });
 
-            staging_pos.x += black_box.width() + 1;
-            staging_row_height = std::max(staging_row_height, black_box.height());
+            staging_pos.x += bitmap.size.x + 1;
+            staging_row_height = std::max(staging_row_height, bitmap.size.y);
 
             iter = hash_to_sprite.try_emplace(glyph_bytes_hash, static_cast<uint16_t>(sprite_infos.size() - 1)).first;
         }
@@ -377,36 +658,302 @@ bool ff::sprite_font::init_sprites()
     return true;
 }
 
-ff::point_float ff::sprite_font::internal_draw_text(ff::dxgi::draw_base* draw, const ff::sprite_list* sprites, std::wstring_view text, const ff::transform& transform, ff::sprite_font_options options) const
+bool ff::sprite_font::init_lazy_atlas()
+{
+    ::font_metrics metrics;
+    if (this->size <= 0.0f || this->size > 200.0f || !::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics) ||
+        this->atlas_options.page_size < 16 || this->atlas_options.page_size > 16384 ||
+        !this->atlas_options.max_pages || this->atlas_options.max_pages >= ff::sprite_font::NO_PAGE)
+    {
+        return false;
+    }
+
+    if (!this->atlas_options.prewarm.empty())
+    {
+        std::scoped_lock lock(this->mutex);
+        this->update_lazy_atlas(this->get_text_run(this->atlas_options.prewarm, ff::sprite_font_options::no_control));
+    }
+
+    return true;
+}
+
+bool ff::sprite_font::has_outline() const
+{
+    return this->lazy_ ? (this->outline_thickness != 0) : (this->outline_sprites != nullptr);
+}
+
+ff::sprite_font::lazy_glyph_info& ff::sprite_font::lazy_glyph(wchar_t ch) const
 {
-    IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
-    if (!font_face || text.empty() || transform.scale.x * transform.scale.y == 0.0f)
+    auto char_iter = this->lazy_char_to_glyph.find(ch);
+    if (char_iter == this->lazy_char_to_glyph.cend())
     {
-        return {};
+        uint16_t glyph_id = ::get_glyph_index(*this->font_file, this->rasterizer_, static_cast<uint32_t>(ch));
+        char_iter = this->lazy_char_to_glyph.try_emplace(ch, glyph_id).first;
     }
 
-    bool has_kerning = font_face->HasKerningPairs();
-    DWRITE_FONT_METRICS1 fm{};
-    font_face->GetMetrics(&fm);
+    auto glyph_iter = this->lazy_glyphs.find(char_iter->second);
+    if (glyph_iter == this->lazy_glyphs.cend())
+    {
+        ff::sprite_font::lazy_glyph_info info{};
+        info.glyph_id = char_iter->second;
+
+        // Glyph zero is for missing chars, which never get drawn
+        ::font_metrics metrics;
+        if (!info.glyph_id ||
+            !::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics) ||
+            !::get_glyph_advance(*this->font_file, this->rasterizer_, info.glyph_id, metrics.design_unit_size, info.glyph_width))
+        {
+            info.rasterized = true;
+        }
 
-    float design_unit_size = this->size / fm.designUnitsPerEm;
-    ff::point_float scaled_design_unit_size = transform.scale * design_unit_size;
-    ff::transform base_pos = transform;
-    base_pos.position.y += fm.ascent * scaled_design_unit_size.y;
-    ff::point_float max_pos(transform.position.x, transform.position.y + (fm.ascent + fm.descent) * scaled_design_unit_size.y);
-    float line_spacing = (fm.ascent + fm.descent + fm.lineGap) * scaled_design_unit_size.y;
+        glyph_iter = this->lazy_glyphs.try_emplace(info.glyph_id, info).first;
+    }
+
+    return glyph_iter->second;
+}
 
-    if (draw)
+bool ff::sprite_font::rasterize_lazy_glyph(ff::sprite_font::lazy_glyph_info& info) const
+{
+    ::font_metrics metrics;
+    ::glyph_bitmap bitmap;
+
+    if (!::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics) ||
+        !::rasterize_glyph(*this->font_file, this->rasterizer_, this->size, metrics.design_unit_size, this->anti_alias, info.glyph_id, bitmap) ||
+        bitmap.alpha.empty())
     {
-        draw->push_no_overlap();
+        info.rasterized = true;
+        return true;
     }
 
+    // The glyph and its outline share one block within a page
+    const size_t page_size = this->atlas_options.page_size;
+    const ff::point_size block_size = this->outline_thickness
+        ? ff::point_size(bitmap.size.x * 2 + 3, bitmap.size.y + 2)
+        : bitmap.size;
+
+    if (block_size.x > page_size || block_size.y > page_size)
+    {
+        debug_fail_msg("Glyph is too big for the font atlas page size");
+        info.rasterized = true;
+        return true;
+    }
+
+    auto try_allocate = [&block_size, page_size](ff::sprite_font::lazy_page& page, ff::point_size& block_pos)
+    {
+        ff::point_size pos = page.pos;
+        size_t row_height = page.row_height;
+
+        if (pos.x + block_size.x > page_size)
+        {
+            // Move down to the next row
+            pos = ff::point_size(0, pos.y + row_height + 1);
+            row_height = 0;
+        }
+
+        if (pos.y + block_size.y > page_size)
+        {
+            return false;
+        }
+
+        block_pos = pos;
+        page.pos = ff::point_size(pos.x + block_size.x + 1, pos.y);
+        page.row_height = std::max(row_height, block_size.y);
+        return true;
+    };
+
+    size_t page_index = 0;
+    ff::point_size block_pos{};
+
+    while (page_index < this->lazy_pages.size() && !try_allocate(this->lazy_pages[page_index], block_pos))
+    {
+        page_index++;
+    }
+
+    if (page_index == this->lazy_pages.size())
+    {
+        if (this->lazy_pages.size() < this->atlas_options.max_pages)
+        {
+            ff::sprite_font::lazy_page page;
+            assert_hr_ret_val(page.scratch.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, page_size, page_size, 1, 1), false);
+            std::memset(page.scratch.GetPixels(), 0, page.scratch.GetPixelsSize());
+            this->lazy_pages.push_back(std::move(page));
+        }
+        else
+        {
+            // Clear the least recently drawn page, unless the current text is already drawing from every page
+            auto page_iter = std::min_element(this->lazy_pages.begin(), this->lazy_pages.end(),
+                [](const ff::sprite_font::lazy_page& lhs, const ff::sprite_font::lazy_page& rhs)
+                {
+                    return lhs.last_used < rhs.last_used;
+                });
+
+            check_ret_val(page_iter->last_used != this->lazy_use_count, false);
+            page_index = static_cast<size_t>(page_iter - this->lazy_pages.begin());
+
+            for (uint16_t glyph_id : page_iter->glyph_ids)
+            {
+                ff::sprite_font::lazy_glyph_info& evicted_info = this->lazy_glyphs[glyph_id];
+                evicted_info.sprite = {};
+                evicted_info.outline_sprite = {};
+                evicted_info.page = ff::sprite_font::NO_PAGE;
+                evicted_info.rasterized = false;
+            }
+
+            page_iter->glyph_ids.clear();
+            page_iter->pos = {};
+            page_iter->row_height = 0;
+            page_iter->dirty = true;
+            std::memset(page_iter->scratch.GetPixels(), 0, page_iter->scratch.GetPixelsSize());
+        }
+
+        assert_ret_val(try_allocate(this->lazy_pages[page_index], block_pos), false);
+    }
+
+    ff::sprite_font::lazy_page& page = this->lazy_pages[page_index];
+    ::copy_glyph(bitmap, *page.scratch.GetImages(), block_pos);
+
+    if (this->outline_thickness)
+    {
+        ::copy_glyph_outline(bitmap, *page.scratch.GetImages(), ff::point_size(block_pos.x + bitmap.size.x + 1, block_pos.y));
+    }
+
+    info.rect = ff::rect_size(block_pos, block_pos + bitmap.size);
+    info.handle = bitmap.handle;
+    info.page = static_cast<uint16_t>(page_index);
+    info.rasterized = true;
+
+    page.glyph_ids.push_back(info.glyph_id);
+    page.last_used = this->lazy_use_count;
+    page.dirty = true;
+
+    return true;
+}
+
+void ff::sprite_font::update_lazy_atlas(const ff::sprite_font::text_run& run) const
+{
+    const size_t frame_count = ff::app_time().frame_count;
+    std::erase_if(this->lazy_retired_textures, [frame_count](const auto& pair) { return pair.first != frame_count; });
+    this->lazy_use_count++;
+
+    for (const ff::sprite_font::text_run_glyph& glyph : run.glyphs)
+    {
+        ff::sprite_font::lazy_glyph_info& info = *glyph.lazy_glyph;
+        if (!info.rasterized)
+        {
+            this->rasterize_lazy_glyph(info);
+        }
+        else if (info.page != ff::sprite_font::NO_PAGE)
+        {
+            this->lazy_pages[info.page].last_used = this->lazy_use_count;
+        }
+    }
+
+    for (ff::sprite_font::lazy_page& page : this->lazy_pages)
+    {
+        if (!page.dirty)
+        {
+            continue;
+        }
+
+        // Static textures can't change, so upload a copy of the page. The old texture stays alive until
+        // the frame is over since sprites for it may still be batched.
+        auto scratch = std::make_shared<DirectX::ScratchImage>();
+        if (FAILED(scratch->InitializeFromImage(*page.scratch.GetImages())))
+        {
+            debug_fail_msg("Failed to copy font atlas page");
+            continue;
+        }
+
+        if (page.texture)
+        {
+            this->lazy_retired_textures.emplace_back(frame_count, std::move(page.texture));
+        }
+
+        page.texture = ff::dxgi::create_static_texture(scratch, ff::dxgi::sprite_type::transparent);
+        page.dirty = false;
+
+        for (uint16_t glyph_id : page.glyph_ids)
+        {
+            ff::sprite_font::lazy_glyph_info& info = this->lazy_glyphs[glyph_id];
+            info.sprite = ff::dxgi::sprite_data(page.texture.get(), info.rect.cast<float>(), info.handle, ff::point_float(1, 1), ff::dxgi::sprite_type::transparent);
+
+            if (this->outline_thickness)
+            {
+                ff::rect_size outline_rect(info.rect.right + 1, info.rect.top, info.rect.right + info.rect.width() + 3, info.rect.bottom + 2);
+                info.outline_sprite = ff::dxgi::sprite_data(page.texture.get(), outline_rect.cast<float>(), info.handle + ff::point_float(1, 1), ff::point_float(1, 1), ff::dxgi::sprite_type::transparent);
+            }
+        }
+    }
+}
+
+const ff::sprite_font::text_run& ff::sprite_font::get_text_run(std::string_view text, ff::sprite_font_options options) const
+{
+    // Only control chars change the layout, the other options are for drawing
+    options = ff::flags::has(options, ff::sprite_font_options::no_control) ? ff::sprite_font_options::no_control : ff::sprite_font_options::none;
+    const size_t key = ff::stable_hash_func(text) ^ static_cast<size_t>(options);
+    const size_t use_count = ++this->text_run_use_count;
+
+    auto iter = this->text_runs.find(key);
+    if (iter != this->text_runs.cend() && iter->second.options == options && iter->second.text == text)
+    {
+        iter->second.last_used = use_count;
+        return iter->second;
+    }
+
+    if (iter == this->text_runs.cend())
+    {
+        if (this->text_runs.size() >= ff::sprite_font::MAX_TEXT_RUNS)
+        {
+            auto oldest_iter = std::min_element(this->text_runs.cbegin(), this->text_runs.cend(), [](const auto& lhs, const auto& rhs)
+                {
+                    return lhs.second.last_used < rhs.second.last_used;
+                });
+
+            this->text_runs.erase(oldest_iter);
+        }
+
+        iter = this->text_runs.try_emplace(key).first;
+    }
+
+    std::array<wchar_t, 2048> wtext_array;
+    std::wstring wtext_string;
+    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
+
+    ff::sprite_font::text_run& run = iter->second;
+    run.text = text;
+    run.options = options;
+    run.last_used = use_count;
+    this->layout_text(wtext, options, run);
+
+    return run;
+}
+
+void ff::sprite_font::layout_text(std::wstring_view text, ff::sprite_font_options options, ff::sprite_font::text_run& run) const
+{
+    run.glyphs.clear();
+    run.colors.clear();
+    run.size = {};
+    run.has_outline_control = false;
+
+    ::font_metrics metrics;
+    if (text.empty() || !::get_font_metrics(this->font_file.get(), this->rasterizer_, this->size, metrics))
+    {
+        return;
+    }
+
+    bool use_controls = !ff::flags::has(options, ff::sprite_font_options::no_control);
+    ff::point_float pos(0, metrics.ascent);
+    ff::point_float max_pos(0, metrics.ascent + metrics.descent);
+    float line_spacing = metrics.ascent + metrics.descent + metrics.line_gap;
+    int text_color = -1;
+    int outline_color = -1;
+
     for (const wchar_t* ch = text.data(), *ch_end = ch + text.size(); ch != ch_end; )
     {
         if (*ch == '\r' || *ch == '\n')
         {
             ch += (*ch == '\r' && ch + 1 != ch_end && ch[1] == '\n') ? 2 : 1;
-            base_pos.position = ff::point_float(transform.position.x, base_pos.position.y + line_spacing);
+            pos = ff::point_float(0, pos.y + line_spacing);
             max_pos.y += line_spacing;
             continue;
         }
@@ -424,64 +971,115 @@ ff::point_float ff::sprite_font::internal_draw_text(ff::dxgi::draw_base* draw, c
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f,
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f,
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f);
-
-                    if (!ff::flags::has(options, ff::sprite_font_options::no_control))
-                    {
-                        if ((control == ff::sprite_font_control::outline_color && sprites == this->outline_sprites.get()) ||
-                            (control == ff::sprite_font_control::text_color && sprites == this->sprites.get()))
-                        {
-                            base_pos.color = color;
-                        }
-                    }
                     break;
 
                 case ff::sprite_font_control::outline_palette_color:
                 case ff::sprite_font_control::text_palette_color:
                     color = ff::color((ch != ch_end) ? static_cast<int>(*ch++) : 0);
-
-                    if (!ff::flags::has(options, ff::sprite_font_options::no_control))
-                    {
-                        if ((control == ff::sprite_font_control::outline_palette_color && sprites == this->outline_sprites.get()) ||
-                            (control == ff::sprite_font_control::text_palette_color && sprites == this->sprites.get()))
-                        {
-                            base_pos.color = color;
-                        }
-                    }
                     break;
+
+                default:
+                    continue;
+            }
+
+            bool outline = (control == ff::sprite_font_control::outline_color || control == ff::sprite_font_control::outline_palette_color);
+            run.has_outline_control |= outline;
+
+            if (use_controls)
+            {
+                run.colors.push_back(color);
+                (outline ? outline_color : text_color) = static_cast<int>(run.colors.size() - 1);
             }
         }
         else
         {
-            const ff::sprite_font::char_and_glyph_info& glyph = this->glyphs[this->glyphs[*ch].char_to_glyph];
+            ff::sprite_font::text_run_glyph run_glyph{ pos, nullptr, nullptr, nullptr, text_color, outline_color };
+            float glyph_width;
 
-            if (draw && sprites && glyph.glyph_to_sprite && glyph.glyph_to_sprite < sprites->size())
+            if (this->lazy_)
             {
-                draw->draw_sprite(sprites->get(static_cast<size_t>(glyph.glyph_to_sprite))->sprite_data(), base_pos);
-            }
-
-            base_pos.position.x += glyph.glyph_width * base_pos.scale.x;
-            max_pos.x = std::max(max_pos.x, base_pos.position.x);
+                ff::sprite_font::lazy_glyph_info& glyph = this->lazy_glyph(*ch);
+                glyph_width = glyph.glyph_width;
 
-            if (has_kerning && ch + 1 != ch_end)
+                // Glyphs that are evicted from the atlas later on get rasterized again when drawn
+                if (!glyph.rasterized || glyph.page != ff::sprite_font::NO_PAGE)
+                {
+                    run_glyph.sprite = &glyph.sprite;
+                    run_glyph.outline_sprite = &glyph.outline_sprite;
+                    run_glyph.lazy_glyph = &glyph;
+                }
+            }
+            else
             {
-                uint16_t two_glyphs[2] = { ch[0], ch[1] };
-                int two_design_kerns[2];
-                if (SUCCEEDED(font_face->GetKerningPairAdjustments(2, two_glyphs, two_design_kerns)))
+                const ff::sprite_font::char_and_glyph_info& glyph = this->glyphs[this->glyphs[*ch].char_to_glyph];
+                const size_t sprite_index = static_cast<size_t>(glyph.glyph_to_sprite);
+                glyph_width = glyph.glyph_width;
+
+                if (this->sprites && sprite_index && sprite_index < this->sprites->size())
                 {
-                    base_pos.position.x += two_design_kerns[0] * scaled_design_unit_size.x;
+                    run_glyph.sprite = &this->sprites->get(sprite_index)->sprite_data();
+
+                    if (this->outline_sprites && sprite_index < this->outline_sprites->size())
+                    {
+                        run_glyph.outline_sprite = &this->outline_sprites->get(sprite_index)->sprite_data();
+                    }
                 }
             }
 
+            if (run_glyph.sprite)
+            {
+                run.glyphs.push_back(run_glyph);
+            }
+
+            pos.x += glyph_width;
+            max_pos.x = std::max(max_pos.x, pos.x);
+
+            if (metrics.has_kerning && ch + 1 != ch_end)
+            {
+                pos.x += ::get_kerning(*this->font_file, this->rasterizer_, ch[0], ch[1]) * metrics.design_unit_size;
+            }
+
             ch++;
         }
     }
 
-    if (draw)
+    run.size = max_pos;
+}
+
+void ff::sprite_font::draw_text_run(ff::dxgi::draw_base& draw, const ff::sprite_font::text_run& run, bool outline, const ff::transform& transform) const
+{
+    this->batch_sprites.clear();
+    this->batch_positions.clear();
+    this->batch_colors.clear();
+    bool uses_colors = false;
+
+    for (const ff::sprite_font::text_run_glyph& glyph : run.glyphs)
     {
-        draw->pop_no_overlap();
+        const ff::dxgi::sprite_data* sprite = outline ? glyph.outline_sprite : glyph.sprite;
+        if (sprite && *sprite)
+        {
+            int color_index = outline ? glyph.outline_color : glyph.text_color;
+            uses_colors |= (color_index >= 0);
+
+            this->batch_sprites.push_back(sprite);
+            this->batch_positions.push_back(transform.position + glyph.offset * transform.scale);
+            this->batch_colors.push_back(color_index >= 0 ? run.colors[color_index] : transform.color);
+        }
     }
 
-    return max_pos - transform.position;
+    if (!this->batch_sprites.empty())
+    {
+        ff::dxgi::sprite_batch_t batch{};
+        batch.sprites = this->batch_sprites;
+        batch.positions = this->batch_positions;
+        batch.scales = std::span(&transform.scale, 1);
+        batch.rotations = transform.rotation ? std::span(&transform.rotation, 1) : std::span<const float>();
+        batch.colors = uses_colors ? std::span<const ff::color>(this->batch_colors) : std::span(&transform.color, 1);
+
+        draw.push_no_overlap();
+        draw.draw_sprites(batch);
+        draw.pop_no_overlap();
+    }
 }
 
 std::vector<std::shared_ptr<ff::resource>> ff::sprite_font::resource_get_dependencies() const
@@ -494,6 +1092,24 @@ std::vector<std::shared_ptr<ff::resource>> ff::sprite_font::resource_get_depende
 
 bool ff::sprite_font::save_to_cache(ff::dict& dict) const
 {
+    if (this->lazy_)
+    {
+        // Glyphs get rasterized again after loading from the cache
+        check_ret_val(*this, false);
+
+        dict.set<ff::resource>("data", this->font_file_resource.resource());
+        dict.set<float>("size", this->size);
+        dict.set<int>("outline", this->outline_thickness);
+        dict.set<bool>("aa", this->anti_alias);
+        dict.set<std::string>("rasterizer", (this->rasterizer_ == ff::sprite_font_rasterizer::truetype) ? "truetype" : "directwrite");
+        dict.set<bool>("lazy", true);
+        dict.set<std::string>("prewarm", this->atlas_options.prewarm);
+        dict.set<size_t>("page_size", this->atlas_options.page_size);
+        dict.set<size_t>("max_pages", this->atlas_options.max_pages);
+
+        return true;
+    }
+
     ff::dict sprites_dict, outline_sprites_dict;
     if (*this && ff::resource_object_base::save_to_cache_typed(*this->sprites, sprites_dict) &&
         (!this->outline_sprites || ff::resource_object_base::save_to_cache_typed(*this->outline_sprites, outline_sprites_dict)))
@@ -502,7 +1118,8 @@ bool ff::sprite_font::save_to_cache(ff::dict& dict) const
         dict.set<float>("size", this->size);
         dict.set<int>("outline", this->outline_thickness);
         dict.set<bool>("aa", this->anti_alias);
-        dict.set_bytes("glyphs", this->glyphs.data(), ff::array_byte_size(this->glyphs));
+        dict.set<std::string>("rasterizer", (this->rasterizer_ == ff::sprite_font_rasterizer::truetype) ? "truetype" : "directwrite");
+        dict.set_bytes("glyphs", this->glyphs.data(), ff::vector_byte_size(this->glyphs));
         dict.set<ff::dict>("sprites", std::move(sprites_dict));
         dict.set<ff::dict>("outline_sprites", std::move(outline_sprites_dict));
 
@@ -519,9 +1136,13 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_font_factory::loa
     int outline_thickness = dict.get<int>("outline");
     bool anti_alias = dict.get<bool>("aa");
 
-    if (font_file_resource)
+    if (font_file_resource && dict.get<bool>("lazy"))
     {
-        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias);
+        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, ::load_atlas_options(dict), ::load_rasterizer(dict));
+    }
+    else if (font_file_resource)
+    {
+        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, ::load_rasterizer(dict));
     }
 
     assert(false);
@@ -534,13 +1155,19 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_font_factory::loa
     float size = dict.get<float>("size");
     int outline_thickness = dict.get<int>("outline");
     bool anti_alias = dict.get<bool>("aa");
+
+    if (font_file_resource && dict.get<bool>("lazy"))
+    {
+        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, ::load_atlas_options(dict), ::load_rasterizer(dict));
+    }
+
     std::shared_ptr<ff::data_base> glyphs_data = dict.get<ff::data_base>("glyphs");
     std::shared_ptr<ff::sprite_list> sprites = std::dynamic_pointer_cast<ff::sprite_list>(dict.get<ff::resource_object_base>("sprites"));
     std::shared_ptr<ff::sprite_list> outline_sprites = std::dynamic_pointer_cast<ff::sprite_list>(dict.get<ff::resource_object_base>("outline_sprites"));
 
     if (font_file_resource && glyphs_data && sprites)
     {
-        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, sprites, outline_sprites, glyphs_data);
+        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, sprites, outline_sprites, glyphs_data, ::load_rasterizer(dict));
     }
 
     assert(false);
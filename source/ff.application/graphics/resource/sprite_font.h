@@ -1,8 +1,10 @@
 #pragma once
 
+#include "../dxgi/sprite_data.h"
+#include "../types/color.h"
+
 namespace ff
 {
-    class color;
     class font_file;
     class sprite_list;
 
@@ -25,24 +27,45 @@ namespace ff
         no_control = 0x04, // ignore any sprite_font_control chars
     };
 
+    enum class sprite_font_rasterizer
+    {
+        directwrite,
+        truetype, // portable CPU rasterizer that reads the font data directly, see ff::truetype_font
+    };
+
+    // Settings for fonts that rasterize glyphs on first use instead of all at load time
+    struct sprite_font_atlas_options
+    {
+        std::string prewarm; // UTF-8 characters to rasterize as soon as the font loads
+        size_t page_size{ 512 };
+        size_t max_pages{ 4 }; // when all pages are full, the least recently drawn page is cleared
+    };
+
     class sprite_font : public ff::resource_object_base
     {
     public:
-        sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias);
+        sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias,
+            ff::sprite_font_rasterizer rasterizer = ff::sprite_font_rasterizer::directwrite);
+        sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias,
+            const ff::sprite_font_atlas_options& atlas_options,
+            ff::sprite_font_rasterizer rasterizer = ff::sprite_font_rasterizer::directwrite);
         sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias,
             const std::shared_ptr<ff::sprite_list>& sprites,
             const std::shared_ptr<ff::sprite_list>& outline_sprites,
-            const std::shared_ptr<ff::data_base>& glyphs_data);
-        sprite_font(sprite_font&& other) noexcept = default;
+            const std::shared_ptr<ff::data_base>& glyphs_data,
+            ff::sprite_font_rasterizer rasterizer = ff::sprite_font_rasterizer::directwrite);
+        sprite_font(sprite_font&& other) noexcept = delete;
         sprite_font(const sprite_font& other) = delete;
 
-        sprite_font& operator=(sprite_font&& other) noexcept = default;
+        sprite_font& operator=(sprite_font&& other) noexcept = delete;
         sprite_font& operator=(const sprite_font & other) = delete;
         operator bool() const;
 
         ff::point_float draw_text(ff::dxgi::draw_base* draw, std::string_view text, const ff::transform& transform, const ff::color& outline_color, ff::sprite_font_options options = ff::sprite_font_options::none) const;
         ff::point_float measure_text(std::string_view text, ff::point_float scale) const;
         float line_spacing() const;
+        bool lazy() const;
+        ff::sprite_font_rasterizer rasterizer() const;
 
         virtual bool resource_load_complete(bool from_source) override;
         virtual std::vector<std::shared_ptr<resource>> resource_get_dependencies() const override;
@@ -51,10 +74,22 @@ namespace ff
         virtual bool save_to_cache(ff::dict& dict) const override;
 
     private:
+        struct lazy_glyph_info;
+        struct text_run;
+
         bool init_sprites();
-        ff::point_float internal_draw_text(ff::dxgi::draw_base* draw, const ff::sprite_list* sprites, std::wstring_view text, const ff::transform& transform, ff::sprite_font_options options) const;
+        bool init_lazy_atlas();
+        bool has_outline() const;
+        lazy_glyph_info& lazy_glyph(wchar_t ch) const; // must be holding mutex
+        bool rasterize_lazy_glyph(lazy_glyph_info& info) const; // must be holding mutex
+        void update_lazy_atlas(const text_run& run) const; // must be holding mutex
+        const text_run& get_text_run(std::string_view text, ff::sprite_font_options options) const; // must be holding mutex
+        void layout_text(std::wstring_view text, ff::sprite_font_options options, text_run& run) const; // must be holding mutex
+        void draw_text_run(ff::dxgi::draw_base& draw, const text_run& run, bool outline, const ff::transform& transform) const; // must be holding mutex
 
         static const size_t MAX_GLYPH_COUNT = 0x10000;
+        static const size_t MAX_TEXT_RUNS = 256;
+        static const uint16_t NO_PAGE = 0xFFFF;
 
         struct char_and_glyph_info
         {
@@ -63,15 +98,78 @@ namespace ff
             float glyph_width;
         };
 
+        struct lazy_glyph_info
+        {
+            ff::dxgi::sprite_data sprite;
+            ff::dxgi::sprite_data outline_sprite;
+            ff::rect_size rect{}; // within the page, the outline is to the right of the glyph
+            ff::point_float handle{};
+            uint16_t glyph_id{};
+            uint16_t page{ ff::sprite_font::NO_PAGE };
+            float glyph_width{};
+            bool rasterized{};
+        };
+
+        struct lazy_page
+        {
+            DirectX::ScratchImage scratch;
+            std::shared_ptr<ff::dxgi::texture_base> texture;
+            std::vector<uint16_t> glyph_ids;
+            ff::point_size pos{};
+            size_t row_height{};
+            size_t last_used{};
+            bool dirty{};
+        };
+
+        struct text_run_glyph
+        {
+            ff::point_float offset; // from the text position at a scale of one
+            const ff::dxgi::sprite_data* sprite;
+            const ff::dxgi::sprite_data* outline_sprite;
+            lazy_glyph_info* lazy_glyph; // lazy fonts make sure this is rasterized before drawing
+            int text_color; // index into text_run::colors, or -1 to use the color passed to draw_text
+            int outline_color;
+        };
+
+        // Laid out text that can be drawn again without converting, measuring, or looking up glyphs
+        struct text_run
+        {
+            std::string text;
+            ff::sprite_font_options options{};
+            std::vector<text_run_glyph> glyphs; // only glyphs that can draw something
+            std::vector<ff::color> colors; // from control chars
+            ff::point_float size{}; // at a scale of one
+            size_t last_used{};
+            bool has_outline_control{};
+        };
+
         std::shared_ptr<ff::sprite_list> sprites;
         std::shared_ptr<ff::sprite_list> outline_sprites;
-        std::array<char_and_glyph_info, ff::sprite_font::MAX_GLYPH_COUNT> glyphs;
+        std::vector<char_and_glyph_info> glyphs; // MAX_GLYPH_COUNT entries, empty when lazy
+
+        // Lazy atlas, only changes while drawing or measuring, which can happen on any thread
+        bool lazy_;
+        ff::sprite_font_atlas_options atlas_options;
+        mutable std::mutex mutex;
+        mutable std::unordered_map<wchar_t, uint16_t> lazy_char_to_glyph;
+        mutable std::unordered_map<uint16_t, lazy_glyph_info> lazy_glyphs;
+        mutable std::vector<lazy_page> lazy_pages;
+        mutable std::vector<std::pair<size_t, std::shared_ptr<ff::dxgi::texture_base>>> lazy_retired_textures; // kept until the frame that drew with them is over
+        mutable size_t lazy_use_count{};
+
+        // Text run cache, keyed by a hash of the text and options, and scratch buffers for drawing runs. Also guarded by mutex.
+        mutable std::unordered_map<size_t, text_run, ff::no_hash<size_t>> text_runs;
+        mutable size_t text_run_use_count{};
+        mutable std::vector<const ff::dxgi::sprite_data*> batch_sprites;
+        mutable std::vector<ff::point_float> batch_positions;
+        mutable std::vector<ff::color> batch_colors;
 
         ff::auto_resource<ff::font_file> font_file_resource;
         std::shared_ptr<ff::font_file> font_file;
         float size;
         int outline_thickness;
         bool anti_alias;
+        ff::sprite_font_rasterizer rasterizer_;
     };
 }
 
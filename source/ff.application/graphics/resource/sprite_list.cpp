@@ -1,10 +1,12 @@
 #include "pch.h"
+#include "graphics/dxgi/dxgi_globals.h"
 #include "graphics/dxgi/sprite_data.h"
 #include "graphics/dxgi/format_util.h"
 #include "graphics/resource/sprite_base.h"
 #include "graphics/resource/sprite_list.h"
 #include "graphics/resource/sprite_optimizer.h"
 #include "graphics/resource/sprite_resource.h"
+#include "graphics/resource/texture_data.h"
 #include "graphics/resource/texture_resource.h"
 
 ff::sprite_list::sprite_list(std::vector<ff::sprite>&& sprites)
@@ -112,7 +114,9 @@ bool ff::sprite_list::save_to_cache(ff::dict& dict) const
 std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::load_from_source(const ff::dict& dict, resource_load_context& context) const
 {
     bool optimize = dict.get<bool>("optimize", true);
+    bool trim = dict.get<bool>("trim", true);
     size_t mip_count = dict.get<size_t>("mips", 1);
+    int max_texture_size = dict.get<int>("max_texture_size", 1024);
     DXGI_FORMAT format = ff::dxgi::parse_format(dict.get<std::string>("format", std::string("rgba32")));
     if (format == DXGI_FORMAT_UNKNOWN)
     {
@@ -137,6 +141,44 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
     std::vector<ff::sprite> sprites;
     std::vector<std::string_view> child_names = sprites_dict.child_names(true);
 
+    // Decode all unique texture files in parallel before creating any sprites
+    {
+        std::vector<std::filesystem::path> files;
+        for (std::string_view child_name : child_names)
+        {
+            std::filesystem::path full_file = sprites_dict.get<ff::dict>(child_name).get<std::string>("file");
+            if (texture_views.try_emplace(std::wstring(full_file.native())).second)
+            {
+                files.push_back(std::move(full_file));
+            }
+        }
+
+        ff::internal::load_texture_data_stats stats{};
+        std::vector<ff::internal::texture_data> texture_datas = ff::internal::load_texture_data(files,
+            (optimize && ff::dxgi::color_format(format)) ? DXGI_FORMAT_R8G8B8A8_UNORM : format,
+            optimize ? 1 : mip_count, &stats);
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::shared_ptr<ff::dxgi::texture_base> dxgi_texture = texture_datas[i].data
+                ? ff::dxgi::create_static_texture(texture_datas[i].data, ff::dxgi::sprite_type::unknown)
+                : nullptr;
+
+            if (!dxgi_texture)
+            {
+                std::ostringstream str;
+                str << "Failed to load texture file: " << files[i];
+                context.add_error(str.str());
+                return nullptr;
+            }
+
+            texture_views[files[i].native()] = std::make_shared<ff::texture>(dxgi_texture, texture_datas[i].palette);
+        }
+
+        ff::log::write(ff::log::type::resource_load, "Loaded ", stats.texture_count, " texture file(s) in ", &std::fixed, std::setprecision(1),
+            stats.seconds * 1000.0, "ms, ", stats.megapixels_per_second(), " MP/s, ", stats.megabytes_per_second(), " MB/s");
+    }
+
     for (std::string_view child_name : child_names)
     {
         ff::dict sprite_dict = sprites_dict.get<ff::dict>(child_name);
@@ -161,29 +203,7 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
         ff::point_float scale = sprite_dict.get<ff::point_float>("scale", ff::point_float(1, 1));
         size_t repeat = sprite_dict.get<size_t>("repeat", 1);
 
-        std::shared_ptr<ff::texture> texture_view;
-        auto iter = texture_views.find(full_file.native());
-        if (iter != texture_views.cend())
-        {
-            texture_view = iter->second;
-        }
-        else
-        {
-            std::shared_ptr<ff::texture> texture = std::make_shared<ff::texture>(full_file,
-                (optimize && ff::dxgi::color_format(format)) ? DXGI_FORMAT_R8G8B8A8_UNORM : format,
-                optimize ? 1 : mip_count);
-
-            if (!*texture)
-            {
-                std::ostringstream str;
-                str << "Failed to load texture file: " << full_file;
-                context.add_error(str.str());
-                return nullptr;
-            }
-
-            texture_view = texture;
-            texture_views.try_emplace(std::wstring(full_file.native()), texture_view);
-        }
+        std::shared_ptr<ff::texture> texture_view = texture_views[full_file.native()];
 
         if (size == ff::point_float{} && handle == ff::point_float{})
         {
@@ -213,12 +233,16 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
 
     if (optimize)
     {
-        std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, format, mip_count);
+        ff::internal::optimize_sprites_stats stats{};
+        std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, format, mip_count, max_texture_size, &stats, trim);
         if (new_sprites.size() != sprites.size())
         {
             debug_fail_ret_val(nullptr);
         }
 
+        ff::log::write(ff::log::type::resource_load, "Optimized ", sprites.size(), " sprites into ", stats.texture_count,
+            " texture(s), ", &std::fixed, std::setprecision(1), stats.efficiency() * 100.0, "% used");
+
         std::swap(sprites, new_sprites);
     }
 
@@ -280,3 +304,9 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
 
     return std::make_shared<ff::sprite_list>(std::move(sprites));
 }
+
+size_t ff::internal::sprite_list_factory::build_version() const
+{
+    // 1: Optimized sprites are trimmed and share identical pixels, PNG files are swizzled to BGRA while decoding
+    return 1;
+}
@@ -12,10 +12,19 @@
 #include "../vendor/RectangleBinPack/Rect.cpp"
 #pragma warning(default : 4267)
 
-constexpr int TEXTURE_SIZE_MAX = 1024;
 constexpr int TEXTURE_SIZE_MIN = 128;
 constexpr int BORDER_SIZE = 2;
 
+// Every texture size is packed with each of these, and the best result is used
+constexpr std::array<rbp::MaxRectsBinPack::FreeRectChoiceHeuristic, 5> PACK_HEURISTICS
+{
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectBestAreaFit,
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectBestShortSideFit,
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectBestLongSideFit,
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectBottomLeftRule,
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectContactPointRule,
+};
+
 namespace
 {
     // Info about where each sprite came from and where it's going
@@ -42,6 +51,12 @@ namespace
             {
                 if (this->source_rect.width() == other.source_rect.width())
                 {
+                    if (this->pixel_hash != other.pixel_hash)
+                    {
+                        // Keep the same pixels together to detect dupe sprites
+                        return this->pixel_hash < other.pixel_hash;
+                    }
+
                     if (this->source_rect.top == other.source_rect.top)
                     {
                         if (this->source_rect.left == other.source_rect.left)
@@ -64,6 +79,11 @@ namespace
             return this->source_rect.height() > other.source_rect.height();
         }
 
+        ff::point_int padded_size() const
+        {
+            return this->source_rect.size() + ff::point_int(::BORDER_SIZE * 2, ::BORDER_SIZE * 2);
+        }
+
         ff::rect_int sprite_dest_rect() const
         {
             return this->source_rect != this->dest_rect
@@ -77,6 +97,11 @@ namespace
         ff::rect_int dest_rect;
         size_t sprite_index;
         size_t dest_texture;
+
+        // Set by trim_sprites
+        const DirectX::Image* source_image{};
+        ff::point_int trim_offset{}; // how far the top left of source_rect moved in
+        size_t pixel_hash{};
     };
 
     // Cached RGBA original texture
@@ -91,48 +116,126 @@ namespace
     {
         optimized_texture_info(ff::point_int size)
             : size(size)
-            , packer(std::make_unique<rbp::MaxRectsBinPack>(size.x, size.y, false))
-        {
-        }
-
-        bool find_placement(ff::point_int placement_size, ff::rect_int& dest_rect)
         {
-            rbp::Rect dest = this->packer->Insert(placement_size.x, placement_size.y, rbp::MaxRectsBinPack::FreeRectChoiceHeuristic::RectBestAreaFit);
-            dest_rect = ff::rect_int(dest.x, dest.y, dest.x + dest.width, dest.y + dest.height);
-            return dest.width && dest.height;
         }
 
         ff::point_int size;
         DirectX::ScratchImage scratch_texture;
         std::shared_ptr<ff::texture> final_texture;
+    };
+
+    // Where sprites would go when packed into one texture of a certain size
+    struct pack_result
+    {
+        bool better_than(const pack_result& other, size_t sprite_count) const
+        {
+            const bool all_placed = this->placements.size() == sprite_count;
+            const bool other_all_placed = other.placements.size() == sprite_count;
 
-    private:
-        std::unique_ptr<rbp::MaxRectsBinPack> packer;
+            if (all_placed != other_all_placed)
+            {
+                return all_placed;
+            }
+
+            // When everything fits, use the smallest texture, otherwise fill up the texture as much as possible
+            if (all_placed || this->placed_area == other.placed_area)
+            {
+                return this->size.x * this->size.y < other.size.x * other.size.y;
+            }
+
+            return this->placed_area > other.placed_area;
+        }
+
+        ff::point_int size;
+        std::vector<std::pair<size_t, ff::rect_int>> placements; // sprite index and dest rect
+        int64_t placed_area;
     };
 }
 
-// Returns true when all done (sprites will still be placed when false is returned)
-static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<optimized_texture_info>& texture_infos, size_t start_texture)
+// Sprites with the same pixels can share the same spot in a texture, even when they came from different textures
+static bool same_sprite(const ::optimized_sprite_info& sprite1, const ::optimized_sprite_info& sprite2)
 {
-    size_t sprites_done = 0;
+    if (sprite1.source_rect.size() != sprite2.source_rect.size() || sprite1.pixel_hash != sprite2.pixel_hash ||
+        !sprite1.source_image || !sprite2.source_image || sprite1.source_image->format != sprite2.source_image->format)
+    {
+        return false;
+    }
 
-    for (size_t i = 0; i < sprites.size(); i++)
+    const size_t pixel_size = DirectX::BitsPerPixel(sprite1.source_image->format) / 8;
+    const size_t row_size = sprite1.source_rect.width() * pixel_size;
+
+    for (int y = 0; y < sprite1.source_rect.height(); y++)
     {
-        ::optimized_sprite_info& sprite = sprites[i];
-        ff::point_int size = sprite.source_rect.size() + ff::point_int{::BORDER_SIZE * 2, ::BORDER_SIZE * 2};
-        bool oversized = size.x > ::TEXTURE_SIZE_MAX || size.y > ::TEXTURE_SIZE_MAX;
+        const uint8_t* row1 = sprite1.source_image->pixels + sprite1.source_image->rowPitch * (sprite1.source_rect.top + y) + sprite1.source_rect.left * pixel_size;
+        const uint8_t* row2 = sprite2.source_image->pixels + sprite2.source_image->rowPitch * (sprite2.source_rect.top + y) + sprite2.source_rect.left * pixel_size;
+
+        if (std::memcmp(row1, row2, row_size))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Packs as many sprites as possible into one texture
+static ::pack_result pack_texture(
+    const std::vector<::optimized_sprite_info>& sprites,
+    const std::vector<size_t>& sprite_indexes,
+    ff::point_int size,
+    rbp::MaxRectsBinPack::FreeRectChoiceHeuristic heuristic)
+{
+    ::pack_result result{ size };
+    rbp::MaxRectsBinPack packer(size.x, size.y, false);
 
-        if (sprite.has_dest_texture())
+    for (size_t i : sprite_indexes)
+    {
+        ff::point_int sprite_size = sprites[i].padded_size();
+        rbp::Rect dest = packer.Insert(sprite_size.x, sprite_size.y, heuristic);
+
+        if (dest.width && dest.height)
         {
-            // Already placed
+            result.placements.emplace_back(i, ff::rect_int(dest.x, dest.y, dest.x + dest.width, dest.y + dest.height));
+            result.placed_area += static_cast<int64_t>(dest.width) * dest.height;
         }
-        else if (i > 0 && !(sprite < sprites[i - 1]) && !(sprites[i - 1] < sprite))
+    }
+
+    return result;
+}
+
+static bool compute_optimized_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<::optimized_texture_info>& texture_infos, int max_texture_size)
+{
+    // Texture sizes should be powers of 2 to support compression and mipmaps
+    int texture_size_max = ::TEXTURE_SIZE_MIN;
+    while (texture_size_max * 2 <= max_texture_size)
+    {
+        texture_size_max *= 2;
+    }
+
+    std::vector<ff::point_int> texture_sizes;
+    for (int height = ::TEXTURE_SIZE_MIN; height <= texture_size_max; height *= 2)
+    {
+        texture_sizes.emplace_back(height, height);
+
+        if (height < texture_size_max)
         {
-            // The previous sprite is exactly the same
-            sprite.dest_texture = sprites[i - 1].dest_texture;
-            sprite.dest_rect = sprites[i - 1].dest_rect;
+            texture_sizes.emplace_back(height * 2, height);
         }
-        else if (oversized)
+    }
+
+    std::vector<size_t> pending_sprites;
+    pending_sprites.reserve(sprites.size());
+
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        ::optimized_sprite_info& sprite = sprites[i];
+        ff::point_int size = sprite.padded_size();
+
+        if (i > 0 && ::same_sprite(sprite, sprites[i - 1]))
+        {
+            // The previous sprite is exactly the same, it will share the same spot
+        }
+        else if (size.x > texture_size_max || size.y > texture_size_max)
         {
             // No need for borders
             size = sprite.source_rect.size();
@@ -141,7 +244,6 @@ static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::ve
             sprite.dest_texture = texture_infos.size();
             sprite.dest_rect = ff::rect_int(ff::point_int(0, 0), size);
 
-            // texture sizes should be powers of 2 to support compression and mipmaps
             size.x = ff::math::nearest_power_of_two(size.x);
             size.y = ff::math::nearest_power_of_two(size.y);
 
@@ -149,64 +251,84 @@ static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::ve
         }
         else
         {
-            // Look for empty space in an existing texture
-            for (size_t h = start_texture; h < texture_infos.size() && !sprite.has_dest_texture(); h++)
+            pending_sprites.push_back(i);
+        }
+    }
+
+    while (!pending_sprites.empty())
+    {
+        // Try every texture size with every heuristic on the thread pool
+        std::vector<::pack_result> results(texture_sizes.size() * ::PACK_HEURISTICS.size());
+        ff::task_graph graph;
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            graph.add_task([&sprites, &pending_sprites, &texture_sizes, &results, i]()
             {
-                if (texture_infos[h].find_placement(size, sprite.dest_rect))
-                {
-                    sprite.dest_texture = h;
-                }
-            }
+                const ff::point_int size = texture_sizes[i / ::PACK_HEURISTICS.size()];
+                results[i] = ::pack_texture(sprites, pending_sprites, size, ::PACK_HEURISTICS[i % ::PACK_HEURISTICS.size()]);
+                return true;
+            });
         }
 
-        if (sprite.has_dest_texture())
+        assert_ret_val(graph.run(), false);
+
+        ::pack_result best{};
+        for (::pack_result& result : results)
         {
-            sprites_done++;
+            if (best.placements.empty() || result.better_than(best, pending_sprites.size()))
+            {
+                best = std::move(result);
+            }
         }
-    }
 
-    return sprites_done == sprites.size();
-}
+        assert_ret_val(!best.placements.empty(), false);
 
-static bool compute_optimized_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<::optimized_texture_info>& texture_infos)
-{
-    for (bool done = false; !done && sprites.size(); )
-    {
-        // Add a new texture, start with the smallest size and work up
-        for (ff::point_int size(::TEXTURE_SIZE_MIN, ::TEXTURE_SIZE_MIN); !done && size.x <= ::TEXTURE_SIZE_MAX; size *= 2)
+        for (const auto& [sprite_index, dest_rect] : best.placements)
         {
-            size_t texture_index = texture_infos.size();
-            texture_infos.emplace_back(size);
+            sprites[sprite_index].dest_texture = texture_infos.size();
+            sprites[sprite_index].dest_rect = dest_rect;
+        }
 
-            done = ::place_sprites(sprites, texture_infos, texture_infos.size() - 1);
+        texture_infos.emplace_back(best.size);
 
-            if (!done && size.x < ::TEXTURE_SIZE_MAX)
+        std::erase_if(pending_sprites, [&sprites](size_t i)
             {
-                // Remove this texture and use a bigger one instead
-                texture_infos.erase(texture_infos.begin() + texture_index);
+                return sprites[i].has_dest_texture();
+            });
+    }
 
-                for (::optimized_sprite_info& sprite : sprites)
-                {
-                    if (sprite.has_dest_texture())
-                    {
-                        if (sprite.dest_texture == texture_index)
-                        {
-                            sprite.dest_texture = ff::constants::invalid_unsigned<size_t>();
-                            sprite.dest_rect = {};
-                        }
-                        else if (sprite.dest_texture > texture_index)
-                        {
-                            sprite.dest_texture--;
-                        }
-                    }
-                }
-            }
+    for (size_t i = 1; i < sprites.size(); i++)
+    {
+        if (!sprites[i].has_dest_texture() && ::same_sprite(sprites[i], sprites[i - 1]))
+        {
+            sprites[i].dest_texture = sprites[i - 1].dest_texture;
+            sprites[i].dest_rect = sprites[i - 1].dest_rect;
         }
     }
 
     return true;
 }
 
+static void compute_stats(const std::vector<::optimized_sprite_info>& sprites, const std::vector<::optimized_texture_info>& texture_infos, ff::internal::optimize_sprites_stats& stats)
+{
+    stats = {};
+    stats.texture_count = texture_infos.size();
+
+    for (const ::optimized_texture_info& texture_info : texture_infos)
+    {
+        stats.texture_area += static_cast<size_t>(texture_info.size.x) * static_cast<size_t>(texture_info.size.y);
+    }
+
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        if (!i || !::same_sprite(sprites[i], sprites[i - 1]))
+        {
+            stats.sprite_area += static_cast<size_t>(sprites[i].dest_rect.area());
+        }
+    }
+}
+
 static std::vector<::optimized_sprite_info> create_sprite_infos(const std::vector<ff::sprite>& original_sprites)
 {
     std::vector<::optimized_sprite_info> sprite_infos;
@@ -256,6 +378,82 @@ static bool create_original_textures(
     return true;
 }
 
+// Trims transparent edges off of each sprite (when trim is true) and hashes the pixels that are left
+static bool trim_sprites(
+    std::vector<::optimized_sprite_info>& sprite_infos,
+    const std::unordered_map<const ff::texture*, ::original_texture_info>& original_textures,
+    bool trim)
+{
+    ff::task_graph graph;
+
+    for (::optimized_sprite_info& sprite : sprite_infos)
+    {
+        graph.add_task([&sprite, &original_textures, trim]()
+        {
+            auto iter = original_textures.find(sprite.sprite->texture().get());
+            if (iter == original_textures.cend())
+            {
+                debug_fail_ret_val(false);
+            }
+
+            // Palette textures use index zero for transparent
+            const DirectX::Image& image = *iter->second.rgb_scratch->GetImages();
+            const size_t pixel_size = DirectX::BitsPerPixel(image.format) / 8;
+            const size_t alpha_offset = (image.format == DXGI_FORMAT_R8G8B8A8_UNORM) ? 3 : 0;
+            const ff::rect_int rect = sprite.source_rect;
+            ff::rect_int bounds(rect.right, rect.bottom, rect.left, rect.top);
+
+            for (int y = rect.top; trim && y < rect.bottom; y++)
+            {
+                const uint8_t* alpha = image.pixels + image.rowPitch * y + rect.left * pixel_size + alpha_offset;
+
+                for (int x = rect.left; x < rect.right; x++, alpha += pixel_size)
+                {
+                    if (*alpha)
+                    {
+                        bounds.left = std::min(bounds.left, x);
+                        bounds.top = std::min(bounds.top, y);
+                        bounds.right = std::max(bounds.right, x + 1);
+                        bounds.bottom = std::max(bounds.bottom, y + 1);
+                    }
+                }
+            }
+
+            if (!trim)
+            {
+                bounds = rect;
+            }
+            else if (bounds.left >= bounds.right)
+            {
+                // Nothing is visible
+                bounds = ff::rect_int(rect.top_left(), rect.top_left() + ff::point_int(1, 1));
+            }
+            else
+            {
+                // Keep one transparent pixel around the edges, so that filtering at the edges is the same
+                bounds = bounds.inflate(1, 1).crop(rect);
+            }
+
+            sprite.trim_offset = bounds.top_left() - rect.top_left();
+            sprite.source_rect = bounds;
+            sprite.source_image = &image;
+
+            ff::stable_hash_data_t hash(static_cast<size_t>(bounds.area()));
+            for (int y = bounds.top; y < bounds.bottom; y++)
+            {
+                hash.hash(image.pixels + image.rowPitch * y + bounds.left * pixel_size, bounds.width() * pixel_size);
+            }
+
+            sprite.pixel_hash = hash;
+            return true;
+        });
+    }
+
+    const bool status = graph.run();
+    assert(status);
+    return status;
+}
+
 static bool create_optimized_textures(DXGI_FORMAT format, std::vector<::optimized_texture_info>& texture_infos)
 {
     format = ff::dxgi::color_format(format) ? DXGI_FORMAT_R8G8B8A8_UNORM : format;
@@ -274,12 +472,11 @@ static bool copy_optimized_sprites(
     std::unordered_map<const ff::texture*, ::original_texture_info>& original_textures,
     std::vector<::optimized_texture_info>& texture_infos)
 {
-    std::vector<ff::co_task_source<bool>> tasks;
-    tasks.reserve(sprite_infos.size());
+    ff::task_graph graph;
 
     for (::optimized_sprite_info& sprite : sprite_infos)
     {
-        tasks.emplace_back(ff::task::run<bool>([&sprite, &original_textures, &texture_infos]()
+        graph.add_task([&sprite, &original_textures, &texture_infos]()
         {
             auto iter = original_textures.find(sprite.sprite->texture().get());
             if (sprite.dest_texture >= texture_infos.size() || iter == original_textures.cend())
@@ -422,15 +619,10 @@ static bool copy_optimized_sprites(
 
             assert(status);
             return status;
-        }));
-    }
-
-    bool status = true;
-    for (ff::co_task_source<bool>& task : tasks)
-    {
-        status &= task.wait();
+        });
     }
 
+    const bool status = graph.run();
     assert(status);
     return status;
 }
@@ -470,7 +662,7 @@ static bool create_final_sprites(
             std::string(sprite_info.sprite->name()),
             texture_infos[sprite_info.dest_texture].final_texture,
             sprite_info.sprite_dest_rect().cast<float>(),
-            sprite_info.sprite->sprite_data().handle(),
+            sprite_info.sprite->sprite_data().handle() - sprite_info.trim_offset.cast<float>(),
             sprite_info.sprite->sprite_data().scale(),
             sprite_info.dest_sprite_type);
     }
@@ -478,22 +670,34 @@ static bool create_final_sprites(
     return true;
 }
 
-std::vector<ff::sprite> ff::internal::optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count)
+double ff::internal::optimize_sprites_stats::efficiency() const
+{
+    return this->texture_area ? static_cast<double>(this->sprite_area) / static_cast<double>(this->texture_area) : 0.0;
+}
+
+std::vector<ff::sprite> ff::internal::optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count, int max_texture_size, ff::internal::optimize_sprites_stats* stats, bool trim)
 {
     std::vector<ff::sprite> new_sprites;
     assert_ret_val(new_mip_count == 1 || ff::dxgi::color_format(new_format), new_sprites);
 
     std::vector<::optimized_sprite_info> sprite_infos = ::create_sprite_infos(old_sprites);
-    std::sort(sprite_infos.begin(), sprite_infos.end());
-
     std::unordered_map<const ff::texture*, ::original_texture_info> original_textures;
     std::shared_ptr<DirectX::ScratchImage> scratch_palette;
     std::vector<::optimized_texture_info> texture_infos;
 
     assert_ret_val(::create_original_textures(new_format, sprite_infos, original_textures, scratch_palette) &&
-        ::compute_optimized_sprites(sprite_infos, texture_infos) &&
+        ::trim_sprites(sprite_infos, original_textures, trim), new_sprites);
+
+    std::sort(sprite_infos.begin(), sprite_infos.end());
+
+    assert_ret_val(::compute_optimized_sprites(sprite_infos, texture_infos, max_texture_size) &&
         ::create_optimized_textures(new_format, texture_infos), new_sprites);
 
+    if (stats)
+    {
+        ::compute_stats(sprite_infos, texture_infos, *stats);
+    }
+
     // Go back to the original order
     std::sort(sprite_infos.begin(), sprite_infos.end(), [](const ::optimized_sprite_info& info1, const ::optimized_sprite_info& info2)
         {
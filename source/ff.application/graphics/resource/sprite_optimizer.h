@@ -4,6 +4,17 @@
 
 namespace ff::internal
 {
-    std::vector<ff::sprite> optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count);
+    struct optimize_sprites_stats
+    {
+        double efficiency() const; // how much of the new textures is used by sprites, from 0 to 1
+
+        size_t texture_count;
+        size_t texture_area; // pixels in all new textures
+        size_t sprite_area; // pixels used by sprites and their borders, shared sprites are only counted once
+    };
+
+    // max_texture_size is rounded down to a power of two, bigger sprites get their own texture.
+    // trim removes transparent edges, which makes the sprites smaller in the world too.
+    std::vector<ff::sprite> optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count, int max_texture_size = 1024, ff::internal::optimize_sprites_stats* stats = nullptr, bool trim = true);
     std::vector<ff::sprite> outline_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count);
 }
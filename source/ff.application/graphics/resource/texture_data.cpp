@@ -176,3 +176,60 @@ std::shared_ptr<DirectX::ScratchImage> ff::internal::load_texture_data(
     assert(false);
     return nullptr;
 }
+
+double ff::internal::load_texture_data_stats::megapixels_per_second() const
+{
+    return (this->seconds > 0.0) ? static_cast<double>(this->pixel_count) / (this->seconds * 1000000.0) : 0.0;
+}
+
+double ff::internal::load_texture_data_stats::megabytes_per_second() const
+{
+    return (this->seconds > 0.0) ? static_cast<double>(this->file_bytes) / (this->seconds * 1024.0 * 1024.0) : 0.0;
+}
+
+std::vector<ff::internal::texture_data> ff::internal::load_texture_data(
+    const std::vector<std::filesystem::path>& files,
+    DXGI_FORMAT new_format,
+    size_t new_mip_count,
+    ff::internal::load_texture_data_stats* stats)
+{
+    const int64_t start_time = ff::timer::current_raw_time();
+    std::vector<ff::internal::texture_data> results(files.size());
+    std::vector<size_t> file_bytes(files.size());
+    {
+        // Files that fail to load are left null in the results
+        ff::task_graph graph;
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            graph.add_task([i, &files, &results, &file_bytes, new_format, new_mip_count]()
+            {
+                ff::resource_file resource_file(files[i]);
+                file_bytes[i] = resource_file.saved_data() ? resource_file.saved_data()->saved_size() : 0;
+                results[i].data = ff::internal::load_texture_data(resource_file, new_format, new_mip_count, results[i].palette);
+                return results[i].data != nullptr;
+            });
+        }
+
+        graph.run();
+    }
+
+    if (stats)
+    {
+        *stats = {};
+        stats->seconds = ff::timer::seconds_since_raw(start_time);
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            if (results[i].data)
+            {
+                const DirectX::TexMetadata& metadata = results[i].data->GetMetadata();
+                stats->texture_count++;
+                stats->file_bytes += file_bytes[i];
+                stats->pixel_count += metadata.width * metadata.height;
+            }
+        }
+    }
+
+    return results;
+}
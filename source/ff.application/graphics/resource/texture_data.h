@@ -2,5 +2,25 @@
 
 namespace ff::internal
 {
+    struct texture_data
+    {
+        std::shared_ptr<DirectX::ScratchImage> data;
+        std::shared_ptr<DirectX::ScratchImage> palette;
+    };
+
+    struct load_texture_data_stats
+    {
+        double megapixels_per_second() const;
+        double megabytes_per_second() const; // file bytes, before decoding
+
+        size_t texture_count; // only the ones that loaded
+        size_t file_bytes;
+        size_t pixel_count; // top mip level only
+        double seconds; // wall clock time for the whole batch
+    };
+
     std::shared_ptr<DirectX::ScratchImage> load_texture_data(const ff::resource_file& resource_file, DXGI_FORMAT new_format, size_t new_mip_count, std::shared_ptr<DirectX::ScratchImage>& palette);
+
+    // Decodes and converts each file on the thread pool, results are in the same order as the files and have null data for failures
+    std::vector<ff::internal::texture_data> load_texture_data(const std::vector<std::filesystem::path>& files, DXGI_FORMAT new_format, size_t new_mip_count, ff::internal::load_texture_data_stats* stats = nullptr);
 }
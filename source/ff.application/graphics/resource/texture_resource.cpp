@@ -345,3 +345,9 @@ std::shared_ptr<ff::resource_object_base> ff::internal::texture_factory::load_fr
     auto texture = std::make_shared<ff::texture>(dxgi_texture, palette_scratch.GetImageCount() ? std::make_shared<DirectX::ScratchImage>(std::move(palette_scratch)) : nullptr);
     return *texture ? texture : nullptr;
 }
+
+size_t ff::internal::texture_factory::build_version() const
+{
+    // 1: PNG files are swizzled to BGRA while decoding
+    return 1;
+}
@@ -63,5 +63,6 @@ namespace ff::internal
 
         virtual std::shared_ptr<resource_object_base> load_from_source(const ff::dict& dict, resource_load_context& context) const override;
         virtual std::shared_ptr<resource_object_base> load_from_cache(const ff::dict& dict) const override;
+        virtual size_t build_version() const override;
     };
 }
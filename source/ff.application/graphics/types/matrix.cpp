@@ -29,6 +29,8 @@ const DirectX::XMFLOAT3X3& ff::matrix_identity_3x3()
 
 ff::matrix_stack::matrix_stack()
     : stack{ ff::matrix_identity_4x4() }
+    , id_stack{ 0 }
+    , next_id(1)
 {
 }
 
@@ -37,10 +39,16 @@ const DirectX::XMFLOAT4X4& ff::matrix_stack::matrix() const
     return this->stack[this->stack.size() - 1];
 }
 
+size_t ff::matrix_stack::matrix_id() const
+{
+    return this->id_stack[this->id_stack.size() - 1];
+}
+
 void ff::matrix_stack::push()
 {
     DirectX::XMFLOAT4X4 matrix = this->matrix();
     this->stack.push_back(matrix);
+    this->id_stack.push_back(this->matrix_id());
 }
 
 void ff::matrix_stack::pop()
@@ -58,6 +66,7 @@ void ff::matrix_stack::pop()
     }
 
     this->stack.pop_back();
+    this->id_stack.pop_back();
 
     if (change)
     {
@@ -68,10 +77,12 @@ void ff::matrix_stack::pop()
 void ff::matrix_stack::reset(const DirectX::XMFLOAT4X4* default_matrix)
 {
     this->stack.resize(1);
+    this->id_stack.resize(1);
 
-    if (default_matrix)
+    if (default_matrix && *default_matrix != this->stack[0])
     {
         this->stack[0] = *default_matrix;
+        this->id_stack[0] = this->next_id++;
     }
 }
 
@@ -87,6 +98,7 @@ void ff::matrix_stack::set(const DirectX::XMFLOAT4X4& matrix)
         }
 
         this->stack[this->stack.size() - 1] = matrix;
+        this->id_stack[this->id_stack.size() - 1] = this->next_id++;
 
         this->matrix_changed_.notify(*this);
     }
@@ -105,6 +117,7 @@ void ff::matrix_stack::transform(const DirectX::XMFLOAT4X4& matrix)
 
         DirectX::XMFLOAT4X4& my_matrix = this->stack[this->stack.size() - 1];
         DirectX::XMStoreFloat4x4(&my_matrix, DirectX::XMLoadFloat4x4(&matrix) * DirectX::XMLoadFloat4x4(&my_matrix));
+        this->id_stack[this->id_stack.size() - 1] = this->next_id++;
 
         this->matrix_changed_.notify(*this);
     }
@@ -5,6 +5,13 @@ namespace ff
     const DirectX::XMFLOAT4X4& matrix_identity_4x4();
     const DirectX::XMFLOAT3X3& matrix_identity_3x3();
 
+    /// <summary>
+    /// Stack of world matrixes, with an ID that only changes when the current matrix changes
+    /// </summary>
+    /// <remarks>
+    /// The ID can be used as a cheap cache key for anything derived from the current matrix. Popping
+    /// back to a parent matrix restores the parent's ID, and IDs are never reused by the same stack.
+    /// </remarks>
     class matrix_stack
     {
     public:
@@ -16,6 +23,7 @@ namespace ff
         matrix_stack& operator=(const matrix_stack& other) = delete;
 
         const DirectX::XMFLOAT4X4& matrix() const;
+        size_t matrix_id() const;
         void push();
         void pop();
         void reset(const DirectX::XMFLOAT4X4* default_matrix = nullptr); // only should be called by the owner
@@ -28,6 +36,8 @@ namespace ff
 
     private:
         std::vector<DirectX::XMFLOAT4X4> stack;
+        std::vector<size_t> id_stack;
+        size_t next_id;
         ff::signal<const matrix_stack&> matrix_changing_;
         ff::signal<const matrix_stack&> matrix_changed_;
     };
@@ -4,6 +4,7 @@
 
 ff::font_file::font_file(std::shared_ptr<ff::data_base> data, size_t index, bool bold, bool italic)
     : ff::resource_file(std::make_shared<ff::saved_data_static>(data, data->size(), ff::saved_data_type::none), ".ttf")
+    , truetype_(data, index, bold, italic)
     , index_(index)
     , bold_(bold)
     , italic_(italic)
@@ -30,7 +31,7 @@ ff::font_file::font_file(std::shared_ptr<ff::data_base> data, size_t index, bool
 
 ff::font_file::operator bool() const
 {
-    return this->font_face_;
+    return this->font_face_ || this->truetype_;
 }
 
 bool ff::font_file::bold() const
@@ -53,6 +54,11 @@ IDWriteFontFace5* ff::font_file::font_face()
     return this->font_face_.Get();
 }
 
+const ff::truetype_font& ff::font_file::truetype() const
+{
+    return this->truetype_;
+}
+
 bool ff::font_file::save_to_cache(ff::dict& dict) const
 {
     if (ff::resource_file::save_to_cache(dict))
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../write/truetype_font.h"
+
 namespace ff
 {
     class font_file : public ff::resource_file
@@ -17,12 +19,14 @@ namespace ff
         bool italic() const;
         size_t index() const;
         IDWriteFontFace5* font_face();
+        const ff::truetype_font& truetype() const; // portable access to the same font data
 
     protected:
         virtual bool save_to_cache(ff::dict& dict) const override;
 
     private:
         Microsoft::WRL::ComPtr<IDWriteFontFace5> font_face_;
+        ff::truetype_font truetype_;
         size_t index_;
         bool bold_;
         bool italic_;
@@ -0,0 +1,823 @@
+#include "pch.h"
+#include "graphics/write/truetype_font.h"
+
+static constexpr uint32_t make_tag(const char(&name)[5])
+{
+    return (static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8) |
+        static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+}
+
+// Font data is big endian, and reading past the end returns zero instead of crashing on bad fonts
+
+static uint16_t read_u16(std::span<const uint8_t> data, size_t offset)
+{
+    return (offset + 2 <= data.size()) ? static_cast<uint16_t>((data[offset] << 8) | data[offset + 1]) : 0;
+}
+
+static int16_t read_i16(std::span<const uint8_t> data, size_t offset)
+{
+    return static_cast<int16_t>(::read_u16(data, offset));
+}
+
+static uint32_t read_u32(std::span<const uint8_t> data, size_t offset)
+{
+    return (offset + 4 <= data.size())
+        ? ((static_cast<uint32_t>(data[offset]) << 24) | (static_cast<uint32_t>(data[offset + 1]) << 16) | (static_cast<uint32_t>(data[offset + 2]) << 8) | data[offset + 3])
+        : 0;
+}
+
+static float read_f2dot14(std::span<const uint8_t> data, size_t offset)
+{
+    return ::read_i16(data, offset) / 16384.0f;
+}
+
+static std::span<const uint8_t> safe_subspan(std::span<const uint8_t> data, size_t offset, size_t size = std::dynamic_extent)
+{
+    if (offset > data.size())
+    {
+        return {};
+    }
+
+    return data.subspan(offset, std::min(size, data.size() - offset));
+}
+
+// Adds a line to the coverage accumulation buffer, each pixel gets the signed area covered to its left
+static void accumulate_line(std::vector<float>& area, size_t width, size_t height, ff::point_float p0, ff::point_float p1)
+{
+    if (std::abs(p0.y - p1.y) <= std::numeric_limits<float>::epsilon())
+    {
+        return;
+    }
+
+    const float dir = (p0.y < p1.y) ? 1.0f : -1.0f;
+    if (dir < 0)
+    {
+        std::swap(p0, p1);
+    }
+
+    const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    const size_t y_start = static_cast<size_t>(std::max(0.0f, p0.y));
+    const size_t y_end = std::min(height, static_cast<size_t>(std::max(0.0f, std::ceil(p1.y))));
+    float x = p0.x + std::max(0.0f, -p0.y) * dxdy;
+
+    for (size_t y = y_start; y < y_end; y++)
+    {
+        const float dy = std::min(static_cast<float>(y + 1), p1.y) - std::max(static_cast<float>(y), p0.y);
+        const float x_next = x + dxdy * dy;
+        const float d = dy * dir;
+        const float x0 = std::max(0.0f, std::min(x, x_next));
+        const float x1 = std::max(0.0f, std::max(x, x_next));
+        const float x0_floor = std::floor(x0);
+        const float x1_ceil = std::ceil(x1);
+        const size_t x0i = static_cast<size_t>(x0_floor);
+        const size_t x1i = static_cast<size_t>(x1_ceil);
+        float* line = area.data() + y * width;
+
+        if (y * width + x1i + 1 >= area.size())
+        {
+            x = x_next;
+            continue;
+        }
+
+        if (x1i <= x0i + 1)
+        {
+            // Only touches one pixel, or two with the remainder
+            const float x_mid = 0.5f * (x + x_next) - x0_floor;
+            line[x0i] += d - d * x_mid;
+            line[x0i + 1] += d * x_mid;
+        }
+        else
+        {
+            const float s = 1.0f / (x1 - x0);
+            const float x0_frac = x0 - x0_floor;
+            const float a0 = 0.5f * s * (1.0f - x0_frac) * (1.0f - x0_frac);
+            const float x1_frac = x1 - x1_ceil + 1.0f;
+            const float am = 0.5f * s * x1_frac * x1_frac;
+
+            line[x0i] += d * a0;
+
+            if (x1i == x0i + 2)
+            {
+                line[x0i + 1] += d * (1.0f - a0 - am);
+            }
+            else
+            {
+                const float a1 = s * (1.5f - x0_frac);
+                line[x0i + 1] += d * (a1 - a0);
+
+                for (size_t xi = x0i + 2; xi < x1i - 1; xi++)
+                {
+                    line[xi] += d * s;
+                }
+
+                const float a2 = a1 + static_cast<float>(x1i - x0i - 3) * s;
+                line[x1i - 1] += d * (1.0f - a2 - am);
+            }
+
+            line[x1i] += d * am;
+        }
+
+        x = x_next;
+    }
+}
+
+// Splits a quadratic curve into lines, with more lines for sharper curves
+static void flatten_curve(std::vector<ff::point_float>& lines, ff::point_float p0, ff::point_float control, ff::point_float p2)
+{
+    const ff::point_float dev = p0 - control * 2.0f + p2;
+    const float dev_squared = dev.x * dev.x + dev.y * dev.y;
+
+    if (dev_squared < 0.333f)
+    {
+        lines.push_back(p0);
+        lines.push_back(p2);
+        return;
+    }
+
+    const size_t count = 1 + static_cast<size_t>(std::sqrt(std::sqrt(3.0f * dev_squared)));
+    ff::point_float prev = p0;
+
+    for (size_t i = 1; i <= count; i++)
+    {
+        const float t = static_cast<float>(i) / count;
+        const float mt = 1.0f - t;
+        const ff::point_float pos = p0 * (mt * mt) + control * (2.0f * t * mt) + p2 * (t * t);
+
+        lines.push_back(prev);
+        lines.push_back(pos);
+        prev = pos;
+    }
+}
+
+// The same slant as FreeType's oblique simulation, about 12 degrees
+static constexpr float ITALIC_SHEAR = 0.2126f;
+
+ff::truetype_font::truetype_font(std::shared_ptr<ff::data_base> data, size_t index, bool bold, bool italic)
+    : data(data)
+    , bold(bold)
+    , italic(italic)
+{
+    if (this->data && this->data->size())
+    {
+        this->bytes = std::span<const uint8_t>(this->data->data(), this->data->size());
+
+        if (!this->load(index))
+        {
+            this->bytes = {};
+        }
+    }
+}
+
+ff::truetype_font::operator bool() const
+{
+    return !this->bytes.empty();
+}
+
+const ff::truetype_metrics& ff::truetype_font::metrics() const
+{
+    return this->metrics_;
+}
+
+size_t ff::truetype_font::glyph_count() const
+{
+    return this->glyph_count_;
+}
+
+uint16_t ff::truetype_font::glyph_index(uint32_t ch) const
+{
+    if (this->cmap_format == 4 && ch <= 0xFFFF)
+    {
+        // Segments are sorted by their end code
+        const size_t seg_count = ::read_u16(this->cmap, 6) / 2;
+        size_t low = 0, high = seg_count;
+
+        while (low < high)
+        {
+            size_t mid = (low + high) / 2;
+            if (::read_u16(this->cmap, 14 + mid * 2) < ch)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        const uint16_t start_code = ::read_u16(this->cmap, 16 + seg_count * 2 + low * 2);
+        if (low == seg_count || ch < start_code)
+        {
+            return 0;
+        }
+
+        const uint16_t id_delta = ::read_u16(this->cmap, 16 + seg_count * 4 + low * 2);
+        const size_t range_offset_pos = 16 + seg_count * 6 + low * 2;
+        const uint16_t range_offset = ::read_u16(this->cmap, range_offset_pos);
+
+        if (!range_offset)
+        {
+            return static_cast<uint16_t>(ch + id_delta);
+        }
+
+        const uint16_t glyph = ::read_u16(this->cmap, range_offset_pos + range_offset + (ch - start_code) * 2);
+        return glyph ? static_cast<uint16_t>(glyph + id_delta) : 0;
+    }
+    else if (this->cmap_format == 12)
+    {
+        // Groups are sorted by their start code
+        const size_t group_count = ::read_u32(this->cmap, 12);
+        size_t low = 0, high = group_count;
+
+        while (low < high)
+        {
+            size_t mid = (low + high) / 2;
+            if (::read_u32(this->cmap, 16 + mid * 12 + 4) < ch)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        const uint32_t start_code = ::read_u32(this->cmap, 16 + low * 12);
+        if (low == group_count || ch < start_code)
+        {
+            return 0;
+        }
+
+        const uint32_t glyph = ::read_u32(this->cmap, 16 + low * 12 + 8) + (ch - start_code);
+        return (glyph < this->glyph_count_) ? static_cast<uint16_t>(glyph) : 0;
+    }
+
+    return 0;
+}
+
+ff::truetype_glyph_metrics ff::truetype_font::glyph_metrics(uint16_t glyph) const
+{
+    if (glyph >= this->glyph_count_ || !this->h_metric_count)
+    {
+        return {};
+    }
+
+    if (glyph < this->h_metric_count)
+    {
+        return { ::read_u16(this->hmtx, glyph * 4) + this->bold_strength(), ::read_i16(this->hmtx, glyph * 4 + 2) };
+    }
+
+    // Monospaced glyphs at the end only store their left side bearing
+    return
+    {
+        ::read_u16(this->hmtx, (this->h_metric_count - 1) * 4) + this->bold_strength(),
+        ::read_i16(this->hmtx, this->h_metric_count * 4 + (glyph - this->h_metric_count) * 2),
+    };
+}
+
+int ff::truetype_font::kerning(uint16_t left_glyph, uint16_t right_glyph) const
+{
+    const uint32_t key = (static_cast<uint32_t>(left_glyph) << 16) | right_glyph;
+    size_t low = 0, high = this->kern_pairs.size() / 6;
+
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        uint32_t mid_key = ::read_u32(this->kern_pairs, mid * 6);
+
+        if (mid_key == key)
+        {
+            return ::read_i16(this->kern_pairs, mid * 6 + 4);
+        }
+        else if (mid_key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return 0;
+}
+
+bool ff::truetype_font::rasterize(uint16_t glyph, float pixel_size, bool anti_alias, ff::truetype_glyph_bitmap& bitmap) const
+{
+    bitmap.offset = {};
+    bitmap.size = {};
+    bitmap.coverage.clear();
+
+    check_ret_val(*this && pixel_size > 0.0f && glyph < this->glyph_count_, false);
+
+    std::vector<ff::truetype_font::point_t> points;
+    std::vector<size_t> contour_ends;
+    check_ret_val(this->glyph_points(glyph, points, contour_ends, 0), false);
+
+    if (this->bold)
+    {
+        ff::truetype_font::embolden(points, contour_ends, static_cast<float>(this->bold_strength()));
+    }
+
+    if (this->italic)
+    {
+        for (ff::truetype_font::point_t& point : points)
+        {
+            point.x += point.y * ::ITALIC_SHEAR;
+        }
+    }
+
+    // Convert contours to lines in pixels, Y goes down
+
+    const float scale = pixel_size / this->metrics_.units_per_em;
+    auto to_pixels = [scale](const ff::truetype_font::point_t& point)
+    {
+        return ff::point_float(point.x * scale, -point.y * scale);
+    };
+
+    std::vector<ff::point_float> lines;
+    lines.reserve(points.size() * 4);
+
+    for (size_t contour = 0, start = 0; contour < contour_ends.size(); start = contour_ends[contour++])
+    {
+        const size_t end = std::min(contour_ends[contour], points.size());
+        if (end <= start + 1)
+        {
+            continue;
+        }
+
+        // Start at an on-curve point, or between two off-curve points
+        const ff::truetype_font::point_t* contour_points = points.data() + start;
+        const size_t count = end - start;
+        ff::point_float first_pos;
+        size_t next = 0;
+        size_t remaining = count;
+
+        if (contour_points[0].on_curve)
+        {
+            first_pos = to_pixels(contour_points[0]);
+            next = 1;
+            remaining = count - 1;
+        }
+        else if (contour_points[count - 1].on_curve)
+        {
+            first_pos = to_pixels(contour_points[count - 1]);
+            remaining = count - 1;
+        }
+        else
+        {
+            first_pos = (to_pixels(contour_points[0]) + to_pixels(contour_points[count - 1])) * 0.5f;
+        }
+
+        ff::point_float prev_pos = first_pos;
+        ff::point_float control_pos{};
+        bool has_control = false;
+
+        for (size_t i = 0; i < remaining; i++)
+        {
+            const ff::truetype_font::point_t& point = contour_points[(next + i) % count];
+            const ff::point_float pos = to_pixels(point);
+
+            if (point.on_curve)
+            {
+                if (has_control)
+                {
+                    ::flatten_curve(lines, prev_pos, control_pos, pos);
+                }
+                else
+                {
+                    lines.push_back(prev_pos);
+                    lines.push_back(pos);
+                }
+
+                prev_pos = pos;
+                has_control = false;
+            }
+            else if (has_control)
+            {
+                // Two off-curve points in a row have an implied on-curve point between them
+                const ff::point_float mid_pos = (control_pos + pos) * 0.5f;
+                ::flatten_curve(lines, prev_pos, control_pos, mid_pos);
+                prev_pos = mid_pos;
+                control_pos = pos;
+            }
+            else
+            {
+                control_pos = pos;
+                has_control = true;
+            }
+        }
+
+        if (has_control)
+        {
+            ::flatten_curve(lines, prev_pos, control_pos, first_pos);
+        }
+        else
+        {
+            lines.push_back(prev_pos);
+            lines.push_back(first_pos);
+        }
+    }
+
+    if (lines.empty())
+    {
+        return true;
+    }
+
+    ff::point_float min_pos = lines.front();
+    ff::point_float max_pos = lines.front();
+
+    for (const ff::point_float& pos : lines)
+    {
+        min_pos = ff::point_float(std::min(min_pos.x, pos.x), std::min(min_pos.y, pos.y));
+        max_pos = ff::point_float(std::max(max_pos.x, pos.x), std::max(max_pos.y, pos.y));
+    }
+
+    const ff::point_int origin(static_cast<int>(std::floor(min_pos.x)), static_cast<int>(std::floor(min_pos.y)));
+    const ff::point_size size(
+        static_cast<size_t>(std::max(1, static_cast<int>(std::ceil(max_pos.x)) - origin.x)),
+        static_cast<size_t>(std::max(1, static_cast<int>(std::ceil(max_pos.y)) - origin.y)));
+    const ff::point_float origin_float = origin.cast<float>();
+
+    // Accumulate signed area, then the running sum across each row is the coverage
+
+    std::vector<float> area(size.x * size.y + 4);
+    for (size_t i = 0; i + 1 < lines.size(); i += 2)
+    {
+        ::accumulate_line(area, size.x, size.y, lines[i] - origin_float, lines[i + 1] - origin_float);
+    }
+
+    bitmap.offset = origin;
+    bitmap.size = size;
+    bitmap.coverage.resize(size.x * size.y);
+
+    float total = 0;
+    for (size_t i = 0; i < bitmap.coverage.size(); i++)
+    {
+        total += area[i];
+        const float coverage = std::min(std::abs(total), 1.0f);
+        bitmap.coverage[i] = anti_alias
+            ? static_cast<uint8_t>(coverage * 255.0f + 0.5f)
+            : (coverage >= 0.5f ? 255 : 0);
+    }
+
+    return true;
+}
+
+bool ff::truetype_font::load(size_t index)
+{
+    size_t font_offset = 0;
+
+    if (::read_u32(this->bytes, 0) == ::make_tag("ttcf"))
+    {
+        check_ret_val(index < ::read_u32(this->bytes, 8), false);
+        font_offset = ::read_u32(this->bytes, 12 + index * 4);
+    }
+
+    std::span<const uint8_t> head, maxp, hhea, os2, cmap_table, kern;
+    const size_t table_count = ::read_u16(this->bytes, font_offset + 4);
+
+    for (size_t i = 0; i < table_count; i++)
+    {
+        const size_t record = font_offset + 12 + i * 16;
+        const size_t offset = ::read_u32(this->bytes, record + 8);
+        const size_t size = ::read_u32(this->bytes, record + 12);
+        check_ret_val(offset <= this->bytes.size() && size <= this->bytes.size() - offset, false);
+
+        const std::span<const uint8_t> table = this->bytes.subspan(offset, size);
+        switch (::read_u32(this->bytes, record))
+        {
+            case ::make_tag("cmap"): cmap_table = table; break;
+            case ::make_tag("glyf"): this->glyf = table; break;
+            case ::make_tag("head"): head = table; break;
+            case ::make_tag("hhea"): hhea = table; break;
+            case ::make_tag("hmtx"): this->hmtx = table; break;
+            case ::make_tag("kern"): kern = table; break;
+            case ::make_tag("loca"): this->loca = table; break;
+            case ::make_tag("maxp"): maxp = table; break;
+            case ::make_tag("OS/2"): os2 = table; break;
+        }
+    }
+
+    // Only fonts with TrueType outlines are supported, not CFF
+    check_ret_val(head.size() >= 54 && maxp.size() >= 6 && hhea.size() >= 36 && !cmap_table.empty() && !this->loca.empty() && !this->glyf.empty() && !this->hmtx.empty(), false);
+
+    this->metrics_.units_per_em = ::read_u16(head, 18);
+    this->long_loca = ::read_i16(head, 50) != 0;
+    this->glyph_count_ = ::read_u16(maxp, 4);
+    this->h_metric_count = std::min<size_t>(::read_u16(hhea, 34), this->glyph_count_);
+    check_ret_val(this->metrics_.units_per_em > 0 && this->h_metric_count > 0, false);
+
+    // Line metrics match what GDI and DirectWrite use, which prefer the Windows values in OS/2
+    const int hhea_ascent = ::read_i16(hhea, 4);
+    const int hhea_descent = -::read_i16(hhea, 6);
+    const int hhea_line_gap = ::read_i16(hhea, 8);
+
+    if (os2.size() >= 78)
+    {
+        this->metrics_.ascent = ::read_u16(os2, 74);
+        this->metrics_.descent = ::read_u16(os2, 76);
+        this->metrics_.line_gap = std::max(0, (hhea_ascent + hhea_descent + hhea_line_gap) - (this->metrics_.ascent + this->metrics_.descent));
+    }
+    else
+    {
+        this->metrics_.ascent = hhea_ascent;
+        this->metrics_.descent = hhea_descent;
+        this->metrics_.line_gap = hhea_line_gap;
+    }
+
+    // Prefer full Unicode character maps
+
+    int best_cmap_score = 0;
+    for (size_t i = 0, count = ::read_u16(cmap_table, 2); i < count; i++)
+    {
+        const uint16_t platform = ::read_u16(cmap_table, 4 + i * 8);
+        const uint16_t encoding = ::read_u16(cmap_table, 6 + i * 8);
+        const std::span<const uint8_t> subtable = ::safe_subspan(cmap_table, ::read_u32(cmap_table, 8 + i * 8));
+        const uint16_t format = ::read_u16(subtable, 0);
+        const bool unicode = (platform == 0) || (platform == 3 && (encoding == 1 || encoding == 10));
+        const int score = !unicode ? 0 : (format == 12 ? 2 : (format == 4 ? 1 : 0));
+
+        if (score > best_cmap_score)
+        {
+            best_cmap_score = score;
+            this->cmap = subtable;
+            this->cmap_format = format;
+        }
+    }
+
+    check_ret_val(best_cmap_score > 0, false);
+
+    // Only the first horizontal format 0 kerning table is used, later fonts use GPOS instead
+    if (::read_u16(kern, 0) == 0 && ::read_u16(kern, 2) > 0)
+    {
+        const uint16_t coverage = ::read_u16(kern, 8);
+        if ((coverage >> 8) == 0 && (coverage & 0x07) == 0x01)
+        {
+            const size_t pair_count = ::read_u16(kern, 10);
+            this->kern_pairs = ::safe_subspan(kern, 18, pair_count * 6);
+        }
+    }
+
+    return true;
+}
+
+int ff::truetype_font::bold_strength() const
+{
+    // Same as FreeType's bold simulation
+    return this->bold ? this->metrics_.units_per_em / 24 : 0;
+}
+
+// Moves each point out along the miter of its two edges, so that every edge moves out by half of strength
+void ff::truetype_font::embolden(std::vector<ff::truetype_font::point_t>& points, const std::vector<size_t>& contour_ends, float strength)
+{
+    // Outer contours are usually clockwise, but check the total signed area to know which side is outside
+    float area = 0;
+    for (size_t contour = 0, start = 0; contour < contour_ends.size(); start = contour_ends[contour++])
+    {
+        const size_t end = std::min(contour_ends[contour], points.size());
+        for (size_t i = start; i < end; i++)
+        {
+            const ff::truetype_font::point_t& p0 = points[i];
+            const ff::truetype_font::point_t& p1 = points[(i + 1 < end) ? i + 1 : start];
+            area += p0.x * p1.y - p1.x * p0.y;
+        }
+    }
+
+    const float outside = (area < 0) ? 1.0f : -1.0f;
+    const float half_strength = strength * 0.5f;
+    std::vector<ff::point_float> offsets;
+
+    for (size_t contour = 0, start = 0; contour < contour_ends.size(); start = contour_ends[contour++])
+    {
+        const size_t end = std::min(contour_ends[contour], points.size());
+        if (end <= start + 2)
+        {
+            continue;
+        }
+
+        const size_t count = end - start;
+        offsets.assign(count, ff::point_float{});
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const ff::truetype_font::point_t& prev = points[start + (i + count - 1) % count];
+            const ff::truetype_font::point_t& cur = points[start + i];
+            const ff::truetype_font::point_t& next = points[start + (i + 1) % count];
+
+            ff::point_float in(cur.x - prev.x, cur.y - prev.y);
+            ff::point_float out(next.x - cur.x, next.y - cur.y);
+            const float in_length = std::sqrt(in.x * in.x + in.y * in.y);
+            const float out_length = std::sqrt(out.x * out.x + out.y * out.y);
+            if (in_length == 0.0f || out_length == 0.0f)
+            {
+                continue;
+            }
+
+            // Outward normals of both edges, and skip points where the outline almost turns back on itself
+            in /= in_length;
+            out /= out_length;
+            const ff::point_float normal0(-in.y * outside, in.x * outside);
+            const ff::point_float normal1(-out.y * outside, out.x * outside);
+            const float denom = 1.0f + normal0.x * normal1.x + normal0.y * normal1.y;
+            if (denom >= 0.0625f)
+            {
+                offsets[i] = (normal0 + normal1) * (half_strength / denom);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            points[start + i].x += offsets[i].x;
+            points[start + i].y += offsets[i].y;
+        }
+    }
+}
+
+std::span<const uint8_t> ff::truetype_font::glyph_data(uint16_t glyph) const
+{
+    if (glyph >= this->glyph_count_)
+    {
+        return {};
+    }
+
+    const size_t start = this->long_loca ? ::read_u32(this->loca, glyph * 4) : ::read_u16(this->loca, glyph * 2) * 2;
+    const size_t end = this->long_loca ? ::read_u32(this->loca, glyph * 4 + 4) : ::read_u16(this->loca, glyph * 2 + 2) * 2;
+
+    return (end > start) ? ::safe_subspan(this->glyf, start, end - start) : std::span<const uint8_t>();
+}
+
+bool ff::truetype_font::glyph_points(uint16_t glyph, std::vector<ff::truetype_font::point_t>& points, std::vector<size_t>& contour_ends, size_t depth) const
+{
+    const std::span<const uint8_t> data = this->glyph_data(glyph);
+    if (data.size() < 10)
+    {
+        // No outline, like a space
+        return true;
+    }
+
+    const int contour_count = ::read_i16(data, 0);
+    if (contour_count >= 0)
+    {
+        const size_t point_start = points.size();
+        size_t point_count = 0;
+        size_t offset = 10;
+
+        for (int i = 0; i < contour_count; i++, offset += 2)
+        {
+            const size_t end = static_cast<size_t>(::read_u16(data, offset)) + 1;
+            check_ret_val(end >= point_count, false);
+
+            point_count = end;
+            contour_ends.push_back(point_start + end);
+        }
+
+        // Skip hinting instructions
+        offset += 2 + ::read_u16(data, offset);
+
+        std::vector<uint8_t> flags;
+        flags.reserve(point_count);
+
+        while (flags.size() < point_count)
+        {
+            check_ret_val(offset < data.size(), false);
+            const uint8_t flag = data[offset++];
+            flags.push_back(flag);
+
+            if (flag & 0x08)
+            {
+                check_ret_val(offset < data.size(), false);
+                for (size_t repeat = data[offset++]; repeat && flags.size() < point_count; repeat--)
+                {
+                    flags.push_back(flag);
+                }
+            }
+        }
+
+        points.resize(point_start + point_count);
+
+        // Coordinates are deltas, either a byte with a separate sign bit, or a signed short
+
+        int value = 0;
+        for (size_t i = 0; i < point_count; i++)
+        {
+            const uint8_t flag = flags[i];
+            int delta = 0;
+
+            if (flag & 0x02)
+            {
+                check_ret_val(offset < data.size(), false);
+                delta = (flag & 0x10) ? data[offset] : -static_cast<int>(data[offset]);
+                offset++;
+            }
+            else if (!(flag & 0x10))
+            {
+                delta = ::read_i16(data, offset);
+                offset += 2;
+            }
+
+            value += delta;
+            points[point_start + i].x = static_cast<float>(value);
+            points[point_start + i].on_curve = (flag & 0x01) != 0;
+        }
+
+        value = 0;
+        for (size_t i = 0; i < point_count; i++)
+        {
+            const uint8_t flag = flags[i];
+            int delta = 0;
+
+            if (flag & 0x04)
+            {
+                check_ret_val(offset < data.size(), false);
+                delta = (flag & 0x20) ? data[offset] : -static_cast<int>(data[offset]);
+                offset++;
+            }
+            else if (!(flag & 0x20))
+            {
+                delta = ::read_i16(data, offset);
+                offset += 2;
+            }
+
+            value += delta;
+            points[point_start + i].y = static_cast<float>(value);
+        }
+
+        check_ret_val(offset <= data.size(), false);
+        return true;
+    }
+
+    // Composite glyphs are made of transformed copies of other glyphs
+
+    check_ret_val(depth < 8, false);
+    size_t offset = 10;
+    uint16_t flags;
+
+    do
+    {
+        flags = ::read_u16(data, offset);
+        const uint16_t component = ::read_u16(data, offset + 2);
+        offset += 4;
+
+        float dx, dy;
+        if (flags & 0x0001)
+        {
+            dx = ::read_i16(data, offset);
+            dy = ::read_i16(data, offset + 2);
+            offset += 4;
+        }
+        else
+        {
+            check_ret_val(offset + 2 <= data.size(), false);
+            dx = static_cast<int8_t>(data[offset]);
+            dy = static_cast<int8_t>(data[offset + 1]);
+            offset += 2;
+        }
+
+        if (!(flags & 0x0002))
+        {
+            // Aligning matching points isn't supported
+            dx = 0;
+            dy = 0;
+        }
+
+        float a = 1, b = 0, c = 0, d = 1;
+        if (flags & 0x0008)
+        {
+            a = d = ::read_f2dot14(data, offset);
+            offset += 2;
+        }
+        else if (flags & 0x0040)
+        {
+            a = ::read_f2dot14(data, offset);
+            d = ::read_f2dot14(data, offset + 2);
+            offset += 4;
+        }
+        else if (flags & 0x0080)
+        {
+            a = ::read_f2dot14(data, offset);
+            b = ::read_f2dot14(data, offset + 2);
+            c = ::read_f2dot14(data, offset + 4);
+            d = ::read_f2dot14(data, offset + 6);
+            offset += 8;
+        }
+
+        const size_t first_point = points.size();
+        check_ret_val(this->glyph_points(component, points, contour_ends, depth + 1), false);
+
+        for (size_t i = first_point; i < points.size(); i++)
+        {
+            ff::truetype_font::point_t& point = points[i];
+            const float x = point.x;
+            const float y = point.y;
+            point.x = a * x + c * y + dx;
+            point.y = b * x + d * y + dy;
+        }
+
+        check_ret_val(offset <= data.size(), false);
+    }
+    while (flags & 0x0020);
+
+    return true;
+}
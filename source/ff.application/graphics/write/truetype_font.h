@@ -0,0 +1,83 @@
+#pragma once
+
+namespace ff
+{
+    struct truetype_metrics
+    {
+        int units_per_em;
+        int ascent; // positive, above the baseline
+        int descent; // positive, below the baseline
+        int line_gap;
+    };
+
+    struct truetype_glyph_metrics
+    {
+        int advance_width;
+        int left_side_bearing;
+    };
+
+    struct truetype_glyph_bitmap
+    {
+        ff::point_int offset; // top left pixel relative to the glyph origin on the baseline, Y goes down
+        ff::point_size size;
+        std::vector<uint8_t> coverage; // one byte per pixel, empty when the glyph has no outline
+    };
+
+    /// <summary>
+    /// Reads glyph outlines directly from TrueType font data and rasterizes them on the CPU
+    /// </summary>
+    /// <remarks>
+    /// Only standard C++ is used, so this works wherever DirectWrite doesn't. Hinting is ignored and
+    /// coverage is computed with exact signed area accumulation. All methods are const and safe to call
+    /// from multiple threads at once. Bold and italic simulate styles the font data doesn't have, by
+    /// growing the outlines and slanting them, with wider advances for bold.
+    /// </remarks>
+    class truetype_font
+    {
+    public:
+        truetype_font() = default;
+        truetype_font(std::shared_ptr<ff::data_base> data, size_t index, bool bold = false, bool italic = false);
+        truetype_font(truetype_font&& other) noexcept = default;
+        truetype_font(const truetype_font& other) = delete;
+
+        truetype_font& operator=(truetype_font&& other) noexcept = default;
+        truetype_font& operator=(const truetype_font& other) = delete;
+        operator bool() const;
+
+        const ff::truetype_metrics& metrics() const;
+        size_t glyph_count() const;
+        uint16_t glyph_index(uint32_t ch) const; // zero when the font doesn't have the char
+        ff::truetype_glyph_metrics glyph_metrics(uint16_t glyph) const;
+        int kerning(uint16_t left_glyph, uint16_t right_glyph) const; // font units
+        bool rasterize(uint16_t glyph, float pixel_size, bool anti_alias, ff::truetype_glyph_bitmap& bitmap) const;
+
+    private:
+        struct point_t
+        {
+            float x;
+            float y;
+            bool on_curve;
+        };
+
+        bool load(size_t index);
+        std::span<const uint8_t> glyph_data(uint16_t glyph) const;
+        bool glyph_points(uint16_t glyph, std::vector<ff::truetype_font::point_t>& points, std::vector<size_t>& contour_ends, size_t depth) const;
+        int bold_strength() const; // font units that bold glyphs grow by
+        static void embolden(std::vector<ff::truetype_font::point_t>& points, const std::vector<size_t>& contour_ends, float strength);
+
+        std::shared_ptr<ff::data_base> data;
+        std::span<const uint8_t> bytes;
+        std::span<const uint8_t> cmap;
+        std::span<const uint8_t> loca;
+        std::span<const uint8_t> glyf;
+        std::span<const uint8_t> hmtx;
+        std::span<const uint8_t> kern_pairs;
+        ff::truetype_metrics metrics_{};
+        size_t glyph_count_{};
+        size_t h_metric_count{};
+        uint16_t cmap_format{};
+        bool long_loca{};
+        bool bold{};
+        bool italic{};
+    };
+}
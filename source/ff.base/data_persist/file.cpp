@@ -114,6 +114,7 @@ ff::file_read::file_read(const std::filesystem::path& path)
 
 ff::file_read::file_read(file_read&& other) noexcept
     : file_base(std::move(other))
+    , overlapped_handle_(std::move(other.overlapped_handle_))
 {}
 
 ff::file_read::file_read(const file_read& other)
@@ -124,12 +125,14 @@ ff::file_read::file_read(const file_read& other)
 ff::file_read& ff::file_read::operator=(file_read&& other) noexcept
 {
     file_base::operator=(std::move(other));
+    this->overlapped_handle_ = std::move(other.overlapped_handle_);
     return *this;
 }
 
 ff::file_read& ff::file_read::operator=(const file_read& other)
 {
     file_base::operator=(other);
+    this->overlapped_handle_ = other.overlapped_handle_;
     return *this;
 }
 
@@ -146,7 +149,147 @@ size_t ff::file_read::read(void* data, size_t size)
 
 ff::co_task<size_t> ff::file_read::read_async(void* data, size_t size)
 {
-    return {};
+    const size_t offset = *this ? this->pos() : 0;
+    const size_t end = *this ? std::max(offset, std::min(offset + size, this->size())) : 0;
+
+    if (end != offset)
+    {
+        this->pos(end);
+    }
+
+    return this->read_async(offset, data, size);
+}
+
+ff::co_task<size_t> ff::file_read::read_async(size_t offset, void* data, size_t size)
+{
+    // Keep the handle alive even if this file goes away while the read is pending
+    std::shared_ptr<ff::win_handle> handle = this->overlapped_handle();
+    size_t total_read = 0;
+
+    while (handle && *handle && total_read < size)
+    {
+        const size_t chunk_offset = offset + total_read;
+        const DWORD chunk_size = static_cast<DWORD>(std::min<size_t>(size - total_read, 0x40000000));
+
+        ff::win_event done_event;
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(chunk_offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(chunk_offset) >> 32);
+        overlapped.hEvent = done_event;
+
+        if (!::ReadFile(*handle, static_cast<uint8_t*>(data) + total_read, chunk_size, nullptr, &overlapped))
+        {
+            if (::GetLastError() != ERROR_IO_PENDING)
+            {
+                // ERROR_HANDLE_EOF when reading past the end
+                break;
+            }
+
+            // The thread pool waits for the event, no thread is blocked
+            co_await done_event;
+        }
+
+        DWORD chunk_read = 0;
+        if (!::GetOverlappedResult(*handle, &overlapped, &chunk_read, FALSE) || !chunk_read)
+        {
+            break;
+        }
+
+        total_read += chunk_read;
+    }
+
+    co_return total_read;
+}
+
+bool ff::file_read::read_ranges(const ff::read_range_t* ranges, size_t count)
+{
+    return this->read_ranges_async(ranges, count).result();
+}
+
+ff::co_task<bool> ff::file_read::read_ranges_async(const ff::read_range_t* ranges, size_t count)
+{
+    // Gaps smaller than this get read and thrown away, since one read is faster than two
+    const size_t max_gap_size = 1024 * 64;
+    const size_t max_merged_size = 1024 * 1024 * 16;
+
+    struct merged_range_t
+    {
+        size_t start;
+        size_t end;
+        size_t first_range;
+        size_t range_count;
+        std::vector<uint8_t> buffer;
+        ff::co_task<size_t> task;
+    };
+
+    std::vector<ff::read_range_t> sorted_ranges(ranges, ranges + count);
+    std::sort(sorted_ranges.begin(), sorted_ranges.end(), [](const ff::read_range_t& l, const ff::read_range_t& r)
+        {
+            return l.offset < r.offset;
+        });
+
+    std::vector<merged_range_t> merged_ranges;
+    for (size_t i = 0; i < sorted_ranges.size(); i++)
+    {
+        const ff::read_range_t& range = sorted_ranges[i];
+        merged_range_t* merged = !merged_ranges.empty() ? &merged_ranges.back() : nullptr;
+
+        if (merged && range.offset <= merged->end + max_gap_size && range.offset + range.size - merged->start <= max_merged_size)
+        {
+            merged->end = std::max(merged->end, range.offset + range.size);
+            merged->range_count++;
+        }
+        else
+        {
+            merged_ranges.push_back(merged_range_t{ range.offset, range.offset + range.size, i, 1 });
+        }
+    }
+
+    // Start every read before waiting for any of them
+    for (merged_range_t& merged : merged_ranges)
+    {
+        if (merged.range_count == 1)
+        {
+            const ff::read_range_t& range = sorted_ranges[merged.first_range];
+            merged.task = this->read_async(range.offset, range.data, range.size);
+        }
+        else
+        {
+            merged.buffer.resize(merged.end - merged.start);
+            merged.task = this->read_async(merged.start, merged.buffer.data(), merged.buffer.size());
+        }
+    }
+
+    bool success = true;
+    for (merged_range_t& merged : merged_ranges)
+    {
+        size_t read_size = co_await merged.task;
+        success = success && (read_size == merged.end - merged.start);
+
+        for (size_t i = 0; success && i < merged.range_count && !merged.buffer.empty(); i++)
+        {
+            const ff::read_range_t& range = sorted_ranges[merged.first_range + i];
+            std::memcpy(range.data, merged.buffer.data() + range.offset - merged.start, range.size);
+        }
+    }
+
+    co_return success;
+}
+
+std::shared_ptr<ff::win_handle> ff::file_read::overlapped_handle()
+{
+    if (!this->overlapped_handle_ && *this)
+    {
+        CREATEFILE2_EXTENDED_PARAMETERS params{ sizeof(params) };
+        params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+        params.dwFileFlags = FILE_FLAG_OVERLAPPED;
+
+        this->overlapped_handle_ = std::make_shared<ff::win_handle>(::CreateFile2(
+            this->path().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, OPEN_EXISTING, &params));
+        assert(*this->overlapped_handle_);
+    }
+
+    return this->overlapped_handle_;
 }
 
 ff::file_write::file_write(const std::filesystem::path& path, bool append)
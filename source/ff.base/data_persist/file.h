@@ -5,6 +5,13 @@
 
 namespace ff
 {
+    struct read_range_t
+    {
+        size_t offset;
+        size_t size;
+        void* data;
+    };
+
     class file_base
     {
     protected:
@@ -46,7 +53,22 @@ namespace ff
         file_read& operator=(const file_read& other);
 
         size_t read(void* data, size_t size);
+
+        // Overlapped reads that don't block a thread while waiting, any number can be outstanding at once.
+        // The position version moves pos() forward right away. The file and buffer must outlive the task.
         ff::co_task<size_t> read_async(void* data, size_t size);
+        ff::co_task<size_t> read_async(size_t offset, void* data, size_t size);
+
+        // Sorts the ranges and merges the ones that are close together, then reads the merged ranges concurrently.
+        // Doesn't change pos(). Returns false unless every range was completely read.
+        // The blocking version is only for synchronous readers, coroutines should await read_ranges_async.
+        bool read_ranges(const ff::read_range_t* ranges, size_t count);
+        ff::co_task<bool> read_ranges_async(const ff::read_range_t* ranges, size_t count);
+
+    private:
+        std::shared_ptr<ff::win_handle> overlapped_handle();
+
+        std::shared_ptr<ff::win_handle> overlapped_handle_;
     };
 
     class file_write : public file_base
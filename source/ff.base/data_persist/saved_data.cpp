@@ -1,4 +1,5 @@
 #include "pch.h"
+#include "base/stable_hash.h"
 #include "types/flags.h"
 #include "data_persist/compression.h"
 #include "data_persist/data.h"
@@ -33,6 +34,38 @@ std::shared_ptr<ff::data_base> ff::saved_data_base::loaded_data() const
     return this->saved_data();
 }
 
+bool ff::saved_data_base::file_range(std::filesystem::path& path, size_t& offset) const
+{
+    return false;
+}
+
+ff::co_task<std::shared_ptr<ff::data_base>> ff::saved_data_base::saved_data_async() const
+{
+    co_return this->saved_data();
+}
+
+ff::co_task<std::shared_ptr<ff::data_base>> ff::saved_data_base::loaded_data_async() const
+{
+    std::shared_ptr<ff::data_base> saved_data = co_await this->saved_data_async();
+    if (!saved_data || !ff::flags::has(this->type(), saved_data_type::zlib_compressed))
+    {
+        co_return saved_data;
+    }
+
+    auto write_buffer = std::make_shared<std::vector<uint8_t>>();
+    write_buffer->reserve(this->loaded_size());
+    data_writer writer(write_buffer);
+    data_reader reader(saved_data);
+
+    if (ff::compression::uncompress(reader, saved_data->size(), writer))
+    {
+        co_return std::make_shared<data_vector>(write_buffer);
+    }
+
+    assert(false);
+    co_return nullptr;
+}
+
 ff::saved_data_static::saved_data_static(const std::shared_ptr<data_base>& data, size_t loaded_size, saved_data_type type)
     : data(data)
     , data_loaded_size(loaded_size)
@@ -80,7 +113,7 @@ std::shared_ptr<ff::reader_base> ff::saved_data_file::saved_reader() const
         size_t actual_pos = file.pos(this->data_offset);
         if (actual_pos == this->data_offset && actual_pos + this->data_saved_size <= file.size())
         {
-            return std::make_shared<file_reader>(std::move(file));
+            return std::make_shared<buffered_reader>(std::make_shared<file_reader>(std::move(file)));
         }
     }
 
@@ -103,6 +136,76 @@ std::shared_ptr<ff::data_base> ff::saved_data_file::saved_data() const
     return nullptr;
 }
 
+ff::co_task<std::shared_ptr<ff::data_base>> ff::saved_data_file::saved_data_async() const
+{
+    std::vector<uint8_t> buffer(this->data_saved_size);
+    file_read file(this->path);
+
+    if (file && this->data_offset + this->data_saved_size <= file.size())
+    {
+        size_t actually_read = co_await file.read_async(this->data_offset, buffer.data(), buffer.size());
+        if (actually_read == this->data_saved_size)
+        {
+            co_return std::make_shared<data_vector>(std::move(buffer));
+        }
+    }
+
+    assert(false);
+    co_return nullptr;
+}
+
+ff::co_task<std::vector<std::shared_ptr<ff::saved_data_base>>> ff::saved_data_file::read_batch_async(std::vector<std::shared_ptr<saved_data_base>> items)
+{
+    std::vector<std::shared_ptr<saved_data_base>> result = items;
+    std::vector<size_t> offsets(items.size());
+    std::unordered_map<std::filesystem::path, std::vector<size_t>, ff::stable_hash<std::filesystem::path>> file_to_items;
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        std::filesystem::path path;
+        if (items[i] && items[i]->file_range(path, offsets[i]))
+        {
+            file_to_items[path].push_back(i);
+        }
+    }
+
+    for (auto& [path, indexes] : file_to_items)
+    {
+        file_read file(path);
+        if (!file)
+        {
+            continue;
+        }
+
+        std::vector<std::vector<uint8_t>> buffers(indexes.size());
+        std::vector<ff::read_range_t> ranges;
+        ranges.reserve(indexes.size());
+
+        for (size_t i = 0; i < indexes.size(); i++)
+        {
+            const saved_data_base& item = *items[indexes[i]];
+            buffers[i].resize(item.saved_size());
+            ranges.push_back(ff::read_range_t{ offsets[indexes[i]], item.saved_size(), buffers[i].data() });
+        }
+
+        // The file, ranges, and buffers stay alive in this coroutine until the reads are done
+        if (!co_await file.read_ranges_async(ranges.data(), ranges.size()))
+        {
+            // Leave the originals to be read one at a time later
+            assert(false);
+            continue;
+        }
+
+        for (size_t i = 0; i < indexes.size(); i++)
+        {
+            const saved_data_base& item = *items[indexes[i]];
+            result[indexes[i]] = std::make_shared<saved_data_static>(std::make_shared<data_vector>(std::move(buffers[i])), item.loaded_size(), item.type());
+        }
+    }
+
+    co_return result;
+}
+
 size_t ff::saved_data_file::saved_size() const
 {
     return this->data_saved_size;
@@ -117,3 +220,10 @@ ff::saved_data_type ff::saved_data_file::type() const
 {
     return this->data_type;
 }
+
+bool ff::saved_data_file::file_range(std::filesystem::path& path, size_t& offset) const
+{
+    path = this->path;
+    offset = this->data_offset;
+    return true;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../thread/co_task.h"
+
 namespace ff
 {
     class data_base;
@@ -25,10 +27,15 @@ namespace ff
         virtual std::shared_ptr<data_base> saved_data() const = 0;
         virtual std::shared_ptr<reader_base> loaded_reader() const;
         virtual std::shared_ptr<data_base> loaded_data() const;
+        virtual ff::co_task<std::shared_ptr<data_base>> saved_data_async() const;
+        ff::co_task<std::shared_ptr<data_base>> loaded_data_async() const;
 
         virtual size_t saved_size() const = 0;
         virtual size_t loaded_size() const = 0;
         virtual saved_data_type type() const = 0;
+
+        // Returns false unless the saved data is a range of a file, so reads from the same file can be merged
+        virtual bool file_range(std::filesystem::path& path, size_t& offset) const;
     };
 
     class saved_data_static : public saved_data_base
@@ -66,10 +73,16 @@ namespace ff
 
         virtual std::shared_ptr<reader_base> saved_reader() const override;
         virtual std::shared_ptr<data_base> saved_data() const override;
+        virtual ff::co_task<std::shared_ptr<data_base>> saved_data_async() const override;
 
         virtual size_t saved_size() const  override;
         virtual size_t loaded_size() const  override;
         virtual saved_data_type type() const  override;
+        virtual bool file_range(std::filesystem::path& path, size_t& offset) const override;
+
+        // Reads everything from each file with a few merged reads. Returns saved_data_static in place of each
+        // saved_data_file that was read, anything else is returned as-is. No thread is blocked while the reads are pending.
+        static ff::co_task<std::vector<std::shared_ptr<saved_data_base>>> read_batch_async(std::vector<std::shared_ptr<saved_data_base>> items);
 
     private:
         std::filesystem::path path;
@@ -1,4 +1,5 @@
 #include "pch.h"
+#include "base/assert.h"
 #include "types/stack_vector.h"
 #include "data_persist/data.h"
 #include "data_persist/saved_data.h"
@@ -209,6 +210,38 @@ namespace
     };
 }
 
+bool ff::reader_base::read_ranges(const ff::read_range_t* ranges, size_t count)
+{
+    std::vector<const ff::read_range_t*> sorted_ranges;
+    sorted_ranges.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sorted_ranges.push_back(&ranges[i]);
+    }
+
+    // Read in order so that seeking is always forward
+    std::sort(sorted_ranges.begin(), sorted_ranges.end(), [](const ff::read_range_t* l, const ff::read_range_t* r)
+        {
+            return l->offset < r->offset;
+        });
+
+    const size_t old_pos = this->pos();
+    bool success = true;
+
+    for (const ff::read_range_t* range : sorted_ranges)
+    {
+        if (this->pos(range->offset) != range->offset || this->read(range->data, range->size) != range->size)
+        {
+            success = false;
+            break;
+        }
+    }
+
+    this->pos(old_pos);
+    return success;
+}
+
 ff::data_reader::data_reader(const std::shared_ptr<data_base>& data)
     : data(data)
     , data_pos(0)
@@ -269,6 +302,11 @@ size_t ff::file_reader::read(void* data, size_t size)
     return file.read(data, size);
 }
 
+bool ff::file_reader::read_ranges(const ff::read_range_t* ranges, size_t count)
+{
+    return this->file.read_ranges(ranges, count);
+}
+
 size_t ff::file_reader::size() const
 {
     return file.size();
@@ -397,6 +435,206 @@ std::shared_ptr<ff::saved_data_base> ff::file_writer::saved_data(size_t offset,
     return std::make_shared<saved_data_file>(this->file.path(), offset, saved_size, loaded_size, type);
 }
 
+ff::buffered_reader::buffered_reader(reader_base& reader, size_t block_size)
+    : reader(&reader)
+    , buffer_pos(0)
+    , buffer_size(0)
+    , reader_pos(reader.pos())
+    , data_pos(reader_pos)
+    , block_size(std::max<size_t>(block_size, 1))
+{}
+
+ff::buffered_reader::buffered_reader(const std::shared_ptr<reader_base>& reader, size_t block_size)
+    : buffered_reader(*reader, block_size)
+{
+    this->owned_reader = reader;
+}
+
+size_t ff::buffered_reader::read(void* data, size_t size)
+{
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+    size_t total_read = 0;
+
+    while (size)
+    {
+        if (this->data_pos >= this->buffer_pos && this->data_pos < this->buffer_pos + this->buffer_size)
+        {
+            const size_t buffer_offset = this->data_pos - this->buffer_pos;
+            const size_t copy_size = std::min(size, this->buffer_size - buffer_offset);
+            std::memcpy(bytes, this->buffer.data() + buffer_offset, copy_size);
+
+            this->data_pos += copy_size;
+            total_read += copy_size;
+            bytes += copy_size;
+            size -= copy_size;
+        }
+        else if (size >= this->block_size)
+        {
+            // Big reads skip the buffer
+            const size_t read_size = this->read_from_reader(bytes, size);
+            this->data_pos += read_size;
+            total_read += read_size;
+            break;
+        }
+        else
+        {
+            this->buffer.resize(this->block_size);
+            this->buffer_pos = this->data_pos;
+            this->buffer_size = this->read_from_reader(this->buffer.data(), this->block_size);
+
+            if (!this->buffer_size)
+            {
+                break;
+            }
+        }
+    }
+
+    return total_read;
+}
+
+bool ff::buffered_reader::read_ranges(const ff::read_range_t* ranges, size_t count)
+{
+    return this->reader->read_ranges(ranges, count);
+}
+
+size_t ff::buffered_reader::size() const
+{
+    return this->reader->size();
+}
+
+size_t ff::buffered_reader::pos() const
+{
+    return this->data_pos;
+}
+
+size_t ff::buffered_reader::pos(size_t new_pos)
+{
+    assert(new_pos <= this->size());
+    new_pos = std::min(new_pos, this->size());
+    this->data_pos = new_pos;
+    return new_pos;
+}
+
+std::shared_ptr<ff::saved_data_base> ff::buffered_reader::saved_data(size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type) const
+{
+    return this->reader->saved_data(offset, saved_size, loaded_size, type);
+}
+
+size_t ff::buffered_reader::read_from_reader(void* data, size_t size)
+{
+    if (this->reader_pos != this->data_pos)
+    {
+        this->reader_pos = this->reader->pos(this->data_pos);
+        if (this->reader_pos != this->data_pos)
+        {
+            return 0;
+        }
+    }
+
+    const size_t read_size = this->reader->read(data, size);
+    this->reader_pos += read_size;
+    return read_size;
+}
+
+ff::buffered_writer::buffered_writer(writer_base& writer, size_t block_size)
+    : writer(&writer)
+    , buffer_pos(writer.pos())
+    , block_size(std::max<size_t>(block_size, 1))
+{}
+
+ff::buffered_writer::buffered_writer(const std::shared_ptr<writer_base>& writer, size_t block_size)
+    : buffered_writer(*writer, block_size)
+{
+    this->owned_writer = writer;
+}
+
+ff::buffered_writer::~buffered_writer()
+{
+    if (this->writer)
+    {
+        this->flush();
+    }
+}
+
+bool ff::buffered_writer::flush()
+{
+    if (this->buffer.empty())
+    {
+        return true;
+    }
+
+    const size_t written = this->writer->write(this->buffer.data(), this->buffer.size());
+    const bool success = (written == this->buffer.size());
+    assert(success);
+
+    this->buffer_pos += written;
+    this->buffer.clear();
+    return success;
+}
+
+size_t ff::buffered_writer::write(const void* data, size_t size)
+{
+    if (this->buffer.size() + size > this->block_size)
+    {
+        check_ret_val(this->flush(), 0);
+
+        if (size >= this->block_size)
+        {
+            // Big writes skip the buffer
+            const size_t written = this->writer->write(data, size);
+            this->buffer_pos += written;
+            return written;
+        }
+    }
+
+    if (this->buffer.capacity() < this->block_size)
+    {
+        this->buffer.reserve(this->block_size);
+    }
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    this->buffer.insert(this->buffer.cend(), bytes, bytes + size);
+    return size;
+}
+
+void ff::buffered_writer::reserve(size_t size)
+{
+    this->writer->reserve(size);
+}
+
+size_t ff::buffered_writer::size() const
+{
+    return std::max(this->writer->size(), this->pos());
+}
+
+size_t ff::buffered_writer::pos() const
+{
+    return this->buffer_pos + this->buffer.size();
+}
+
+size_t ff::buffered_writer::pos(size_t new_pos)
+{
+    if (new_pos == this->pos())
+    {
+        return new_pos;
+    }
+
+    this->flush();
+    this->buffer_pos = this->writer->pos(new_pos);
+    return this->buffer_pos;
+}
+
+std::shared_ptr<ff::saved_data_base> ff::buffered_writer::saved_data(size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type) const
+{
+    // The data must be in the other writer before anything can refer to it
+    if (offset + saved_size > this->buffer_pos)
+    {
+        const_cast<ff::buffered_writer*>(this)->flush();
+    }
+
+    return this->writer->saved_data(offset, saved_size, loaded_size, type);
+}
+
 size_t ff::stream_copy(writer_base& writer, reader_base& reader, size_t size, size_t chunk_size)
 {
     std::vector<uint8_t> buffer;
@@ -23,6 +23,10 @@ namespace ff
     {
     public:
         virtual size_t read(void* data, size_t size) = 0;
+
+        // Reads any number of ranges, possibly in a different order or merged together. Doesn't change pos().
+        // Returns false unless every range was completely read.
+        virtual bool read_ranges(const ff::read_range_t* ranges, size_t count);
     };
 
     class writer_base : public stream_base
@@ -67,6 +71,7 @@ namespace ff
         bool operator!() const;
 
         virtual size_t read(void* data, size_t size) override;
+        virtual bool read_ranges(const ff::read_range_t* ranges, size_t count) override;
         virtual size_t size() const override;
         virtual size_t pos() const override;
         virtual size_t pos(size_t new_pos) override;
@@ -123,6 +128,84 @@ namespace ff
         file_write file;
     };
 
+    /// <summary>
+    /// Reads blocks from another reader, so lots of small reads don't each turn into a system call
+    /// </summary>
+    /// <remarks>
+    /// Setting pos() only moves within the buffer, the other reader is only moved when reading outside
+    /// of the buffer. The other reader shouldn't be used directly while this one is alive.
+    /// </remarks>
+    class buffered_reader : public reader_base
+    {
+    public:
+        static const size_t default_block_size = 1024 * 64;
+
+        buffered_reader(reader_base& reader, size_t block_size = ff::buffered_reader::default_block_size);
+        buffered_reader(const std::shared_ptr<reader_base>& reader, size_t block_size = ff::buffered_reader::default_block_size);
+        buffered_reader(buffered_reader&& other) noexcept = default;
+        buffered_reader(const buffered_reader& other) = delete;
+
+        buffered_reader& operator=(buffered_reader&& other) noexcept = default;
+        buffered_reader& operator=(const buffered_reader& other) = delete;
+
+        virtual size_t read(void* data, size_t size) override;
+        virtual bool read_ranges(const ff::read_range_t* ranges, size_t count) override;
+        virtual size_t size() const override;
+        virtual size_t pos() const override;
+        virtual size_t pos(size_t new_pos) override;
+        virtual std::shared_ptr<saved_data_base> saved_data(size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type) const override;
+
+    private:
+        size_t read_from_reader(void* data, size_t size);
+
+        std::shared_ptr<reader_base> owned_reader;
+        reader_base* reader;
+        std::vector<uint8_t> buffer;
+        size_t buffer_pos; // stream position of buffer[0]
+        size_t buffer_size; // valid bytes in the buffer
+        size_t reader_pos;
+        size_t data_pos;
+        size_t block_size;
+    };
+
+    /// <summary>
+    /// Collects small writes into blocks before passing them to another writer
+    /// </summary>
+    /// <remarks>
+    /// Call flush() or destroy this writer before using the other writer directly. Setting pos() and
+    /// saved_data() both flush first, so the other writer always sees the data in the right order.
+    /// </remarks>
+    class buffered_writer : public writer_base
+    {
+    public:
+        static const size_t default_block_size = 1024 * 64;
+
+        buffered_writer(writer_base& writer, size_t block_size = ff::buffered_writer::default_block_size);
+        buffered_writer(const std::shared_ptr<writer_base>& writer, size_t block_size = ff::buffered_writer::default_block_size);
+        buffered_writer(buffered_writer&& other) noexcept = default;
+        buffered_writer(const buffered_writer& other) = delete;
+        virtual ~buffered_writer() override;
+
+        buffered_writer& operator=(buffered_writer&& other) noexcept = default;
+        buffered_writer& operator=(const buffered_writer& other) = delete;
+
+        bool flush();
+
+        virtual size_t write(const void* data, size_t size) override;
+        virtual void reserve(size_t size) override;
+        virtual size_t size() const override;
+        virtual size_t pos() const override;
+        virtual size_t pos(size_t new_pos) override;
+        virtual std::shared_ptr<saved_data_base> saved_data(size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type) const override;
+
+    private:
+        std::shared_ptr<writer_base> owned_writer;
+        writer_base* writer;
+        std::vector<uint8_t> buffer;
+        size_t buffer_pos; // stream position of buffer[0]
+        size_t block_size;
+    };
+
     size_t stream_copy(writer_base& writer, reader_base& reader, size_t size, size_t chunk_size = 0);
     Microsoft::WRL::ComPtr<IStream> get_stream(const std::shared_ptr<reader_base>& reader);
 }
@@ -14,6 +14,11 @@ void ff::global_resources::add(ff::reader_base& reader)
     ::global_resources->add_resources(reader);
 }
 
+void ff::global_resources::add(const std::shared_ptr<ff::data_base>& data)
+{
+    ::global_resources->add_resources(data);
+}
+
 bool ff::global_resources::add_files(const std::filesystem::path& path)
 {
     return ::global_resources->add_files(path);
@@ -11,6 +11,7 @@ namespace ff
 namespace ff::global_resources
 {
     void add(ff::reader_base& reader);
+    void add(const std::shared_ptr<ff::data_base>& data);
     bool add_files(const std::filesystem::path& path);
     std::shared_ptr<ff::resource_objects> get();
     std::shared_ptr<ff::resource> get(std::string_view name);
@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "base/log.h"
+#include "data_persist/data.h"
+#include "data_persist/dict.h"
+#include "data_persist/file.h"
+#include "data_persist/filesystem.h"
+#include "data_persist/persist.h"
+#include "data_persist/stream.h"
+#include "data_value/dict_v.h"
+#include "resource/resource_build_cache.h"
+
+using namespace std::string_view_literals;
+
+static const size_t BUILD_CACHE_COOKIE = ff::stable_hash_func("ff::resource_build_cache@0"sv);
+
+ff::resource_build_cache::resource_build_cache(const std::filesystem::path& directory, bool read_enabled)
+    : directory_(directory)
+    , hit_count_(0)
+    , miss_count_(0)
+    , tool_version_hash(::BUILD_CACHE_COOKIE)
+    , read_enabled(read_enabled)
+{}
+
+std::filesystem::path ff::resource_build_cache::default_directory()
+{
+    std::filesystem::path path = ff::filesystem::user_local_path();
+    return (path /= "ff.cache") /= "build";
+}
+
+const std::filesystem::path& ff::resource_build_cache::directory() const
+{
+    return this->directory_;
+}
+
+void ff::resource_build_cache::add_tool_version(std::string_view version)
+{
+    assert(!this->hit_count_ && !this->miss_count_);
+
+    const size_t hash = ff::stable_hash_func(version);
+    std::scoped_lock lock(this->mutex);
+    this->tool_version_hash = ff::stable_hash_incremental(&hash, sizeof(hash), ff::stable_hash_incremental(&this->tool_version_hash, sizeof(this->tool_version_hash)));
+}
+
+size_t ff::resource_build_cache::file_hash(const std::filesystem::path& path)
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        auto i = this->file_hashes.find(path);
+        if (i != this->file_hashes.cend())
+        {
+            return i->second;
+        }
+    }
+
+    ff::file_mem_mapped file(path);
+    const size_t size = file ? file.size() : 0;
+    ff::stable_hash_data_t hash(size);
+
+    if (size)
+    {
+        hash.hash(file.data(), size);
+    }
+
+    std::scoped_lock lock(this->mutex);
+    return this->file_hashes.try_emplace(path, hash.hash()).first->second;
+}
+
+ff::value_ptr ff::resource_build_cache::load(size_t hash)
+{
+    std::filesystem::path path = this->entry_path(hash);
+    std::shared_ptr<ff::data_base> data = (this->read_enabled && ff::filesystem::exists(path)) ? ff::filesystem::read_binary_file(path) : nullptr;
+    ff::value_ptr dict_value;
+
+    if (data)
+    {
+        ff::data_reader reader(data);
+        size_t cookie, saved_hash;
+        if (ff::load(reader, cookie) && cookie == this->tool_version_hash && ff::load(reader, saved_hash) && saved_hash == hash)
+        {
+            ff::value_ptr value = ff::value::load_typed(reader);
+            dict_value = value ? ff::type::try_get_dict_from_data(value) : nullptr;
+        }
+
+        if (!dict_value)
+        {
+            ff::log::write(ff::log::type::resource_load, "Invalid build cache entry: ", ff::filesystem::to_string(path));
+        }
+    }
+
+    (dict_value ? this->hit_count_ : this->miss_count_).fetch_add(1);
+    return dict_value;
+}
+
+bool ff::resource_build_cache::save(size_t hash, const ff::dict& dict)
+{
+    auto data_vector = std::make_shared<std::vector<uint8_t>>();
+    {
+        ff::data_writer writer(data_vector);
+        ff::value_ptr dict_value = ff::value::create<ff::dict>(ff::dict(dict));
+        assert_ret_val(ff::save(writer, this->tool_version_hash) && ff::save(writer, hash) && dict_value->save_typed(writer), false);
+    }
+
+    // Write to a unique temp file first, other builds may be reading or writing the same entry
+    std::filesystem::path path = this->entry_path(hash);
+    std::filesystem::path temp_path = path;
+    temp_path += std::to_string(::GetCurrentProcessId()) + "." + std::to_string(::GetCurrentThreadId()) + ".tmp";
+
+    if (!ff::filesystem::create_directories(path.parent_path()) ||
+        !ff::filesystem::write_binary_file(temp_path, data_vector->data(), data_vector->size()))
+    {
+        ff::log::write(ff::log::type::resource_load, "Failed to write build cache entry: ", ff::filesystem::to_string(temp_path));
+        return false;
+    }
+
+    std::error_code ec{};
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        // Another build probably wrote the same entry first
+        ff::filesystem::remove(temp_path);
+        return ff::filesystem::exists(path);
+    }
+
+    return true;
+}
+
+size_t ff::resource_build_cache::hit_count() const
+{
+    return this->hit_count_.load();
+}
+
+size_t ff::resource_build_cache::miss_count() const
+{
+    return this->miss_count_.load();
+}
+
+std::filesystem::path ff::resource_build_cache::entry_path(size_t hash)
+    const
+{
+    // Different tool versions get different entries, so switching between branches doesn't thrash the cache
+    const size_t key = ff::stable_hash_incremental(&hash, sizeof(hash), ff::stable_hash_incremental(&this->tool_version_hash, sizeof(this->tool_version_hash)));
+
+    std::ostringstream name;
+    name << std::hex << std::setw(sizeof(size_t) * 2) << std::setfill('0') << key;
+    std::string name_str = name.str();
+
+    std::filesystem::path path = this->directory_;
+    return (path /= name_str.substr(0, 2)) /= name_str + ".res";
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../base/stable_hash.h"
+#include "../data_value/value_ptr.h"
+
+namespace ff
+{
+    class dict;
+
+    /// <summary>
+    /// On-disk cache of compiled resources, keyed by a hash of everything that went into compiling them
+    /// </summary>
+    /// <remarks>
+    /// The directory can be shared between branches and machines, since the keys only depend on file
+    /// contents and paths relative to the source JSON. Entries are written to a temp file and then
+    /// renamed, so concurrent builds never see a partially written entry.
+    ///
+    /// Compiled output also depends on the code that compiled it. Each factory's build_version() is part of
+    /// the hash for its resources, so that must be bumped when a factory's output changes. Anything else
+    /// that affects output (like a reference DLL) can be passed to add_tool_version before anything is
+    /// loaded or saved. Rebuilding the tool without changing a version doesn't invalidate anything.
+    /// </remarks>
+    class resource_build_cache
+    {
+    public:
+        resource_build_cache(const std::filesystem::path& directory, bool read_enabled = true);
+        resource_build_cache(resource_build_cache&& other) noexcept = delete;
+        resource_build_cache(const resource_build_cache& other) = delete;
+
+        resource_build_cache& operator=(resource_build_cache&& other) noexcept = delete;
+        resource_build_cache& operator=(const resource_build_cache& other) = delete;
+
+        static std::filesystem::path default_directory();
+        const std::filesystem::path& directory() const;
+
+        void add_tool_version(std::string_view version);
+        size_t file_hash(const std::filesystem::path& path); // cached for the lifetime of this object
+        ff::value_ptr load(size_t hash); // returns a dict value, or nullptr if not cached
+        bool save(size_t hash, const ff::dict& dict);
+
+        size_t hit_count() const;
+        size_t miss_count() const;
+
+    private:
+        std::filesystem::path entry_path(size_t hash) const;
+
+        std::mutex mutex;
+        std::filesystem::path directory_;
+        std::unordered_map<std::filesystem::path, size_t, ff::stable_hash<std::filesystem::path>> file_hashes;
+        std::atomic<size_t> hit_count_;
+        std::atomic<size_t> miss_count_;
+        size_t tool_version_hash;
+        bool read_enabled;
+    };
+}
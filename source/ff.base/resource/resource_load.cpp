@@ -32,9 +32,8 @@ static std::shared_ptr<ff::resource_objects> load_cached_resources(const std::fi
     auto data = mem_map_file ? ff::filesystem::map_binary_file(path) : ff::filesystem::read_binary_file(path);
     assert_ret_val(data, std::shared_ptr<ff::resource_objects>());
 
-    ff::data_reader reader(data);
     auto resource_objects = std::make_shared<ff::resource_objects>();
-    assert_ret_val(resource_objects->add_resources(reader), std::shared_ptr<ff::resource_objects>());
+    assert_ret_val(resource_objects->add_resources(data), std::shared_ptr<ff::resource_objects>());
 
     std::vector<std::string> input_files = resource_objects->input_files();
     check_ret_val(input_files.size(), std::shared_ptr<ff::resource_objects>());
@@ -53,7 +52,7 @@ static std::shared_ptr<ff::resource_objects> load_cached_resources(const std::fi
     return resource_objects;
 }
 
-ff::load_resources_result ff::load_resources_from_file(const std::filesystem::path& path, ff::resource_cache_t cache_type, bool debug)
+ff::load_resources_result ff::load_resources_from_file(const std::filesystem::path& path, ff::resource_cache_t cache_type, bool debug, ff::resource_build_cache* build_cache)
 {
     ff::load_resources_result result{};
 
@@ -72,7 +71,7 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
     if (ff::filesystem::read_text_file(path, text))
     {
         std::filesystem::path base_path = path.parent_path();
-        result = ff::load_resources_from_json(text, base_path, debug);
+        result = ff::load_resources_from_json(text, base_path, debug, build_cache);
         if (result.resources)
         {
             if (debug)
@@ -91,12 +90,16 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
             {
                 result.cache_path = ::get_cache_path(path, debug);
 
-                ff::file_writer writer(result.cache_path);
-                if (writer && !result.resources->save(writer))
+                ff::file_writer file_writer(result.cache_path);
+                if (file_writer)
                 {
-                    // Ignore failures saving the cache, just delete the cache instead
-                    ff::filesystem::remove(result.cache_path);
-                    result.cache_path.clear();
+                    ff::buffered_writer writer(file_writer);
+                    if (!result.resources->save(writer) || !writer.flush())
+                    {
+                        // Ignore failures saving the cache, just delete the cache instead
+                        ff::filesystem::remove(result.cache_path);
+                        result.cache_path.clear();
+                    }
                 }
             }
         }
@@ -105,7 +108,7 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
     return result;
 }
 
-ff::load_resources_result ff::load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug)
+ff::load_resources_result ff::load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug, ff::resource_build_cache* build_cache)
 {
     const char* error_pos;
     ff::dict dict;
@@ -120,7 +123,7 @@ ff::load_resources_result ff::load_resources_from_json(std::string_view json_tex
         return result;
     }
 
-    return ff::load_resources_from_json(dict, base_path, debug);
+    return ff::load_resources_from_json(dict, base_path, debug, build_cache);
 }
 
 bool ff::is_resource_cache_updated(const std::vector<std::filesystem::path>& source_files, const std::filesystem::path& cache_path)
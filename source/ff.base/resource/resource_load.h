@@ -25,6 +25,7 @@ namespace ff::internal
 namespace ff
 {
     class dict;
+    class resource_build_cache;
     class resource_objects;
 
     struct load_resources_result
@@ -43,8 +44,9 @@ namespace ff
         rebuild_cache,
     };
 
-    ff::load_resources_result load_resources_from_file(const std::filesystem::path& path, ff::resource_cache_t cache_type, bool debug);
-    ff::load_resources_result load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug);
-    ff::load_resources_result load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug);
+    // The build cache reuses previously compiled root resources whose inputs haven't changed, it's optional
+    ff::load_resources_result load_resources_from_file(const std::filesystem::path& path, ff::resource_cache_t cache_type, bool debug, ff::resource_build_cache* build_cache = nullptr);
+    ff::load_resources_result load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug, ff::resource_build_cache* build_cache = nullptr);
+    ff::load_resources_result load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug, ff::resource_build_cache* build_cache = nullptr);
     bool is_resource_cache_updated(const std::vector<std::filesystem::path>& source_files, const std::filesystem::path& cache_path);
 }
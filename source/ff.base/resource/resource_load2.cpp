@@ -5,17 +5,22 @@
 #include "data_persist/dict_visitor.h"
 #include "data_persist/filesystem.h"
 #include "data_persist/json_persist.h"
+#include "data_persist/stream.h"
 #include "data_value/data_v.h"
 #include "data_value/dict_v.h"
 #include "data_value/resource_v.h"
 #include "data_value/resource_object_v.h"
+#include "data_value/saved_data_v.h"
 #include "data_value/string_v.h"
+#include "data_value/value_vector_v.h"
 #include "resource/resource.h"
+#include "resource/resource_build_cache.h"
 #include "resource/resource_load.h"
 #include "resource/resource_load_context.h"
 #include "resource/resource_object_base.h"
 #include "resource/resource_object_factory_base.h"
 #include "resource/resource_objects.h"
+#include "thread/task_graph.h"
 #include "types/scope_exit.h"
 
 static std::string make_symbol_from_name(std::string_view name)
@@ -49,11 +54,96 @@ static std::string make_symbol_from_name(std::string_view name)
     return id.str();
 }
 
+static void hash_build_string(std::string_view value, ff::stable_hash_data_t& hash)
+{
+    const size_t size = value.size();
+    hash.hash(&size, sizeof(size));
+    hash.hash(value.data(), size);
+}
+
+// Hashes a resource value in a way that doesn't depend on dict order or where the source JSON lives on disk,
+// and collects the names of referenced resources so that their hashes can be combined later
+static void hash_build_value(const ff::value* value, std::string_view base_path, ff::stable_hash_data_t& hash, std::vector<std::string>& refs)
+{
+    ff::value_ptr dict_value = value ? ff::type::try_get_dict_from_data(value) : nullptr;
+
+    if (!value)
+    {
+        ::hash_build_string("null", hash);
+    }
+    else if (dict_value)
+    {
+        const ff::dict& dict = dict_value->get<ff::dict>();
+        ::hash_build_string("dict", hash);
+
+        const ff::resource_object_factory_base* factory = ff::resource_object_base::get_factory(dict.get<std::string>(ff::internal::RES_TYPE));
+        if (factory)
+        {
+            const size_t version = factory->build_version();
+            ::hash_build_string(factory->name(), hash);
+            hash.hash(&version, sizeof(version));
+        }
+
+        for (std::string_view name : dict.child_names(true))
+        {
+            ::hash_build_string(name, hash);
+            ::hash_build_value(dict.get(name), base_path, hash, refs);
+        }
+    }
+    else if (value->is_type<ff::value_vector>())
+    {
+        const ff::value_vector& values = value->get<ff::value_vector>();
+        const size_t size = values.size();
+        ::hash_build_string("vector", hash);
+        hash.hash(&size, sizeof(size));
+
+        for (const ff::value_ptr& child_value : values)
+        {
+            ::hash_build_value(child_value, base_path, hash, refs);
+        }
+    }
+    else if (value->is_type<std::string>())
+    {
+        std::string_view string_value = value->get<std::string>();
+        if (!base_path.empty() && string_value.starts_with(base_path))
+        {
+            // Full file paths were expanded from paths relative to the source JSON
+            string_value = string_value.substr(base_path.size());
+        }
+
+        ::hash_build_string("string", hash);
+        ::hash_build_string(string_value, hash);
+    }
+    else if (value->is_type<ff::resource>())
+    {
+        std::shared_ptr<ff::resource> res = value->get<ff::resource>();
+        std::string_view name = res ? res->name() : std::string_view{};
+        ::hash_build_string("ref", hash);
+        ::hash_build_string(name, hash);
+        refs.emplace_back(name);
+    }
+    else
+    {
+        auto bytes = std::make_shared<std::vector<uint8_t>>();
+        ff::data_writer writer(bytes);
+
+        if (value->save_typed(writer))
+        {
+            hash.hash(bytes->data(), bytes->size());
+        }
+        else
+        {
+            ::hash_build_string("unknown", hash);
+        }
+    }
+}
+
 class transformer_context : public ff::resource_load_context
 {
 public:
-    transformer_context(const std::filesystem::path& base_path, bool debug)
+    transformer_context(const std::filesystem::path& base_path, bool debug, ff::resource_build_cache* build_cache)
         : base_path_(base_path)
+        , build_cache_(build_cache)
         , debug_(debug)
     {}
 
@@ -90,6 +180,11 @@ public:
         return this->debug_;
     }
 
+    virtual ff::resource_build_cache* build_cache() const override
+    {
+        return this->build_cache_;
+    }
+
     const ff::dict& values() const
     {
         static ff::dict empty_dict;
@@ -265,6 +360,32 @@ public:
         return id_to_name_copy;
     }
 
+    void set_build_hash(std::string_view name, size_t hash)
+    {
+        std::scoped_lock lock(this->mutex);
+        this->name_to_build_hash.insert_or_assign(std::string(name), hash);
+    }
+
+    // Returns zero if the named root resource can't use the build cache
+    size_t build_hash(std::string_view name) const
+    {
+        std::scoped_lock lock(this->mutex);
+        auto i = this->name_to_build_hash.find(std::string(name));
+        return i != this->name_to_build_hash.cend() ? i->second : 0;
+    }
+
+    void add_cached_object(ff::resource_object_base* obj)
+    {
+        std::scoped_lock lock(this->mutex);
+        this->cached_objects.insert(obj);
+    }
+
+    bool is_cached_object(ff::resource_object_base* obj) const
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->cached_objects.find(obj) != this->cached_objects.cend();
+    }
+
 private:
     mutable std::recursive_mutex mutex;
     std::filesystem::path base_path_;
@@ -275,6 +396,9 @@ private:
     std::unordered_map<std::string, std::unordered_set<std::filesystem::path>> name_to_paths;
     std::unordered_set<std::filesystem::path, ff::stable_hash<std::filesystem::path>> paths_;
     std::unordered_map<std::string, std::string> id_to_name_;
+    std::unordered_map<std::string, size_t> name_to_build_hash;
+    std::unordered_set<ff::resource_object_base*> cached_objects;
+    ff::resource_build_cache* build_cache_;
     bool debug_;
 };
 
@@ -521,7 +645,73 @@ class start_load_objects_from_dict_transformer : public transformer_base
 public:
     using transformer_base::transformer_base;
 
+    // Computes the build cache key for each typed root object from its own values, input files,
+    // and factory versions, combined with the keys of the root objects that it references.
+    void hash_root_objects(const ff::dict& dict)
+    {
+        ff::resource_build_cache* cache = this->context().build_cache();
+        if (!cache)
+        {
+            return;
+        }
+
+        std::string base_path = ff::filesystem::to_string(std::filesystem::weakly_canonical(this->context().base_path()));
+        std::unordered_map<std::string_view, build_hash_t> hashes;
+
+        for (std::string_view name : dict.child_names())
+        {
+            ff::value_ptr dict_value = ff::type::try_get_dict_from_data(dict.get(name));
+            if (!dict_value || !dict_value->get<ff::dict>().get(ff::internal::RES_TYPE))
+            {
+                continue;
+            }
+
+            build_hash_t& info = hashes.try_emplace(name).first->second;
+            ff::stable_hash_data_t hash;
+            const bool debug = this->context().debug();
+            hash.hash(&debug, sizeof(debug));
+            ::hash_build_value(dict_value, base_path, hash, info.refs);
+
+            std::vector<std::filesystem::path> paths = this->context().paths(name);
+            std::sort(paths.begin(), paths.end());
+
+            for (const std::filesystem::path& path : paths)
+            {
+                const size_t file_hash = cache->file_hash(path);
+                hash.hash(&file_hash, sizeof(file_hash));
+            }
+
+            info.hash = hash.hash();
+        }
+
+        for (auto& [name, info] : hashes)
+        {
+            this->context().set_build_hash(name, this->combine_build_hash(name, hashes));
+        }
+    }
+
 protected:
+    virtual ff::value_ptr transform_root_value(ff::value_ptr value) override
+    {
+        ff::resource_build_cache* cache = this->context().build_cache();
+        const size_t hash = cache ? this->context().build_hash(this->path()) : 0;
+        ff::value_ptr cached_value = hash ? cache->load(hash) : nullptr;
+        ff::value_ptr obj_value = cached_value ? this->create_cached_objects(cached_value) : nullptr;
+
+        if (obj_value && obj_value->is_type<ff::resource_object_base>())
+        {
+            ff::value_ptr dict_value = ff::type::try_get_dict_from_data(value);
+            if (dict_value)
+            {
+                this->add_id_symbol(dict_value->get<ff::dict>());
+            }
+
+            return obj_value;
+        }
+
+        return transformer_base::transform_root_value(value);
+    }
+
     virtual ff::value_ptr transform_dict(const ff::dict& dict) override
     {
         ff::value_ptr output_value = transformer_base::transform_dict(dict);
@@ -555,19 +745,10 @@ protected:
             {
                 const ff::dict& output_dict = output_dict_value->get<ff::dict>();
                 ff::value_ptr type_value = output_dict.get(ff::internal::RES_TYPE);
-                ff::value_ptr symbol_value = output_dict.get(ff::internal::RES_SYMBOL);
 
                 if (this->path_depth() == 1)
                 {
-                    std::string name = this->path();
-                    std::string id = (symbol_value && symbol_value->is_type<std::string>())
-                        ? symbol_value->get<std::string>()
-                        : ::make_symbol_from_name(name);
-
-                    if (id.size())
-                    {
-                        this->context().set_id_to_name(id, name);
-                    }
+                    this->add_id_symbol(output_dict);
                 }
 
                 if (type_value && type_value->is_type<std::string>())
@@ -592,6 +773,126 @@ protected:
 
         return output_value;
     }
+
+private:
+    struct build_hash_t
+    {
+        std::vector<std::string> refs;
+        size_t hash{};
+        size_t combined_hash{};
+        bool combining{};
+    };
+
+    size_t combine_build_hash(std::string_view name, std::unordered_map<std::string_view, build_hash_t>& hashes)
+    {
+        build_hash_t& info = hashes.find(name)->second;
+        if (info.combined_hash || info.combining)
+        {
+            // Reference cycles just use the hash of the object itself
+            return info.combined_hash ? info.combined_hash : info.hash;
+        }
+
+        info.combining = true;
+        ff::stable_hash_data_t hash;
+        hash.hash(&info.hash, sizeof(info.hash));
+
+        std::vector<std::string> refs = info.refs;
+        std::sort(refs.begin(), refs.end());
+
+        for (std::string_view ref_name : refs)
+        {
+            // Siblings like "parent.child" don't exist until the parent finishes loading
+            auto i = hashes.find(ref_name);
+            for (size_t dot = ref_name.rfind('.'); i == hashes.end() && dot != std::string_view::npos; dot = ref_name.rfind('.'))
+            {
+                ref_name = ref_name.substr(0, dot);
+                i = hashes.find(ref_name);
+            }
+
+            if (i != hashes.end())
+            {
+                const size_t ref_hash = this->combine_build_hash(i->first, hashes);
+                hash.hash(&ref_hash, sizeof(ref_hash));
+            }
+        }
+
+        info.combining = false;
+        info.combined_hash = hash.hash();
+        return info.combined_hash;
+    }
+
+    // Same as ff::resource_objects::create_resource_objects, but references go through the context
+    ff::value_ptr create_cached_objects(ff::value_ptr value)
+    {
+        if (!value)
+        {
+            return value;
+        }
+
+        ff::value_ptr dict_value = ff::type::try_get_dict_from_data(value);
+        if (dict_value)
+        {
+            ff::dict dict = dict_value->get<ff::dict>();
+            const ff::resource_object_factory_base* factory = ff::resource_object_base::get_factory(dict.get<std::string>(ff::internal::RES_TYPE));
+
+            for (std::string_view name : dict.child_names())
+            {
+                dict.set(name, this->create_cached_objects(dict.get(name)));
+            }
+
+            if (factory)
+            {
+                std::shared_ptr<ff::resource_object_base> obj = factory->load_from_cache(dict);
+                if (!obj)
+                {
+                    return nullptr;
+                }
+
+                this->context().add_cached_object(obj.get());
+                return ff::value::create<ff::resource_object_base>(obj);
+            }
+
+            return ff::value::create<ff::dict>(std::move(dict));
+        }
+        else if (value->is_type<ff::value_vector>())
+        {
+            ff::value_vector values = value->get<ff::value_vector>();
+            for (ff::value_ptr& child_value : values)
+            {
+                child_value = this->create_cached_objects(child_value);
+            }
+
+            return ff::value::create<ff::value_vector>(std::move(values));
+        }
+        else if (value->is_type<std::string>())
+        {
+            std::string_view str = value->get<std::string>();
+            if (str.starts_with(ff::internal::REF_PREFIX))
+            {
+                return ff::value::create<ff::resource>(this->context().set_reference(str.substr(ff::internal::REF_PREFIX.size())));
+            }
+        }
+        else if (value->is_type<ff::saved_data_base>())
+        {
+            return value->try_convert<ff::data_base>();
+        }
+
+        return value;
+    }
+
+    void add_id_symbol(const ff::dict& dict)
+    {
+        std::string name = this->path();
+        ff::value_ptr symbol_value = dict.get(ff::internal::RES_SYMBOL);
+        std::string id = (symbol_value && symbol_value->is_type<std::string>())
+            ? symbol_value->get<std::string>()
+            : ::make_symbol_from_name(name);
+
+        if (id.size())
+        {
+            this->context().set_id_to_name(id, name);
+        }
+    }
 };
 
 class finish_load_objects_from_dict_transformer : public transformer_base
@@ -599,6 +900,54 @@ class finish_load_objects_from_dict_transformer : public transformer_base
 public:
     using transformer_base::transformer_base;
 
+    // Finishes root objects in dependency order so that independent objects finish concurrently,
+    // without pool threads blocking on each other. Anything left over (like dependency cycles or
+    // nested objects) still gets finished when visiting the dict.
+    void finish_root_objects(const ff::dict& dict)
+    {
+        ff::task_graph graph;
+        std::unordered_map<ff::resource_object_base*, size_t> obj_to_task;
+
+        for (std::string_view name : dict.child_names())
+        {
+            ff::value_ptr value = dict.get(name);
+            ff::resource_object_base* obj = value->is_type<ff::resource_object_base>() ? value->get<ff::resource_object_base>().get() : nullptr;
+
+            if (obj && obj_to_task.try_emplace(obj, graph.size()).second)
+            {
+                graph.add_task([this, name, obj]()
+                    {
+                        this->push_path(name);
+                        bool result = this->finish_loading_object(obj);
+
+                        if (!result)
+                        {
+                            this->add_error("Failed to finish loading resource");
+                        }
+
+                        this->pop_path();
+                        return result;
+                    });
+            }
+        }
+
+        for (auto& [obj, task_id] : obj_to_task)
+        {
+            for (std::shared_ptr<ff::resource> dep : obj->resource_get_dependencies())
+            {
+                std::shared_ptr<ff::resource_object_base> dep_obj = dep ? dep->value()->convert_or_default<ff::resource_object_base>()->get<ff::resource_object_base>() : nullptr;
+                auto i = dep_obj ? obj_to_task.find(dep_obj.get()) : obj_to_task.end();
+
+                if (i != obj_to_task.end() && i->second != task_id)
+                {
+                    graph.add_dependency(task_id, i->second);
+                }
+            }
+        }
+
+        graph.run();
+    }
+
 protected:
     virtual ff::value_ptr transform_value(ff::value_ptr value) override
     {
@@ -664,7 +1013,7 @@ private:
                 }
             }
 
-            result = obj->resource_load_complete(true);
+            result = obj->resource_load_complete(!this->context().is_cached_object(obj));
         }
 
         // Done
@@ -752,6 +1101,22 @@ public:
     using transformer_base::transformer_base;
 
 protected:
+    virtual ff::value_ptr transform_root_value(ff::value_ptr value) override
+    {
+        std::shared_ptr<ff::resource_object_base> obj = (value && value->is_type<ff::resource_object_base>()) ? value->get<ff::resource_object_base>() : nullptr;
+        value = transformer_base::transform_root_value(value);
+
+        ff::resource_build_cache* cache = this->context().build_cache();
+        const size_t hash = (cache && obj && !this->context().is_cached_object(obj.get())) ? this->context().build_hash(this->path()) : 0;
+
+        if (hash && value && value->is_type<ff::dict>())
+        {
+            cache->save(hash, value->get<ff::dict>());
+        }
+
+        return value;
+    }
+
     virtual ff::value_ptr transform_value(ff::value_ptr value) override
     {
         value = transformer_base::transform_value(value);
@@ -778,11 +1143,11 @@ protected:
     }
 };
 
-ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug)
+ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug, ff::resource_build_cache* build_cache)
 {
     ff::dict dict = json_dict;
 
-    ::transformer_context context(base_path, debug);
+    ::transformer_context context(base_path, debug, build_cache);
     ::expand_file_paths_transformer t1(context);
     ::expand_values_and_templates_transformer t2(context);
     ::start_load_objects_from_dict_transformer t3(context);
@@ -793,6 +1158,15 @@ ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict
 
     for (transformer_base* transformer : transformers)
     {
+        if (transformer == &t3)
+        {
+            t3.hash_root_objects(dict);
+        }
+        else if (transformer == &t5)
+        {
+            t5.finish_root_objects(dict);
+        }
+
         std::vector<std::string> errors;
         ff::value_ptr new_dict_value = ff::type::try_get_dict_from_data(transformer->visit_dict(dict, errors));
 
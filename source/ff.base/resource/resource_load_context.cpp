@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "resource/resource_load_context.h"
 
+ff::resource_build_cache* ff::resource_load_context::build_cache() const
+{
+    return nullptr;
+}
+
 ff::resource_load_context& ff::resource_load_context::null()
 {
     class null_context : public ff::resource_load_context
@@ -3,6 +3,7 @@
 namespace ff
 {
     class data_base;
+    class resource_build_cache;
 
     class resource_load_context
     {
@@ -12,6 +13,7 @@ namespace ff
         virtual void add_error(std::string_view text) = 0;
         virtual void add_output_file(std::string_view name, const std::shared_ptr<ff::data_base>& data) = 0;
         virtual bool debug() const = 0;
+        virtual ff::resource_build_cache* build_cache() const; // only when compiling from source, can be nullptr
 
         static resource_load_context& null();
     };
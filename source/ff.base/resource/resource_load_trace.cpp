@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "data_persist/dict.h"
+#include "data_persist/filesystem.h"
+#include "data_persist/json_persist.h"
+#include "data_value/dict_v.h"
+#include "data_value/double_v.h"
+#include "data_value/int_v.h"
+#include "data_value/string_v.h"
+#include "data_value/value_vector_v.h"
+#include "resource/resource_load_trace.h"
+#include "types/timer.h"
+
+namespace
+{
+    struct resource_times_t
+    {
+        std::vector<std::string_view> dependencies;
+        int64_t queued{};
+        int64_t started{};
+        int64_t created{};
+        int64_t finalized{};
+        DWORD started_thread_id{};
+        size_t id{};
+    };
+}
+
+static std::string_view event_type_name(ff::resource_load_trace::event_type type)
+{
+    switch (type)
+    {
+        case ff::resource_load_trace::event_type::queued: return "queued";
+        case ff::resource_load_trace::event_type::started: return "started";
+        case ff::resource_load_trace::event_type::decompressed: return "decompressed";
+        case ff::resource_load_trace::event_type::blocked: return "blocked";
+        case ff::resource_load_trace::event_type::created: return "created";
+        case ff::resource_load_trace::event_type::finalized: return "finalized";
+        default: return "unknown";
+    }
+}
+
+// Collects the times for each resource from a list of events, names are views into the events
+static std::unordered_map<std::string_view, ::resource_times_t> get_resource_times(const std::vector<ff::resource_load_trace::event_t>& events)
+{
+    std::unordered_map<std::string_view, ::resource_times_t> result;
+
+    for (const ff::resource_load_trace::event_t& event : events)
+    {
+        auto [i, inserted] = result.try_emplace(event.name);
+        ::resource_times_t& times = i->second;
+
+        if (inserted)
+        {
+            times.id = result.size();
+        }
+
+        switch (event.type)
+        {
+            case ff::resource_load_trace::event_type::queued:
+                times.queued = times.queued ? times.queued : event.time;
+                break;
+
+            case ff::resource_load_trace::event_type::started:
+                times.started = event.time;
+                times.started_thread_id = event.thread_id;
+                break;
+
+            case ff::resource_load_trace::event_type::blocked:
+                times.dependencies.push_back(event.detail);
+                break;
+
+            case ff::resource_load_trace::event_type::created:
+                times.created = event.time;
+                break;
+
+            case ff::resource_load_trace::event_type::finalized:
+                times.finalized = event.time;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return result;
+}
+
+static double to_milliseconds(int64_t start, int64_t end)
+{
+    return (start && end) ? ff::timer::seconds_between_raw(start, end) * 1000.0 : 0.0;
+}
+
+ff::resource_load_trace::resource_load_trace()
+    : start_time(ff::timer::current_raw_time())
+{}
+
+void ff::resource_load_trace::add(ff::resource_load_trace::event_type type, std::string_view name, std::string_view detail)
+{
+    ff::resource_load_trace::event_t event{ std::string(name), std::string(detail), ff::timer::current_raw_time(), ::GetCurrentThreadId(), type };
+
+    std::scoped_lock lock(this->mutex);
+    this->events_.push_back(std::move(event));
+}
+
+std::vector<ff::resource_load_trace::event_t> ff::resource_load_trace::events() const
+{
+    std::scoped_lock lock(this->mutex);
+    return this->events_;
+}
+
+void ff::resource_load_trace::clear()
+{
+    std::scoped_lock lock(this->mutex);
+    this->events_.clear();
+    this->start_time = ff::timer::current_raw_time();
+}
+
+ff::resource_load_trace::critical_path_t ff::resource_load_trace::critical_path() const
+{
+    ff::resource_load_trace::critical_path_t result{};
+    std::vector<ff::resource_load_trace::event_t> events = this->events();
+    std::unordered_map<std::string_view, ::resource_times_t> times = ::get_resource_times(events);
+
+    // Start from the last resource to finish, then keep following whichever dependency finished last
+    auto last = std::max_element(times.cbegin(), times.cend(),
+        [](const auto& l, const auto& r)
+        {
+            return l.second.finalized < r.second.finalized;
+        });
+
+    std::unordered_set<std::string_view> visited;
+    for (auto i = last; i != times.cend() && i->second.finalized && visited.insert(i->first).second; )
+    {
+        result.names.emplace_back(i->first);
+        auto next = times.cend();
+
+        for (std::string_view dependency : i->second.dependencies)
+        {
+            auto dep = times.find(dependency);
+            if (dep != times.cend() && (next == times.cend() || dep->second.finalized > next->second.finalized))
+            {
+                next = dep;
+            }
+        }
+
+        i = next;
+    }
+
+    if (!result.names.empty())
+    {
+        std::reverse(result.names.begin(), result.names.end());
+        const ::resource_times_t& first = times[result.names.front()];
+        result.seconds = ::to_milliseconds(first.queued ? first.queued : first.started, last->second.finalized) / 1000.0;
+    }
+
+    return result;
+}
+
+std::string ff::resource_load_trace::summary() const
+{
+    std::vector<ff::resource_load_trace::event_t> events = this->events();
+    std::unordered_map<std::string_view, ::resource_times_t> times = ::get_resource_times(events);
+    ff::resource_load_trace::critical_path_t path = this->critical_path();
+
+    int64_t first_time = 0, last_time = 0;
+    for (const ff::resource_load_trace::event_t& event : events)
+    {
+        first_time = first_time ? std::min(first_time, event.time) : event.time;
+        last_time = std::max(last_time, event.time);
+    }
+
+    std::ostringstream output;
+    output << std::fixed << std::setprecision(1);
+    output << "Resources: " << times.size() << ", total: " << ::to_milliseconds(first_time, last_time) << "ms\n";
+    output << "Critical path: " << path.seconds * 1000.0 << "ms\n";
+
+    for (const std::string& name : path.names)
+    {
+        const ::resource_times_t& info = times[name];
+        output << "  " << name
+            << " (wait: " << ::to_milliseconds(info.queued, info.started)
+            << "ms, load: " << ::to_milliseconds(info.started, info.created)
+            << "ms, blocked: " << ::to_milliseconds(info.created, info.finalized) << "ms)\n";
+    }
+
+    return output.str();
+}
+
+void ff::resource_load_trace::write_chrome_trace(std::ostream& output) const
+{
+    std::vector<ff::resource_load_trace::event_t> events = this->events();
+    std::unordered_map<std::string_view, ::resource_times_t> times = ::get_resource_times(events);
+    const int pid = static_cast<int>(::GetCurrentProcessId());
+    int64_t start_time;
+    {
+        std::scoped_lock lock(this->mutex);
+        start_time = this->start_time;
+    }
+
+    auto to_microseconds = [start_time](int64_t time)
+        {
+            return ff::timer::seconds_between_raw(start_time, time) * 1000000.0;
+        };
+
+    auto create_event = [pid](std::string_view name, std::string_view phase, double time, DWORD thread_id)
+        {
+            ff::dict dict;
+            dict.set<std::string>("name", std::string(name));
+            dict.set<std::string>("cat", "resource");
+            dict.set<std::string>("ph", std::string(phase));
+            dict.set<double>("ts", time);
+            dict.set<int>("pid", pid);
+            dict.set<int>("tid", static_cast<int>(thread_id));
+            return dict;
+        };
+
+    ff::value_vector trace_events;
+
+    for (auto& [name, info] : times)
+    {
+        // Whole lifetime, from queued to finalized, as an async span since it crosses threads
+        if (info.queued && info.finalized)
+        {
+            for (const auto& [phase, time] : { std::make_pair("b", info.queued), std::make_pair("e", info.finalized) })
+            {
+                ff::dict dict = create_event(name, phase, to_microseconds(time), info.started_thread_id);
+                dict.set<int>("id", static_cast<int>(info.id));
+                trace_events.push_back(ff::value::create<ff::dict>(std::move(dict)));
+            }
+        }
+
+        // Actual work on a pool thread
+        if (info.started && info.created)
+        {
+            ff::dict dict = create_event(name, "X", to_microseconds(info.started), info.started_thread_id);
+            dict.set<double>("dur", to_microseconds(info.created) - to_microseconds(info.started));
+            trace_events.push_back(ff::value::create<ff::dict>(std::move(dict)));
+        }
+    }
+
+    for (const ff::resource_load_trace::event_t& event : events)
+    {
+        std::ostringstream name;
+        name << ::event_type_name(event.type) << ": " << event.name;
+
+        ff::dict dict = create_event(name.str(), "i", to_microseconds(event.time), event.thread_id);
+        dict.set<std::string>("s", "t");
+
+        if (!event.detail.empty())
+        {
+            ff::dict args;
+            args.set<std::string>("detail", std::string(event.detail));
+            dict.set<ff::dict>("args", std::move(args));
+        }
+
+        trace_events.push_back(ff::value::create<ff::dict>(std::move(dict)));
+    }
+
+    ff::dict dict;
+    dict.set<ff::value_vector>("traceEvents", std::move(trace_events));
+    dict.set<std::string>("displayTimeUnit", "ms");
+    ff::json_write(dict, output);
+}
+
+bool ff::resource_load_trace::save_chrome_trace(const std::filesystem::path& path) const
+{
+    std::ostringstream output;
+    this->write_chrome_trace(output);
+
+    std::string text = output.str();
+    return ff::filesystem::write_binary_file(path, text.data(), text.size());
+}
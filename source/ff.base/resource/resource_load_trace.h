@@ -0,0 +1,59 @@
+#pragma once
+
+namespace ff
+{
+    /// <summary>
+    /// Thread-safe timeline of resource load events, shared by any resource_objects that it's attached to.
+    /// Exports Chrome trace-event JSON (chrome://tracing or ui.perfetto.dev) and finds the critical path.
+    /// </summary>
+    class resource_load_trace
+    {
+    public:
+        enum class event_type
+        {
+            queued, // requested, waiting for a pool thread
+            started, // a pool thread started loading
+            decompressed, // saved data was loaded and uncompressed
+            blocked, // waiting for another resource to finish, detail is the other resource name
+            created, // resource objects were created, may still be blocked
+            finalized, // resource value is ready to use
+        };
+
+        struct event_t
+        {
+            std::string name;
+            std::string detail;
+            int64_t time; // raw ff::timer time
+            DWORD thread_id;
+            ff::resource_load_trace::event_type type;
+        };
+
+        struct critical_path_t
+        {
+            std::vector<std::string> names; // from first to finish, to last to finish
+            double seconds; // from the first one being queued to the last one being finalized
+        };
+
+        resource_load_trace();
+        resource_load_trace(resource_load_trace&& other) noexcept = delete;
+        resource_load_trace(const resource_load_trace& other) = delete;
+
+        resource_load_trace& operator=(resource_load_trace&& other) noexcept = delete;
+        resource_load_trace& operator=(const resource_load_trace& other) = delete;
+
+        void add(ff::resource_load_trace::event_type type, std::string_view name, std::string_view detail = {});
+        std::vector<ff::resource_load_trace::event_t> events() const;
+        void clear();
+
+        ff::resource_load_trace::critical_path_t critical_path() const;
+        std::string summary() const;
+
+        void write_chrome_trace(std::ostream& output) const;
+        bool save_chrome_trace(const std::filesystem::path& path) const;
+
+    private:
+        mutable std::mutex mutex;
+        std::vector<ff::resource_load_trace::event_t> events_;
+        int64_t start_time;
+    };
+}
@@ -9,3 +9,8 @@ std::string_view ff::resource_object_factory_base::name() const
 {
     return this->name_;
 }
+
+size_t ff::resource_object_factory_base::build_version() const
+{
+    return 0;
+}
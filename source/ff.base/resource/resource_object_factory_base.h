@@ -19,6 +19,9 @@ namespace ff
         virtual std::shared_ptr<resource_object_base> load_from_source(const ff::dict& dict, resource_load_context& context) const = 0;
         virtual std::shared_ptr<resource_object_base> load_from_cache(const ff::dict& dict) const = 0;
 
+        // Change this whenever load_from_source output changes, so that stale build cache entries aren't used
+        virtual size_t build_version() const;
+
     private:
         std::string name_;
     };
@@ -26,6 +26,82 @@ static const size_t RESOURCE_PERSIST_COOKIE = ff::stable_hash_func("ff::resource
 static const size_t RESOURCE_PERSIST_HEADER = ff::stable_hash_func("ff::resource_objects::header@0"sv);
 static const size_t RESOURCE_PERSIST_METADATA = ff::stable_hash_func("ff::resource_objects::metadata@0"sv);
 static const size_t RESOURCE_PERSIST_DATA = ff::stable_hash_func("ff::resource_objects::data@0"sv);
+static const size_t RESOURCE_PERSIST_COOKIE_MAPPED = ff::stable_hash_func("ff::resource_objects@1"sv);
+static const size_t PREFETCH_BATCH_SIZE = 32 * 1024 * 1024; // saved bytes per merged read
+
+namespace
+{
+    // Packs are saved in a format that can be used in place from memory, so opening one only needs to validate
+    // this header. The cookie comes first, then this header, the entries sorted by name, the names, the metadata,
+    // and then the data for each resource. All offsets are from the start of the pack.
+    struct mapped_pack_header_t
+    {
+        uint64_t resource_count;
+        uint64_t names_offset;
+        uint64_t names_size;
+        uint64_t metadata_offset;
+        uint64_t metadata_size;
+        uint64_t reserved;
+    };
+
+    struct mapped_pack_entry_t
+    {
+        uint64_t name_offset; // from names_offset
+        uint64_t name_size;
+        uint64_t data_offset;
+        uint64_t saved_size;
+        uint64_t loaded_size;
+        uint64_t saved_type;
+    };
+
+    constexpr size_t MAPPED_PACK_ENTRIES_OFFSET = sizeof(uint64_t) + sizeof(::mapped_pack_header_t);
+}
+
+struct ff::resource_objects::mapped_pack_t
+{
+    std::shared_ptr<ff::data_base> data;
+    const ::mapped_pack_entry_t* entries;
+    const char* names;
+    size_t names_size;
+    size_t size;
+
+    std::string_view name(size_t index) const
+    {
+        const ::mapped_pack_entry_t& entry = this->entries[index];
+        return (entry.name_offset <= this->names_size && entry.name_size <= this->names_size - entry.name_offset)
+            ? std::string_view(this->names + entry.name_offset, static_cast<size_t>(entry.name_size))
+            : std::string_view{};
+    }
+
+    // Returns this->size when the name isn't found
+    size_t find(std::string_view name) const
+    {
+        size_t low = 0, high = this->size;
+        while (low < high)
+        {
+            const size_t mid = low + (high - low) / 2;
+            if (this->name(mid) < name)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        return (low < this->size && this->name(low) == name) ? low : this->size;
+    }
+
+    std::shared_ptr<ff::saved_data_base> saved_data(size_t index) const
+    {
+        const ::mapped_pack_entry_t& entry = this->entries[index];
+        assert_ret_val(entry.data_offset <= this->data->size() && entry.saved_size <= this->data->size() - entry.data_offset, nullptr);
+
+        std::shared_ptr<ff::data_base> subdata = this->data->subdata(static_cast<size_t>(entry.data_offset), static_cast<size_t>(entry.saved_size));
+        return std::make_shared<ff::saved_data_static>(subdata, static_cast<size_t>(entry.loaded_size), static_cast<ff::saved_data_type>(entry.saved_type & 0xFF));
+    }
+};
 
 static ff::value_ptr load_typed_value(std::shared_ptr<ff::saved_data_base> saved_data)
 {
@@ -40,6 +116,17 @@ static ff::value_ptr load_typed_value(std::shared_ptr<ff::saved_data_base> saved
     return value;
 }
 
+static ff::value_ptr load_typed_value(std::shared_ptr<ff::data_base> loaded_data)
+{
+    assert_ret_val(loaded_data, nullptr);
+
+    ff::data_reader reader(loaded_data);
+    auto value = ff::value::load_typed(reader);
+    assert_ret_val(value, nullptr);
+
+    return value;
+}
+
 ff::resource_objects::resource_objects()
     : loading_count(0)
     , done_loading_event(true)
@@ -93,6 +180,11 @@ void ff::resource_objects::add_resources(const ff::resource_objects& other)
     {
         this->try_add_resource(name, other_info.saved_value);
     }
+
+    for (auto& pack : other.mapped_packs)
+    {
+        this->mapped_packs.push_back(pack);
+    }
 }
 
 bool ff::resource_objects::add_resources(ff::reader_base& reader)
@@ -100,8 +192,36 @@ bool ff::resource_objects::add_resources(ff::reader_base& reader)
     std::vector<std::tuple<std::string, size_t, size_t, size_t, size_t>> resource_datas;
     std::shared_ptr<ff::saved_data_base> metadata_saved;
 
+    const size_t pack_start = reader.pos();
     size_t cookie;
-    assert_ret_val(ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_COOKIE, false);
+    assert_ret_val(ff::load(reader, cookie) && (cookie == ::RESOURCE_PERSIST_COOKIE || cookie == ::RESOURCE_PERSIST_COOKIE_MAPPED), false);
+
+    if (cookie == ::RESOURCE_PERSIST_COOKIE_MAPPED)
+    {
+        // The reader can't be used in place, so read the index into memory and add every resource now
+        ::mapped_pack_header_t header;
+        assert_ret_val(ff::load_bytes(reader, &header, sizeof(header)) && header.resource_count <= reader.size() / sizeof(::mapped_pack_entry_t), false);
+
+        std::vector<::mapped_pack_entry_t> entries(static_cast<size_t>(header.resource_count));
+        std::string names(static_cast<size_t>(header.names_size), '\0');
+        assert_ret_val(ff::load_bytes(reader, entries.data(), entries.size() * sizeof(::mapped_pack_entry_t)), false);
+        assert_ret_val(reader.pos(pack_start + static_cast<size_t>(header.names_offset)) == pack_start + header.names_offset && reader.read(names.data(), names.size()) == names.size(), false);
+
+        std::scoped_lock lock(this->resource_mutex);
+        this->resource_metadata_saved->push_back(reader.saved_data(pack_start + static_cast<size_t>(header.metadata_offset),
+            static_cast<size_t>(header.metadata_size), static_cast<size_t>(header.metadata_size), ff::saved_data_type::none));
+
+        for (const ::mapped_pack_entry_t& entry : entries)
+        {
+            assert_ret_val(entry.name_offset <= names.size() && entry.name_size <= names.size() - entry.name_offset, false);
+            std::string_view name = std::string_view(names).substr(static_cast<size_t>(entry.name_offset), static_cast<size_t>(entry.name_size));
+            ff::saved_data_type data_type = static_cast<ff::saved_data_type>(entry.saved_type & 0xFF);
+            this->try_add_resource(name, reader.saved_data(pack_start + static_cast<size_t>(entry.data_offset),
+                static_cast<size_t>(entry.saved_size), static_cast<size_t>(entry.loaded_size), data_type));
+        }
+
+        return true;
+    }
 
     // Read header and metadata
     {
@@ -150,6 +270,20 @@ bool ff::resource_objects::add_resources(ff::reader_base& reader)
     return true;
 }
 
+bool ff::resource_objects::add_resources(const std::shared_ptr<ff::data_base>& data)
+{
+    assert_ret_val(data && data->size() >= sizeof(uint64_t), false);
+
+    if (*reinterpret_cast<const uint64_t*>(data->data()) == ::RESOURCE_PERSIST_COOKIE_MAPPED)
+    {
+        return this->add_mapped_resources(data);
+    }
+
+    // Older format needs to be parsed
+    ff::data_reader reader(data);
+    return this->add_resources(reader);
+}
+
 bool ff::resource_objects::add_files(const std::filesystem::path& path)
 {
     std::vector<std::filesystem::path> files;
@@ -171,8 +305,9 @@ bool ff::resource_objects::add_files(const std::filesystem::path& path)
 
     for (const auto& file : files)
     {
-        ff::file_reader reader(file);
-        assert_ret_val(reader && this->add_resources(reader), false);
+        // Packs are used in place, so each file stays mapped (and locked) while its resources are alive
+        std::shared_ptr<ff::data_base> data = ff::filesystem::map_binary_file(file);
+        assert_ret_val(data && this->add_resources(data), false);
     }
 
     return true;
@@ -264,6 +399,18 @@ void ff::resource_objects::add_metadata_only(const ff::dict& dict) const
 
 // caller must own resource_mutex
 bool ff::resource_objects::try_add_resource(std::string_view name, std::shared_ptr<ff::saved_data_base> data)
+{
+    if (this->resource_infos.find(name) == this->resource_infos.cend() && this->find_mapped_resource(name))
+    {
+        ff::log::write(ff::log::type::resource_load, "Duplicate resource: ", name);
+        return false;
+    }
+
+    return this->add_resource_info(name, std::move(data));
+}
+
+// caller must own resource_mutex
+bool ff::resource_objects::add_resource_info(std::string_view name, std::shared_ptr<ff::saved_data_base> data)
 {
     ff::resource_objects::resource_object_info info{ std::make_unique<std::string>(name), std::move(data) };
     if (!this->resource_infos.try_emplace(*info.name, std::move(info)).second)
@@ -275,6 +422,66 @@ bool ff::resource_objects::try_add_resource(std::string_view name, std::shared_p
     return true;
 }
 
+bool ff::resource_objects::add_mapped_resources(const std::shared_ptr<ff::data_base>& data)
+{
+    const size_t size = data->size();
+    assert_ret_val(size >= ::MAPPED_PACK_ENTRIES_OFFSET, false);
+
+    const ::mapped_pack_header_t& header = *reinterpret_cast<const ::mapped_pack_header_t*>(data->data() + sizeof(uint64_t));
+    assert_ret_val(header.resource_count <= (size - ::MAPPED_PACK_ENTRIES_OFFSET) / sizeof(::mapped_pack_entry_t) &&
+        header.names_offset <= size && header.names_size <= size - header.names_offset &&
+        header.metadata_offset <= size && header.metadata_size <= size - header.metadata_offset, false);
+
+    auto pack = std::make_shared<ff::resource_objects::mapped_pack_t>();
+    pack->data = data;
+    pack->entries = reinterpret_cast<const ::mapped_pack_entry_t*>(data->data() + ::MAPPED_PACK_ENTRIES_OFFSET);
+    pack->names = reinterpret_cast<const char*>(data->data() + header.names_offset);
+    pack->names_size = static_cast<size_t>(header.names_size);
+    pack->size = static_cast<size_t>(header.resource_count);
+
+    std::shared_ptr<ff::data_base> metadata = data->subdata(static_cast<size_t>(header.metadata_offset), static_cast<size_t>(header.metadata_size));
+
+    std::scoped_lock lock(this->resource_mutex);
+    this->resource_metadata_saved->push_back(std::make_shared<ff::saved_data_static>(metadata, metadata->size(), ff::saved_data_type::none));
+    this->mapped_packs.push_back(std::move(pack));
+
+    return true;
+}
+
+// caller must own resource_mutex
+std::shared_ptr<ff::saved_data_base> ff::resource_objects::find_mapped_resource(std::string_view name) const
+{
+    for (auto& pack : this->mapped_packs)
+    {
+        const size_t index = pack->find(name);
+        if (index != pack->size)
+        {
+            return pack->saved_data(index);
+        }
+    }
+
+    return nullptr;
+}
+
+// caller must own resource_mutex
+std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> ff::resource_objects::saved_resources() const
+{
+    std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> result;
+
+    for (std::string_view name : this->resource_object_names())
+    {
+        auto i = this->resource_infos.find(name);
+        std::shared_ptr<ff::saved_data_base> saved_value = (i != this->resource_infos.cend()) ? i->second.saved_value : this->find_mapped_resource(name);
+
+        if (saved_value)
+        {
+            result.push_back(std::make_pair(name, std::move(saved_value)));
+        }
+    }
+
+    return result;
+}
+
 // caller must own resource_mutex
 ff::dict& ff::resource_objects::resource_metadata() const
 {
@@ -300,12 +507,11 @@ ff::dict& ff::resource_objects::resource_metadata() const
 bool ff::resource_objects::save(ff::writer_base& writer) const
 {
     // Collect the memory for each resource
-    std::vector<std::tuple<std::string_view, std::shared_ptr<ff::saved_data_base>>> resource_datas;
+    std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> resource_datas;
     std::shared_ptr<ff::data_base> metadata_data;
-    size_t full_size_guess = sizeof(size_t) * 8; // cookies and sizes
     {
         std::scoped_lock lock(this->resource_mutex);
-        resource_datas.reserve(this->resource_infos.size());
+        resource_datas = this->saved_resources();
 
         // Save metadata, and reuse old saved metadata if possible
         if (this->resource_metadata_dict->empty() && this->resource_metadata_saved->size() == 1)
@@ -321,53 +527,63 @@ bool ff::resource_objects::save(ff::writer_base& writer) const
             ff::value_ptr dict_value = ff::value::create<ff::dict>(std::move(resource_metadata));
             assert_ret_val(dict_value->save_typed(metadata_writer), false);
         }
+    }
 
-        full_size_guess += metadata_data->size();
+    std::sort(resource_datas.begin(), resource_datas.end(),
+        [](const auto& l, const auto& r)
+        {
+            return l.first < r.first;
+        });
+
+    // Compute the layout
+    ::mapped_pack_header_t header{};
+    std::vector<::mapped_pack_entry_t> entries;
+    entries.reserve(resource_datas.size());
+    {
+        header.resource_count = resource_datas.size();
+        header.names_offset = ::MAPPED_PACK_ENTRIES_OFFSET + resource_datas.size() * sizeof(::mapped_pack_entry_t);
 
-        for (auto& [name, info] : this->resource_infos)
+        for (auto& [name, saved_data] : resource_datas)
         {
-            resource_datas.push_back(std::make_tuple(name, info.saved_value));
-            full_size_guess += name.size() + info.saved_value->saved_size() + sizeof(size_t) * 6;
+            ::mapped_pack_entry_t& entry = entries.emplace_back();
+            entry.name_offset = header.names_size;
+            entry.name_size = name.size();
+            entry.saved_size = saved_data->saved_size();
+            entry.loaded_size = saved_data->loaded_size();
+            entry.saved_type = static_cast<uint64_t>(saved_data->type());
+            header.names_size += name.size();
         }
-    }
 
-    writer.reserve(full_size_guess);
-    assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_COOKIE), false);
+        header.metadata_offset = header.names_offset + header.names_size + ff::save_padding_size(static_cast<size_t>(header.names_size));
+        header.metadata_size = metadata_data->size();
 
-    // Write header
+        uint64_t data_offset = header.metadata_offset + header.metadata_size + ff::save_padding_size(metadata_data->size());
+        for (::mapped_pack_entry_t& entry : entries)
+        {
+            entry.data_offset = data_offset;
+            data_offset += entry.saved_size + ff::save_padding_size(static_cast<size_t>(entry.saved_size));
+        }
+
+        writer.reserve(static_cast<size_t>(data_offset));
+    }
+
+    // Write header, index, and names
     {
-        const size_t size = resource_datas.size();
-        assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_HEADER) && ff::save(writer, size), false);
+        assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_COOKIE_MAPPED) &&
+            ff::save_bytes(writer, &header, sizeof(header)) &&
+            ff::save_bytes(writer, entries.data(), entries.size() * sizeof(::mapped_pack_entry_t)), false);
 
-        size_t data_offset = 0;
         for (auto& [name, saved_data] : resource_datas)
         {
-            const size_t saved_size = saved_data->saved_size();
-            const size_t loaded_size = saved_data->loaded_size();
-            const size_t saved_type = static_cast<size_t>(saved_data->type());
-            assert_ret_val(
-                ff::save(writer, name) &&
-                ff::save(writer, data_offset) &&
-                ff::save(writer, saved_size) &&
-                ff::save(writer, loaded_size) &&
-                ff::save(writer, saved_type), false);
-            data_offset += saved_size + ff::save_padding_size(saved_size);
+            assert_ret_val(writer.write(name.data(), name.size()) == name.size(), false);
         }
-    }
 
-    // Write metadata
-    {
-        const size_t size = metadata_data->size(), data_flags = 0;
-        assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_METADATA) &&
-            ff::save(writer, size) &&
-            ff::save(writer, size) &&
-            ff::save(writer, data_flags), false);
-        assert_ret_val(ff::save_bytes(writer, *metadata_data), false);
+        assert_ret_val(ff::save_padding(writer, static_cast<size_t>(header.names_size)), false);
     }
 
-    // Write data
+    // Write metadata and data
     {
-        assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_DATA), false);
+        assert_ret_val(ff::save_bytes(writer, *metadata_data), false);
 
         for (auto& [name, saved_data] : resource_datas)
         {
@@ -384,9 +600,9 @@ bool ff::resource_objects::save(ff::dict& dict) const
     std::scoped_lock lock(this->resource_mutex);
     dict.set(this->resource_metadata(), false);
 
-    for (auto& [name, info] : this->resource_infos)
+    for (auto& [name, saved_value] : this->saved_resources())
     {
-        ff::value_ptr dict_value = ::load_typed_value(info.saved_value);
+        ff::value_ptr dict_value = ::load_typed_value(saved_value);
         assert_ret_val(dict_value, false);
         dict.set(name, dict_value);
     }
@@ -447,6 +663,126 @@ std::vector<std::pair<std::string, std::shared_ptr<ff::data_base>>> ff::resource
     return result;
 }
 
+void ff::resource_objects::start_prefetch_recording()
+{
+    std::scoped_lock lock(this->resource_mutex);
+    this->prefetch_recording = std::make_unique<ff::resource_prefetch_manifest>();
+    this->prefetch_recording_start = ff::timer::current_raw_time();
+
+    for (auto& [name, info] : this->resource_infos)
+    {
+        info.prefetch_recorded = false;
+    }
+}
+
+ff::resource_prefetch_manifest ff::resource_objects::stop_prefetch_recording()
+{
+    std::scoped_lock lock(this->resource_mutex);
+    ff::resource_prefetch_manifest manifest;
+
+    if (this->prefetch_recording)
+    {
+        manifest = std::move(*this->prefetch_recording);
+        this->prefetch_recording.reset();
+    }
+
+    return manifest;
+}
+
+bool ff::resource_objects::is_prefetch_recording() const
+{
+    std::scoped_lock lock(this->resource_mutex);
+    return this->prefetch_recording != nullptr;
+}
+
+ff::co_task<std::vector<std::shared_ptr<ff::resource>>> ff::resource_objects::prefetch_async(ff::resource_prefetch_manifest manifest)
+{
+    // File reads happen on the thread pool, the caller must keep the resources alive until they are needed
+    co_await ff::task::resume_on_task();
+
+    std::vector<std::shared_ptr<ff::resource>> resources;
+    resources.reserve(manifest.size());
+
+    const std::vector<ff::resource_prefetch_manifest::entry_t>& entries = manifest.entries();
+    std::vector<std::shared_ptr<ff::saved_data_base>> saved_values;
+
+    for (size_t start = 0; start < entries.size(); )
+    {
+        // Read the saved data for everything that isn't loaded yet, so resources from the same pack file get merged
+        // into a few big reads instead of one small read each. Batches are limited so that all the data isn't in memory at once.
+        size_t end = start;
+        size_t batch_size = 0;
+        saved_values.clear();
+        {
+            std::scoped_lock lock(this->resource_mutex);
+
+            for (; end < entries.size() && (end == start || batch_size < ::PREFETCH_BATCH_SIZE); end++)
+            {
+                std::shared_ptr<ff::saved_data_base> saved_value;
+
+                auto i = this->resource_infos.find(entries[end].name);
+                if (i == this->resource_infos.cend())
+                {
+                    saved_value = this->find_mapped_resource(entries[end].name);
+                }
+                else if (i->second.weak_value.expired())
+                {
+                    saved_value = i->second.saved_value;
+                }
+
+                batch_size += saved_value ? saved_value->saved_size() : 0;
+                saved_values.push_back(std::move(saved_value));
+            }
+        }
+
+        saved_values = co_await ff::saved_data_file::read_batch_async(std::move(saved_values));
+
+        std::scoped_lock lock(this->resource_mutex);
+
+        for (size_t i = start; i < end; i++)
+        {
+            std::shared_ptr<ff::resource> resource = this->get_resource_object_here(entries[i].name, saved_values[i - start]);
+            if (resource)
+            {
+                resources.push_back(std::move(resource));
+            }
+            else
+            {
+                ff::log::write(ff::log::type::resource_load, "Prefetch resource missing: ", entries[i].name);
+            }
+        }
+
+        start = end;
+    }
+
+    co_return resources;
+}
+
+ff::co_task<std::vector<std::shared_ptr<ff::resource>>> ff::resource_objects::prefetch_async(std::filesystem::path manifest_path)
+{
+    co_await ff::task::resume_on_task();
+
+    ff::resource_prefetch_manifest manifest;
+    if (!manifest.load(manifest_path))
+    {
+        co_return std::vector<std::shared_ptr<ff::resource>>();
+    }
+
+    co_return co_await this->prefetch_async(std::move(manifest));
+}
+
+void ff::resource_objects::load_trace(const std::shared_ptr<ff::resource_load_trace>& trace)
+{
+    std::scoped_lock lock(this->resource_mutex);
+    this->load_trace_ = trace;
+}
+
+std::shared_ptr<ff::resource_load_trace> ff::resource_objects::load_trace() const
+{
+    std::scoped_lock lock(this->resource_mutex);
+    return this->load_trace_;
+}
+
 std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object(std::string_view name)
 {
     std::shared_ptr<ff::resource> value;
@@ -464,16 +800,32 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object(std::str
 }
 
 // Caller must own the this->resource_object_info_mutex lock
-std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std::string_view name)
+std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std::string_view name, const std::shared_ptr<ff::saved_data_base>& preloaded_value)
 {
     std::shared_ptr<ff::resource> resource_result;
 
     auto iter = this->resource_infos.find(name);
+    if (iter == this->resource_infos.cend())
+    {
+        // First request for a resource from a mapped pack
+        std::shared_ptr<ff::saved_data_base> saved_value = this->find_mapped_resource(name);
+        if (saved_value && this->add_resource_info(name, std::move(saved_value)))
+        {
+            iter = this->resource_infos.find(name);
+        }
+    }
+
     if (iter != this->resource_infos.cend())
     {
         ff::resource_objects::resource_object_info& info = iter->second;
         resource_result = info.weak_value.lock();
 
+        if (this->prefetch_recording && !info.prefetch_recorded)
+        {
+            info.prefetch_recorded = true;
+            this->prefetch_recording->add(name, ff::timer::seconds_since_raw(this->prefetch_recording_start));
+        }
+
         if (!resource_result)
         {
             if (this->loading_count.fetch_add(1) == 0)
@@ -487,6 +839,8 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std
             loading_info->loading_resource = resource_result;
             loading_info->name = name;
             loading_info->owner = &info;
+            loading_info->saved_value = preloaded_value ? preloaded_value : info.saved_value;
+            loading_info->trace = this->load_trace_;
             loading_info->start_time = ff::timer::current_raw_time();
             loading_info->blocked_count = 1;
 
@@ -495,12 +849,14 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std
 
             ff::log::write(ff::log::type::resource_load, "Loading: ", name);
 
+            if (loading_info->trace)
+            {
+                loading_info->trace->add(ff::resource_load_trace::event_type::queued, name);
+            }
+
             ff::thread_pool::add_task([this, loading_info]()
             {
-                ff::value_ptr dict_value = ::load_typed_value(loading_info->owner->saved_value);
-                ff::value_ptr new_value = this->create_resource_objects(loading_info, dict_value);
-                this->update_resource_object_info(loading_info, new_value);
-                // no code here since the destructor may be running
+                this->load_resource_async(loading_info);
             });
         }
     }
@@ -508,6 +864,33 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std
     return resource_result;
 }
 
+ff::co_task<> ff::resource_objects::load_resource_async(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info)
+{
+    ff::resource_load_trace* trace = loading_info->trace.get();
+    if (trace)
+    {
+        trace->add(ff::resource_load_trace::event_type::started, loading_info->name);
+    }
+
+    // Resources in a file are read with overlapped I/O, so no pool thread is blocked on the disk
+    std::shared_ptr<ff::saved_data_base> saved_value = loading_info->saved_value;
+    std::shared_ptr<ff::data_base> loaded_data = saved_value ? co_await saved_value->loaded_data_async() : nullptr;
+    ff::value_ptr dict_value = ::load_typed_value(loaded_data);
+    if (trace)
+    {
+        trace->add(ff::resource_load_trace::event_type::decompressed, loading_info->name);
+    }
+
+    ff::value_ptr new_value = this->create_resource_objects(loading_info, dict_value);
+    if (trace)
+    {
+        trace->add(ff::resource_load_trace::event_type::created, loading_info->name);
+    }
+
+    this->update_resource_object_info(loading_info, new_value);
+    // no code here since the destructor may be running
+}
+
 std::vector<std::string_view> ff::resource_objects::resource_object_names() const
 {
     std::scoped_lock lock(this->resource_mutex);
@@ -519,6 +902,23 @@ std::vector<std::string_view> ff::resource_objects::resource_object_names() cons
         names.push_back(i.first);
     }
 
+    if (!this->mapped_packs.empty())
+    {
+        std::unordered_set<std::string_view> unique_names(names.cbegin(), names.cend());
+
+        for (auto& pack : this->mapped_packs)
+        {
+            for (size_t i = 0; i < pack->size; i++)
+            {
+                std::string_view name = pack->name(i);
+                if (!name.empty() && unique_names.insert(name).second)
+                {
+                    names.push_back(name);
+                }
+            }
+        }
+    }
+
     return names;
 }
 
@@ -556,6 +956,11 @@ void ff::resource_objects::update_resource_object_info(std::shared_ptr<ff::resou
     if (loading_done)
     {
         loading_info->loading_resource->finalize_value(new_value);
+
+        if (loading_info->trace)
+        {
+            loading_info->trace->add(ff::resource_load_trace::event_type::finalized, loading_info->name);
+        }
         {
             std::scoped_lock lock(this->resource_mutex);
             loading_info->owner->weak_loading_info.reset();
@@ -651,6 +1056,11 @@ ff::value_ptr ff::resource_objects::create_resource_objects(std::shared_ptr<ff::
                     {
                         ff::log::write(ff::log::type::resource_load, "Blocking: '", loading_info->name, "' blocked by '", ref_loading_info->name, "'");
 
+                        if (loading_info->trace)
+                        {
+                            loading_info->trace->add(ff::resource_load_trace::event_type::blocked, loading_info->name, ref_loading_info->name);
+                        }
+
                         loading_info->blocked_count++;
                         ref_loading_info->parent_loading_infos.push_back(loading_info);
                     }
@@ -711,12 +1121,15 @@ ff::co_task<> ff::resource_objects::rebuild_async()
         ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::use_cache_in_memory, ff::constants::profile_build);
         if (result.resources)
         {
-            for (auto& [name, other_info] : result.resources->resource_infos)
+            // New resources replace old ones, even when the old ones are in a mapped pack
+            std::scoped_lock other_lock(result.resources->resource_mutex);
+            for (auto& [name, saved_value] : result.resources->saved_resources())
             {
                 this->resource_infos.erase(name);
+                this->add_resource_info(name, saved_value);
             }
 
-            this->add_resources(*result.resources);
+            this->add_metadata_only(result.resources->resource_metadata());
         }
     }
 
@@ -733,7 +1146,7 @@ ff::co_task<> ff::resource_objects::rebuild_async()
 std::shared_ptr<ff::resource_object_base> ff::internal::resource_objects_factory::load_from_source(const ff::dict& dict, resource_load_context& context) const
 {
     std::vector<std::string> errors;
-    ff::load_resources_result result = ff::load_resources_from_json(dict, context.base_path(), context.debug());
+    ff::load_resources_result result = ff::load_resources_from_json(dict, context.base_path(), context.debug(), context.build_cache());
 
     if (!result.errors.empty())
     {
@@ -756,10 +1169,12 @@ std::shared_ptr<ff::resource_object_base> ff::internal::resource_objects_factory
     std::shared_ptr<ff::saved_data_base> saved_data = dict.get<ff::saved_data_base>("resources");
     assert_ret_val(saved_data, nullptr);
 
-    auto reader = saved_data->loaded_reader();
-    assert_ret_val(reader, nullptr);
+    std::shared_ptr<ff::data_base> data = saved_data->loaded_data();
+    assert_ret_val(data, nullptr);
 
-    return std::make_shared<ff::resource_objects>(*reader);
+    auto resources = std::make_shared<ff::resource_objects>();
+    assert_ret_val(resources->add_resources(data), nullptr);
+    return resources;
 }
 
 bool ff::resource_objects::save_to_cache(ff::dict& dict) const
@@ -7,6 +7,8 @@
 #include "../resource/resource_object_base.h"
 #include "../resource/resource_object_provider.h"
 #include "../resource/resource_object_factory_base.h"
+#include "../resource/resource_load_trace.h"
+#include "../resource/resource_prefetch.h"
 #include "../thread/co_task.h"
 
 namespace ff
@@ -35,6 +37,7 @@ namespace ff
         void add_resources(const ff::dict& dict);
         void add_resources(const ff::resource_objects& other);
         bool add_resources(ff::reader_base& reader);
+        bool add_resources(const std::shared_ptr<ff::data_base>& data); // keeps a reference, resources are indexed in place
         bool add_files(const std::filesystem::path& path);
         bool save(ff::writer_base& writer) const;
         bool save(ff::dict& dict) const;
@@ -46,6 +49,17 @@ namespace ff
         std::vector<std::pair<std::string, std::string>> id_to_names(std::string_view source_namespace) const;
         std::vector<std::pair<std::string, std::shared_ptr<ff::data_base>>> output_files() const;
 
+        // Prefetch (records the order that resources are first requested, then replays it to warm them up)
+        void start_prefetch_recording();
+        ff::resource_prefetch_manifest stop_prefetch_recording();
+        bool is_prefetch_recording() const;
+        ff::co_task<std::vector<std::shared_ptr<ff::resource>>> prefetch_async(ff::resource_prefetch_manifest manifest);
+        ff::co_task<std::vector<std::shared_ptr<ff::resource>>> prefetch_async(std::filesystem::path manifest_path);
+
+        // Tracing (records load events for resources that start loading after this is set, can be shared)
+        void load_trace(const std::shared_ptr<ff::resource_load_trace>& trace);
+        std::shared_ptr<ff::resource_load_trace> load_trace() const;
+
         // ff::resource_object_loader
         virtual std::shared_ptr<ff::resource> get_resource_object(std::string_view name) override;
         virtual std::vector<std::string_view> resource_object_names() const override;
@@ -59,11 +73,16 @@ namespace ff
         void add_resources_only(const ff::dict& dict);
         void add_metadata_only(const ff::dict& dict) const;
         bool try_add_resource(std::string_view name, std::shared_ptr<ff::saved_data_base> data);
+        bool add_resource_info(std::string_view name, std::shared_ptr<ff::saved_data_base> data);
+        bool add_mapped_resources(const std::shared_ptr<ff::data_base>& data);
+        std::shared_ptr<ff::saved_data_base> find_mapped_resource(std::string_view name) const; // must be holding resource_mutex
+        std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> saved_resources() const; // must be holding resource_mutex
         ff::dict& resource_metadata() const; // must be holding resource_mutex
         void rebuild(ff::push_base<ff::co_task<>>& tasks);
         ff::co_task<> rebuild_async();
 
         struct resource_object_info;
+        struct mapped_pack_t;
 
         struct resource_object_loading_info
         {
@@ -73,6 +92,8 @@ namespace ff
             std::vector<std::shared_ptr<ff::resource_objects::resource_object_loading_info>> parent_loading_infos;
             std::string name;
             ff::resource_objects::resource_object_info* owner{};
+            std::shared_ptr<ff::saved_data_base> saved_value; // may already be read into memory
+            std::shared_ptr<ff::resource_load_trace> trace;
             int64_t start_time{};
             int blocked_count{};
         };
@@ -83,16 +104,22 @@ namespace ff
             std::shared_ptr<ff::saved_data_base> saved_value;
             std::weak_ptr<ff::resource> weak_value;
             std::weak_ptr<ff::resource_objects::resource_object_loading_info> weak_loading_info;
+            bool prefetch_recorded{};
         };
 
+        ff::co_task<> load_resource_async(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info);
         void update_resource_object_info(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info, ff::value_ptr new_value);
         ff::value_ptr create_resource_objects(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info, ff::value_ptr value);
-        std::shared_ptr<ff::resource> get_resource_object_here(std::string_view name);
+        std::shared_ptr<ff::resource> get_resource_object_here(std::string_view name, const std::shared_ptr<ff::saved_data_base>& preloaded_value = nullptr);
 
         mutable std::recursive_mutex resource_mutex;
         std::unique_ptr<std::vector<std::shared_ptr<ff::saved_data_base>>> resource_metadata_saved;
         std::unique_ptr<ff::dict> resource_metadata_dict;
         std::unordered_map<std::string_view, ff::resource_objects::resource_object_info> resource_infos;
+        std::vector<std::shared_ptr<const ff::resource_objects::mapped_pack_t>> mapped_packs; // resources that aren't in resource_infos yet
+        std::unique_ptr<ff::resource_prefetch_manifest> prefetch_recording;
+        int64_t prefetch_recording_start{};
+        std::shared_ptr<ff::resource_load_trace> load_trace_;
 
         std::atomic<int> loading_count;
         ff::win_event done_loading_event;
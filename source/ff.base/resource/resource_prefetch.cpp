@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "data_persist/dict.h"
+#include "data_persist/filesystem.h"
+#include "data_persist/json_persist.h"
+#include "data_value/dict_v.h"
+#include "data_value/double_v.h"
+#include "data_value/string_v.h"
+#include "data_value/value_vector_v.h"
+#include "resource/resource_prefetch.h"
+
+using namespace std::string_view_literals;
+
+static constexpr std::string_view MANIFEST_RESOURCES = "resources"sv;
+static constexpr std::string_view MANIFEST_NAME = "name"sv;
+static constexpr std::string_view MANIFEST_TIME = "time"sv;
+
+bool ff::resource_prefetch_manifest::empty() const
+{
+    return this->entries_.empty();
+}
+
+size_t ff::resource_prefetch_manifest::size() const
+{
+    return this->entries_.size();
+}
+
+void ff::resource_prefetch_manifest::clear()
+{
+    this->entries_.clear();
+}
+
+void ff::resource_prefetch_manifest::add(std::string_view name, double seconds)
+{
+    this->entries_.push_back(ff::resource_prefetch_manifest::entry_t{ std::string(name), seconds });
+}
+
+const std::vector<ff::resource_prefetch_manifest::entry_t>& ff::resource_prefetch_manifest::entries() const
+{
+    return this->entries_;
+}
+
+bool ff::resource_prefetch_manifest::save(const std::filesystem::path& path) const
+{
+    ff::value_vector values;
+    values.reserve(this->entries_.size());
+
+    for (const ff::resource_prefetch_manifest::entry_t& entry : this->entries_)
+    {
+        ff::dict entry_dict;
+        entry_dict.set<std::string>(::MANIFEST_NAME, std::string(entry.name));
+        entry_dict.set<double>(::MANIFEST_TIME, entry.seconds);
+        values.push_back(ff::value::create<ff::dict>(std::move(entry_dict)));
+    }
+
+    ff::dict dict;
+    dict.set<ff::value_vector>(::MANIFEST_RESOURCES, std::move(values));
+
+    std::ostringstream output;
+    ff::json_write(dict, output);
+    return ff::filesystem::write_text_file(path, output.str());
+}
+
+bool ff::resource_prefetch_manifest::load(const std::filesystem::path& path)
+{
+    this->entries_.clear();
+
+    std::string text;
+    ff::dict dict;
+    check_ret_val(ff::filesystem::read_text_file(path, text), false);
+    assert_ret_val(ff::json_parse(text, dict), false);
+
+    for (const ff::value_ptr& value : dict.get<ff::value_vector>(::MANIFEST_RESOURCES))
+    {
+        const ff::dict& entry_dict = value->convert_or_default<ff::dict>()->get<ff::dict>();
+        std::string name = entry_dict.get<std::string>(::MANIFEST_NAME);
+
+        if (!name.empty())
+        {
+            this->add(name, entry_dict.get<double>(::MANIFEST_TIME));
+        }
+    }
+
+    return true;
+}
+
+std::filesystem::path ff::resource_prefetch_manifest::path_for_pack(const std::filesystem::path& pack_path)
+{
+    std::filesystem::path path = pack_path;
+    return path.replace_extension(".prefetch.json");
+}
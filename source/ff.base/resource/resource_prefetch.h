@@ -0,0 +1,40 @@
+#pragma once
+
+namespace ff
+{
+    /// <summary>
+    /// Ordered list of resources that were first requested during a recorded session,
+    /// replayed by ff::resource_objects::prefetch_async to start loading them ahead of need.
+    /// </summary>
+    class resource_prefetch_manifest
+    {
+    public:
+        struct entry_t
+        {
+            std::string name;
+            double seconds; // since recording started
+        };
+
+        resource_prefetch_manifest() = default;
+        resource_prefetch_manifest(resource_prefetch_manifest&& other) noexcept = default;
+        resource_prefetch_manifest(const resource_prefetch_manifest& other) = default;
+
+        resource_prefetch_manifest& operator=(resource_prefetch_manifest&& other) noexcept = default;
+        resource_prefetch_manifest& operator=(const resource_prefetch_manifest& other) = default;
+
+        bool empty() const;
+        size_t size() const;
+        void clear();
+        void add(std::string_view name, double seconds);
+        const std::vector<ff::resource_prefetch_manifest::entry_t>& entries() const;
+
+        bool save(const std::filesystem::path& path) const;
+        bool load(const std::filesystem::path& path);
+
+        // The manifest for "game.res.pack" is "game.res.prefetch.json" in the same directory
+        static std::filesystem::path path_for_pack(const std::filesystem::path& pack_path);
+
+    private:
+        std::vector<ff::resource_prefetch_manifest::entry_t> entries_;
+    };
+}
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "thread/task_graph.h"
+#include "thread/thread_pool.h"
+
+ff::task_graph::task_graph(size_t max_concurrent)
+    : max_concurrent(max_concurrent ? max_concurrent : std::max<size_t>(std::thread::hardware_concurrency(), 1))
+{}
+
+size_t ff::task_graph::add_task(std::function<bool()>&& func)
+{
+    std::scoped_lock lock(this->mutex);
+    assert_ret_val(!this->running, static_cast<size_t>(-1));
+
+    ff::task_graph::task_t& task = this->tasks.emplace_back();
+    task.func = std::move(func);
+    return this->tasks.size() - 1;
+}
+
+void ff::task_graph::add_dependency(size_t task_id, size_t depends_on_task_id)
+{
+    std::scoped_lock lock(this->mutex);
+    assert_ret(!this->running && task_id < this->tasks.size() && depends_on_task_id < this->tasks.size());
+
+    std::vector<size_t>& dependents = this->tasks[depends_on_task_id].dependents;
+    if (std::find(dependents.cbegin(), dependents.cend(), task_id) == dependents.cend())
+    {
+        dependents.push_back(task_id);
+        this->tasks[task_id].blocked_count++;
+    }
+}
+
+size_t ff::task_graph::size() const
+{
+    std::scoped_lock lock(this->mutex);
+    return this->tasks.size();
+}
+
+bool ff::task_graph::run()
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        assert_ret_val(!this->running, false);
+        this->running = true;
+
+        for (size_t i = this->tasks.size(); i > 0; i--)
+        {
+            if (!this->tasks[i - 1].blocked_count)
+            {
+                this->ready_tasks.push_back(i - 1);
+            }
+        }
+
+        this->start_ready_tasks();
+    }
+
+    // Run whatever didn't fit on the thread pool here, rather than only blocking this thread.
+    // This matters when the graph is run from a thread pool task, like a resource load.
+    for (size_t task_id = this->take_ready_task(); task_id != ff::constants::invalid_unsigned<size_t>(); task_id = this->take_ready_task())
+    {
+        this->run_task(task_id);
+    }
+
+    this->done_event.wait();
+
+    std::scoped_lock lock(this->mutex);
+    this->running = false;
+
+    return this->done_count == this->tasks.size() && std::all_of(this->tasks.cbegin(), this->tasks.cend(),
+        [](const ff::task_graph::task_t& task)
+        {
+            return task.succeeded;
+        });
+}
+
+bool ff::task_graph::task_succeeded(size_t task_id) const
+{
+    std::scoped_lock lock(this->mutex);
+    return task_id < this->tasks.size() && this->tasks[task_id].succeeded;
+}
+
+void ff::task_graph::start_ready_tasks()
+{
+    while (!this->ready_tasks.empty() && this->running_count < this->max_concurrent)
+    {
+        size_t task_id = this->ready_tasks.back();
+        this->ready_tasks.pop_back();
+
+        if (this->tasks[task_id].dependency_failed)
+        {
+            this->task_finished(task_id, false);
+            continue;
+        }
+
+        this->running_count++;
+
+        ff::thread_pool::add_task([this, task_id]()
+            {
+                this->run_task(task_id);
+            });
+    }
+
+    if (!this->running_count && this->ready_tasks.empty())
+    {
+        // Either everything is done, or the rest is stuck in a dependency cycle
+        this->done_event.set();
+    }
+}
+
+size_t ff::task_graph::take_ready_task()
+{
+    std::scoped_lock lock(this->mutex);
+
+    while (!this->ready_tasks.empty())
+    {
+        size_t task_id = this->ready_tasks.back();
+        this->ready_tasks.pop_back();
+
+        if (this->tasks[task_id].dependency_failed)
+        {
+            this->task_finished(task_id, false);
+            continue;
+        }
+
+        this->running_count++;
+        return task_id;
+    }
+
+    // Sets the done event if that was the last task
+    this->start_ready_tasks();
+    return ff::constants::invalid_unsigned<size_t>();
+}
+
+void ff::task_graph::task_finished(size_t task_id, bool succeeded)
+{
+    ff::task_graph::task_t& task = this->tasks[task_id];
+    task.done = true;
+    task.succeeded = succeeded;
+    task.func = nullptr;
+    this->done_count++;
+
+    for (size_t dependent_id : task.dependents)
+    {
+        ff::task_graph::task_t& dependent = this->tasks[dependent_id];
+        dependent.dependency_failed |= !succeeded;
+
+        if (!--dependent.blocked_count)
+        {
+            this->ready_tasks.push_back(dependent_id);
+        }
+    }
+}
+
+void ff::task_graph::run_task(size_t task_id)
+{
+    std::function<bool()> func;
+    {
+        std::scoped_lock lock(this->mutex);
+        func = std::move(this->tasks[task_id].func);
+    }
+
+    const bool succeeded = func();
+
+    std::scoped_lock lock(this->mutex);
+    this->running_count--;
+    this->task_finished(task_id, succeeded);
+    this->start_ready_tasks();
+}
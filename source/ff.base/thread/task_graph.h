@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../windows/win_handle.h"
+
+namespace ff
+{
+    /// <summary>
+    /// Runs a dependency graph of tasks on the thread pool
+    /// </summary>
+    /// <remarks>
+    /// A task starts as soon as every task it depends on is done, with at most max_concurrent tasks
+    /// running on the thread pool at once. Newly unblocked tasks run first, so a chain of dependencies finishes before
+    /// unrelated work is started, which keeps the memory for partially built results bounded.
+    /// </remarks>
+    class task_graph
+    {
+    public:
+        task_graph(size_t max_concurrent = 0); // zero means one task per hardware thread
+        task_graph(task_graph&& other) noexcept = delete;
+        task_graph(const task_graph& other) = delete;
+
+        task_graph& operator=(task_graph&& other) noexcept = delete;
+        task_graph& operator=(const task_graph& other) = delete;
+
+        size_t add_task(std::function<bool()>&& func);
+        void add_dependency(size_t task_id, size_t depends_on_task_id);
+        size_t size() const;
+
+        // Blocks until every task that can run is done. Tasks that depend on a failed task don't run.
+        // Ready tasks that don't fit on the thread pool run on the calling thread while it waits.
+        // Returns false if any task failed or couldn't run due to a dependency cycle.
+        bool run();
+        bool task_succeeded(size_t task_id) const;
+
+    private:
+        struct task_t
+        {
+            std::function<bool()> func;
+            std::vector<size_t> dependents;
+            size_t blocked_count{};
+            bool dependency_failed{};
+            bool done{};
+            bool succeeded{};
+        };
+
+        void start_ready_tasks(); // must be holding mutex
+        size_t take_ready_task(); // for the thread that called run()
+        void task_finished(size_t task_id, bool succeeded); // must be holding mutex
+        void run_task(size_t task_id);
+
+        mutable std::recursive_mutex mutex;
+        std::vector<ff::task_graph::task_t> tasks;
+        std::vector<size_t> ready_tasks;
+        ff::win_event done_event;
+        size_t max_concurrent;
+        size_t running_count{};
+        size_t done_count{};
+        bool running{};
+    };
+}
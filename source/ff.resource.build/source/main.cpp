@@ -17,12 +17,15 @@ constexpr std::string_view ASSETS_COMBINED_NAMESPACE = "assets_combined";
 static int show_usage()
 {
     std::cerr << "Command line options:\n";
-    std::cerr << "  1) " << ::PROGRAM_NAME << ".exe -in \"input file\" [-out \"output file\"] [-pdb \"output path\"] [-header \"output C++\"] [-ref \"types.dll\"] [-debug] [-force]\n";
+    std::cerr << "  1) " << ::PROGRAM_NAME << ".exe -in \"input file\" [-out \"output file\"] [-pdb \"output path\"] [-header \"output C++\"] [-ref \"types.dll\"] [-cache [\"build cache path\"]] [-debug] [-force]\n";
     std::cerr << "  3) " << ::PROGRAM_NAME << ".exe -dump \"pack file\"\n";
     std::cerr << "  4) " << ::PROGRAM_NAME << ".exe -dumpbin \"pack file\"\n\n";
     std::cerr << "NOTES:\n";
     std::cerr << "  -verbose can be added to any command for extra log output.\n";
     std::cerr << "  With -ref, the reference DLL must contain an exported C method: 'void ff_init()'.\n";
+    std::cerr << "    It can also export 'const char* ff_build_version()', change that string to invalidate the build cache.\n";
+    std::cerr << "  With -cache, compiled resources are reused from the build cache when their inputs and resource type versions haven't changed.\n";
+    std::cerr << "  Files that resources read on their own (like shader includes) aren't tracked. -force and -debug only write to the cache.\n";
     std::cerr << "  Using -dumpbin will save all binary resources to a temp folder and open it.\n";
 
     return ::EXIT_CODE_BAD_COMMAND_LINE;
@@ -119,51 +122,66 @@ static bool compile_resource_pack(
     const std::filesystem::path& pdb_output,
     const std::filesystem::path& header_file,
     const std::filesystem::path& symbol_header_file,
+    ff::resource_build_cache* build_cache,
     const bool force,
     const bool debug)
 {
     assert_ret_val(!input_files.empty(), false);
 
-    std::vector<ff::load_resources_result> load_results;
-    load_results.reserve(input_files.size());
+    // Input files don't depend on each other, so load them all at once
+    std::vector<ff::load_resources_result> load_results(input_files.size());
+    ff::task_graph load_graph;
 
-    for (const std::filesystem::path& input_file : input_files)
+    for (size_t i = 0; i < input_files.size(); i++)
     {
-        std::string file_extension = ff::filesystem::extension_lower_string(input_file);
-        ff::load_resources_result result;
+        load_graph.add_task([&input_files, &load_results, i, build_cache, force, debug]()
+            {
+                const std::filesystem::path& input_file = input_files[i];
+                std::string file_extension = ff::filesystem::extension_lower_string(input_file);
+                ff::load_resources_result& result = load_results[i];
 
-        if (file_extension == ".json")
-        {
-            const ff::resource_cache_t cache_type = force ? ff::resource_cache_t::rebuild_cache : ff::resource_cache_t::use_cache_mem_mapped;
-            result = ff::load_resources_from_file(input_file, cache_type, debug);
-        }
-        else if (file_extension == ".pack")
-        {
-            ff::file_reader reader(input_file);
-            result.resources = std::make_shared<ff::resource_objects>();
+                if (file_extension == ".json")
+                {
+                    const ff::resource_cache_t cache_type = force ? ff::resource_cache_t::rebuild_cache : ff::resource_cache_t::use_cache_mem_mapped;
+                    result = ff::load_resources_from_file(input_file, cache_type, debug, build_cache);
+                }
+                else if (file_extension == ".pack")
+                {
+                    ff::file_reader file_reader(input_file);
+                    result.resources = file_reader ? std::make_shared<ff::resource_objects>() : nullptr;
+
+                    if (result.resources)
+                    {
+                        ff::buffered_reader reader(file_reader);
+                        if (!result.resources->add_resources(reader))
+                        {
+                            result.resources.reset();
+                        }
+                    }
+                }
 
-            if (!reader || !result.resources->add_resources(reader))
-            {
-                result.resources.reset();
-            }
-        }
+                return result.errors.empty() && result.resources;
+            });
+    }
 
-        if (result.errors.empty() && result.resources)
-        {
-            load_results.push_back(std::move(result));
-        }
-        else
+    if (!load_graph.run())
+    {
+        for (size_t i = 0; i < input_files.size(); i++)
         {
-            std::cerr << "Failed to load resources: " << ff::filesystem::to_string(input_file) << "\n";
-
-            for (auto& error : result.errors)
+            const ff::load_resources_result& result = load_results[i];
+            if (!result.errors.empty() || !result.resources)
             {
-                std::cerr << error << "\n";
+                std::cerr << "Failed to load resources: " << ff::filesystem::to_string(input_files[i]) << "\n";
+
+                for (auto& error : result.errors)
+                {
+                    std::cerr << error << "\n";
+                }
             }
         }
-    }
 
-    check_ret_val(load_results.size() == input_files.size(), false);
+        return false;
+    }
 
     ff::resource_objects built_resources;
     {
@@ -199,14 +217,16 @@ static bool compile_resource_pack(
 
         if (!written)
         {
-            ff::file_writer writer(output_file);
-            if (!writer)
+            ff::file_writer file_writer(output_file);
+            if (!file_writer)
             {
                 std::cerr << "Failed to create file: " << ff::filesystem::to_string(output_file) << "\n";
                 return false;
             }
 
-            if (!built_resources.save(writer))
+            ff::buffered_writer writer(file_writer);
+
+            if (!built_resources.save(writer) || !writer.flush())
             {
                 std::cerr << "Failed to write file: " << ff::filesystem::to_string(output_file) << "\n";
                 return false;
@@ -308,7 +328,7 @@ private:
     std::filesystem::path root_path;
 };
 
-static bool load_reference_files(const std::vector<std::filesystem::path>& reference_files, bool verbose)
+static bool load_reference_files(const std::vector<std::filesystem::path>& reference_files, bool verbose, std::vector<std::string>& build_versions)
 {
     for (auto& ref : reference_files)
     {
@@ -330,6 +350,15 @@ static bool load_reference_files(const std::vector<std::filesystem::path>& refer
             }
 
             init_func();
+
+            typedef const char* (*ff_build_version_t)();
+            ff_build_version_t build_version_func = reinterpret_cast<ff_build_version_t>(::GetProcAddress(mod, "ff_build_version"));
+            const char* build_version = build_version_func ? build_version_func() : nullptr;
+
+            if (build_version)
+            {
+                build_versions.push_back(ff::filesystem::to_string(ref.filename()) + ":" + build_version);
+            }
         }
         else
         {
@@ -355,6 +384,7 @@ static int do_compile(
     const std::filesystem::path& pdb_output,
     const std::filesystem::path& header_file,
     const std::filesystem::path& symbol_header_file,
+    const std::filesystem::path& build_cache_path,
     const bool force,
     const bool debug,
     const bool verbose)
@@ -376,17 +406,37 @@ static int do_compile(
         return ::EXIT_CODE_INIT_FAILED;
     }
 
-    if (!::load_reference_files(reference_files, verbose))
+    std::vector<std::string> build_versions;
+    if (!::load_reference_files(reference_files, verbose, build_versions))
     {
         return ::EXIT_CODE_BAD_REFERENCE;
     }
 
-    if (!::compile_resource_pack(input_files, output_file, pdb_output, header_file, symbol_header_file, force, debug))
+    // Debug output files are only written when compiling from source, so -debug can't read from the cache
+    std::unique_ptr<ff::resource_build_cache> build_cache = !build_cache_path.empty()
+        ? std::make_unique<ff::resource_build_cache>(build_cache_path, !force && !debug)
+        : nullptr;
+
+    if (build_cache)
+    {
+        for (const std::string& version : build_versions)
+        {
+            build_cache->add_tool_version(version);
+        }
+    }
+
+    if (!::compile_resource_pack(input_files, output_file, pdb_output, header_file, symbol_header_file, build_cache.get(), force, debug))
     {
         std::cerr << ::PROGRAM_NAME << ": Compile failed\n";
         return ::EXIT_CODE_COMPILE_FAILED;
     }
 
+    if (verbose && build_cache)
+    {
+        std::cout << ::PROGRAM_NAME << ": Build cache: " << ff::filesystem::to_string(build_cache->directory())
+            << " (" << build_cache->hit_count() << " hits, " << build_cache->miss_count() << " misses)\n";
+    }
+
     return ::EXIT_CODE_SUCCESS;
 }
 
@@ -405,13 +455,15 @@ static int do_dump(const std::filesystem::path& input_file, bool dump_bin)
         return ::EXIT_CODE_INIT_FAILED;
     }
 
-    ff::file_reader reader(input_file);
-    if (!reader)
+    ff::file_reader file_reader(input_file);
+    if (!file_reader)
     {
         std::cerr << "Can't open file: " << input_file << "\n";
         return ::EXIT_CODE_OPEN_FILE_FAILED;
     }
 
+    ff::buffered_reader reader(file_reader);
+
     ff::resource_objects resources;
     if (!resources.add_resources(reader))
     {
@@ -486,6 +538,7 @@ int main()
     std::filesystem::path pdb_output;
     std::filesystem::path header_file;
     std::filesystem::path symbol_header_file;
+    std::filesystem::path build_cache_path;
 
     auto at_exit = ff::scope_exit([&timer, &command_flags]()
     {
@@ -557,6 +610,21 @@ int main()
 
                 reference_files.push_back(std::filesystem::current_path() / ff::filesystem::to_path(args[++i]));
             }
+            else if (arg == "-cache")
+            {
+                if (command != command_t::compile)
+                {
+                    return ::show_usage();
+                }
+
+                build_cache_path = (i + 1 < args.size() && !args[i + 1].starts_with('-'))
+                    ? std::filesystem::current_path() / ff::filesystem::to_path(args[++i])
+                    : ff::resource_build_cache::default_directory();
+            }
+            else if (arg == "-nocache")
+            {
+                build_cache_path.clear();
+            }
             else if ((arg == "-dump" || arg == "-dumpbin") && i + 1 < args.size())
             {
                 if (command != command_t::none || !input_files.empty())
@@ -620,7 +688,7 @@ int main()
     switch (command)
     {
         case command_t::compile:
-            return ::do_compile(input_files, output_file, reference_files, pdb_output, header_file, symbol_header_file, force, debug, verbose);
+            return ::do_compile(input_files, output_file, reference_files, pdb_output, header_file, symbol_header_file, build_cache_path, force, debug, verbose);
 
         case command_t::dump_text:
             return ::do_dump(input_files[0], false);
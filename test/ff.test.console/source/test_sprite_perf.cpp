@@ -58,13 +58,19 @@ namespace
 
             draw->push_palette(&this->palette_cycle);
 
+            this->sprites.clear();
+            this->transforms.clear();
+
             for (size_t i = 0; i < this->pos_datas.size(); i++)
             {
                 const pos_data& pd = this->pos_datas[i];
                 const render_data& rd = this->render_datas[i];
-                draw->draw_sprite(*rd.sprite, ff::transform(pd.pos, rd.scale, rd.rotate, rd.color));
+                this->sprites.push_back(rd.sprite);
+                this->transforms.emplace_back(pd.pos, rd.scale, rd.rotate, rd.color);
             }
 
+            draw->draw_sprites(this->sprites, this->transforms);
+
             std::string text = ff::string::concat("Count:", this->pos_datas.size(), ", SPACE:More, DEL:Clear");
             this->font->draw_text(draw.get(), text, ff::transform(ff::point_float(20, 1040), ff::point_float(1, 1), 0, ff::color_white()), ff::color_none());
         }
@@ -116,6 +122,8 @@ namespace
         ff::viewport viewport;
         std::vector<pos_data> pos_datas;
         std::vector<render_data> render_datas;
+        std::vector<const ff::dxgi::sprite_data*> sprites;
+        std::vector<ff::transform> transforms;
         std::shared_ptr<ff::dxgi::depth_base> depth;
         ff::auto_resource<ff::sprite_font> font;
         ff::auto_resource<ff::palette_data> palette_data;
@@ -152,5 +152,83 @@ namespace ff::test::base
             bool success = wait_done.wait(2000);
             Assert::IsTrue(success);
         }
+
+        TEST_METHOD(task_graph)
+        {
+            std::mutex mutex;
+            std::vector<int> order;
+            auto add_order = [&mutex, &order](int value)
+                {
+                    std::scoped_lock lock(mutex);
+                    order.push_back(value);
+                    return true;
+                };
+
+            ff::task_graph graph(2);
+            size_t a = graph.add_task([&add_order]() { ::Sleep(250); return add_order(1); });
+            size_t b = graph.add_task([&add_order]() { return add_order(2); });
+            size_t c = graph.add_task([&add_order]() { return add_order(3); });
+            size_t d = graph.add_task([&add_order]() { return add_order(4); });
+            graph.add_dependency(c, a);
+            graph.add_dependency(c, b);
+            graph.add_dependency(d, c);
+
+            Assert::IsTrue(graph.run());
+            Assert::AreEqual<size_t>(4, order.size());
+            Assert::AreEqual(3, order[2]);
+            Assert::AreEqual(4, order[3]);
+        }
+
+        TEST_METHOD(task_graph_failure)
+        {
+            bool dependent_ran = false;
+            bool independent_ran = false;
+
+            ff::task_graph graph;
+            size_t a = graph.add_task([]() { return false; });
+            size_t b = graph.add_task([&dependent_ran]() { return dependent_ran = true; });
+            size_t c = graph.add_task([&independent_ran]() { return independent_ran = true; });
+            graph.add_dependency(b, a);
+
+            Assert::IsFalse(graph.run());
+            Assert::IsFalse(dependent_ran);
+            Assert::IsTrue(independent_ran);
+            Assert::IsFalse(graph.task_succeeded(a));
+            Assert::IsFalse(graph.task_succeeded(b));
+            Assert::IsTrue(graph.task_succeeded(c));
+        }
+
+        TEST_METHOD(task_graph_runs_on_caller)
+        {
+            std::mutex mutex;
+            std::vector<std::thread::id> thread_ids;
+
+            ff::task_graph graph(1);
+            for (size_t i = 0; i < 4; i++)
+            {
+                graph.add_task([&mutex, &thread_ids]()
+                    {
+                        ::Sleep(50);
+                        std::scoped_lock lock(mutex);
+                        thread_ids.push_back(std::this_thread::get_id());
+                        return true;
+                    });
+            }
+
+            Assert::IsTrue(graph.run());
+            Assert::AreEqual<size_t>(4, thread_ids.size());
+            Assert::IsTrue(std::find(thread_ids.cbegin(), thread_ids.cend(), std::this_thread::get_id()) != thread_ids.cend());
+        }
+
+        TEST_METHOD(task_graph_cycle)
+        {
+            ff::task_graph graph;
+            size_t a = graph.add_task([]() { return true; });
+            size_t b = graph.add_task([]() { return true; });
+            graph.add_dependency(a, b);
+            graph.add_dependency(b, a);
+
+            Assert::IsFalse(graph.run());
+        }
     };
 }
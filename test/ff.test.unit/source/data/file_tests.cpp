@@ -49,5 +49,164 @@ namespace ff::test::data
 
             std::filesystem::remove(path);
         }
+
+        TEST_METHOD(read_async)
+        {
+            std::filesystem::path path = ff::filesystem::temp_directory_path();
+            path /= "temp_test_async.bin";
+
+            std::vector<uint32_t> values(0x10000);
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                values[i] = static_cast<uint32_t>(i);
+            }
+
+            Assert::IsTrue(ff::filesystem::write_binary_file(path, values.data(), values.size() * sizeof(uint32_t)));
+
+            // Several outstanding reads at once
+            {
+                ff::file_read fr(path);
+                Assert::IsTrue(fr);
+
+                const size_t chunk_count = 8;
+                const size_t chunk_size = values.size() / chunk_count;
+                std::vector<uint32_t> read_values(values.size());
+                std::vector<ff::co_task<size_t>> tasks;
+
+                for (size_t i = 0; i < chunk_count; i++)
+                {
+                    tasks.push_back(fr.read_async(read_values.data() + i * chunk_size, chunk_size * sizeof(uint32_t)));
+                }
+
+                Assert::AreEqual(fr.size(), fr.pos());
+
+                for (ff::co_task<size_t>& task : tasks)
+                {
+                    Assert::AreEqual(chunk_size * sizeof(uint32_t), task.result());
+                }
+
+                Assert::IsTrue(values == read_values);
+            }
+
+            // Reading past the end
+            {
+                ff::file_read fr(path);
+                uint32_t value = 0;
+                Assert::AreEqual(sizeof(uint32_t), fr.read_async(fr.size() - sizeof(uint32_t), &value, sizeof(value) * 2).result());
+                Assert::AreEqual(values.back(), value);
+                Assert::AreEqual(size_t(0), fr.read_async(fr.size(), &value, sizeof(value)).result());
+            }
+
+            std::filesystem::remove(path);
+        }
+
+        TEST_METHOD(buffered_read_write)
+        {
+            std::filesystem::path path = ff::filesystem::temp_directory_path();
+            path /= "temp_test_buffered.bin";
+
+            // Lots of small writes, then seek back and patch the start
+            {
+                ff::file_writer file_writer(path);
+                Assert::IsTrue(file_writer);
+
+                ff::buffered_writer writer(file_writer, 64);
+                for (uint32_t i = 0; i < 1000; i++)
+                {
+                    Assert::IsTrue(ff::save(writer, i));
+                }
+
+                Assert::AreEqual(size_t(4000), writer.pos());
+                Assert::AreEqual(size_t(4000), writer.size());
+
+                const uint32_t first = 1234;
+                Assert::AreEqual(size_t(0), writer.pos(0));
+                Assert::IsTrue(ff::save(writer, first));
+                Assert::IsTrue(writer.flush());
+                Assert::AreEqual(size_t(4000), file_writer.size());
+            }
+
+            // Small reads with seeking back and forth
+            {
+                ff::file_reader file_reader(path);
+                Assert::IsTrue(file_reader);
+
+                ff::buffered_reader reader(file_reader, 64);
+                uint32_t value;
+
+                Assert::IsTrue(ff::load(reader, value));
+                Assert::AreEqual(uint32_t(1234), value);
+
+                for (uint32_t i = 1; i < 1000; i++)
+                {
+                    Assert::IsTrue(ff::load(reader, value));
+                    Assert::AreEqual(i, value);
+                }
+
+                Assert::IsFalse(ff::load(reader, value));
+                Assert::AreEqual(size_t(400), reader.pos(400));
+                Assert::IsTrue(ff::load(reader, value));
+                Assert::AreEqual(uint32_t(100), value);
+
+                std::vector<uint32_t> values(500);
+                Assert::AreEqual(size_t(8), reader.pos(8));
+                Assert::AreEqual(values.size() * sizeof(uint32_t), reader.read(values.data(), values.size() * sizeof(uint32_t)));
+                Assert::AreEqual(uint32_t(2), values.front());
+                Assert::AreEqual(uint32_t(501), values.back());
+            }
+
+            std::filesystem::remove(path);
+        }
+
+        TEST_METHOD(read_ranges)
+        {
+            std::filesystem::path path = ff::filesystem::temp_directory_path();
+            path /= "temp_test_ranges.bin";
+
+            std::vector<uint32_t> values(0x40000);
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                values[i] = static_cast<uint32_t>(i);
+            }
+
+            Assert::IsTrue(ff::filesystem::write_binary_file(path, values.data(), values.size() * sizeof(uint32_t)));
+
+            // Out of order, adjacent, overlapping, and far apart
+            const size_t offsets[] = { 0x30000, 16, 0, 20, 0x100, 0x3FFF0 };
+            std::vector<uint32_t> read_values(std::size(offsets) * 4);
+            std::vector<ff::read_range_t> ranges;
+
+            for (size_t i = 0; i < std::size(offsets); i++)
+            {
+                ranges.push_back(ff::read_range_t{ offsets[i] * sizeof(uint32_t), 4 * sizeof(uint32_t), &read_values[i * 4] });
+            }
+
+            ff::file_read fr(path);
+            Assert::IsTrue(fr.read_ranges(ranges.data(), ranges.size()));
+            Assert::AreEqual(size_t(0), fr.pos());
+
+            for (size_t i = 0; i < read_values.size(); i++)
+            {
+                Assert::AreEqual(static_cast<uint32_t>(offsets[i / 4] + i % 4), read_values[i]);
+            }
+
+            // The generic reader version should match
+            std::vector<uint32_t> read_values2(read_values.size());
+            for (size_t i = 0; i < ranges.size(); i++)
+            {
+                ranges[i].data = &read_values2[i * 4];
+            }
+
+            ff::data_reader reader(ff::filesystem::read_binary_file(path));
+            Assert::IsTrue(reader.read_ranges(ranges.data(), ranges.size()));
+            Assert::IsTrue(read_values == read_values2);
+
+            // Past the end
+            ff::read_range_t bad_range{ fr.size() - 4, 8, read_values.data() };
+            Assert::IsFalse(fr.read_ranges(&bad_range, 1));
+            Assert::IsFalse(reader.read_ranges(&bad_range, 1));
+
+            std::filesystem::remove(path);
+        }
     };
 }
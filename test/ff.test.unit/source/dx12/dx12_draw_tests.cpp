@@ -22,6 +22,232 @@ namespace ff::test::dx12
             ff::dx12::frame_complete();
         }
 
+        TEST_METHOD(cull_offscreen)
+        {
+            auto dd = ff::dxgi::create_draw_device();
+            ff::dx12::target_texture target(std::make_shared<ff::dx12::texture>(ff::point_size(32, 32)));
+            ff::dx12::depth depth;
+            const ff::rect_float offscreen_rect(64, 64, 96, 96);
+
+            ff::dxgi::command_context_base& context = ff::dx12::frame_started();
+            {
+                ff::dxgi::draw_ptr draw = dd->begin_draw(context, target, &depth, ff::rect_float(0, 0, 32, 32), ff::rect_float(0, 0, 32, 32));
+                draw->draw_rectangle(ff::rect_float(8, 8, 24, 24), ff::color_white());
+                draw->draw_rectangle(offscreen_rect, ff::color_white());
+                draw->draw_circle(ff::dxgi::endpoint_t{ { -16, 16 }, &ff::color_white(), 8 });
+                draw->draw_line(ff::point_float(40, 0), ff::point_float(40, 32), ff::color_white(), 1);
+
+                // Moving the world brings the offscreen rectangle into view
+                DirectX::XMFLOAT4X4 translate_matrix;
+                DirectX::XMStoreFloat4x4(&translate_matrix, DirectX::XMMatrixTranslation(-64, -64, 0));
+                draw->world_matrix_stack().push();
+                draw->world_matrix_stack().transform(translate_matrix);
+                draw->draw_rectangle(offscreen_rect, ff::color_white());
+                draw->world_matrix_stack().pop();
+            }
+
+            Assert::AreEqual<size_t>(3, dd->culled_count());
+
+            {
+                ff::dxgi::draw_ptr draw = dd->begin_draw(context, target, &depth, ff::rect_float(0, 0, 32, 32), ff::rect_float(0, 0, 32, 32), ff::dxgi::draw_options::no_culling);
+                draw->draw_rectangle(offscreen_rect, ff::color_white());
+            }
+
+            Assert::AreEqual<size_t>(0, dd->culled_count());
+            ff::dx12::frame_complete();
+        }
+
+        TEST_METHOD(defer_opaque_sprites)
+        {
+            // More textures than there are slots, so opaque sprites get deferred into later batches
+            constexpr size_t texture_count = ff::dxgi::draw_util::MAX_TEXTURES + 8;
+            std::vector<std::unique_ptr<ff::dx12::texture>> textures;
+            std::vector<ff::dxgi::sprite_data> sprites;
+
+            for (size_t i = 0; i < texture_count; i++)
+            {
+                auto scratch = std::make_shared<DirectX::ScratchImage>();
+                Assert::IsTrue(SUCCEEDED(scratch->Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 1, 1)));
+                std::memset(scratch->GetPixels(), 0xFF, scratch->GetPixelsSize());
+                textures.push_back(std::make_unique<ff::dx12::texture>(scratch));
+            }
+
+            for (size_t i = 0; i < texture_count; i++)
+            {
+                sprites.emplace_back(textures[i].get(), ff::rect_float(0, 0, 4, 4), ff::point_float(0, 0), ff::point_float(2, 2), ff::dxgi::sprite_type::opaque);
+            }
+
+            const ff::color clear_color = ff::color_black();
+            ff::dx12::target_texture target(std::make_shared<ff::dx12::texture>(ff::point_size(64, 64), DXGI_FORMAT_UNKNOWN, 1, 1, 1, &clear_color));
+
+            ff::dxgi::command_context_base& context = ff::dx12::frame_started();
+            target.begin_render(context, &clear_color);
+            {
+                ff::dx12::depth depth;
+                std::unique_ptr<ff::dxgi::draw_device_base> draw_device = ff::dxgi::create_draw_device();
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, ff::rect_float(0, 0, 64, 64), ff::rect_float(0, 0, 64, 64));
+
+                for (size_t i = 0; i < texture_count; i++)
+                {
+                    draw->draw_sprite(sprites[i], ff::transform(ff::point_float((i % 8) * 8.0f, (i / 8) * 8.0f)));
+                }
+            }
+
+            target.end_render(context);
+            ff::dx12::frame_complete();
+            ff::dx12::wait_for_idle();
+
+            std::shared_ptr<DirectX::ScratchImage> result = target.shared_texture()->data();
+            const DirectX::Image& image = *result->GetImages();
+
+            for (size_t i = 0; i < texture_count; i++)
+            {
+                const uint8_t* pixel = image.pixels + ((i / 8) * 8 + 4) * image.rowPitch + ((i % 8) * 8 + 4) * 4;
+                Assert::AreEqual<uint32_t>(0xFFFFFFFF, *reinterpret_cast<const uint32_t*>(pixel));
+            }
+        }
+
+        TEST_METHOD(instance_buffer_chunks)
+        {
+            // Instances are written straight into upload memory chunks, and every batch needs more than two of the smallest chunks.
+            // Without depth, the GPU draws instances in buffer order, so each pixel must end up with the color that was drawn last.
+            constexpr size_t batch_count = 2;
+            constexpr size_t sprite_count = ff::dxgi::draw_util::MIN_INSTANCE_BUCKET_COUNT * 4 + 44;
+
+            auto scratch = std::make_shared<DirectX::ScratchImage>();
+            Assert::IsTrue(SUCCEEDED(scratch->Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1)));
+            std::memset(scratch->GetPixels(), 0xFF, scratch->GetPixelsSize());
+            ff::dx12::texture texture(scratch);
+            ff::dxgi::sprite_data sprite(&texture, ff::rect_float(0, 0, 1, 1), ff::point_float(0, 0), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+
+            const ff::color clear_color = ff::color_black();
+            ff::dx12::target_texture target(std::make_shared<ff::dx12::texture>(ff::point_size(32, 32), DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, &clear_color));
+            std::unique_ptr<ff::dxgi::draw_device_base> draw_device = ff::dxgi::create_draw_device();
+
+            ff::dxgi::command_context_base& context = ff::dx12::frame_started();
+            target.begin_render(context, &clear_color);
+
+            for (size_t batch = 0; batch < batch_count; batch++)
+            {
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, nullptr, ff::rect_float(0, 0, 32, 32), ff::rect_float(0, 0, 32, 32));
+
+                for (size_t i = 0; i < sprite_count; i++)
+                {
+                    ff::transform transform = this->chunk_test_transform(batch, i);
+                    transform.color = ff::color_magenta();
+                    draw->draw_sprite(sprite, transform);
+                }
+
+                for (size_t i = 0; i < sprite_count; i++)
+                {
+                    draw->draw_sprite(sprite, this->chunk_test_transform(batch, i));
+                }
+            }
+
+            target.end_render(context);
+            ff::dx12::frame_complete();
+            ff::dx12::wait_for_idle();
+
+            std::shared_ptr<DirectX::ScratchImage> result = target.shared_texture()->data();
+            const DirectX::Image& image = *result->GetImages();
+
+            for (size_t batch = 0; batch < batch_count; batch++)
+            {
+                for (size_t i = 0; i < sprite_count; i++)
+                {
+                    const ff::point_float pos = this->chunk_test_transform(batch, i).position;
+                    const uint8_t* pixel = image.pixels + static_cast<size_t>(pos.y) * image.rowPitch + static_cast<size_t>(pos.x) * 4;
+                    Assert::AreEqual<size_t>(i % 256, pixel[0]);
+                    Assert::AreEqual<size_t>(i / 256, pixel[1]);
+                    Assert::AreEqual<size_t>(batch, pixel[2]);
+                    Assert::AreEqual<size_t>(255, pixel[3]);
+                }
+            }
+        }
+
+        TEST_METHOD(draw_recorded)
+        {
+            std::unique_ptr<ff::dx12::texture> test_texture;
+            {
+                ff::data_static texture_mem(ff::get_hinstance(), RT_RCDATA, MAKEINTRESOURCE(ID_TEST_TEXTURE));
+                ff::png_image_reader png(texture_mem.data(), texture_mem.size());
+                test_texture = std::make_unique<ff::dx12::texture>(std::make_shared<DirectX::ScratchImage>(std::move(*png.read())));
+            }
+
+            ff::dxgi::sprite_data test_sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+            const ff::color transparent_color(1, 0, 0, 0.5f);
+
+            auto draw_layer = [&](ff::dxgi::draw_base& draw, size_t layer)
+                {
+                    if (layer == 0)
+                    {
+                        draw.draw_sprite(test_sprite, ff::transform(ff::point_float(40, 40)));
+                        draw.draw_circle(ff::dxgi::endpoint_t{ { 128, 128 }, &ff::color_yellow(), 16 }, 4.0f);
+                    }
+                    else
+                    {
+                        DirectX::XMFLOAT4X4 translate_matrix;
+                        DirectX::XMStoreFloat4x4(&translate_matrix, DirectX::XMMatrixTranslation(32, 0, 0));
+                        draw.world_matrix_stack().push();
+                        draw.world_matrix_stack().transform(translate_matrix);
+                        draw.draw_rectangle(ff::rect_float(16, 96, 128, 160), transparent_color);
+                        draw.draw_sprite(test_sprite, ff::transform(ff::point_float(180, 180), ff::point_float(2, 2), 30));
+                        draw.world_matrix_stack().pop();
+                        draw.draw_line(ff::point_float(0, 256), ff::point_float(256, 0), ff::color_red(), 3);
+                    }
+                };
+
+            auto render = [&](bool recorded)
+                {
+                    const ff::color clear_color(0.25, 0, 0.5, 1);
+                    ff::dx12::target_texture target(std::make_shared<ff::dx12::texture>(ff::point_size(256, 256), DXGI_FORMAT_UNKNOWN, 1, 1, 1, &clear_color));
+
+                    ff::dxgi::command_context_base& context = ff::dx12::frame_started();
+                    target.begin_render(context, &clear_color);
+                    {
+                        ff::dx12::depth depth;
+                        std::unique_ptr<ff::dxgi::draw_device_base> draw_device = ff::dxgi::create_draw_device();
+                        ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, ff::rect_float(0, 0, 256, 256), ff::rect_float(0, 0, 256, 256));
+
+                        if (recorded)
+                        {
+                            ff::dxgi::draw_util::draw_recorder recorders[2];
+                            ff::dxgi::draw_util::draw_recorder* recorder_ptrs[2] = { &recorders[0], &recorders[1] };
+                            ff::dxgi::draw_util::draw_recorder::record(recorder_ptrs, [&](size_t index, ff::dxgi::draw_util::draw_recorder& recorder)
+                                {
+                                    draw_layer(recorder, index);
+                                });
+
+                            draw->draw_recorded(recorders[0]);
+                            draw->draw_recorded(recorders[1]);
+                        }
+                        else
+                        {
+                            draw_layer(*draw, 0);
+                            draw_layer(*draw, 1);
+                        }
+                    }
+
+                    target.end_render(context);
+                    ff::dx12::frame_complete();
+                    ff::dx12::wait_for_idle();
+
+                    return target.shared_texture()->data();
+                };
+
+            std::shared_ptr<DirectX::ScratchImage> direct_image = render(false);
+            std::shared_ptr<DirectX::ScratchImage> recorded_image = render(true);
+
+            const DirectX::Image& image1 = *direct_image->GetImages();
+            const DirectX::Image& image2 = *recorded_image->GetImages();
+            Assert::AreEqual(image1.slicePitch, image2.slicePitch);
+
+            for (size_t y = 0; y < image1.height; y++)
+            {
+                Assert::IsTrue(!std::memcmp(image1.pixels + y * image1.rowPitch, image2.pixels + y * image2.rowPitch, image1.width * 4));
+            }
+        }
+
         TEST_METHOD(draw_shapes)
         {
             std::unique_ptr<ff::dx12::texture> test_texture;
@@ -84,5 +310,14 @@ namespace ff::test::dx12
 
             ff::test::assert_image(file_path, ID_DX12_DRAW_SHAPE_RESULT);
         }
+
+    private:
+        // A different pixel and color for every sprite in the instance chunk test
+        ff::transform chunk_test_transform(size_t batch, size_t index)
+        {
+            const ff::point_float position(static_cast<float>(index % 32), static_cast<float>(batch * 10 + index / 32));
+            const ff::color color(static_cast<float>(index % 256) / 255.0f, static_cast<float>(index / 256) / 255.0f, static_cast<float>(batch) / 255.0f, 1.0f);
+            return ff::transform(position, ff::point_float(1, 1), 0.0f, color);
+        }
     };
 }
@@ -84,5 +84,266 @@ namespace ff::test::graphics
             Assert::AreEqual<size_t>(1, events.size());
             Assert::AreEqual<size_t>(ff::stable_hash_func("start"sv), events[0].event_id);
         }
+
+        TEST_METHOD(compiled_keys)
+        {
+            for (ff::animation_keys::method_t interpolate : { ff::animation_keys::method_t::interpolate_linear, ff::animation_keys::method_t::interpolate_spline })
+            {
+                ff::create_animation_keys create_keys("test", 0, 8, ff::flags::set(ff::animation_keys::method_t::bounds_clamp, interpolate));
+                create_keys.add_frame(0, ff::value::create<ff::rect_float>(ff::rect_float(0, 0, 1, 1)));
+                create_keys.add_frame(2, ff::value::create<ff::rect_float>(ff::rect_float(4, 8, 2, 0)));
+                create_keys.add_frame(5, ff::value::create<ff::rect_float>(ff::rect_float(-4, 1, 3, 0.5f)));
+                create_keys.add_frame(8, ff::value::create<ff::rect_float>(ff::rect_float(1, 2, 3, 4)));
+
+                ff::animation_keys keys = create_keys.create();
+                Assert::AreEqual<size_t>(4, keys.float_count());
+
+                for (float frame = -1; frame <= 9; frame += 0.25f)
+                {
+                    ff::rect_float expect = keys.get_value(frame)->get<ff::rect_float>();
+                    ff::rect_float actual;
+                    Assert::IsTrue(keys.get_floats(frame, reinterpret_cast<float*>(&actual), 4));
+                    Assert::AreEqual(expect.left, actual.left, 0.0001f);
+                    Assert::AreEqual(expect.top, actual.top, 0.0001f);
+                    Assert::AreEqual(expect.right, actual.right, 0.0001f);
+                    Assert::AreEqual(expect.bottom, actual.bottom, 0.0001f);
+                }
+            }
+
+            ff::create_animation_keys string_keys("test", 0, 1);
+            string_keys.add_frame(0, ff::value::create<std::string>("param:value"));
+            Assert::AreEqual<size_t>(0, string_keys.create().float_count());
+        }
+
+        TEST_METHOD(baked_animation)
+        {
+            auto anim_json = [](bool bake)
+                {
+                    return std::string(R"({ "res:type": "animation", "length": 4, "fps": 10, "loop": true, "bake": )") + (bake ? "true" : "false") + R"(,
+                        "visuals": [ { "visual": "sprite", "color": "color", "position": "position", "scale": "scale", "rotate": "rotate" } ],
+                        "keys":
+                        {
+                          "sprite": { "values": [ { "frame": 0, "value": "ref:sprites.thing[0]" }, { "frame": 2, "value": "ref:sprites.thing[1]" } ] },
+                          "color": { "values": [ { "frame": 0, "value": [ 1, 1, 1, 1 ] }, { "frame": 4, "value": [ 1, 0, 0, 0.5 ] } ] },
+                          "position": { "method": "spline", "values": [ { "frame": 0, "value": [ 1, 0 ] }, { "frame": 2, "value": [ 8, 4 ] }, { "frame": 4, "value": [ 0, 0 ] } ] },
+                          "scale": { "values": [ { "frame": 0, "value": [ 2, 2 ] }, { "frame": 4, "value": [ 0.25, 0.25 ] } ] },
+                          "rotate": { "values": [ { "frame": 0, "value": 45 }, { "frame": 4, "value": 0 } ] }
+                        }
+                      })";
+                };
+
+            std::string json = R"({ "sprites": { "res:type": "sprites", "sprites": { "thing": { "file": "file:test_texture.png", "pos": [ 0, 0 ], "size": [ 8, 8 ], "handle": [ 4, 4 ], "repeat": 2 } } },)";
+            json += "\"baked_anim\": " + anim_json(true) + ", \"keyed_anim\": " + anim_json(false) + " }";
+
+            auto result = ff::test::create_resources(json);
+            auto baked_anim = ff::get_resource<ff::animation>(*std::get<0>(result), "baked_anim");
+            auto keyed_anim = ff::get_resource<ff::animation>(*std::get<0>(result), "keyed_anim");
+            Assert::IsTrue(baked_anim->baked());
+            Assert::IsFalse(keyed_anim->baked());
+
+            auto dd = ff::dxgi::create_recording_draw_device();
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+
+            for (float frame = 0; frame < 9; frame += 0.35f)
+            {
+                dd->clear();
+                {
+                    ff::dxgi::draw_ptr draw = dd->begin_draw(dd->command_context(), *target, nullptr);
+                    baked_anim->draw_frame(*draw, ff::transform::identity(), frame);
+                    keyed_anim->draw_frame(*draw, ff::transform::identity(), frame);
+                }
+
+                Assert::AreEqual<size_t>(1, dd->draw_calls().size());
+                auto sprites = dd->instances<ff::dxgi::draw_util::sprite_instance>(dd->draw_calls()[0]);
+                Assert::AreEqual<size_t>(2, sprites.size());
+
+                const float* baked = reinterpret_cast<const float*>(&sprites[0]);
+                const float* keyed = reinterpret_cast<const float*>(&sprites[1]);
+                for (size_t i = 0; i < 16; i++)
+                {
+                    if (i != 14) // depth
+                    {
+                        Assert::AreEqual(keyed[i], baked[i], 0.1f);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(baked_animation_visual_loop)
+        {
+            // The visual loops every 1.05 frames, which falls between two baked samples
+            auto anim_json = [](bool bake)
+                {
+                    return std::string(R"({ "res:type": "animation", "length": 4, "fps": 6, "bake": )") + (bake ? "true" : "false") + R"(,
+                        "visuals": [ { "visual": "sprite", "position": "position", "length": 1.05, "loop": true } ],
+                        "keys":
+                        {
+                          "sprite": { "values": [ { "frame": 0, "value": "ref:sprites.thing[0]" } ] },
+                          "position": { "values": [ { "frame": 0, "value": [ 0, 0 ] }, { "frame": 1.05, "value": [ 2.1, 0 ] } ] }
+                        }
+                      })";
+                };
+
+            std::string json = R"({ "sprites": { "res:type": "sprites", "sprites": { "thing": { "file": "file:test_texture.png", "pos": [ 0, 0 ], "size": [ 8, 8 ], "handle": [ 4, 4 ] } } },)";
+            json += "\"baked_anim\": " + anim_json(true) + ", \"keyed_anim\": " + anim_json(false) + " }";
+
+            auto result = ff::test::create_resources(json);
+            auto baked_anim = ff::get_resource<ff::animation>(*std::get<0>(result), "baked_anim");
+            auto keyed_anim = ff::get_resource<ff::animation>(*std::get<0>(result), "keyed_anim");
+            Assert::IsTrue(baked_anim->baked());
+
+            auto dd = ff::dxgi::create_recording_draw_device();
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+
+            for (float frame : { 0.25f, 0.93f, 1.04f, 1.62f, 2.08f })
+            {
+                dd->clear();
+                {
+                    ff::dxgi::draw_ptr draw = dd->begin_draw(dd->command_context(), *target, nullptr);
+                    baked_anim->draw_frame(*draw, ff::transform::identity(), frame);
+                    keyed_anim->draw_frame(*draw, ff::transform::identity(), frame);
+                }
+
+                Assert::AreEqual<size_t>(1, dd->draw_calls().size());
+                auto sprites = dd->instances<ff::dxgi::draw_util::sprite_instance>(dd->draw_calls()[0]);
+                Assert::AreEqual<size_t>(2, sprites.size());
+
+                const float* baked = reinterpret_cast<const float*>(&sprites[0]);
+                const float* keyed = reinterpret_cast<const float*>(&sprites[1]);
+                for (size_t i = 0; i < 16; i++)
+                {
+                    if (i != 14) // depth
+                    {
+                        Assert::AreEqual(keyed[i], baked[i], 0.1f);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(key_cursors)
+        {
+            ff::create_animation_keys create_keys("test", 0, 20, ff::flags::set(ff::animation_keys::method_t::bounds_loop, ff::animation_keys::method_t::interpolate_linear));
+            for (int i = 0; i <= 20; i += 2)
+            {
+                create_keys.add_frame(static_cast<float>(i), ff::value::create<float>(static_cast<float>(i * i)));
+            }
+
+            ff::animation_keys keys = create_keys.create();
+            ff::animation_keys::cursor_t value_cursor{};
+            ff::animation_keys::cursor_t floats_cursor{};
+
+            // Plays forward past the loop point, then seeks backwards
+            for (float frame : { 0.0f, 0.5f, 1.0f, 2.0f, 2.5f, 5.0f, 11.0f, 19.5f, 20.0f, 21.0f, 23.0f, 7.0f, 6.0f, 18.0f, -3.0f })
+            {
+                const float expect = keys.get_value(frame)->get<float>();
+                float actual;
+                Assert::IsTrue(keys.get_floats(frame, &actual, 1, &floats_cursor));
+                Assert::AreEqual(expect, actual, 0.0001f);
+                Assert::AreEqual(expect, keys.get_value(frame, nullptr, &value_cursor)->get<float>(), 0.0001f);
+            }
+        }
+
+        TEST_METHOD(animation_system)
+        {
+            ff::create_animation create_anim(8, 30);
+            create_anim.add_event(0, "start");
+            create_anim.add_event(4, "middle");
+            std::shared_ptr<ff::animation> anim = create_anim.create();
+
+            ff::animation_system system;
+            std::vector<ff::animation_player> players;
+            for (size_t i = 0; i < 300; i++)
+            {
+                const float start_frame = static_cast<float>(i % 4);
+                const float speed = (i % 2) ? 1.0f : 0.5f;
+                Assert::AreEqual(i, system.add(anim, start_frame, speed));
+                players.emplace_back(anim, start_frame, speed);
+            }
+
+            system.remove(7);
+            Assert::AreEqual<size_t>(299, system.size());
+            Assert::AreEqual<size_t>(7, system.add(anim, 3, 0.5f));
+            players[7] = ff::animation_player(anim, 3, 0.5f);
+
+            for (size_t update = 0; update < 30; update++)
+            {
+                system.update();
+
+                size_t event_count = 0;
+                for (size_t i = 0; i < players.size(); i++)
+                {
+                    std::vector<ff::animation_event> events;
+                    ff::push_back_collection push_back_events(events);
+                    const bool playing = players[i].update_animation(&push_back_events);
+
+                    Assert::AreEqual(playing, system.playing(i));
+                    event_count += events.size();
+                }
+
+                Assert::AreEqual(event_count, system.events().size());
+            }
+        }
+
+        TEST_METHOD(animation_system_parallel)
+        {
+            ff::create_animation create_anim1(8, 30);
+            create_anim1.add_event(0, "start");
+            create_anim1.add_event(4, "middle");
+
+            ff::create_animation create_anim2(6, 60);
+            create_anim2.add_event(1, "one");
+            create_anim2.add_event(5, "five");
+
+            ff::create_animation create_anim3(4, 30);
+            create_anim3.add_event(2, "two");
+
+            const std::array<std::shared_ptr<ff::animation>, 3> anims{ create_anim1.create(), create_anim2.create(), create_anim3.create() };
+            const std::array<size_t, 3> anim_counts{ 1100, 200, 50 };
+
+            // More than MAX_GROUP_SIZE players of the first animation, so it's split into two groups, and each animation
+            // gets its own group too. Players are added in animation order, so the events come out in player ID order.
+            ff::animation_system system;
+            std::vector<ff::animation_player> players;
+            for (size_t anim_index = 0; anim_index < anims.size(); anim_index++)
+            {
+                for (size_t i = 0; i < anim_counts[anim_index]; i++)
+                {
+                    const float start_frame = static_cast<float>(i % 4);
+                    const float speed = (i % 3) ? 1.0f : 0.5f;
+                    Assert::AreEqual(players.size(), system.add(anims[anim_index], start_frame, speed));
+                    players.emplace_back(anims[anim_index], start_frame, speed);
+                }
+            }
+
+            for (size_t update = 0; update < 30; update++)
+            {
+                system.update();
+
+                std::vector<ff::animation_system::event_t> expect_events;
+                for (size_t i = 0; i < players.size(); i++)
+                {
+                    std::vector<ff::animation_event> events;
+                    ff::push_back_collection push_back_events(events);
+                    const bool playing = players[i].update_animation(&push_back_events);
+                    Assert::AreEqual(playing, system.playing(i));
+
+                    for (const ff::animation_event& event : events)
+                    {
+                        expect_events.push_back(ff::animation_system::event_t{ i, event });
+                    }
+                }
+
+                const std::vector<ff::animation_system::event_t>& actual_events = system.events();
+                Assert::AreEqual(expect_events.size(), actual_events.size());
+
+                for (size_t i = 0; i < expect_events.size(); i++)
+                {
+                    Assert::AreEqual(expect_events[i].player_id, actual_events[i].player_id);
+                    Assert::AreEqual(expect_events[i].event.event_id, actual_events[i].event.event_id);
+                    Assert::IsTrue(expect_events[i].event.animation == actual_events[i].event.animation);
+                    Assert::IsTrue(expect_events[i].event.params == actual_events[i].event.params);
+                }
+            }
+        }
     };
 }
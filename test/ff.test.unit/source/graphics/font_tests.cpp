@@ -38,5 +38,266 @@ namespace ff::test::graphics
             Assert::IsTrue(size.x > 95 && size.x < 95.5);
             Assert::IsTrue(size.y > 32.5 && size.y < 33);
         }
+
+        TEST_METHOD(lazy_sprite_font_resource)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_sprite_font": { "res:type": "font", "data": "ref:test_font", "size": 12, "outline": 1 },
+                    "test_lazy_font": { "res:type": "font", "data": "ref:test_font", "size": 12, "outline": 1, "lazy": true, "prewarm": "0123456789", "page_size": 64, "max_pages": 2 }
+                }
+            )");
+
+            auto font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_sprite_font");
+            auto lazy_font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_lazy_font");
+            Assert::IsTrue(font && *font && !font->lazy());
+            Assert::IsTrue(lazy_font && *lazy_font && lazy_font->lazy());
+            Assert::AreEqual(font->line_spacing(), lazy_font->line_spacing());
+
+            const std::string_view text = "Hello, this is text.\r\nAnother line.";
+            ff::point_float size = font->measure_text(text, ff::point_float(1, 1));
+            ff::point_float lazy_size = lazy_font->measure_text(text, ff::point_float(1, 1));
+            Assert::AreEqual(size.x, lazy_size.x, 0.001f);
+            Assert::AreEqual(size.y, lazy_size.y, 0.001f);
+
+            auto dd = ff::dxgi::create_recording_draw_device();
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(1024, 256), 1.0, DMDO_DEFAULT });
+
+            // The target is big enough that nothing gets culled. Every glyph is drawn twice, outline first, and each draw
+            // only samples from the lazy font's pages.
+            const std::string_view short_text = "Hello, text.";
+            const std::vector<drawn_glyph_t> expect_glyphs = font_tests::draw_text_glyphs(*dd, *target, *font, short_text);
+            const std::vector<drawn_glyph_t> glyphs = font_tests::draw_text_glyphs(*dd, *target, *lazy_font, short_text);
+            Assert::AreEqual<size_t>(22, expect_glyphs.size());
+            Assert::AreEqual(expect_glyphs.size(), glyphs.size());
+            Assert::IsTrue(font_tests::valid_glyph_textures(*dd, 2));
+
+            // Two pages can't hold all of these glyphs, so drawing them evicts everything that was drawn before
+            const std::array<std::string_view, 4> evict_texts{ "ABCDEFGHIJKLM", "NOPQRSTUVWXYZ", "abcdfgijkmnpq", "ruvwyz[]{}<>?" };
+            for (std::string_view evict_text : evict_texts)
+            {
+                const std::vector<drawn_glyph_t> evict_glyphs = font_tests::draw_text_glyphs(*dd, *target, *lazy_font, evict_text);
+                Assert::AreEqual(font_tests::draw_text_glyphs(*dd, *target, *font, evict_text).size(), evict_glyphs.size());
+                Assert::AreEqual(evict_text.size() * 2, evict_glyphs.size());
+            }
+
+            // Glyphs come back in the same places after being rasterized again, on new page textures
+            const std::vector<drawn_glyph_t> redrawn_glyphs = font_tests::draw_text_glyphs(*dd, *target, *lazy_font, short_text);
+            Assert::AreEqual(glyphs.size(), redrawn_glyphs.size());
+            Assert::IsTrue(font_tests::valid_glyph_textures(*dd, 2));
+
+            for (size_t i = 0; i < glyphs.size(); i++)
+            {
+                const ff::dxgi::draw_util::sprite_instance& instance = glyphs[i].instance;
+                const ff::dxgi::draw_util::sprite_instance& redrawn_instance = redrawn_glyphs[i].instance;
+                Assert::IsTrue(!std::memcmp(&instance.rect, &redrawn_instance.rect, sizeof(instance.rect)));
+                Assert::IsTrue(!std::memcmp(&instance.color, &redrawn_instance.color, sizeof(instance.color)));
+                Assert::IsTrue(!std::memcmp(&instance.pos_rot, &redrawn_instance.pos_rot, sizeof(instance.pos_rot)));
+
+                for (const drawn_glyph_t& glyph : glyphs)
+                {
+                    Assert::IsTrue(glyph.texture != redrawn_glyphs[i].texture);
+                }
+            }
+        }
+
+        TEST_METHOD(sprite_font_text_runs)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_sprite_font": { "res:type": "font", "data": "ref:test_font", "size": 12 }
+                }
+            )");
+
+            auto font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_sprite_font");
+            Assert::IsTrue(font && *font);
+
+            // Cached runs are laid out at a scale of one
+            const std::string_view text = "Score: 012345\nTime: 6789";
+            ff::point_float size = font->measure_text(text, ff::point_float(1, 1));
+            ff::point_float cached_size = font->measure_text(text, ff::point_float(1, 1));
+            ff::point_float scaled_size = font->measure_text(text, ff::point_float(2, 3));
+            ff::point_float draw_size = font->draw_text(nullptr, text, ff::transform(ff::point_float(10, 10), ff::point_float(2, 3)), ff::color_none());
+
+            Assert::IsTrue(size.x > 0 && size.y > 0);
+            Assert::IsTrue(size == cached_size);
+            Assert::AreEqual(size.x * 2, scaled_size.x, 0.001f);
+            Assert::AreEqual(size.y * 3, scaled_size.y, 0.001f);
+            Assert::IsTrue(scaled_size == draw_size);
+
+            // Control chars change colors, not positions
+            std::string control_text(text);
+            control_text.insert(0, ff::string::to_string(std::wstring{ static_cast<wchar_t>(ff::sprite_font_control::text_palette_color), L'\x1' }));
+            Assert::IsTrue(size == font->measure_text(control_text, ff::point_float(1, 1)));
+        }
+
+        TEST_METHOD(sprite_font_threads)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_lazy_font": { "res:type": "font", "data": "ref:test_font", "size": 12, "outline": 1, "lazy": true, "page_size": 64, "max_pages": 2 }
+                }
+            )");
+
+            auto font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_lazy_font");
+            Assert::IsTrue(font && *font);
+
+            // Each thread draws different text, so glyphs keep getting evicted and rasterized again while other threads draw
+            const std::array<std::string_view, 4> texts{ "ABCDEFGHIJKLM", "NOPQRSTUVWXYZ", "abcdefghijklm", "nopqrstuvwxyz" };
+            std::array<ff::point_float, 4> sizes;
+            for (size_t i = 0; i < texts.size(); i++)
+            {
+                sizes[i] = font->measure_text(texts[i], ff::point_float(1, 1));
+            }
+
+            ff::task_graph graph(texts.size());
+            for (size_t i = 0; i < texts.size(); i++)
+            {
+                graph.add_task([&font, &texts, &sizes, i]()
+                    {
+                        auto dd = ff::dxgi::create_recording_draw_device();
+                        auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(1024, 256), 1.0, DMDO_DEFAULT });
+
+                        for (size_t j = 0; j < 64; j++)
+                        {
+                            const size_t text_index = (i + j) % texts.size();
+                            const size_t next_text_index = (text_index + 1) % texts.size();
+
+                            // Every glyph and its outline must be drawn from a page that was current while drawing
+                            if (font_tests::draw_text_glyphs(*dd, *target, *font, texts[text_index]).size() != texts[text_index].size() * 2 ||
+                                !font_tests::valid_glyph_textures(*dd, 2) ||
+                                font->measure_text(texts[next_text_index], ff::point_float(1, 1)) != sizes[next_text_index])
+                            {
+                                return false;
+                            }
+                        }
+
+                        return true;
+                    });
+            }
+
+            Assert::IsTrue(graph.run());
+        }
+
+        TEST_METHOD(truetype_sprite_font_resource)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_sprite_font": { "res:type": "font", "data": "ref:test_font", "size": 12 },
+                    "test_truetype_font": { "res:type": "font", "data": "ref:test_font", "size": 12, "rasterizer": "truetype" }
+                }
+            )");
+
+            auto ttf = ff::get_resource<ff::font_file>(*std::get<0>(result), "test_font");
+            Assert::IsTrue(ttf && ttf->truetype());
+            Assert::AreEqual<size_t>(938, ttf->truetype().glyph_count());
+
+            ff::truetype_glyph_bitmap bitmap;
+            uint16_t glyph = ttf->truetype().glyph_index('A');
+            Assert::IsTrue(glyph != 0 && ttf->truetype().rasterize(glyph, 24, true, bitmap));
+            Assert::IsTrue(bitmap.size.x > 0 && bitmap.size.y > 0 && bitmap.coverage.size() == bitmap.size.x * bitmap.size.y);
+
+            auto font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_sprite_font");
+            auto truetype_font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_truetype_font");
+            Assert::IsTrue(font && *font && font->rasterizer() == ff::sprite_font_rasterizer::directwrite);
+            Assert::IsTrue(truetype_font && *truetype_font && truetype_font->rasterizer() == ff::sprite_font_rasterizer::truetype);
+            Assert::AreEqual(font->line_spacing(), truetype_font->line_spacing(), 0.001f);
+
+            const std::string_view text = "Hello, this is text.\r\nAnother line.";
+            ff::point_float size = font->measure_text(text, ff::point_float(1, 1));
+            ff::point_float truetype_size = truetype_font->measure_text(text, ff::point_float(1, 1));
+            Assert::AreEqual(size.y, truetype_size.y, 0.001f);
+            Assert::AreEqual(size.x, truetype_size.x, 1.0f);
+        }
+
+        TEST_METHOD(truetype_bold_italic)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_bold_font": { "res:type": "font_file", "file": "file:test_font.ttf", "bold": true },
+                    "test_italic_font": { "res:type": "font_file", "file": "file:test_font.ttf", "italic": true }
+                }
+            )");
+
+            auto ttf = ff::get_resource<ff::font_file>(*std::get<0>(result), "test_font");
+            auto bold_ttf = ff::get_resource<ff::font_file>(*std::get<0>(result), "test_bold_font");
+            auto italic_ttf = ff::get_resource<ff::font_file>(*std::get<0>(result), "test_italic_font");
+            Assert::IsTrue(ttf->truetype() && bold_ttf->truetype() && italic_ttf->truetype());
+
+            const uint16_t glyph = ttf->truetype().glyph_index('l');
+            ff::truetype_glyph_bitmap bitmap;
+            ff::truetype_glyph_bitmap bold_bitmap;
+            ff::truetype_glyph_bitmap italic_bitmap;
+            Assert::IsTrue(ttf->truetype().rasterize(glyph, 24, true, bitmap));
+            Assert::IsTrue(bold_ttf->truetype().rasterize(glyph, 24, true, bold_bitmap));
+            Assert::IsTrue(italic_ttf->truetype().rasterize(glyph, 24, true, italic_bitmap));
+
+            // Bold glyphs grow by 1/24 of an em, italic ones lean right
+            const int units_per_em = ttf->truetype().metrics().units_per_em;
+            Assert::AreEqual(ttf->truetype().glyph_metrics(glyph).advance_width + units_per_em / 24, bold_ttf->truetype().glyph_metrics(glyph).advance_width);
+            Assert::AreEqual(ttf->truetype().glyph_metrics(glyph).advance_width, italic_ttf->truetype().glyph_metrics(glyph).advance_width);
+            Assert::IsTrue(bold_bitmap.size.x > bitmap.size.x);
+            Assert::IsTrue(italic_bitmap.size.x > bitmap.size.x && italic_bitmap.size.y == bitmap.size.y);
+        }
+
+    private:
+        struct drawn_glyph_t
+        {
+            ff::dxgi::draw_util::sprite_instance instance;
+            ff::dxgi::texture_view_base* texture; // nullptr if the instance's texture index isn't valid for its draw call
+        };
+
+        // Draws text into an empty recording, then returns every sprite instance with the texture that it samples
+        static std::vector<drawn_glyph_t> draw_text_glyphs(ff::dxgi::recording_draw_device& dd, ff::dxgi::target_base& target, const ff::sprite_font& font, std::string_view text)
+        {
+            dd.clear();
+            {
+                ff::dxgi::draw_ptr draw = dd.begin_draw(dd.command_context(), target, nullptr);
+                font.draw_text(draw.get(), text, ff::transform::identity(), ff::color_black());
+            }
+
+            std::vector<drawn_glyph_t> glyphs;
+            for (const ff::dxgi::recording_draw_device::draw_call_t& draw_call : dd.draw_calls())
+            {
+                std::span<ff::dxgi::texture_view_base* const> textures = dd.textures(draw_call);
+                for (const ff::dxgi::draw_util::sprite_instance& instance : dd.instances<ff::dxgi::draw_util::sprite_instance>(draw_call))
+                {
+                    const size_t texture_index = instance.indexes & 0xFF;
+                    glyphs.push_back(drawn_glyph_t{ instance, (texture_index < textures.size()) ? textures[texture_index] : nullptr });
+                }
+            }
+
+            return glyphs;
+        }
+
+        // Checks that every sprite in the last recording samples a real texture, and that each draw call used no more than max_pages textures
+        static bool valid_glyph_textures(const ff::dxgi::recording_draw_device& dd, size_t max_pages)
+        {
+            for (const ff::dxgi::recording_draw_device::draw_call_t& draw_call : dd.draw_calls())
+            {
+                std::span<ff::dxgi::texture_view_base* const> textures = dd.textures(draw_call);
+                if (draw_call.instance_type != ff::dxgi::draw_util::instance_bucket_type::sprites_out_transparent ||
+                    textures.empty() || textures.size() > max_pages ||
+                    std::find(textures.begin(), textures.end(), nullptr) != textures.end())
+                {
+                    return false;
+                }
+
+                for (const ff::dxgi::draw_util::sprite_instance& instance : dd.instances<ff::dxgi::draw_util::sprite_instance>(draw_call))
+                {
+                    if ((instance.indexes & 0xFF) >= textures.size())
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return !dd.draw_calls().empty();
+        }
     };
 }
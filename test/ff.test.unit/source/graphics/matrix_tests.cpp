@@ -0,0 +1,168 @@
+#include "pch.h"
+
+namespace ff::test::graphics
+{
+    TEST_CLASS(matrix_tests)
+    {
+    public:
+        TEST_METHOD(matrix_id_push_pop)
+        {
+            ff::matrix_stack stack;
+            const size_t base_id = stack.matrix_id();
+
+            // Pushing keeps the current matrix, so it keeps the ID too
+            stack.push();
+            Assert::AreEqual(base_id, stack.matrix_id());
+
+            stack.transform(this->translate_matrix(8, 0));
+            const size_t transform_id = stack.matrix_id();
+            Assert::AreNotEqual(base_id, transform_id);
+
+            stack.push();
+            Assert::AreEqual(transform_id, stack.matrix_id());
+
+            stack.set(this->translate_matrix(0, 8));
+            const size_t set_id = stack.matrix_id();
+            Assert::AreNotEqual(base_id, set_id);
+            Assert::AreNotEqual(transform_id, set_id);
+
+            // Popping restores the parent's ID
+            stack.pop();
+            Assert::AreEqual(transform_id, stack.matrix_id());
+            Assert::IsTrue(this->same_matrix(this->translate_matrix(8, 0), stack.matrix()));
+
+            stack.pop();
+            Assert::AreEqual(base_id, stack.matrix_id());
+            Assert::IsTrue(this->same_matrix(ff::matrix_identity_4x4(), stack.matrix()));
+
+            // The same change as before still gets a new ID, IDs are never reused
+            stack.push();
+            stack.transform(this->translate_matrix(8, 0));
+            Assert::AreNotEqual(base_id, stack.matrix_id());
+            Assert::AreNotEqual(transform_id, stack.matrix_id());
+            Assert::AreNotEqual(set_id, stack.matrix_id());
+            stack.pop();
+        }
+
+        TEST_METHOD(matrix_id_no_change)
+        {
+            ff::matrix_stack stack;
+            const size_t base_id = stack.matrix_id();
+
+            // Changes that leave the matrix alone don't issue a new ID
+            stack.set(ff::matrix_identity_4x4());
+            Assert::AreEqual(base_id, stack.matrix_id());
+
+            stack.transform(ff::matrix_identity_4x4());
+            Assert::AreEqual(base_id, stack.matrix_id());
+
+            // Transforming the bottom of the stack pushes first, so the bottom keeps its ID
+            stack.transform(this->translate_matrix(8, 0));
+            const size_t transform_id = stack.matrix_id();
+            Assert::AreNotEqual(base_id, transform_id);
+
+            stack.set(this->translate_matrix(8, 0));
+            Assert::AreEqual(transform_id, stack.matrix_id());
+
+            stack.pop();
+            Assert::AreEqual(base_id, stack.matrix_id());
+        }
+
+        TEST_METHOD(matrix_id_reset)
+        {
+            ff::matrix_stack stack;
+            const size_t base_id = stack.matrix_id();
+
+            stack.push();
+            stack.transform(this->translate_matrix(8, 0));
+            const size_t transform_id = stack.matrix_id();
+
+            stack.reset();
+            Assert::AreEqual(base_id, stack.matrix_id());
+            Assert::IsTrue(this->same_matrix(ff::matrix_identity_4x4(), stack.matrix()));
+
+            // Resetting to the matrix that's already at the bottom keeps its ID
+            stack.reset(&ff::matrix_identity_4x4());
+            Assert::AreEqual(base_id, stack.matrix_id());
+
+            // A different default matrix gets a new ID, but only the first time
+            const DirectX::XMFLOAT4X4 default_matrix = this->translate_matrix(0, 8);
+            stack.reset(&default_matrix);
+            const size_t default_id = stack.matrix_id();
+            Assert::AreNotEqual(base_id, default_id);
+            Assert::AreNotEqual(transform_id, default_id);
+            Assert::IsTrue(this->same_matrix(default_matrix, stack.matrix()));
+
+            stack.push();
+            stack.transform(this->translate_matrix(8, 0));
+            stack.reset(&default_matrix);
+            Assert::AreEqual(default_id, stack.matrix_id());
+            Assert::IsTrue(this->same_matrix(default_matrix, stack.matrix()));
+
+            // Without a default matrix, the bottom of the stack stays the same
+            stack.reset();
+            Assert::AreEqual(default_id, stack.matrix_id());
+            Assert::IsTrue(this->same_matrix(default_matrix, stack.matrix()));
+        }
+
+        TEST_METHOD(world_matrix_indexes)
+        {
+            auto dd = ff::dxgi::create_recording_draw_device();
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+            auto texture = ff::dxgi::create_recording_texture(ff::point_size(4, 4), DXGI_FORMAT_R8G8B8A8_UNORM, ff::dxgi::sprite_type::opaque);
+            ff::dxgi::sprite_data sprite(texture.get(), ff::rect_float(0, 0, 4, 4), ff::point_float(0, 0), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+            const DirectX::XMFLOAT4X4 translate_matrix = this->translate_matrix(8, 0);
+
+            {
+                ff::dxgi::draw_ptr draw = dd->begin_draw(dd->command_context(), *target, nullptr);
+                ff::matrix_stack& stack = draw->world_matrix_stack();
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(0, 0)));
+
+                stack.push();
+                stack.transform(translate_matrix);
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(4, 0)));
+                stack.pop();
+
+                // Same ID as the first sprite
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(8, 0)));
+
+                // Pushing the same matrix again doesn't change the ID
+                stack.push();
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(12, 0)));
+
+                // New ID for a matrix that was already used, which still finds the same index
+                stack.transform(translate_matrix);
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(16, 0)));
+                stack.pop();
+
+                draw->draw_sprite(sprite, ff::transform(ff::point_float(20, 0)));
+            }
+
+            Assert::AreEqual<size_t>(1, dd->batch_count());
+            Assert::AreEqual<size_t>(1, dd->draw_calls().size());
+
+            auto sprites = dd->instances<ff::dxgi::draw_util::sprite_instance>(dd->draw_calls()[0]);
+            const std::array<uint32_t, 6> expect_indexes{ 0, 1, 0, 0, 1, 0 };
+            Assert::AreEqual(expect_indexes.size(), sprites.size());
+
+            for (size_t i = 0; i < sprites.size(); i++)
+            {
+                Assert::AreEqual(static_cast<float>(i * 4), sprites[i].pos_rot.x);
+                Assert::AreEqual(expect_indexes[i], sprites[i].indexes >> 24);
+            }
+        }
+
+    private:
+        DirectX::XMFLOAT4X4 translate_matrix(float x, float y)
+        {
+            DirectX::XMFLOAT4X4 matrix;
+            DirectX::XMStoreFloat4x4(&matrix, DirectX::XMMatrixTranslation(x, y, 0));
+            return matrix;
+        }
+
+        bool same_matrix(const DirectX::XMFLOAT4X4& lhs, const DirectX::XMFLOAT4X4& rhs)
+        {
+            return !std::memcmp(&lhs, &rhs, sizeof(lhs));
+        }
+    };
+}
@@ -0,0 +1,173 @@
+#include "pch.h"
+
+namespace ff::test::graphics
+{
+    TEST_CLASS(recording_draw_tests)
+    {
+    public:
+        TEST_METHOD(batch_sprites)
+        {
+            auto dd = ff::dxgi::create_recording_draw_device();
+            Assert::IsTrue(dd->valid());
+
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+            auto texture = ff::dxgi::create_recording_texture(ff::point_size(16, 16), DXGI_FORMAT_R8G8B8A8_UNORM, ff::dxgi::sprite_type::opaque);
+            ff::dxgi::sprite_data sprite(texture.get(), ff::rect_float(0, 0, 16, 16), ff::point_float(0, 0), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+
+            {
+                ff::dxgi::draw_ptr draw = dd->begin_draw(dd->command_context(), *target, nullptr);
+                Assert::IsTrue(draw.operator bool());
+
+                for (int i = 0; i < 3; i++)
+                {
+                    draw->draw_sprite(sprite, ff::transform(ff::point_float(i * 16.0f, 0)));
+                }
+
+                draw->draw_rectangle(ff::rect_float(0, 0, 32, 32), ff::color(1.0f, 1.0f, 1.0f, 0.5f));
+            }
+
+            // Opaque sprites share one draw, then the transparent rectangle is drawn on top
+            const auto& draw_calls = dd->draw_calls();
+            Assert::AreEqual<size_t>(1, dd->batch_count());
+            Assert::AreEqual<size_t>(2, draw_calls.size());
+            Assert::IsTrue(draw_calls[0].instance_type == ff::dxgi::draw_util::instance_bucket_type::sprites);
+            Assert::AreEqual<size_t>(3, draw_calls[0].instance_count);
+            Assert::AreEqual<size_t>(1, draw_calls[0].texture_count);
+            Assert::IsTrue(draw_calls[1].instance_type == ff::dxgi::draw_util::instance_bucket_type::rectangles_filled_out_transparent);
+            Assert::AreEqual<size_t>(1, draw_calls[1].instance_count);
+
+            auto sprites = dd->instances<ff::dxgi::draw_util::sprite_instance>(draw_calls[0]);
+            auto rectangles = dd->instances<ff::dxgi::draw_util::rectangle_instance>(draw_calls[1]);
+            Assert::AreEqual<size_t>(3, sprites.size());
+            Assert::AreEqual<size_t>(1, rectangles.size());
+            Assert::IsTrue(rectangles[0].depth > sprites[2].pos_rot.z);
+        }
+
+        TEST_METHOD(defer_opaque_sprites)
+        {
+            // With depth, opaque sprites that don't fit into the texture slots get deferred to a second batch,
+            // so the later sprite that reuses the first texture still joins the first batch
+            auto dd = ff::dxgi::create_recording_draw_device();
+            auto depth = ff::dxgi::create_recording_depth(ff::point_size(64, 64));
+            std::vector<ff::dxgi::draw_util::sprite_instance> sprites = this->draw_too_many_textures(*dd, depth.get());
+
+            Assert::AreEqual<size_t>(2, dd->batch_count());
+            Assert::AreEqual<size_t>(ff::dxgi::draw_util::MAX_TEXTURES + 1, dd->draw_calls()[0].instance_count);
+            Assert::AreEqual<size_t>(ff::dxgi::draw_util::MAX_TEXTURES + 9, sprites.size());
+            Assert::IsTrue(sprites[ff::dxgi::draw_util::MAX_TEXTURES].pos_rot.z > sprites.back().pos_rot.z);
+
+            dd->clear();
+            Assert::IsTrue(dd->draw_calls().empty());
+            Assert::IsTrue(dd->instance_data().empty());
+        }
+
+        TEST_METHOD(no_depth_keeps_sprite_order)
+        {
+            // Without depth, draw order is the only ordering, so nothing can be deferred
+            auto dd = ff::dxgi::create_recording_draw_device();
+            std::vector<ff::dxgi::draw_util::sprite_instance> sprites = this->draw_too_many_textures(*dd, nullptr);
+
+            Assert::AreEqual<size_t>(2, dd->batch_count());
+            Assert::AreEqual<size_t>(ff::dxgi::draw_util::MAX_TEXTURES, dd->draw_calls()[0].instance_count);
+            Assert::AreEqual<size_t>(ff::dxgi::draw_util::MAX_TEXTURES + 9, sprites.size());
+
+            for (size_t i = 1; i < sprites.size(); i++)
+            {
+                Assert::IsTrue(sprites[i].pos_rot.z > sprites[i - 1].pos_rot.z);
+            }
+        }
+
+        TEST_METHOD(instance_buffer_chunks)
+        {
+            // Every batch needs more than two of the smallest instance chunks. Without buffer chunks, instances are copied with map().
+            // With small buffer chunks, the first batch mixes buffer chunks with a CPU chunk. The next batch needs one chunk that's
+            // too big for the buffer, so it uses map(), and the last batch reuses that CPU chunk.
+            constexpr size_t batch_count = 3;
+            constexpr size_t sprite_count = ff::dxgi::draw_util::MIN_INSTANCE_BUCKET_COUNT * 4 + 44;
+            constexpr size_t small_chunk_size = sizeof(ff::dxgi::draw_util::sprite_instance) * ff::dxgi::draw_util::MIN_INSTANCE_BUCKET_COUNT * 2;
+
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+            auto texture = ff::dxgi::create_recording_texture(ff::point_size(1, 1), DXGI_FORMAT_R8G8B8A8_UNORM, ff::dxgi::sprite_type::opaque);
+            ff::dxgi::sprite_data sprite(texture.get(), ff::rect_float(0, 0, 1, 1), ff::point_float(0, 0), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+
+            for (size_t max_chunk_size : { size_t(0), small_chunk_size })
+            {
+                auto dd = ff::dxgi::create_recording_draw_device();
+                dd->max_instance_chunk_size(max_chunk_size);
+
+                for (size_t batch = 0; batch < batch_count; batch++)
+                {
+                    ff::dxgi::draw_ptr draw = dd->begin_draw(dd->command_context(), *target, nullptr);
+                    for (size_t i = 0; i < sprite_count; i++)
+                    {
+                        draw->draw_sprite(sprite, this->chunk_test_transform(batch, i));
+                    }
+                }
+
+                const auto& draw_calls = dd->draw_calls();
+                Assert::AreEqual(batch_count, dd->batch_count());
+                Assert::AreEqual(batch_count, draw_calls.size());
+                Assert::AreEqual<size_t>(max_chunk_size ? 3 : 0, dd->instance_chunk_count());
+
+                for (size_t batch = 0; batch < batch_count; batch++)
+                {
+                    auto sprites = dd->instances<ff::dxgi::draw_util::sprite_instance>(draw_calls[batch]);
+                    Assert::AreEqual(batch, draw_calls[batch].batch);
+                    Assert::AreEqual(sprite_count, sprites.size());
+
+                    for (size_t i = 0; i < sprites.size(); i++)
+                    {
+                        const ff::transform transform = this->chunk_test_transform(batch, i);
+                        const DirectX::XMFLOAT4 color = transform.color.to_shader_color();
+                        Assert::AreEqual(transform.position.x, sprites[i].pos_rot.x);
+                        Assert::AreEqual(transform.position.y, sprites[i].pos_rot.y);
+                        Assert::IsTrue(!std::memcmp(&color, &sprites[i].color, sizeof(color)));
+                    }
+                }
+            }
+        }
+
+    private:
+        // A different position and color for every sprite in the instance chunk test
+        ff::transform chunk_test_transform(size_t batch, size_t index)
+        {
+            const ff::point_float position(static_cast<float>(index % 32), static_cast<float>(batch * 10 + index / 32));
+            const ff::color color(static_cast<float>(index % 256) / 255.0f, static_cast<float>(index / 256) / 255.0f, static_cast<float>(batch) / 255.0f, 1.0f);
+            return ff::transform(position, ff::point_float(1, 1), 0.0f, color);
+        }
+
+        // Draws one sprite for each of 8 more textures than there are slots, then one more with the first texture.
+        // Returns the sprite instances in the order they were drawn by the GPU.
+        std::vector<ff::dxgi::draw_util::sprite_instance> draw_too_many_textures(ff::dxgi::recording_draw_device& dd, ff::dxgi::depth_base* depth)
+        {
+            constexpr size_t texture_count = ff::dxgi::draw_util::MAX_TEXTURES + 8;
+            std::vector<std::shared_ptr<ff::dxgi::texture_base>> textures;
+            std::vector<ff::dxgi::sprite_data> sprites;
+
+            for (size_t i = 0; i < texture_count; i++)
+            {
+                textures.push_back(ff::dxgi::create_recording_texture(ff::point_size(4, 4), DXGI_FORMAT_R8G8B8A8_UNORM, ff::dxgi::sprite_type::opaque));
+                sprites.emplace_back(textures[i].get(), ff::rect_float(0, 0, 4, 4), ff::point_float(0, 0), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+            }
+
+            auto target = ff::dxgi::create_recording_target(ff::window_size{ ff::point_size(64, 64), 1.0, DMDO_DEFAULT });
+            {
+                ff::dxgi::draw_ptr draw = dd.begin_draw(dd.command_context(), *target, depth);
+                for (size_t i = 0; i <= texture_count; i++)
+                {
+                    draw->draw_sprite(sprites[i % texture_count], ff::transform(ff::point_float(static_cast<float>(i % 16) * 4.0f, static_cast<float>(i / 16) * 4.0f)));
+                }
+            }
+
+            std::vector<ff::dxgi::draw_util::sprite_instance> instances;
+            for (const auto& draw_call : dd.draw_calls())
+            {
+                Assert::IsTrue(draw_call.instance_type == ff::dxgi::draw_util::instance_bucket_type::sprites);
+                auto span = dd.instances<ff::dxgi::draw_util::sprite_instance>(draw_call);
+                instances.insert(instances.end(), span.begin(), span.end());
+            }
+
+            return instances;
+        }
+    };
+}
@@ -24,5 +24,114 @@ namespace ff::test::graphics
             Assert::IsTrue(sprites->size() == 5);
             Assert::IsNotNull(sprites->get(0)->sprite_data().view());
         }
+
+        TEST_METHOD(optimize_sprites)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_sprites": { "res:type": "sprites", "optimize": false,
+                        "sprites": {
+                            "one": { "file": "file:test_texture.png", "pos": [ 0, 0 ], "size": [ 16, 16 ], "offset": [ 16, 0 ], "repeat": 2 },
+                            "two": { "file": "file:test_texture.png", "pos": [ 0, 16 ], "size": [ 16, 16 ], "offset": [ 16, 0 ], "repeat": 2 },
+                            "three": { "file": "file:test_texture.png", "pos": [ 0, 0 ], "size": [ 16, 16 ] }
+                        }
+                    }
+                }
+            )");
+
+            auto sprite_list = ff::get_resource<ff::sprite_list>(*std::get<0>(result), "test_sprites");
+            std::vector<ff::sprite> sprites;
+            for (size_t i = 0; i < sprite_list->size(); i++)
+            {
+                sprites.push_back(*sprite_list->get(i));
+            }
+
+            ff::internal::optimize_sprites_stats stats{};
+            std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1024, &stats);
+            Assert::AreEqual<size_t>(5, new_sprites.size());
+            Assert::AreEqual<size_t>(1, stats.texture_count);
+            Assert::AreEqual<size_t>(128 * 128, stats.texture_area);
+            Assert::AreEqual<size_t>(4 * 20 * 20, stats.sprite_area); // the duplicate sprite isn't counted
+            Assert::AreEqual(4.0 * 20 * 20 / (128 * 128), stats.efficiency(), 0.0001);
+
+            // Only the left column of the texture is transparent, and one transparent pixel is kept, so nothing gets trimmed
+            for (size_t i = 0; i < sprites.size(); i++)
+            {
+                Assert::IsTrue(new_sprites[i].sprite_data().world() == sprites[i].sprite_data().world());
+                Assert::IsTrue(new_sprites[i].sprite_data().handle() == sprites[i].sprite_data().handle());
+            }
+
+            const ff::sprite* three = nullptr;
+            const ff::sprite* one = nullptr;
+            for (const ff::sprite& sprite : new_sprites)
+            {
+                three = (sprite.name() == "three") ? &sprite : three;
+                one = (sprite.name() == "one[0]") ? &sprite : one;
+            }
+
+            Assert::IsTrue(one && three && one->sprite_data().texture_uv() == three->sprite_data().texture_uv());
+        }
+
+        TEST_METHOD(optimize_sprites_trim)
+        {
+            // The same 6x3 block of pixels in two different textures
+            std::shared_ptr<ff::texture> texture1 = sprite_tests::create_block_texture(ff::point_int(4, 6));
+            std::shared_ptr<ff::texture> texture2 = sprite_tests::create_block_texture(ff::point_int(20, 18));
+
+            std::vector<ff::sprite> sprites;
+            sprites.emplace_back("one", texture1, ff::rect_float(0, 0, 16, 16), ff::point_float(8, 8), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+            sprites.emplace_back("two", texture2, ff::rect_float(16, 12, 32, 28), ff::point_float(8, 8), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+
+            ff::internal::optimize_sprites_stats stats{};
+            std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1024, &stats);
+            Assert::AreEqual<size_t>(2, new_sprites.size());
+            Assert::AreEqual<size_t>(1, stats.texture_count);
+            Assert::AreEqual<size_t>(12 * 9, stats.sprite_area); // 8x5 after trimming, plus borders, and only stored once
+
+            for (const ff::sprite& sprite : new_sprites)
+            {
+                // The block plus one transparent pixel around it, and the handle moves with the trimmed top left
+                Assert::IsTrue(sprite.sprite_data().texture_rect().size() == ff::point_float(8, 5));
+                Assert::IsTrue(sprite.sprite_data().world() == ff::rect_float(-5, -3, 3, 2));
+                Assert::IsTrue(sprite.sprite_data().handle() == ff::point_float(5, 3));
+            }
+
+            Assert::IsTrue(new_sprites[0].texture() == new_sprites[1].texture());
+            Assert::IsTrue(new_sprites[0].sprite_data().texture_uv() == new_sprites[1].sprite_data().texture_uv());
+
+            // Without trimming, the whole rects are still identical and shared
+            new_sprites = ff::internal::optimize_sprites(sprites, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1024, &stats, false);
+            Assert::AreEqual<size_t>(2, new_sprites.size());
+            Assert::AreEqual<size_t>(20 * 20, stats.sprite_area);
+
+            for (const ff::sprite& sprite : new_sprites)
+            {
+                Assert::IsTrue(sprite.sprite_data().world() == ff::rect_float(-8, -8, 8, 8));
+                Assert::IsTrue(sprite.sprite_data().handle() == ff::point_float(8, 8));
+            }
+
+            Assert::IsTrue(new_sprites[0].sprite_data().texture_uv() == new_sprites[1].sprite_data().texture_uv());
+        }
+
+    private:
+        // Transparent 32x32 texture with an opaque 6x3 block of different colors at block_pos
+        static std::shared_ptr<ff::texture> create_block_texture(ff::point_int block_pos)
+        {
+            auto scratch = std::make_shared<DirectX::ScratchImage>();
+            Assert::IsTrue(SUCCEEDED(scratch->Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 32, 32, 1, 1)));
+            std::memset(scratch->GetPixels(), 0, scratch->GetPixelsSize());
+
+            const DirectX::Image& image = *scratch->GetImages();
+            for (int y = 0; y < 3; y++)
+            {
+                uint32_t* row = reinterpret_cast<uint32_t*>(image.pixels + image.rowPitch * (block_pos.y + y)) + block_pos.x;
+                for (int x = 0; x < 6; x++)
+                {
+                    row[x] = 0xFF000000 | static_cast<uint32_t>(x * 32 + y * 8);
+                }
+            }
+
+            return std::make_shared<ff::texture>(ff::dxgi::create_static_texture(scratch));
+        }
     };
 }
@@ -34,5 +34,39 @@ namespace ff::test::graphics
             Assert::IsTrue(converted_texture.dxgi_texture()->size() == texture.dxgi_texture()->size());
             Assert::IsTrue(converted_texture.dxgi_texture()->mip_count() == 2);
         }
+
+        TEST_METHOD(load_texture_data_batch)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_texture": { "res:type": "texture", "file": "file:test_texture.png" }
+                }
+            )");
+
+            auto& temp_path = std::get<1>(result);
+            std::vector<std::filesystem::path> files{ temp_path / "test_texture.png", temp_path / "test_texture.png", temp_path / "test_texture.png" };
+
+            // BGRA is swizzled by libpng while decoding
+            ff::internal::load_texture_data_stats stats{};
+            std::vector<ff::internal::texture_data> datas = ff::internal::load_texture_data(files, DXGI_FORMAT_B8G8R8A8_UNORM, 1, &stats);
+            std::vector<ff::internal::texture_data> rgba_datas = ff::internal::load_texture_data(files, DXGI_FORMAT_R8G8B8A8_UNORM, 1);
+            Assert::AreEqual<size_t>(3, datas.size());
+            Assert::AreEqual<size_t>(3, stats.texture_count);
+            Assert::AreEqual<size_t>(3 * 256 * 256, stats.pixel_count);
+            Assert::IsTrue(stats.file_bytes > 0 && stats.megapixels_per_second() > 0);
+
+            for (size_t i = 0; i < datas.size(); i++)
+            {
+                Assert::IsTrue(datas[i].data && datas[i].data->GetMetadata().format == DXGI_FORMAT_B8G8R8A8_UNORM);
+                Assert::IsTrue(rgba_datas[i].data && rgba_datas[i].data->GetMetadata().format == DXGI_FORMAT_R8G8B8A8_UNORM);
+
+                const uint8_t* bgra = datas[i].data->GetPixels();
+                const uint8_t* rgba = rgba_datas[i].data->GetPixels();
+                for (size_t h = 0; h < datas[i].data->GetPixelsSize(); h += 4)
+                {
+                    Assert::IsTrue(bgra[h] == rgba[h + 2] && bgra[h + 1] == rgba[h + 1] && bgra[h + 2] == rgba[h] && bgra[h + 3] == rgba[h + 3]);
+                }
+            }
+        }
     };
 }
@@ -64,5 +64,209 @@ namespace ff::test::resource
             Assert::IsTrue(data1->size() == test_string1.size() + 3 && !std::memcmp(data1->data() + 3, test_string1.data(), test_string1.size()));
             Assert::IsTrue(data2->size() == test_string2.size() + 3 && !std::memcmp(data2->data() + 3, test_string2.data(), test_string2.size()));
         }
+
+        TEST_METHOD(build_cache)
+        {
+            std::filesystem::path temp_path = ff::filesystem::temp_directory_path() / "resource_build_cache_test";
+            ff::scope_exit cleanup([&temp_path]()
+                {
+                    ff::filesystem::remove_all(temp_path);
+                });
+
+            std::filesystem::path source_path = temp_path / "res.json";
+            std::filesystem::path cache_path = temp_path / "cache";
+            std::string json_source =
+                "{\n"
+                "    'test_file1': { 'res:type': 'file', 'file': 'file:test1.txt' },\n"
+                "    'test_file2': { 'res:type': 'file', 'file': 'file:test2.txt' }\n"
+                "}\n";
+            std::replace(json_source.begin(), json_source.end(), '\'', '\"');
+
+            ff::filesystem::write_text_file(temp_path / "test1.txt", "test1");
+            ff::filesystem::write_text_file(temp_path / "test2.txt", "test2");
+            ff::filesystem::write_text_file(source_path, json_source);
+
+            {
+                ff::resource_build_cache cache(cache_path);
+                ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::none, false, &cache);
+                Assert::IsNotNull(result.resources.get());
+                Assert::AreEqual<size_t>(0, cache.hit_count());
+                Assert::AreEqual<size_t>(2, cache.miss_count());
+            }
+
+            {
+                ff::resource_build_cache cache(cache_path);
+                ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::none, false, &cache);
+                Assert::IsNotNull(result.resources.get());
+                Assert::AreEqual<size_t>(2, cache.hit_count());
+                Assert::AreEqual<size_t>(0, cache.miss_count());
+            }
+
+            ff::filesystem::write_text_file(temp_path / "test2.txt", "test2 changed");
+
+            {
+                ff::resource_build_cache cache(cache_path);
+                ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::none, false, &cache);
+                Assert::IsNotNull(result.resources.get());
+                Assert::AreEqual<size_t>(1, cache.hit_count());
+                Assert::AreEqual<size_t>(1, cache.miss_count());
+
+                ff::auto_resource<ff::resource_file> res_file1 = result.resources->get_resource_object("test_file1");
+                ff::auto_resource<ff::resource_file> res_file2 = result.resources->get_resource_object("test_file2");
+                std::shared_ptr<ff::data_base> data1 = res_file1->saved_data()->loaded_data();
+                std::shared_ptr<ff::data_base> data2 = res_file2->saved_data()->loaded_data();
+                Assert::IsTrue(data1->size() == 8 && !std::memcmp(data1->data() + 3, "test1", 5));
+                Assert::IsTrue(data2->size() == 16 && !std::memcmp(data2->data() + 3, "test2 changed", 13));
+            }
+
+            {
+                // A different tool version doesn't share entries
+                ff::resource_build_cache cache(cache_path);
+                cache.add_tool_version("types.dll:2");
+                ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::none, false, &cache);
+                Assert::IsNotNull(result.resources.get());
+                Assert::AreEqual<size_t>(0, cache.hit_count());
+                Assert::AreEqual<size_t>(2, cache.miss_count());
+            }
+        }
+
+        TEST_METHOD(mapped_pack)
+        {
+            std::string json_source =
+                "{\n"
+                "    'value1': 'one',\n"
+                "    'value2': [ 'two', 2 ],\n"
+                "    'value3': { 'three': 3 }\n"
+                "}\n";
+            std::replace(json_source.begin(), json_source.end(), '\'', '\"');
+
+            ff::load_resources_result result = ff::load_resources_from_json(json_source, "", false);
+            Assert::IsNotNull(result.resources.get());
+
+            auto data_vector = std::make_shared<std::vector<uint8_t>>();
+            {
+                ff::data_writer writer(data_vector);
+                Assert::IsTrue(result.resources->save(writer));
+            }
+
+            // Used in place, nothing is indexed until it's requested
+            auto data = std::make_shared<ff::data_vector>(data_vector);
+            ff::resource_objects mapped_resources;
+            Assert::IsTrue(mapped_resources.add_resources(data));
+            Assert::AreEqual<size_t>(3, mapped_resources.resource_object_names().size());
+
+            ff::auto_resource_value value1 = mapped_resources.get_resource_object("value1");
+            ff::auto_resource_value value3 = mapped_resources.get_resource_object("value3");
+            ff::auto_resource_value missing = mapped_resources.get_resource_object("value4");
+            Assert::AreEqual(std::string("one"), value1->value()->get<std::string>());
+            Assert::AreEqual(3, value3->value()->get<ff::dict>().get<int>("three"));
+            Assert::IsTrue(missing->value()->is_type<nullptr_t>());
+            Assert::AreEqual<size_t>(3, mapped_resources.resource_object_names().size());
+
+            // The same pack read through a stream
+            ff::data_reader reader(data);
+            ff::resource_objects read_resources(reader);
+            Assert::AreEqual<size_t>(3, read_resources.resource_object_names().size());
+
+            ff::auto_resource_value value2 = read_resources.get_resource_object("value2");
+            Assert::AreEqual<size_t>(2, value2->value()->get<ff::value_vector>().size());
+
+            // Saving a mapped pack includes resources that were never requested
+            ff::dict dict;
+            Assert::IsTrue(mapped_resources.save(dict));
+            Assert::IsNotNull(dict.get("value2").get());
+        }
+
+        TEST_METHOD(load_trace)
+        {
+            std::string json_source =
+                "{\n"
+                "    'value1': 'one',\n"
+                "    'value2': { 'child': 'ref:value1' }\n"
+                "}\n";
+            std::replace(json_source.begin(), json_source.end(), '\'', '\"');
+
+            ff::load_resources_result result = ff::load_resources_from_json(json_source, "", false);
+            Assert::IsNotNull(result.resources.get());
+
+            auto trace = std::make_shared<ff::resource_load_trace>();
+            result.resources->load_trace(trace);
+            {
+                ff::auto_resource_value value2 = result.resources->get_resource_object("value2");
+                result.resources->flush_all_resources();
+            }
+
+            std::vector<ff::resource_load_trace::event_t> events = trace->events();
+            for (const char* name : { "value1", "value2" })
+            {
+                for (ff::resource_load_trace::event_type type : { ff::resource_load_trace::event_type::queued, ff::resource_load_trace::event_type::finalized })
+                {
+                    Assert::IsTrue(std::any_of(events.cbegin(), events.cend(), [name, type](const ff::resource_load_trace::event_t& event)
+                        {
+                            return event.name == name && event.type == type;
+                        }));
+                }
+            }
+
+            ff::resource_load_trace::critical_path_t path = trace->critical_path();
+            Assert::IsFalse(path.names.empty());
+            Assert::AreEqual(std::string("value2"), path.names.back());
+
+            std::ostringstream output;
+            trace->write_chrome_trace(output);
+
+            ff::dict trace_dict;
+            Assert::IsTrue(ff::json_parse(output.str(), trace_dict));
+            Assert::IsFalse(trace_dict.get<ff::value_vector>("traceEvents").empty());
+        }
+
+        TEST_METHOD(prefetch_manifest)
+        {
+            std::filesystem::path temp_path = ff::filesystem::temp_directory_path() / "resource_prefetch_test";
+            ff::scope_exit cleanup([&temp_path]()
+                {
+                    ff::filesystem::remove_all(temp_path);
+                });
+
+            std::string json_source =
+                "{\n"
+                "    'value1': 'one',\n"
+                "    'value2': 'two',\n"
+                "    'value3': 'three'\n"
+                "}\n";
+            std::replace(json_source.begin(), json_source.end(), '\'', '\"');
+
+            ff::load_resources_result result = ff::load_resources_from_json(json_source, "", false);
+            Assert::IsNotNull(result.resources.get());
+            Assert::IsTrue(result.errors.empty());
+
+            result.resources->start_prefetch_recording();
+            Assert::IsTrue(result.resources->is_prefetch_recording());
+            {
+                ff::auto_resource_value value3 = result.resources->get_resource_object("value3");
+                ff::auto_resource_value value1 = result.resources->get_resource_object("value1");
+                ff::auto_resource_value value3_again = result.resources->get_resource_object("value3");
+                result.resources->flush_all_resources();
+            }
+
+            ff::resource_prefetch_manifest manifest = result.resources->stop_prefetch_recording();
+            Assert::IsFalse(result.resources->is_prefetch_recording());
+            Assert::AreEqual<size_t>(2, manifest.size());
+            Assert::AreEqual(std::string("value3"), manifest.entries()[0].name);
+            Assert::AreEqual(std::string("value1"), manifest.entries()[1].name);
+
+            std::filesystem::path manifest_path = ff::resource_prefetch_manifest::path_for_pack(temp_path / "test.res.pack");
+            Assert::IsTrue(manifest.save(manifest_path));
+
+            ff::resource_prefetch_manifest loaded_manifest;
+            Assert::IsTrue(loaded_manifest.load(manifest_path));
+            Assert::AreEqual<size_t>(2, loaded_manifest.size());
+            Assert::AreEqual(std::string("value3"), loaded_manifest.entries()[0].name);
+
+            std::vector<std::shared_ptr<ff::resource>> prefetched = result.resources->prefetch_async(manifest_path).result();
+            Assert::AreEqual<size_t>(2, prefetched.size());
+            Assert::AreEqual(std::string("three"), prefetched[0]->value()->get<std::string>());
+            Assert::AreEqual(std::string("one"), prefetched[1]->value()->get<std::string>());
+        }
     };
 }